@@ -8,6 +8,11 @@ if %ERRORLEVEL% EQU 0 (
 	xcopy "..\..\data\shaders\base\*.spv" "assets\shaders\base" /Y
 	
 
+	rem The .spv files of shaders the desktop compiles at runtime may be out of date
+	pushd "..\..\data\shaders\deferred"
+	call generate-spirv.bat
+	popd
+
 	mkdir "assets\shaders\deferred"
 	xcopy "..\..\data\shaders\deferred\*.spv" "assets\shaders\deferred" /Y
 
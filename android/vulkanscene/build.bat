@@ -8,6 +8,11 @@ if %ERRORLEVEL% EQU 0 (
 	xcopy "..\..\data\shaders\base\*.spv" "assets\shaders\base" /Y
 	
 
+	rem The .spv files of shaders the desktop compiles at runtime may be out of date
+	pushd "..\..\data\shaders\vulkanscene"
+	call generate-spriv.bat
+	popd
+
 	mkdir "assets\shaders\vulkanscene"
 	xcopy "..\..\data\shaders\vulkanscene\*.spv" "assets\shaders\vulkanscene" /Y
 
@@ -0,0 +1,290 @@
+/*
+* Bounding volume hierarchy for triangle meshes
+*
+* This code is licensed under the MIT license (MIT) (http://opensource.org/licenses/MIT)
+*/
+
+#include "bvh.h"
+
+#include <algorithm>
+#include <array>
+#include <float.h>
+
+#include "threadPool.hpp"
+
+using glm::vec3;
+using glm::vec4;
+
+namespace vkx {
+
+namespace {
+    struct Aabb {
+        vec3 min{ FLT_MAX };
+        vec3 max{ -FLT_MAX };
+
+        void grow(const vec3& point) {
+            min = glm::min(min, point);
+            max = glm::max(max, point);
+        }
+
+        void grow(const Aabb& other) {
+            min = glm::min(min, other.min);
+            max = glm::max(max, other.max);
+        }
+
+        bool empty() const {
+            return min.x > max.x;
+        }
+
+        float area() const {
+            if (empty()) {
+                return 0.0f;
+            }
+            vec3 extent = max - min;
+            return extent.x * extent.y + extent.y * extent.z + extent.z * extent.x;
+        }
+    };
+
+    struct BuildNode {
+        Aabb bounds;
+        uint32_t left{ 0 };
+        uint32_t right{ 0 };
+        uint32_t first{ 0 };
+        uint32_t count{ 0 };
+        // Index of the deferred subtree that replaces this node, or -1
+        int32_t subtree{ -1 };
+    };
+
+    struct Subtree {
+        uint32_t first;
+        uint32_t count;
+        std::vector<BuildNode> nodes;
+    };
+
+    class Builder {
+    public:
+        const std::vector<Aabb>& primBounds;
+        const std::vector<vec3>& centroids;
+        std::vector<uint32_t>& ids;
+        uint32_t minLeafSize;
+
+        Builder(const std::vector<Aabb>& primBounds, const std::vector<vec3>& centroids, std::vector<uint32_t>& ids, uint32_t minLeafSize)
+            : primBounds(primBounds), centroids(centroids), ids(ids), minLeafSize(minLeafSize) {}
+
+        // Builds the node for ids[first, first + count) and its children into out.
+        // If deferred is set, ranges of at most deferLimit triangles are not built but
+        // recorded as subtrees, to be built later (possibly on another thread).
+        uint32_t build(std::vector<BuildNode>& out, uint32_t first, uint32_t count, std::vector<Subtree>* deferred = nullptr, uint32_t deferLimit = 0) {
+            uint32_t index = (uint32_t)out.size();
+            out.emplace_back();
+            if (deferred && count <= deferLimit) {
+                out[index].subtree = (int32_t)deferred->size();
+                deferred->push_back({ first, count, {} });
+                return index;
+            }
+
+            Aabb bounds, centroidBounds;
+            for (uint32_t i = first; i < first + count; ++i) {
+                bounds.grow(primBounds[ids[i]]);
+                centroidBounds.grow(centroids[ids[i]]);
+            }
+            out[index].bounds = bounds;
+            out[index].first = first;
+            out[index].count = count;
+            if (count <= minLeafSize) {
+                return index;
+            }
+
+            // Evaluate the surface area heuristic at the bin boundaries of every axis
+            struct Bin {
+                Aabb bounds;
+                uint32_t count{ 0 };
+            };
+            float bestCost = FLT_MAX;
+            int bestAxis = -1;
+            uint32_t bestSplit = 0;
+            vec3 extent = centroidBounds.max - centroidBounds.min;
+            for (int axis = 0; axis < 3; ++axis) {
+                if (extent[axis] <= 0.0f) {
+                    continue;
+                }
+                std::array<Bin, Bvh::BIN_COUNT> bins;
+                float scale = Bvh::BIN_COUNT / extent[axis];
+                for (uint32_t i = first; i < first + count; ++i) {
+                    uint32_t id = ids[i];
+                    uint32_t b = std::min(Bvh::BIN_COUNT - 1, (uint32_t)((centroids[id][axis] - centroidBounds.min[axis]) * scale));
+                    bins[b].bounds.grow(primBounds[id]);
+                    bins[b].count++;
+                }
+
+                std::array<float, Bvh::BIN_COUNT - 1> leftCost;
+                Aabb leftBounds;
+                uint32_t leftCount = 0;
+                for (uint32_t b = 0; b < Bvh::BIN_COUNT - 1; ++b) {
+                    leftBounds.grow(bins[b].bounds);
+                    leftCount += bins[b].count;
+                    leftCost[b] = leftBounds.area() * leftCount;
+                }
+                Aabb rightBounds;
+                uint32_t rightCount = 0;
+                for (uint32_t b = Bvh::BIN_COUNT - 1; b > 0; --b) {
+                    rightBounds.grow(bins[b].bounds);
+                    rightCount += bins[b].count;
+                    float cost = leftCost[b - 1] + rightBounds.area() * rightCount;
+                    if (rightCount > 0 && rightCount < count && cost < bestCost) {
+                        bestCost = cost;
+                        bestAxis = axis;
+                        bestSplit = b;
+                    }
+                }
+            }
+
+            uint32_t mid;
+            if (bestAxis >= 0) {
+                // Traversal step is assumed to cost as much as one triangle test
+                float leafCost = bounds.area() * count;
+                float splitCost = bounds.area() + bestCost;
+                if (leafCost <= splitCost && count <= Bvh::MAX_LEAF_SIZE) {
+                    return index;
+                }
+                float scale = Bvh::BIN_COUNT / extent[bestAxis];
+                float axisMin = centroidBounds.min[bestAxis];
+                auto it = std::partition(ids.begin() + first, ids.begin() + first + count, [&](uint32_t id) {
+                    return std::min(Bvh::BIN_COUNT - 1, (uint32_t)((centroids[id][bestAxis] - axisMin) * scale)) < bestSplit;
+                });
+                mid = (uint32_t)(it - ids.begin());
+            } else if (count <= Bvh::MAX_LEAF_SIZE) {
+                return index;
+            } else {
+                // All centroids coincide, any split is as good as another
+                mid = first + count / 2;
+            }
+
+            out[index].count = 0;
+            uint32_t left = build(out, first, mid - first, deferred, deferLimit);
+            uint32_t right = build(out, mid, first + count - mid, deferred, deferLimit);
+            out[index].left = left;
+            out[index].right = right;
+            return index;
+        }
+    };
+
+    Aabb nodeBounds(const std::vector<BuildNode>& tree, const std::vector<Subtree>& subtrees, uint32_t index) {
+        const BuildNode& node = tree[index];
+        return node.subtree >= 0 ? subtrees[node.subtree].nodes[0].bounds : node.bounds;
+    }
+
+    // Emits nodes in depth first order.  The miss link of a node is the first node emitted
+    // after its whole subtree, i.e. its next sibling or the next sibling of an ancestor.
+    void flatten(Bvh& bvh, const std::vector<BuildNode>& tree, const std::vector<Subtree>& subtrees, const std::vector<uint32_t>& ids, const std::vector<vec3>& positions, const std::vector<uint32_t>& indices, uint32_t index) {
+        const BuildNode& node = tree[index];
+        if (node.subtree >= 0) {
+            flatten(bvh, subtrees[node.subtree].nodes, subtrees, ids, positions, indices, 0);
+            return;
+        }
+
+        uint32_t flatIndex = (uint32_t)bvh.nodes.size();
+        bvh.nodes.emplace_back();
+        if (node.count > 0) {
+            uint32_t firstTriangle = (uint32_t)bvh.triangles.size();
+            for (uint32_t i = node.first; i < node.first + node.count; ++i) {
+                uint32_t id = ids[i];
+                bvh.triangleIds.push_back(id);
+                bvh.triangles.push_back({
+                    vec4(positions[indices[id * 3 + 0]], 0.0f),
+                    vec4(positions[indices[id * 3 + 1]], 0.0f),
+                    vec4(positions[indices[id * 3 + 2]], 0.0f),
+                });
+            }
+            bvh.nodes[flatIndex].leaf = (firstTriangle << Bvh::LEAF_COUNT_BITS) | node.count;
+        } else {
+            flatten(bvh, tree, subtrees, ids, positions, indices, node.left);
+            flatten(bvh, tree, subtrees, ids, positions, indices, node.right);
+            bvh.nodes[flatIndex].leaf = 0;
+        }
+        bvh.nodes[flatIndex].min = node.bounds.min;
+        bvh.nodes[flatIndex].max = node.bounds.max;
+        bvh.nodes[flatIndex].missIndex = (uint32_t)bvh.nodes.size();
+    }
+
+    // Interior nodes above a deferred subtree were created before its bounds were known
+    Aabb fixupBounds(std::vector<BuildNode>& tree, const std::vector<Subtree>& subtrees, uint32_t index) {
+        BuildNode& node = tree[index];
+        if (node.subtree >= 0) {
+            return nodeBounds(tree, subtrees, index);
+        }
+        if (node.count == 0) {
+            node.bounds = fixupBounds(tree, subtrees, node.left);
+            node.bounds.grow(fixupBounds(tree, subtrees, node.right));
+        }
+        return node.bounds;
+    }
+}
+
+void Bvh::build(const std::vector<vec3>& positions, const std::vector<uint32_t>& indices, ThreadPool* pool) {
+    clear();
+    const uint32_t triangleCount = (uint32_t)(indices.size() / 3);
+    if (triangleCount == 0) {
+        return;
+    }
+    const uint32_t threadCount = pool ? (uint32_t)pool->threads.size() : 0;
+
+    std::vector<Aabb> primBounds(triangleCount);
+    std::vector<vec3> centroids(triangleCount);
+    std::vector<uint32_t> ids(triangleCount);
+    auto prepareRange = [&](uint32_t begin, uint32_t end) {
+        for (uint32_t i = begin; i < end; ++i) {
+            Aabb& bounds = primBounds[i];
+            bounds.grow(positions[indices[i * 3 + 0]]);
+            bounds.grow(positions[indices[i * 3 + 1]]);
+            bounds.grow(positions[indices[i * 3 + 2]]);
+            centroids[i] = (bounds.min + bounds.max) * 0.5f;
+            ids[i] = i;
+        }
+    };
+    if (threadCount > 1 && triangleCount >= minParallelTriangles) {
+        for (uint32_t t = 0; t < threadCount; ++t) {
+            pool->threads[t]->addJob([=, &prepareRange] {
+                prepareRange(triangleCount * t / threadCount, triangleCount * (t + 1) / threadCount);
+            });
+        }
+        pool->wait();
+    } else {
+        prepareRange(0, triangleCount);
+    }
+
+    Builder builder(primBounds, centroids, ids, minLeafSize < MAX_LEAF_SIZE ? minLeafSize : MAX_LEAF_SIZE);
+    std::vector<BuildNode> top;
+    std::vector<Subtree> subtrees;
+    if (threadCount > 1 && triangleCount >= minParallelTriangles) {
+        // Split the top of the tree on this thread until there are a few subtrees per worker,
+        // then build those independently.  They own disjoint ranges of ids.
+        uint32_t deferLimit = std::max(minParallelTriangles, triangleCount / (threadCount * 4));
+        builder.build(top, 0, triangleCount, &subtrees, deferLimit);
+        // Largest first, handed out round robin
+        std::vector<uint32_t> order(subtrees.size());
+        for (uint32_t i = 0; i < order.size(); ++i) {
+            order[i] = i;
+        }
+        std::sort(order.begin(), order.end(), [&](uint32_t a, uint32_t b) {
+            return subtrees[a].count > subtrees[b].count;
+        });
+        for (uint32_t i = 0; i < order.size(); ++i) {
+            Subtree& subtree = subtrees[order[i]];
+            pool->threads[i % threadCount]->addJob([&builder, &subtree] {
+                builder.build(subtree.nodes, subtree.first, subtree.count);
+            });
+        }
+        pool->wait();
+        fixupBounds(top, subtrees, 0);
+    } else {
+        builder.build(top, 0, triangleCount);
+    }
+
+    nodes.reserve(triangleCount * 2);
+    triangles.reserve(triangleCount);
+    triangleIds.reserve(triangleCount);
+    flatten(*this, top, subtrees, ids, positions, indices, 0);
+}
+
+}
@@ -0,0 +1,64 @@
+/*
+* Bounding volume hierarchy for triangle meshes
+*
+* This code is licensed under the MIT license (MIT) (http://opensource.org/licenses/MIT)
+*/
+
+#pragma once
+
+#include <stdint.h>
+#include <vector>
+
+#include <glm/glm.hpp>
+
+namespace vkx {
+    class ThreadPool;
+
+    // Binned SAH hierarchy over an indexed triangle list, flattened into a depth first
+    // node array so it can be uploaded as-is and traversed without a stack.
+    //
+    // Every interior node is directly followed by its left child.  missIndex is the node to
+    // continue with when the ray misses a node, or after the triangles of a leaf have been
+    // tested.  For the last node of the walk it points one past the end of the array.
+    class Bvh {
+    public:
+        // Matches the std430 layout of the shader side struct (32 bytes)
+        struct Node {
+            glm::vec3 min;
+            uint32_t missIndex;
+            glm::vec3 max;
+            // (first triangle << LEAF_COUNT_BITS) | triangle count, zero for interior nodes
+            uint32_t leaf;
+        };
+
+        // Triangles are stored in leaf order, w is unused (48 bytes)
+        struct Triangle {
+            glm::vec4 v0;
+            glm::vec4 v1;
+            glm::vec4 v2;
+        };
+
+        static const uint32_t LEAF_COUNT_BITS = 4;
+        static const uint32_t MAX_LEAF_SIZE = (1 << LEAF_COUNT_BITS) - 1;
+        static const uint32_t BIN_COUNT = 16;
+
+        // Nodes with this many triangles or less always become leaves
+        uint32_t minLeafSize{ 2 };
+        // Subtrees below this size are never handed to a separate thread
+        uint32_t minParallelTriangles{ 4096 };
+
+        std::vector<Node> nodes;
+        std::vector<Triangle> triangles;
+        // Index of the source triangle for every entry in triangles
+        std::vector<uint32_t> triangleIds;
+
+        // If a thread pool is given, independent subtrees are built on its threads
+        void build(const std::vector<glm::vec3>& positions, const std::vector<uint32_t>& indices, ThreadPool* pool = nullptr);
+
+        void clear() {
+            nodes.clear();
+            triangles.clear();
+            triangleIds.clear();
+        }
+    };
+}
@@ -0,0 +1,148 @@
+/*
+* Comparison of rendered images against stored references
+*
+* This code is licensed under the MIT license (MIT) (http://opensource.org/licenses/MIT)
+*/
+
+#include "imageCompare.h"
+
+#include <stdlib.h>
+#include <algorithm>
+#include <cmath>
+#include <fstream>
+#include <iterator>
+#include <limits>
+
+namespace vkx {
+
+namespace {
+    const uint32_t SSIM_WINDOW = 8;
+    // Stabilizing constants of the SSIM for 8 bit values, (0.01 * 255)^2 and (0.03 * 255)^2
+    const double SSIM_C1 = 6.5025;
+    const double SSIM_C2 = 58.5225;
+
+    inline double luma(const uint8_t* rgb) {
+        return 0.299 * rgb[0] + 0.587 * rgb[1] + 0.114 * rgb[2];
+    }
+
+    // Skips whitespace and comments between the fields of a PPM header
+    const char* skipSpace(const char* p, const char* end) {
+        while (p < end) {
+            if (*p == '#') {
+                while (p < end && *p != '\n') {
+                    ++p;
+                }
+            } else if (*p == ' ' || *p == '\t' || *p == '\r' || *p == '\n') {
+                ++p;
+            } else {
+                break;
+            }
+        }
+        return p;
+    }
+
+    const char* parseField(const char* p, const char* end, uint32_t& value) {
+        p = skipSpace(p, end);
+        value = 0;
+        const char* start = p;
+        while (p < end && *p >= '0' && *p <= '9') {
+            value = value * 10 + (*p++ - '0');
+        }
+        return p == start ? nullptr : p;
+    }
+}
+
+ImageComparison compareImages(const uint8_t* reference, const uint8_t* image, uint32_t width, uint32_t height, uint32_t tolerance) {
+    ImageComparison result;
+    size_t pixels = (size_t)width * height;
+    result.diff.resize(pixels * 3);
+
+    uint64_t squaredError = 0;
+    for (size_t i = 0; i < pixels; ++i) {
+        const uint8_t* a = reference + i * 3;
+        const uint8_t* b = image + i * 3;
+        uint32_t difference = 0;
+        for (int c = 0; c < 3; ++c) {
+            int32_t d = (int32_t)a[c] - (int32_t)b[c];
+            squaredError += d * d;
+            difference = std::max(difference, (uint32_t)abs(d));
+        }
+        result.maxDifference = std::max(result.maxDifference, difference);
+        uint8_t* out = result.diff.data() + i * 3;
+        if (difference > tolerance) {
+            ++result.differingPixels;
+            out[0] = 255;
+            out[1] = 0;
+            out[2] = 0;
+        } else {
+            out[0] = a[0] / 4;
+            out[1] = a[1] / 4;
+            out[2] = a[2] / 4;
+        }
+    }
+    if (squaredError == 0) {
+        result.psnr = std::numeric_limits<double>::infinity();
+    } else {
+        double mse = (double)squaredError / (pixels * 3);
+        result.psnr = 10.0 * std::log10(255.0 * 255.0 / mse);
+    }
+
+    // SSIM of non overlapping windows, the last row and column of windows may be smaller
+    double ssimSum = 0.0;
+    uint32_t windows = 0;
+    for (uint32_t y0 = 0; y0 < height; y0 += SSIM_WINDOW) {
+        for (uint32_t x0 = 0; x0 < width; x0 += SSIM_WINDOW) {
+            uint32_t x1 = std::min(x0 + SSIM_WINDOW, width), y1 = std::min(y0 + SSIM_WINDOW, height);
+            double sumA = 0.0, sumB = 0.0, sumAA = 0.0, sumBB = 0.0, sumAB = 0.0;
+            for (uint32_t y = y0; y < y1; ++y) {
+                for (uint32_t x = x0; x < x1; ++x) {
+                    size_t offset = ((size_t)y * width + x) * 3;
+                    double a = luma(reference + offset), b = luma(image + offset);
+                    sumA += a;
+                    sumB += b;
+                    sumAA += a * a;
+                    sumBB += b * b;
+                    sumAB += a * b;
+                }
+            }
+            double n = (double)(x1 - x0) * (y1 - y0);
+            double meanA = sumA / n, meanB = sumB / n;
+            double varianceA = sumAA / n - meanA * meanA;
+            double varianceB = sumBB / n - meanB * meanB;
+            double covariance = sumAB / n - meanA * meanB;
+            ssimSum += ((2.0 * meanA * meanB + SSIM_C1) * (2.0 * covariance + SSIM_C2)) /
+                ((meanA * meanA + meanB * meanB + SSIM_C1) * (varianceA + varianceB + SSIM_C2));
+            ++windows;
+        }
+    }
+    result.ssim = windows ? ssimSum / windows : 1.0;
+    return result;
+}
+
+bool readPpm(const std::string& filename, std::vector<uint8_t>& pixels, uint32_t& width, uint32_t& height) {
+    std::ifstream file(filename, std::ios::binary);
+    if (!file) {
+        return false;
+    }
+    std::vector<char> data((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+    const char* p = data.data();
+    const char* end = p + data.size();
+    if (data.size() < 2 || p[0] != 'P' || p[1] != '6') {
+        return false;
+    }
+    uint32_t maxValue = 0;
+    p += 2;
+    if (!(p = parseField(p, end, width)) || !(p = parseField(p, end, height)) || !(p = parseField(p, end, maxValue)) || maxValue != 255) {
+        return false;
+    }
+    // A single whitespace character separates the header from the pixels
+    ++p;
+    size_t size = (size_t)width * height * 3;
+    if (p > end || (size_t)(end - p) < size) {
+        return false;
+    }
+    pixels.assign((const uint8_t*)p, (const uint8_t*)p + size);
+    return true;
+}
+
+}
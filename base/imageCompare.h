@@ -0,0 +1,36 @@
+/*
+* Comparison of rendered images against stored references
+*
+* This code is licensed under the MIT license (MIT) (http://opensource.org/licenses/MIT)
+*/
+
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+#include <string>
+#include <vector>
+
+namespace vkx {
+
+    // Differences between two 8 bit RGB images of the same size
+    struct ImageComparison {
+        // Pixels with any channel differing by more than the tolerance
+        uint64_t differingPixels{ 0 };
+        // Largest difference of any channel
+        uint32_t maxDifference{ 0 };
+        // Peak signal to noise ratio over all channels in dB, infinite for equal images
+        double psnr{ 0.0 };
+        // Mean structural similarity of the luma over 8x8 windows, 1 for equal images
+        double ssim{ 0.0 };
+        // RGB image of the reference at a quarter of its brightness with the differing pixels in red
+        std::vector<uint8_t> diff;
+    };
+
+    // Compares tightly packed RGB8 pixels, a channel differing by at most tolerance counts as equal
+    ImageComparison compareImages(const uint8_t* reference, const uint8_t* image, uint32_t width, uint32_t height, uint32_t tolerance);
+
+    // Reads a binary PPM (P6) with 8 bit channels as written by encodePpm, returns false if the
+    // file is missing or in another format
+    bool readPpm(const std::string& filename, std::vector<uint8_t>& pixels, uint32_t& width, uint32_t& height);
+}
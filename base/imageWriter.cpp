@@ -0,0 +1,227 @@
+/*
+* PPM and PNG encoding of 8 bit images
+*
+* This code is licensed under the MIT license (MIT) (http://opensource.org/licenses/MIT)
+*/
+
+#include "imageWriter.h"
+
+#include <string.h>
+#include <algorithm>
+#include <fstream>
+
+namespace vkx {
+
+namespace {
+    // Largest payload of a stored deflate block
+    const size_t STORED_BLOCK_SIZE = 65535;
+
+    // Slicing-by-8 tables of the reflected CRC-32 polynomial used by PNG
+    struct CrcTables {
+        uint32_t table[8][256];
+
+        CrcTables() {
+            for (uint32_t i = 0; i < 256; ++i) {
+                uint32_t c = i;
+                for (int k = 0; k < 8; ++k) {
+                    c = (c & 1) ? 0xEDB88320u ^ (c >> 1) : c >> 1;
+                }
+                table[0][i] = c;
+            }
+            for (uint32_t i = 0; i < 256; ++i) {
+                for (int t = 1; t < 8; ++t) {
+                    table[t][i] = (table[t - 1][i] >> 8) ^ table[0][table[t - 1][i] & 0xff];
+                }
+            }
+        }
+    };
+
+    const CrcTables& crcTables() {
+        static const CrcTables tables;
+        return tables;
+    }
+
+    inline void putBigEndian(uint8_t* out, uint32_t value) {
+        out[0] = (uint8_t)(value >> 24);
+        out[1] = (uint8_t)(value >> 16);
+        out[2] = (uint8_t)(value >> 8);
+        out[3] = (uint8_t)value;
+    }
+
+    // Converts one row to RGB or RGBA
+    void convertRow(const uint8_t* in, uint8_t* out, uint32_t width, PixelLayout layout, bool alpha) {
+        switch (layout) {
+        case PixelLayout::RGB8:
+            if (alpha) {
+                for (uint32_t x = 0; x < width; ++x, in += 3, out += 4) {
+                    out[0] = in[0]; out[1] = in[1]; out[2] = in[2]; out[3] = 0xff;
+                }
+            } else {
+                memcpy(out, in, width * 3);
+            }
+            break;
+        case PixelLayout::RGBA8:
+            if (alpha) {
+                memcpy(out, in, width * 4);
+            } else {
+                for (uint32_t x = 0; x < width; ++x, in += 4, out += 3) {
+                    out[0] = in[0]; out[1] = in[1]; out[2] = in[2];
+                }
+            }
+            break;
+        case PixelLayout::BGRA8:
+            if (alpha) {
+                for (uint32_t x = 0; x < width; ++x, in += 4, out += 4) {
+                    out[0] = in[2]; out[1] = in[1]; out[2] = in[0]; out[3] = in[3];
+                }
+            } else {
+                for (uint32_t x = 0; x < width; ++x, in += 4, out += 3) {
+                    out[0] = in[2]; out[1] = in[1]; out[2] = in[0];
+                }
+            }
+            break;
+        }
+    }
+
+    // Appends a chunk with the payload written by f(data), which must write size bytes
+    template <typename F>
+    void appendChunk(std::vector<uint8_t>& png, const char* type, size_t size, F f) {
+        size_t start = png.size();
+        png.resize(start + 12 + size);
+        uint8_t* chunk = png.data() + start;
+        putBigEndian(chunk, (uint32_t)size);
+        memcpy(chunk + 4, type, 4);
+        f(chunk + 8);
+        putBigEndian(chunk + 8 + size, crc32(chunk + 4, size + 4));
+    }
+}
+
+uint32_t crc32(const uint8_t* data, size_t size, uint32_t crc) {
+    const auto& t = crcTables().table;
+    crc = ~crc;
+    for (; size >= 8; size -= 8, data += 8) {
+        uint32_t low = crc ^ ((uint32_t)data[0] | ((uint32_t)data[1] << 8) | ((uint32_t)data[2] << 16) | ((uint32_t)data[3] << 24));
+        uint32_t high = (uint32_t)data[4] | ((uint32_t)data[5] << 8) | ((uint32_t)data[6] << 16) | ((uint32_t)data[7] << 24);
+        crc = t[7][low & 0xff] ^ t[6][(low >> 8) & 0xff] ^ t[5][(low >> 16) & 0xff] ^ t[4][low >> 24] ^
+            t[3][high & 0xff] ^ t[2][(high >> 8) & 0xff] ^ t[1][(high >> 16) & 0xff] ^ t[0][high >> 24];
+    }
+    for (; size > 0; --size) {
+        crc = t[0][(crc ^ *data++) & 0xff] ^ (crc >> 8);
+    }
+    return ~crc;
+}
+
+uint32_t adler32(const uint8_t* data, size_t size, uint32_t adler) {
+    // Largest run before the sums have to be reduced to stay within 32 bits
+    const size_t NMAX = 5552;
+    uint32_t a = adler & 0xffff, b = adler >> 16;
+    while (size > 0) {
+        size_t run = std::min(size, NMAX);
+        size -= run;
+        for (; run > 0; --run) {
+            a += *data++;
+            b += a;
+        }
+        a %= 65521;
+        b %= 65521;
+    }
+    return (b << 16) | a;
+}
+
+std::vector<uint8_t> encodePpm(const uint8_t* pixels, uint32_t width, uint32_t height, size_t rowPitch, PixelLayout layout) {
+    std::string header = "P6\n" + std::to_string(width) + " " + std::to_string(height) + "\n255\n";
+    std::vector<uint8_t> ppm(header.size() + (size_t)width * height * 3);
+    memcpy(ppm.data(), header.data(), header.size());
+    uint8_t* out = ppm.data() + header.size();
+    for (uint32_t y = 0; y < height; ++y, out += width * 3) {
+        convertRow(pixels + y * rowPitch, out, width, layout, false);
+    }
+    return ppm;
+}
+
+std::vector<uint8_t> encodePng(const uint8_t* pixels, uint32_t width, uint32_t height, size_t rowPitch, PixelLayout layout, bool alpha) {
+    static const uint8_t SIGNATURE[8] = { 0x89, 'P', 'N', 'G', '\r', '\n', 0x1a, '\n' };
+    size_t rowSize = 1 + (size_t)width * (alpha ? 4 : 3);
+    size_t rawSize = rowSize * height;
+    size_t blocks = std::max<size_t>((rawSize + STORED_BLOCK_SIZE - 1) / STORED_BLOCK_SIZE, 1);
+    // zlib header, stored blocks with 5 byte headers and the Adler-32 of the raw data
+    size_t idatSize = 2 + blocks * 5 + rawSize + 4;
+
+    std::vector<uint8_t> png(sizeof(SIGNATURE));
+    png.reserve(sizeof(SIGNATURE) + 25 + 12 + idatSize + 12);
+    memcpy(png.data(), SIGNATURE, sizeof(SIGNATURE));
+
+    appendChunk(png, "IHDR", 13, [&](uint8_t* out) {
+        putBigEndian(out, width);
+        putBigEndian(out + 4, height);
+        out[8] = 8;
+        // Truecolor with or without alpha
+        out[9] = alpha ? 6 : 2;
+        out[10] = 0;
+        out[11] = 0;
+        out[12] = 0;
+    });
+
+    appendChunk(png, "IDAT", idatSize, [&](uint8_t* out) {
+        // Deflate, 32K window, no preset dictionary, fastest compression level
+        *out++ = 0x78;
+        *out++ = 0x01;
+        uint32_t adler = 1;
+        // Rows are converted straight into the stored blocks, which they may straddle
+        size_t remaining = rawSize;
+        size_t blockLeft = 0;
+        auto beginBlock = [&] {
+            blockLeft = std::min(remaining, STORED_BLOCK_SIZE);
+            remaining -= blockLeft;
+            *out++ = remaining == 0 ? 1 : 0;
+            *out++ = (uint8_t)blockLeft;
+            *out++ = (uint8_t)(blockLeft >> 8);
+            *out++ = (uint8_t)~blockLeft;
+            *out++ = (uint8_t)(~blockLeft >> 8);
+        };
+        if (rawSize == 0) {
+            beginBlock();
+        }
+        std::vector<uint8_t> row(rowSize);
+        for (uint32_t y = 0; y < height; ++y) {
+            row[0] = 0;
+            convertRow(pixels + y * rowPitch, row.data() + 1, width, layout, alpha);
+            adler = adler32(row.data(), rowSize, adler);
+            const uint8_t* src = row.data();
+            size_t rowLeft = rowSize;
+            while (rowLeft > 0) {
+                if (blockLeft == 0) {
+                    beginBlock();
+                }
+                size_t n = std::min(rowLeft, blockLeft);
+                memcpy(out, src, n);
+                out += n;
+                src += n;
+                rowLeft -= n;
+                blockLeft -= n;
+            }
+        }
+        putBigEndian(out, adler);
+    });
+
+    appendChunk(png, "IEND", 0, [](uint8_t*) {});
+    return png;
+}
+
+bool writeImage(const std::string& filename, const uint8_t* pixels, uint32_t width, uint32_t height, size_t rowPitch, PixelLayout layout) {
+    std::string extension = filename.size() >= 4 ? filename.substr(filename.size() - 4) : std::string();
+    std::transform(extension.begin(), extension.end(), extension.begin(), ::tolower);
+    std::vector<uint8_t> encoded;
+    if (extension == ".ppm") {
+        encoded = encodePpm(pixels, width, height, rowPitch, layout);
+    } else if (extension == ".png") {
+        encoded = encodePng(pixels, width, height, rowPitch, layout);
+    } else {
+        return false;
+    }
+    std::ofstream file(filename, std::ios::binary);
+    file.write((const char*)encoded.data(), encoded.size());
+    return file.good();
+}
+
+}
@@ -0,0 +1,39 @@
+/*
+* PPM and PNG encoding of 8 bit images
+*
+* This code is licensed under the MIT license (MIT) (http://opensource.org/licenses/MIT)
+*/
+
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+#include <string>
+#include <vector>
+
+namespace vkx {
+
+    // Channel order of the pixels passed to the encoders, 8 bits per channel
+    enum class PixelLayout {
+        RGB8,
+        RGBA8,
+        // Swap chain order of most desktop drivers
+        BGRA8,
+    };
+
+    // Binary PPM (P6), alpha is dropped
+    std::vector<uint8_t> encodePpm(const uint8_t* pixels, uint32_t width, uint32_t height, size_t rowPitch, PixelLayout layout);
+
+    // PNG with 8 bit RGB or RGBA pixels.  The image data is stored in uncompressed deflate blocks
+    // without row filters, so encoding is little more than a copy plus the checksums and the
+    // files are about as large as the pixels.  Meant for frame capture, not for distribution.
+    std::vector<uint8_t> encodePng(const uint8_t* pixels, uint32_t width, uint32_t height, size_t rowPitch, PixelLayout layout, bool alpha = false);
+
+    // Encodes by the extension of the filename (.ppm or .png) and writes the file, returns false
+    // if the extension isn't supported or the file couldn't be written
+    bool writeImage(const std::string& filename, const uint8_t* pixels, uint32_t width, uint32_t height, size_t rowPitch, PixelLayout layout);
+
+    // Checksums of the PNG and zlib containers, exposed for tests of the encoder output
+    uint32_t crc32(const uint8_t* data, size_t size, uint32_t crc = 0);
+    uint32_t adler32(const uint8_t* data, size_t size, uint32_t adler = 1);
+}
@@ -8,6 +8,11 @@
 
 #include "shapes.h"
 
+#include <algorithm>
+#include <unordered_map>
+
+#include "threadPool.hpp"
+
 namespace geometry {
 
 using glm::vec3;
@@ -15,30 +20,187 @@ using glm::vec3;
 // The golden ratio
 static const float PHI = 1.61803398874f;
 
-Solid<3> tesselate(const Solid<3>& solid_, int count) {
+namespace {
+    // Undirected edge, smaller vertex index in the high half
+    using EdgeKey = uint64_t;
+
+    inline EdgeKey edgeKey(Index a, Index b) {
+        return (a < b) ? ((EdgeKey)a << 32) | b : ((EdgeKey)b << 32) | a;
+    }
+
+    inline Index edgeStart(EdgeKey key) {
+        return (Index)(key >> 32);
+    }
+
+    inline Index edgeEnd(EdgeKey key) {
+        return (Index)(key & 0xFFFFFFFF);
+    }
+
+    // Picks the worker responsible for creating the midpoint of an edge
+    inline uint32_t edgeOwner(EdgeKey key, uint32_t threadCount) {
+        return (uint32_t)(((key * 0x9E3779B97F4A7C15ull) >> 32) % threadCount);
+    }
+
+    // Replaces a face by its four children, given the midpoints of the edges ab, bc and ca
+    inline void splitFace(const Face<3>& face, Index ab, Index bc, Index ca, Face<3>* out) {
+        out[0] = Face<3>{ { face[0], ab, ca } };
+        out[1] = Face<3>{ { ab, face[1], bc } };
+        out[2] = Face<3>{ { bc, face[2], ca } };
+        out[3] = Face<3>{ { ab, bc, ca } };
+    }
+
+    Solid<3> subdivide(const Solid<3>& solid, float length) {
+        const size_t faceCount = solid.faces.size();
+        // Every edge of a closed triangle mesh is shared by exactly two faces
+        const size_t edgeCount = faceCount * 3 / 2;
+
+        Solid<3> result;
+        result.vertices.reserve(solid.vertices.size() + edgeCount);
+        result.vertices.assign(solid.vertices.begin(), solid.vertices.end());
+        result.faces.resize(faceCount * 4);
+
+        std::unordered_map<EdgeKey, Index> midpoints;
+        midpoints.reserve(edgeCount);
+        auto midpoint = [&](Index a, Index b) {
+            auto inserted = midpoints.emplace(edgeKey(a, b), (Index)result.vertices.size());
+            if (inserted.second) {
+                vec3 position = glm::normalize(solid.vertices[a] + solid.vertices[b]) * length;
+                result.vertices.push_back(position);
+            }
+            return inserted.first->second;
+        };
+
+        for (size_t f = 0; f < faceCount; ++f) {
+            const Face<3>& face = solid.faces[f];
+            Index ab = midpoint(face[0], face[1]);
+            Index bc = midpoint(face[1], face[2]);
+            Index ca = midpoint(face[2], face[0]);
+            splitFace(face, ab, bc, ca, &result.faces[f * 4]);
+        }
+        return result;
+    }
+
+    // Reference from a face edge to the edge, for handing the edge to the worker that owns it
+    struct EdgeRef {
+        EdgeKey key;
+        // Face index * 3 + edge index
+        uint32_t slot;
+    };
+
+    // Three passes.  Every worker takes an equal range of the faces and sorts their edges into
+    // one bucket per owning worker.  Then every worker numbers the midpoints of the edges in its
+    // buckets locally.  Once the per-worker counts are known, the last pass writes the midpoint
+    // vertices of each worker and its range of the new faces.
+    Solid<3> subdivide(const Solid<3>& solid, float length, vkx::ThreadPool& pool) {
+        const uint32_t threadCount = (uint32_t)pool.threads.size();
+        const size_t faceCount = solid.faces.size();
+        const size_t edgeCount = faceCount * 3 / 2;
+
+        // buckets[t * threadCount + o] holds the edges of the faces of worker t owned by worker o
+        std::vector<std::vector<EdgeRef>> buckets(threadCount * threadCount);
+        for (uint32_t t = 0; t < threadCount; ++t) {
+            pool.threads[t]->addJob([&, t] {
+                size_t begin = faceCount * t / threadCount;
+                size_t end = faceCount * (t + 1) / threadCount;
+                std::vector<EdgeRef>* out = &buckets[t * threadCount];
+                for (uint32_t o = 0; o < threadCount; ++o) {
+                    out[o].reserve((end - begin) * 3 / threadCount + 1);
+                }
+                for (size_t f = begin; f < end; ++f) {
+                    const Face<3>& face = solid.faces[f];
+                    for (size_t e = 0; e < 3; ++e) {
+                        EdgeKey key = edgeKey(face[e], face[(e + 1) % 3]);
+                        out[edgeOwner(key, threadCount)].push_back(EdgeRef{ key, (uint32_t)(f * 3 + e) });
+                    }
+                }
+            });
+        }
+        pool.wait();
+
+        std::vector<Index> localMidpoints(faceCount * 3);
+        std::vector<std::unordered_map<EdgeKey, Index>> midpoints(threadCount);
+        for (uint32_t o = 0; o < threadCount; ++o) {
+            pool.threads[o]->addJob([&, o] {
+                auto& owned = midpoints[o];
+                owned.reserve(edgeCount / threadCount + 1);
+                for (uint32_t t = 0; t < threadCount; ++t) {
+                    for (const EdgeRef& ref : buckets[t * threadCount + o]) {
+                        auto inserted = owned.emplace(ref.key, (Index)owned.size());
+                        localMidpoints[ref.slot] = inserted.first->second;
+                    }
+                }
+            });
+        }
+        pool.wait();
+        buckets.clear();
+
+        std::vector<Index> baseVertex(threadCount);
+        Index vertexCount = (Index)solid.vertices.size();
+        for (uint32_t t = 0; t < threadCount; ++t) {
+            baseVertex[t] = vertexCount;
+            vertexCount += (Index)midpoints[t].size();
+        }
+
+        Solid<3> result;
+        result.vertices.resize(vertexCount);
+        std::copy(solid.vertices.begin(), solid.vertices.end(), result.vertices.begin());
+        result.faces.resize(faceCount * 4);
+
+        for (uint32_t t = 0; t < threadCount; ++t) {
+            pool.threads[t]->addJob([&, t] {
+                for (const auto& entry : midpoints[t]) {
+                    const vec3& a = solid.vertices[edgeStart(entry.first)];
+                    const vec3& b = solid.vertices[edgeEnd(entry.first)];
+                    result.vertices[baseVertex[t] + entry.second] = glm::normalize(a + b) * length;
+                }
+
+                size_t begin = faceCount * t / threadCount;
+                size_t end = faceCount * (t + 1) / threadCount;
+                for (size_t f = begin; f < end; ++f) {
+                    const Face<3>& face = solid.faces[f];
+                    Index mid[3];
+                    for (size_t e = 0; e < 3; ++e) {
+                        EdgeKey key = edgeKey(face[e], face[(e + 1) % 3]);
+                        mid[e] = baseVertex[edgeOwner(key, threadCount)] + localMidpoints[f * 3 + e];
+                    }
+                    splitFace(face, mid[0], mid[1], mid[2], &result.faces[f * 4]);
+                }
+            });
+        }
+        pool.wait();
+        return result;
+    }
+}
+
+Solid<3> tesselate(const Solid<3>& solid, int count) {
+    return tesselate(Solid<3>(solid), count);
+}
+
+Solid<3> tesselate(Solid<3>&& solid_, int count) {
+    Solid<3> solid = std::move(solid_);
+    float length = glm::length(solid.vertices[0]);
+    for (int i = 0; i < count; ++i) {
+        solid = subdivide(solid, length);
+    }
+    return solid;
+}
+
+Solid<3> tesselateParallel(const Solid<3>& solid_, int count, uint32_t threadCount, size_t minParallelFaces) {
+    if (threadCount == 0) {
+        threadCount = std::max(1u, std::thread::hardware_concurrency());
+    }
     Solid<3> solid = solid_;
     float length = glm::length(solid.vertices[0]);
+    vkx::ThreadPool pool;
     for (int i = 0; i < count; ++i) {
-        Solid<3> result { solid.vertices, {} };
-        result.vertices.reserve(solid.vertices.size() + solid.faces.size() * 3);
-        for (size_t f = 0; f < solid.faces.size(); ++f) {
-            Index baseVertex = (Index)result.vertices.size();
-            const Face<3>& oldFace = solid.faces[f];
-            const vec3& a = solid.vertices[oldFace[0]];
-            const vec3& b = solid.vertices[oldFace[1]];
-            const vec3& c = solid.vertices[oldFace[2]];
-            vec3 ab = glm::normalize(a + b) * length;
-            vec3 bc = glm::normalize(b + c) * length;
-            vec3 ca = glm::normalize(c + a) * length;
-            result.vertices.push_back(ab);
-            result.vertices.push_back(bc);
-            result.vertices.push_back(ca);
-            result.faces.push_back(Face<3>{ { oldFace[0], baseVertex, baseVertex + 2 } });
-            result.faces.push_back(Face<3>{ { baseVertex, oldFace[1], baseVertex + 1 } });
-            result.faces.push_back(Face<3>{ { baseVertex + 1, oldFace[2], baseVertex + 2 } });
-            result.faces.push_back(Face<3>{ { baseVertex, baseVertex + 1, baseVertex + 2 } });
+        if (threadCount < 2 || solid.faces.size() < minParallelFaces) {
+            solid = subdivide(solid, length);
+            continue;
+        }
+        if (pool.threads.empty()) {
+            pool.setThreadCount(threadCount);
         }
-        solid = result;
+        solid = subdivide(solid, length, pool);
     }
     return solid;
 }
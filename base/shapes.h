@@ -68,7 +68,27 @@ namespace geometry {
         return triangulatedFaceTriangleCount<N>() * 3;
     }
 
+    // Fan-triangulates every face, so any of the solids below can be fed to tesselate()
+    template <size_t N>
+    Solid<3> triangulate(const Solid<N>& solid) {
+        Solid<3> result{ solid.vertices, {} };
+        result.faces.reserve(solid.faces.size() * triangulatedFaceTriangleCount<N>());
+        for (const auto& face : solid.faces) {
+            for (size_t i = 1; i + 1 < N; ++i) {
+                result.faces.push_back(Face<3>{ { face[0], face[i], face[i + 1] } });
+            }
+        }
+        return result;
+    }
+
+    // Subdivides every triangle into four, projecting the new vertices onto the circumscribed sphere.
+    // Edge midpoints are shared between the neighbouring faces, so a closed solid with V vertices,
+    // E edges and F faces becomes one with V + E vertices and 4F faces per level.
     Solid<3> tesselate(const Solid<3>& solid, int count);
+    Solid<3> tesselate(Solid<3>&& solid, int count);
+    // Produces the same mesh as tesselate() (up to vertex order), but splits each level across a thread pool.
+    // Levels with fewer than minParallelFaces faces are processed on the calling thread.
+    Solid<3> tesselateParallel(const Solid<3>& solid, int count, uint32_t threadCount = 0, size_t minParallelFaces = 16384);
     const Solid<3>& tetrahedron();
     const Solid<4>& cube();
     const Solid<3>& octahedron();
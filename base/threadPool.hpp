@@ -6,6 +6,10 @@
 * This code is licensed under the MIT license (MIT) (http://opensource.org/licenses/MIT)
 */
 
+#pragma once
+
+#include <functional>
+#include <memory>
 #include <vector>
 #include <thread>
 #include <queue>
@@ -0,0 +1,321 @@
+/*
+* Memory mapped asset pack
+*
+* This code is licensed under the MIT license (MIT) (http://opensource.org/licenses/MIT)
+*/
+
+#include "vulkanAssetPack.h"
+
+#include <string.h>
+
+#include <algorithm>
+#include <fstream>
+#include <memory>
+#include <stdexcept>
+
+#if defined(_WIN32)
+#include <windows.h>
+#elif !defined(__ANDROID__)
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace vkx {
+
+namespace pack {
+    void lz4Decompress(const uint8_t* src, size_t srcSize, uint8_t* dst, size_t dstSize) {
+        const uint8_t* ip = src;
+        const uint8_t* const iend = src + srcSize;
+        uint8_t* op = dst;
+        uint8_t* const oend = dst + dstSize;
+
+        auto readLength = [&](size_t length) {
+            if (length == 15) {
+                uint8_t b;
+                do {
+                    if (ip >= iend) {
+                        throw std::runtime_error("Corrupt LZ4 block");
+                    }
+                    b = *ip++;
+                    length += b;
+                } while (b == 255);
+            }
+            return length;
+        };
+
+        while (ip < iend) {
+            uint8_t token = *ip++;
+
+            size_t literals = readLength(token >> 4);
+            if (literals > (size_t)(iend - ip) || literals > (size_t)(oend - op)) {
+                throw std::runtime_error("Corrupt LZ4 block");
+            }
+            memcpy(op, ip, literals);
+            ip += literals;
+            op += literals;
+
+            // The last sequence only contains literals
+            if (ip >= iend) {
+                break;
+            }
+
+            if (iend - ip < 2) {
+                throw std::runtime_error("Corrupt LZ4 block");
+            }
+            size_t offset = ip[0] | (ip[1] << 8);
+            ip += 2;
+            size_t matchLength = readLength(token & 0xF) + 4;
+            if (offset == 0 || offset > (size_t)(op - dst) || matchLength > (size_t)(oend - op)) {
+                throw std::runtime_error("Corrupt LZ4 block");
+            }
+            // Matches may overlap the output, copy byte by byte
+            const uint8_t* match = op - offset;
+            for (size_t i = 0; i < matchLength; ++i) {
+                op[i] = match[i];
+            }
+            op += matchLength;
+        }
+
+        if (op != oend) {
+            throw std::runtime_error("LZ4 block size mismatch");
+        }
+    }
+}
+
+namespace {
+    std::unique_ptr<AssetPack> mountedPack;
+
+    std::string normalize(const std::string& path) {
+        std::string result = path;
+        std::replace(result.begin(), result.end(), '\\', '/');
+        return result;
+    }
+}
+
+void AssetPack::open(const std::string& filename, const std::string& root) {
+    close();
+    this->root = normalize(root);
+#if defined(_WIN32)
+    HANDLE file = CreateFileA(filename.c_str(), GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, FILE_FLAG_RANDOM_ACCESS, NULL);
+    if (file == INVALID_HANDLE_VALUE) {
+        throw std::runtime_error("Could not open " + filename);
+    }
+    LARGE_INTEGER fileSize;
+    GetFileSizeEx(file, &fileSize);
+    HANDLE mapping = CreateFileMappingA(file, NULL, PAGE_READONLY, 0, 0, NULL);
+    if (!mapping) {
+        CloseHandle(file);
+        throw std::runtime_error("Could not map " + filename);
+    }
+    fileHandle = file;
+    mappingHandle = mapping;
+    size = (size_t)fileSize.QuadPart;
+    data = (const uint8_t*)MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+#elif defined(__ANDROID__)
+    throw std::runtime_error("Asset packs are opened through the asset manager on Android");
+#else
+    int fd = ::open(filename.c_str(), O_RDONLY);
+    if (fd < 0) {
+        throw std::runtime_error("Could not open " + filename);
+    }
+    struct stat fileStat;
+    fstat(fd, &fileStat);
+    size = (size_t)fileStat.st_size;
+    void* mapping = mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+    // The mapping keeps the file referenced
+    ::close(fd);
+    if (mapping == MAP_FAILED) {
+        throw std::runtime_error("Could not map " + filename);
+    }
+    data = (const uint8_t*)mapping;
+#endif
+    parse(filename);
+}
+
+#if defined(__ANDROID__)
+void AssetPack::open(AAssetManager* assetManager, const std::string& filename, const std::string& root) {
+    close();
+    this->root = normalize(root);
+    asset = AAssetManager_open(assetManager, filename.c_str(), AASSET_MODE_BUFFER);
+    if (!asset) {
+        throw std::runtime_error("Could not open " + filename);
+    }
+    size = (size_t)AAsset_getLength(asset);
+    data = (const uint8_t*)AAsset_getBuffer(asset);
+    if (!data) {
+        AAsset_close(asset);
+        asset = nullptr;
+        throw std::runtime_error("Could not map " + filename);
+    }
+    parse(filename);
+}
+#endif
+
+void AssetPack::parse(const std::string& filename) {
+    const pack::Header* header = (const pack::Header*)data;
+    if (size < sizeof(pack::Header) || memcmp(header->magic, pack::MAGIC, sizeof(pack::MAGIC)) != 0 || header->version != pack::VERSION) {
+        close();
+        throw std::runtime_error(filename + " is not an asset pack");
+    }
+    if (header->tocOffset + header->entryCount * sizeof(pack::Entry) > size || header->namesOffset + header->namesSize > size) {
+        close();
+        throw std::runtime_error(filename + " is truncated");
+    }
+    const pack::Entry* entries = (const pack::Entry*)(data + header->tocOffset);
+    toc.assign(entries, entries + header->entryCount);
+    names = (const char*)(data + header->namesOffset);
+    for (const auto& entry : toc) {
+        if (entry.offset + entry.storedSize > size || entry.nameOffset + entry.nameLength > header->namesSize) {
+            close();
+            throw std::runtime_error(filename + " is truncated");
+        }
+    }
+}
+
+void AssetPack::close() {
+    if (!data) {
+        return;
+    }
+#if defined(_WIN32)
+    UnmapViewOfFile(data);
+    CloseHandle((HANDLE)mappingHandle);
+    CloseHandle((HANDLE)fileHandle);
+    mappingHandle = fileHandle = nullptr;
+#elif defined(__ANDROID__)
+    AAsset_close(asset);
+    asset = nullptr;
+#else
+    munmap((void*)data, size);
+#endif
+    data = nullptr;
+    size = 0;
+    toc.clear();
+    names = nullptr;
+}
+
+std::string AssetPack::name(const pack::Entry& entry) const {
+    return std::string(names + entry.nameOffset, entry.nameLength);
+}
+
+const pack::Entry* AssetPack::find(const std::string& filename) const {
+    if (!data) {
+        return nullptr;
+    }
+    std::string path = normalize(filename);
+    if (!root.empty() && path.compare(0, root.size(), root) == 0) {
+        path = path.substr(root.size());
+    }
+    // The table of contents is sorted by name
+    auto it = std::lower_bound(toc.begin(), toc.end(), path, [this](const pack::Entry& entry, const std::string& path) {
+        return path.compare(0, path.size(), names + entry.nameOffset, entry.nameLength) > 0;
+    });
+    if (it == toc.end() || path.compare(0, path.size(), names + it->nameOffset, it->nameLength) != 0) {
+        return nullptr;
+    }
+    return &(*it);
+}
+
+const uint8_t* AssetPack::map(const pack::Entry& entry) const {
+    if (entry.flags & pack::ENTRY_LZ4) {
+        return nullptr;
+    }
+    return data + entry.offset;
+}
+
+void AssetPack::read(const pack::Entry& entry, uint8_t* dst) const {
+    if (entry.flags & pack::ENTRY_LZ4) {
+        pack::lz4Decompress(data + entry.offset, entry.storedSize, dst, entry.size);
+    } else {
+        memcpy(dst, data + entry.offset, entry.size);
+    }
+}
+
+std::vector<uint8_t> AssetPack::read(const pack::Entry& entry) const {
+    std::vector<uint8_t> result(entry.size);
+    read(entry, result.data());
+    return result;
+}
+
+AssetPack* AssetPack::mounted() {
+    return mountedPack.get();
+}
+
+bool AssetPack::mount(const std::string& filename, const std::string& root) {
+    if (!std::ifstream(filename).good()) {
+        return false;
+    }
+    std::unique_ptr<AssetPack> pack(new AssetPack());
+    pack->open(filename, root);
+    mountedPack = std::move(pack);
+    return true;
+}
+
+#if defined(__ANDROID__)
+bool AssetPack::mount(AAssetManager* assetManager, const std::string& filename, const std::string& root) {
+    AAsset* asset = AAssetManager_open(assetManager, filename.c_str(), AASSET_MODE_UNKNOWN);
+    if (!asset) {
+        return false;
+    }
+    AAsset_close(asset);
+    std::unique_ptr<AssetPack> pack(new AssetPack());
+    pack->open(assetManager, filename, root);
+    mountedPack = std::move(pack);
+    return true;
+}
+#endif
+
+void AssetPack::unmount() {
+    mountedPack.reset();
+}
+
+KtxView::KtxView(const uint8_t* data, size_t size) {
+    static const uint8_t identifier[12] = { 0xAB, 0x4B, 0x54, 0x58, 0x20, 0x31, 0x31, 0xBB, 0x0D, 0x0A, 0x1A, 0x0A };
+    // Identifier followed by 13 32 bit header fields
+    const size_t headerSize = sizeof(identifier) + 13 * sizeof(uint32_t);
+    if (size < headerSize || memcmp(data, identifier, sizeof(identifier)) != 0) {
+        throw std::runtime_error("Not a KTX file");
+    }
+    const uint32_t* header = (const uint32_t*)(data + sizeof(identifier));
+    if (header[0] != 0x04030201) {
+        throw std::runtime_error("Big endian KTX files are not supported");
+    }
+    width = header[6];
+    height = std::max(header[7], 1u);
+    depth = std::max(header[8], 1u);
+    layers = std::max(header[9], 1u);
+    faces = header[10];
+    if (faces != 1 && faces != 6) {
+        throw std::runtime_error("Not a KTX file");
+    }
+    levels = std::max(header[11], 1u);
+    bool nonArrayCube = faces == 6 && header[9] == 0;
+
+    const uint8_t* ptr = data + headerSize + header[12];
+    const uint8_t* end = data + size;
+    for (uint32_t level = 0; level < levels; ++level) {
+        if (ptr + sizeof(uint32_t) > end) {
+            throw std::runtime_error("Truncated KTX file");
+        }
+        size_t imageSize = *(const uint32_t*)ptr;
+        ptr += sizeof(uint32_t);
+        // imageSize covers a single face for cube maps and all layers and faces otherwise
+        size_t faceSize = nonArrayCube ? imageSize : imageSize / (layers * faces);
+        size_t faceStride = nonArrayCube ? (faceSize + 3) & ~(size_t)3 : faceSize;
+        size_t levelSize = faceStride * layers * faces;
+        if (ptr + levelSize > end) {
+            throw std::runtime_error("Truncated KTX file");
+        }
+        levelData.push_back(ptr);
+        levelImageSizes.push_back(faceSize);
+        levelStrides.push_back(faceStride);
+        ptr += (levelSize + 3) & ~(size_t)3;
+    }
+}
+
+const uint8_t* KtxView::image(uint32_t level, uint32_t layer, uint32_t face) const {
+    return levelData[level] + (layer * faces + face) * levelStrides[level];
+}
+
+}
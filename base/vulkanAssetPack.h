@@ -0,0 +1,141 @@
+/*
+* Memory mapped asset pack
+*
+* This code is licensed under the MIT license (MIT) (http://opensource.org/licenses/MIT)
+*/
+
+#pragma once
+
+#include <stdint.h>
+#include <string>
+#include <vector>
+
+#if defined(__ANDROID__)
+#include <android/asset_manager.h>
+#endif
+
+namespace vkx {
+
+    // Layout of an asset pack file, all values little endian:
+    //
+    //   Header
+    //   Entry[entryCount]          table of contents at tocOffset, sorted by name
+    //   char[namesSize]            entry names (paths relative to the data folder, '/' separated)
+    //   entry data                 every entry starts at a multiple of ALIGNMENT
+    //
+    // Uncompressed entries are used in place from the mapping, the alignment keeps SPIR-V
+    // words and KTX image data aligned.  LZ4 (block format) compressed entries are
+    // decompressed on read.
+    namespace pack {
+        static const char MAGIC[8] = { 'V', 'K', 'X', 'P', 'A', 'C', 'K', 0 };
+        static const uint32_t VERSION = 1;
+        static const uint64_t ALIGNMENT = 64;
+
+        enum EntryFlags : uint16_t {
+            ENTRY_LZ4 = 0x1,
+        };
+
+        struct Header {
+            char magic[8];
+            uint32_t version;
+            uint32_t entryCount;
+            uint64_t tocOffset;
+            uint64_t namesOffset;
+            uint64_t namesSize;
+        };
+
+        struct Entry {
+            uint64_t offset;
+            // Stored size, differs from size if compressed
+            uint64_t storedSize;
+            uint64_t size;
+            uint32_t nameOffset;
+            uint16_t nameLength;
+            uint16_t flags;
+        };
+
+        static_assert(sizeof(Header) == 40, "Unexpected pack header size");
+        static_assert(sizeof(Entry) == 32, "Unexpected pack entry size");
+
+        // Decompresses an LZ4 block, throws if the data is corrupt
+        void lz4Decompress(const uint8_t* src, size_t srcSize, uint8_t* dst, size_t dstSize);
+    }
+
+    // Read only view of a packed file
+    class AssetPack {
+    public:
+        AssetPack() {}
+        ~AssetPack() { close(); }
+        AssetPack(const AssetPack&) = delete;
+        AssetPack& operator=(const AssetPack&) = delete;
+
+        // Maps the whole pack, file names are looked up relative to root
+        void open(const std::string& filename, const std::string& root = "");
+#if defined(__ANDROID__)
+        // The pack has to be stored uncompressed in the apk to be mapped
+        void open(AAssetManager* assetManager, const std::string& filename, const std::string& root = "");
+#endif
+        void close();
+        bool isOpen() const { return data != nullptr; }
+
+        const pack::Entry* find(const std::string& filename) const;
+        std::string name(const pack::Entry& entry) const;
+        const std::vector<pack::Entry>& entries() const { return toc; }
+
+        // Pointer into the mapping, nullptr for compressed entries
+        const uint8_t* map(const pack::Entry& entry) const;
+        // Copies (or decompresses) the entry to dst, which has to hold entry.size bytes
+        void read(const pack::Entry& entry, uint8_t* dst) const;
+        std::vector<uint8_t> read(const pack::Entry& entry) const;
+
+        // The pack used by readBinaryFile, readTextFile, loadShader, the texture
+        // and the mesh loader.  Files not in the pack are loaded from disk.
+        static AssetPack* mounted();
+        // Mounts the pack if the file exists, returns false otherwise
+        static bool mount(const std::string& filename, const std::string& root);
+#if defined(__ANDROID__)
+        static bool mount(AAssetManager* assetManager, const std::string& filename, const std::string& root);
+#endif
+        static void unmount();
+
+    private:
+        void parse(const std::string& filename);
+
+        std::string root;
+        const uint8_t* data{ nullptr };
+        size_t size{ 0 };
+        std::vector<pack::Entry> toc;
+        const char* names{ nullptr };
+#if defined(_WIN32)
+        void* fileHandle{ nullptr };
+        void* mappingHandle{ nullptr };
+#elif defined(__ANDROID__)
+        AAsset* asset{ nullptr };
+#endif
+    };
+
+    // Parses a KTX (version 1) file in place, without copying the image data
+    class KtxView {
+    public:
+        uint32_t width{ 0 };
+        uint32_t height{ 0 };
+        uint32_t depth{ 0 };
+        uint32_t levels{ 0 };
+        // Array layers, 1 for non array textures
+        uint32_t layers{ 0 };
+        uint32_t faces{ 0 };
+
+        // Throws if the data isn't a valid KTX file
+        KtxView(const uint8_t* data, size_t size);
+
+        // Image of a single mip level, array layer and cube face
+        const uint8_t* image(uint32_t level, uint32_t layer, uint32_t face) const;
+        size_t imageSize(uint32_t level) const { return levelImageSizes[level]; }
+
+    private:
+        std::vector<const uint8_t*> levelData;
+        // Size of one layer / face of each level
+        std::vector<size_t> levelImageSizes;
+        std::vector<size_t> levelStrides;
+    };
+}
@@ -1,5 +1,196 @@
 #include "vulkanContext.hpp"
 
+#include <assert.h>
+#include <atomic>
+
 using namespace vkx;
 
-thread_local vk::CommandPool Context::s_cmdPool;
+thread_local std::array<vk::CommandPool, 3> Context::s_cmdPools;
+thread_local Context::OneShotThreadState Context::s_oneShotThread;
+
+namespace {
+    // Command buffers allocated at once when a pool runs out
+    const uint32_t ONE_SHOT_ALLOCATION = 4;
+}
+
+uint64_t Context::nextOneShotRecyclerId() {
+    static std::atomic<uint64_t> lastId{ 0 };
+    return ++lastId;
+}
+
+Context::OneShotPools& Context::oneShotPools(QueueType type) const {
+    if (s_oneShotThread.recycler != oneShots->id) {
+        // First use on this thread, or the pools of the thread belong to another context
+        std::lock_guard<std::mutex> lock(oneShots->mutex);
+        oneShots->threads.push_back(std::make_unique<OneShotThread>());
+        s_oneShotThread.recycler = oneShots->id;
+        s_oneShotThread.pools = oneShots->threads.back().get();
+    }
+    return (*s_oneShotThread.pools)[getQueueFamilyIndex(type) == graphicsQueueIndex ? (size_t)QueueType::Graphics : (size_t)type];
+}
+
+vk::CommandBuffer Context::beginOneShot(QueueType type) const {
+    uint32_t queueFamilyIndex = getQueueFamilyIndex(type);
+    OneShotPools& pools = oneShotPools(type);
+
+    OneShotPool* pool = pools.pools.empty() ? nullptr : &pools.pools[pools.current];
+    if (!pool || (pool->recording == 0 && !pool->fences.empty())) {
+        // The batch of the current pool has been submitted, continue with the first pool that
+        // completed, starting with the current one for callers that wait for each submission
+        pool = nullptr;
+        for (uint32_t i = 0; i < (uint32_t)pools.pools.size() && !pool; ++i) {
+            uint32_t index = (pools.current + i) % (uint32_t)pools.pools.size();
+            OneShotPool& candidate = pools.pools[index];
+            if (candidate.recording > 0) {
+                continue;
+            }
+            bool completed = true;
+            for (const auto& fence : candidate.fences) {
+                if (device.getFenceStatus(fence) != vk::Result::eSuccess) {
+                    completed = false;
+                    break;
+                }
+            }
+            if (!completed) {
+                continue;
+            }
+            if (!candidate.fences.empty()) {
+                // The tickets are answered as completed once they are no longer pending
+                {
+                    std::lock_guard<std::mutex> lock(oneShots->mutex);
+                    for (uint64_t ticket : candidate.tickets) {
+                        oneShots->pending.erase(ticket);
+                    }
+                }
+                candidate.tickets.clear();
+                device.resetFences(candidate.fences);
+                pools.freeFences.insert(pools.freeFences.end(), candidate.fences.begin(), candidate.fences.end());
+                candidate.fences.clear();
+            }
+            if (candidate.used > 0) {
+                device.resetCommandPool(candidate.pool, vk::CommandPoolResetFlags());
+                candidate.used = 0;
+            }
+            pools.current = index;
+            pool = &candidate;
+        }
+        if (!pool) {
+            vk::CommandPoolCreateInfo cmdPoolInfo;
+            cmdPoolInfo.queueFamilyIndex = queueFamilyIndex;
+            cmdPoolInfo.flags = vk::CommandPoolCreateFlagBits::eTransient;
+            OneShotPool created;
+            created.pool = device.createCommandPool(cmdPoolInfo);
+            pools.pools.push_back(created);
+            pools.current = (uint32_t)pools.pools.size() - 1;
+            pool = &pools.pools.back();
+        }
+    }
+
+    if (pool->used == pool->commandBuffers.size()) {
+        vk::CommandBufferAllocateInfo cmdBufAllocateInfo;
+        cmdBufAllocateInfo.commandPool = pool->pool;
+        cmdBufAllocateInfo.level = vk::CommandBufferLevel::ePrimary;
+        cmdBufAllocateInfo.commandBufferCount = ONE_SHOT_ALLOCATION;
+        std::vector<vk::CommandBuffer> allocated = device.allocateCommandBuffers(cmdBufAllocateInfo);
+        pool->commandBuffers.insert(pool->commandBuffers.end(), allocated.begin(), allocated.end());
+    }
+    vk::CommandBuffer commandBuffer = pool->commandBuffers[pool->used++];
+    ++pool->recording;
+
+    vk::CommandBufferBeginInfo cmdBufInfo;
+    cmdBufInfo.flags = vk::CommandBufferUsageFlagBits::eOneTimeSubmit;
+    commandBuffer.begin(cmdBufInfo);
+    return commandBuffer;
+}
+
+uint64_t Context::submitOneShot(const vk::CommandBuffer& commandBuffer, QueueType type, bool wait) const {
+    OneShotPools& pools = oneShotPools(type);
+    // The current pool only changes once none of its command buffers is recording
+    assert(!pools.pools.empty() && pools.pools[pools.current].recording > 0);
+    OneShotPool& pool = pools.pools[pools.current];
+
+    commandBuffer.end();
+
+    vk::Fence fence;
+    if (pools.freeFences.empty()) {
+        fence = device.createFence(vk::FenceCreateInfo());
+    } else {
+        fence = pools.freeFences.back();
+        pools.freeFences.pop_back();
+    }
+
+    vk::SubmitInfo submitInfo;
+    submitInfo.commandBufferCount = 1;
+    submitInfo.pCommandBuffers = &commandBuffer;
+    getQueue(type).submit(submitInfo, fence);
+    pool.fences.push_back(fence);
+    --pool.recording;
+
+    uint64_t ticket;
+    {
+        std::lock_guard<std::mutex> lock(oneShots->mutex);
+        ticket = ++oneShots->lastTicket;
+        oneShots->pending[ticket] = fence;
+    }
+    pool.tickets.push_back(ticket);
+
+    if (wait) {
+        device.waitForFences(fence, VK_TRUE, UINT64_MAX);
+    }
+    return ticket;
+}
+
+bool Context::oneShotCompleted(uint64_t ticket) const {
+    // The fence of a pending ticket isn't reset before the ticket is removed under the lock
+    std::lock_guard<std::mutex> lock(oneShots->mutex);
+    auto it = oneShots->pending.find(ticket);
+    return it == oneShots->pending.end() || device.getFenceStatus(it->second) == vk::Result::eSuccess;
+}
+
+void Context::waitOneShot(uint64_t ticket) const {
+    // Waits without the lock, so the other threads can submit and recycle meanwhile.  A recycled
+    // fence may be reset before it is submitted again, the wait is bounded to see its ticket gone.
+    static const uint64_t RECHECK_NS = 1000000;
+    while (true) {
+        vk::Fence fence;
+        {
+            std::lock_guard<std::mutex> lock(oneShots->mutex);
+            auto it = oneShots->pending.find(ticket);
+            if (it == oneShots->pending.end()) {
+                return;
+            }
+            fence = it->second;
+        }
+        if (device.waitForFences(fence, VK_TRUE, RECHECK_NS) == vk::Result::eSuccess) {
+            return;
+        }
+    }
+}
+
+void Context::destroyOneShotPools() const {
+    if (!oneShots) {
+        return;
+    }
+    std::lock_guard<std::mutex> lock(oneShots->mutex);
+    for (auto& thread : oneShots->threads) {
+        for (auto& pools : *thread) {
+            for (auto& pool : pools.pools) {
+                if (!pool.fences.empty()) {
+                    device.waitForFences(pool.fences, VK_TRUE, UINT64_MAX);
+                    for (const auto& fence : pool.fences) {
+                        device.destroyFence(fence);
+                    }
+                }
+                device.destroyCommandPool(pool.pool);
+            }
+            for (const auto& fence : pools.freeFences) {
+                device.destroyFence(fence);
+            }
+            pools = OneShotPools();
+        }
+    }
+    oneShots->threads.clear();
+    oneShots->pending.clear();
+    // Threads that still refer to the destroyed pools register again
+    oneShots->id = nextOneShotRecyclerId();
+}
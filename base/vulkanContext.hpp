@@ -2,14 +2,24 @@
 
 #include <iostream>
 #include <algorithm>
+#include <array>
+#include <memory>
+#include <mutex>
+#include <unordered_map>
 
 #include <vulkan/vk_cpp.hpp>
 #include <gli/gli.hpp>
 
 #include "vulkanDebug.h"
 #include "vulkanTools.h"
+#include "vulkanHostAllocations.h"
+#include "vulkanResourceRegistry.h"
 
 namespace vkx {
+    // Queues created by the context, compute and transfer map to the graphics queue if the
+    // device has no dedicated families for them
+    enum class QueueType { Graphics, Compute, Transfer };
+
     class Context {
     public:
         // Set to true when example is created with enabled validation layers
@@ -18,11 +28,32 @@ namespace vkx {
         bool enableDebugMarkers = false;
         // fps timer (one second interval)
         float fpsTimer = 0.0f;
-        // Create application wide Vulkan instance
+        // Counts the host memory the implementation allocates if set before createContext.  The
+        // callbacks are passed to the instance and the device, most implementations fall back to
+        // the device's callbacks for objects created without their own.
+        bool enableHostAllocationTracking = false;
+        // Instance and device scope allocations of the tracker are served from an arena of this
+        // size, 0 for none
+        size_t hostAllocationArenaSize = 0;
+        std::shared_ptr<HostAllocationTracker> hostAllocations;
+
+        // Callbacks of the host allocation tracker, none without one
+        vk::Optional<const vk::AllocationCallbacks> allocator() const {
+            if (hostAllocations) {
+                return vk::Optional<const vk::AllocationCallbacks>(hostAllocations->callbacks());
+            }
+            return vk::Optional<const vk::AllocationCallbacks>(nullptr);
+        }
 
+        // Create application wide Vulkan instance
         void createContext(bool enableValidation) {
 
             this->enableValidation = enableValidation;
+            if (enableHostAllocationTracking) {
+                hostAllocations = std::make_shared<HostAllocationTracker>(hostAllocationArenaSize);
+                hostAllocations->routeToArena(vk::SystemAllocationScope::eInstance);
+                hostAllocations->routeToArena(vk::SystemAllocationScope::eDevice);
+            }
             {
                 // Vulkan instance
                 vk::ApplicationInfo appInfo;
@@ -53,7 +84,7 @@ namespace vkx {
                     instanceCreateInfo.enabledLayerCount = debug::validationLayerCount;
                     instanceCreateInfo.ppEnabledLayerNames = debug::validationLayerNames;
                 }
-                instance = vk::createInstance(instanceCreateInfo);
+                instance = vk::createInstance(instanceCreateInfo, allocator());
             }
 
 #if defined(__ANDROID__)
@@ -74,19 +105,36 @@ namespace vkx {
             // Gather physical device memory properties
             deviceMemoryProperties = physicalDevice.getMemoryProperties();
 
+            // Find a queue that supports graphics operations
+            graphicsQueueIndex = findQueue(vk::QueueFlagBits::eGraphics);
+            // Async compute and transfer (DMA) queues, if the device exposes separate families for them
+            uint32_t computeQueueIndex = findDedicatedQueue(vk::QueueFlagBits::eCompute, vk::QueueFlagBits::eGraphics);
+            uint32_t transferQueueIndex = findDedicatedQueue(vk::QueueFlagBits::eTransfer, vk::QueueFlagBits::eGraphics | vk::QueueFlagBits::eCompute);
+            queueFamilyIndices[(size_t)QueueType::Graphics] = graphicsQueueIndex;
+            queueFamilyIndices[(size_t)QueueType::Compute] = computeQueueIndex != VK_QUEUE_FAMILY_IGNORED ? computeQueueIndex : graphicsQueueIndex;
+            queueFamilyIndices[(size_t)QueueType::Transfer] = transferQueueIndex != VK_QUEUE_FAMILY_IGNORED ? transferQueueIndex : graphicsQueueIndex;
+
             // Vulkan device
             {
-                // Find a queue that supports graphics operations
-                uint32_t graphicsQueueIndex = findQueue(vk::QueueFlagBits::eGraphics);
+                // One queue for each distinct family
                 std::array<float, 1> queuePriorities = { 0.0f };
-                vk::DeviceQueueCreateInfo queueCreateInfo;
-                queueCreateInfo.queueFamilyIndex = graphicsQueueIndex;
-                queueCreateInfo.queueCount = 1;
-                queueCreateInfo.pQueuePriorities = queuePriorities.data();
+                std::vector<vk::DeviceQueueCreateInfo> queueCreateInfos;
+                for (uint32_t queueFamilyIndex : queueFamilyIndices) {
+                    auto created = std::find_if(queueCreateInfos.begin(), queueCreateInfos.end(), [&](const vk::DeviceQueueCreateInfo& queueCreateInfo) {
+                        return queueCreateInfo.queueFamilyIndex == queueFamilyIndex;
+                    });
+                    if (created == queueCreateInfos.end()) {
+                        vk::DeviceQueueCreateInfo queueCreateInfo;
+                        queueCreateInfo.queueFamilyIndex = queueFamilyIndex;
+                        queueCreateInfo.queueCount = 1;
+                        queueCreateInfo.pQueuePriorities = queuePriorities.data();
+                        queueCreateInfos.push_back(queueCreateInfo);
+                    }
+                }
                 std::vector<const char*> enabledExtensions = { VK_KHR_SWAPCHAIN_EXTENSION_NAME };
                 vk::DeviceCreateInfo deviceCreateInfo;
-                deviceCreateInfo.queueCreateInfoCount = 1;
-                deviceCreateInfo.pQueueCreateInfos = &queueCreateInfo;
+                deviceCreateInfo.queueCreateInfoCount = (uint32_t)queueCreateInfos.size();
+                deviceCreateInfo.pQueueCreateInfos = queueCreateInfos.data();
                 deviceCreateInfo.pEnabledFeatures = &deviceFeatures;
                 // enable the debug marker extension if it is present (likely meaning a debugging tool is present)
                 if (vkx::checkDeviceExtensionPresent(physicalDevice, VK_EXT_DEBUG_MARKER_EXTENSION_NAME)) {
@@ -101,7 +149,7 @@ namespace vkx {
                     deviceCreateInfo.enabledLayerCount = debug::validationLayerCount;
                     deviceCreateInfo.ppEnabledLayerNames = debug::validationLayerNames;
                 }
-                device = physicalDevice.createDevice(deviceCreateInfo);
+                device = physicalDevice.createDevice(deviceCreateInfo, allocator());
             }
 
             if (enableValidation) {
@@ -112,22 +160,25 @@ namespace vkx {
                 debug::marker::setup(device);
             }
             pipelineCache = device.createPipelineCache(vk::PipelineCacheCreateInfo());
-            // Find a queue that supports graphics operations
-            graphicsQueueIndex = findQueue(vk::QueueFlagBits::eGraphics);
+            oneShots = std::make_shared<OneShotRecycler>();
+            oneShots->id = nextOneShotRecyclerId();
             // Get the graphics queue
             queue = device.getQueue(graphicsQueueIndex, 0);
+            for (size_t i = 0; i < queues.size(); ++i) {
+                queues[i] = device.getQueue(queueFamilyIndices[i], 0);
+            }
 
         }
 
         void destroyContext() {
             destroyCommandPool();
             device.destroyPipelineCache(pipelineCache);
-            device.destroy();
+            device.destroy(allocator());
             if (enableValidation) {
                 debug::freeDebugCallback(instance);
             }
 
-            instance.destroy();
+            instance.destroy(allocator());
         }
 
         uint32_t findQueue(const vk::QueueFlags& flags, const vk::SurfaceKHR& presentSurface = vk::SurfaceKHR()) {
@@ -144,6 +195,30 @@ namespace vkx {
             throw std::runtime_error("No queue matches the flags " + vk::to_string(flags));
         }
 
+        // First queue family with the flags and none of the excluded flags, VK_QUEUE_FAMILY_IGNORED if there is none
+        uint32_t findDedicatedQueue(const vk::QueueFlags& flags, const vk::QueueFlags& excludedFlags) const {
+            std::vector<vk::QueueFamilyProperties> queueProps = physicalDevice.getQueueFamilyProperties();
+            for (uint32_t i = 0; i < (uint32_t)queueProps.size(); i++) {
+                if ((queueProps[i].queueFlags & flags) == flags && !(queueProps[i].queueFlags & excludedFlags)) {
+                    return i;
+                }
+            }
+            return VK_QUEUE_FAMILY_IGNORED;
+        }
+
+        const vk::Queue& getQueue(QueueType type) const {
+            return queues[(size_t)type];
+        }
+
+        uint32_t getQueueFamilyIndex(QueueType type) const {
+            return queueFamilyIndices[(size_t)type];
+        }
+
+        // True if work submitted to the queue can overlap with rendering
+        bool hasDedicatedQueue(QueueType type) const {
+            return type != QueueType::Graphics && getQueueFamilyIndex(type) != graphicsQueueIndex;
+        }
+
         // Vulkan instance, stores all per-application states
         vk::Instance instance;
         std::vector<vk::PhysicalDevice> physicalDevices;
@@ -163,35 +238,109 @@ namespace vkx {
         vk::Queue queue;
         // Find a queue that supports graphics operations
         uint32_t graphicsQueueIndex;
+        // Queues and their families by QueueType
+        std::array<vk::Queue, 3> queues;
+        std::array<uint32_t, 3> queueFamilyIndices;
 
 
 #ifdef WIN32
-        static thread_local vk::CommandPool s_cmdPool;
+        static thread_local std::array<vk::CommandPool, 3> s_cmdPools;
 #else
-        static thread_local vk::CommandPool s_cmdPool;
+        static thread_local std::array<vk::CommandPool, 3> s_cmdPools;
 #endif
 
-        const vk::CommandPool& getCommandPool() const {
-            if (!s_cmdPool) {
+        // Per thread command pool for the family of the queue, queues sharing the graphics family share its pool
+        const vk::CommandPool& getCommandPool(QueueType type = QueueType::Graphics) const {
+            uint32_t queueFamilyIndex = getQueueFamilyIndex(type);
+            vk::CommandPool& cmdPool = s_cmdPools[queueFamilyIndex == graphicsQueueIndex ? (size_t)QueueType::Graphics : (size_t)type];
+            if (!cmdPool) {
                 vk::CommandPoolCreateInfo cmdPoolInfo;
-                cmdPoolInfo.queueFamilyIndex = graphicsQueueIndex;
+                cmdPoolInfo.queueFamilyIndex = queueFamilyIndex;
                 cmdPoolInfo.flags = vk::CommandPoolCreateFlagBits::eResetCommandBuffer;
-                s_cmdPool = device.createCommandPool(cmdPoolInfo);
+                cmdPool = device.createCommandPool(cmdPoolInfo);
             }
-            return s_cmdPool;
+            return cmdPool;
         }
 
         void destroyCommandPool() {
-            if (s_cmdPool) {
-                device.destroyCommandPool(s_cmdPool);
-                s_cmdPool = vk::CommandPool();
+            for (auto& cmdPool : s_cmdPools) {
+                if (cmdPool) {
+                    device.destroyCommandPool(cmdPool);
+                    cmdPool = vk::CommandPool();
+                }
             }
+            destroyOneShotPools();
         }
 
-        vk::CommandBuffer createCommandBuffer(vk::CommandBufferLevel level = vk::CommandBufferLevel::ePrimary, bool begin = false) const {
+        // Recycler for one-shot command buffers.  Every thread has a ring of transient pools per
+        // queue family, command buffers are handed out from the current pool and each submission
+        // gets a fence.  Once the current pool has no command buffer left in recording the next
+        // request moves on to the first pool whose fences have all signaled, resets it as a whole
+        // and reuses the command buffers it already allocated.  A new pool is only created when
+        // all of them are still in flight, so setup code recording many small uploads stops
+        // allocating after the first few.  Command buffers have to be submitted from the thread
+        // that began them.
+        //
+        // The pools of all threads belong to the context's OneShotRecycler, so that
+        // destroyOneShotPools can free those of worker threads too.  Fences never leave the
+        // recycler, submissions are identified by tickets instead.
+        struct OneShotPool {
+            vk::CommandPool pool;
+            std::vector<vk::CommandBuffer> commandBuffers;
+            // Handed out since the last reset
+            uint32_t used{ 0 };
+            // Handed out and not submitted yet
+            uint32_t recording{ 0 };
+            // One per submission since the last reset, and the tickets of the submissions
+            std::vector<vk::Fence> fences;
+            std::vector<uint64_t> tickets;
+        };
+
+        struct OneShotPools {
+            std::vector<OneShotPool> pools;
+            uint32_t current{ 0 };
+            std::vector<vk::Fence> freeFences;
+        };
+
+        // Indexed like s_cmdPools
+        using OneShotThread = std::array<OneShotPools, 3>;
+
+        struct OneShotRecycler {
+            // Unique for every recycler, threads find their pools by it
+            uint64_t id{ 0 };
+            std::mutex mutex;
+            std::vector<std::unique_ptr<OneShotThread>> threads;
+            // Fences of the submissions that weren't seen to complete yet, by ticket
+            std::unordered_map<uint64_t, vk::Fence> pending;
+            uint64_t lastTicket{ 0 };
+        };
+        // Shared by the copies of the context, created with the device
+        std::shared_ptr<OneShotRecycler> oneShots;
+
+        // Pools of the calling thread and the recycler they belong to
+        struct OneShotThreadState {
+            uint64_t recycler{ 0 };
+            OneShotThread* pools{ nullptr };
+        };
+        static thread_local OneShotThreadState s_oneShotThread;
+        OneShotPools& oneShotPools(QueueType type) const;
+
+        // Begins a primary command buffer from the calling thread's recycler
+        vk::CommandBuffer beginOneShot(QueueType type = QueueType::Graphics) const;
+        // Ends and submits a command buffer from beginOneShot, optionally waiting for it.  Returns
+        // the ticket of the submission for oneShotCompleted and waitOneShot, which can be called
+        // from any thread.
+        uint64_t submitOneShot(const vk::CommandBuffer& commandBuffer, QueueType type = QueueType::Graphics, bool wait = true) const;
+        bool oneShotCompleted(uint64_t ticket) const;
+        void waitOneShot(uint64_t ticket) const;
+        // Waits for the one-shot submissions of all threads and destroys their pools
+        void destroyOneShotPools() const;
+        static uint64_t nextOneShotRecyclerId();
+
+        vk::CommandBuffer createCommandBuffer(vk::CommandBufferLevel level = vk::CommandBufferLevel::ePrimary, bool begin = false, QueueType type = QueueType::Graphics) const {
             vk::CommandBuffer cmdBuffer;
             vk::CommandBufferAllocateInfo cmdBufAllocateInfo;
-            cmdBufAllocateInfo.commandPool = getCommandPool();
+            cmdBufAllocateInfo.commandPool = getCommandPool(type);
             cmdBufAllocateInfo.level = level;
             cmdBufAllocateInfo.commandBufferCount = 1;
 
@@ -205,7 +354,7 @@ namespace vkx {
             return cmdBuffer;
         }
 
-        void flushCommandBuffer(vk::CommandBuffer& commandBuffer, bool free = false) const {
+        void flushCommandBuffer(vk::CommandBuffer& commandBuffer, bool free = false, QueueType type = QueueType::Graphics) const {
             if (!commandBuffer) {
                 return;
             }
@@ -215,21 +364,85 @@ namespace vkx {
             vk::SubmitInfo submitInfo;
             submitInfo.commandBufferCount = 1;
             submitInfo.pCommandBuffers = &commandBuffer;
-            queue.submit(submitInfo, vk::Fence());
-            queue.waitIdle();
+            getQueue(type).submit(submitInfo, vk::Fence());
+            getQueue(type).waitIdle();
 
             if (free) {
-                device.freeCommandBuffers(getCommandPool(), commandBuffer);
+                device.freeCommandBuffers(getCommandPool(type), commandBuffer);
                 commandBuffer = vk::CommandBuffer();
             }
         }
 
-        // Create a short lived command buffer which is immediately executed and released
+        // Records a short lived command buffer and executes it, returns once it completed
         template <typename F>
-        void withPrimaryCommandBuffer(F f) const {
-            vk::CommandBuffer commandBuffer = createCommandBuffer(vk::CommandBufferLevel::ePrimary, true);
+        void withPrimaryCommandBuffer(F f, QueueType type = QueueType::Graphics) const {
+            vk::CommandBuffer commandBuffer = beginOneShot(type);
             f(commandBuffer);
-            flushCommandBuffer(commandBuffer, true);
+            submitOneShot(commandBuffer, type, true);
+        }
+
+        // Queue family ownership transfer of exclusive resources between two queues.  Release is
+        // recorded on the source queue after its last access, acquire with the same layouts and
+        // ranges on the destination queue before its first access, and the acquiring submission
+        // has to wait for the releasing one with a semaphore.  Between queues of the same family
+        // the semaphore is all that is needed, only the layout transition is recorded (by acquire).
+        void releaseBuffer(const vk::CommandBuffer& cmdBuffer, vk::Buffer buffer, QueueType srcQueue, QueueType dstQueue, const vk::AccessFlags& srcAccess, const vk::PipelineStageFlags& srcStage, vk::DeviceSize offset = 0, vk::DeviceSize size = VK_WHOLE_SIZE) const {
+            if (getQueueFamilyIndex(srcQueue) == getQueueFamilyIndex(dstQueue)) {
+                return;
+            }
+            vk::BufferMemoryBarrier bufferBarrier;
+            bufferBarrier.srcAccessMask = srcAccess;
+            bufferBarrier.srcQueueFamilyIndex = getQueueFamilyIndex(srcQueue);
+            bufferBarrier.dstQueueFamilyIndex = getQueueFamilyIndex(dstQueue);
+            bufferBarrier.buffer = buffer;
+            bufferBarrier.offset = offset;
+            bufferBarrier.size = size;
+            cmdBuffer.pipelineBarrier(srcStage, vk::PipelineStageFlagBits::eBottomOfPipe, vk::DependencyFlags(), nullptr, bufferBarrier, nullptr);
+        }
+
+        void acquireBuffer(const vk::CommandBuffer& cmdBuffer, vk::Buffer buffer, QueueType srcQueue, QueueType dstQueue, const vk::AccessFlags& dstAccess, const vk::PipelineStageFlags& dstStage, vk::DeviceSize offset = 0, vk::DeviceSize size = VK_WHOLE_SIZE) const {
+            if (getQueueFamilyIndex(srcQueue) == getQueueFamilyIndex(dstQueue)) {
+                return;
+            }
+            vk::BufferMemoryBarrier bufferBarrier;
+            bufferBarrier.dstAccessMask = dstAccess;
+            bufferBarrier.srcQueueFamilyIndex = getQueueFamilyIndex(srcQueue);
+            bufferBarrier.dstQueueFamilyIndex = getQueueFamilyIndex(dstQueue);
+            bufferBarrier.buffer = buffer;
+            bufferBarrier.offset = offset;
+            bufferBarrier.size = size;
+            cmdBuffer.pipelineBarrier(vk::PipelineStageFlagBits::eTopOfPipe, dstStage, vk::DependencyFlags(), nullptr, bufferBarrier, nullptr);
+        }
+
+        void releaseImage(const vk::CommandBuffer& cmdBuffer, vk::Image image, const vk::ImageSubresourceRange& range, vk::ImageLayout oldLayout, vk::ImageLayout newLayout, QueueType srcQueue, QueueType dstQueue, const vk::AccessFlags& srcAccess, const vk::PipelineStageFlags& srcStage) const {
+            if (getQueueFamilyIndex(srcQueue) == getQueueFamilyIndex(dstQueue)) {
+                return;
+            }
+            vk::ImageMemoryBarrier imageBarrier;
+            imageBarrier.srcAccessMask = srcAccess;
+            imageBarrier.oldLayout = oldLayout;
+            imageBarrier.newLayout = newLayout;
+            imageBarrier.srcQueueFamilyIndex = getQueueFamilyIndex(srcQueue);
+            imageBarrier.dstQueueFamilyIndex = getQueueFamilyIndex(dstQueue);
+            imageBarrier.image = image;
+            imageBarrier.subresourceRange = range;
+            cmdBuffer.pipelineBarrier(srcStage, vk::PipelineStageFlagBits::eBottomOfPipe, vk::DependencyFlags(), nullptr, nullptr, imageBarrier);
+        }
+
+        void acquireImage(const vk::CommandBuffer& cmdBuffer, vk::Image image, const vk::ImageSubresourceRange& range, vk::ImageLayout oldLayout, vk::ImageLayout newLayout, QueueType srcQueue, QueueType dstQueue, const vk::AccessFlags& dstAccess, const vk::PipelineStageFlags& dstStage) const {
+            bool sameFamily = getQueueFamilyIndex(srcQueue) == getQueueFamilyIndex(dstQueue);
+            if (sameFamily && oldLayout == newLayout) {
+                return;
+            }
+            vk::ImageMemoryBarrier imageBarrier;
+            imageBarrier.dstAccessMask = dstAccess;
+            imageBarrier.oldLayout = oldLayout;
+            imageBarrier.newLayout = newLayout;
+            imageBarrier.srcQueueFamilyIndex = sameFamily ? VK_QUEUE_FAMILY_IGNORED : getQueueFamilyIndex(srcQueue);
+            imageBarrier.dstQueueFamilyIndex = sameFamily ? VK_QUEUE_FAMILY_IGNORED : getQueueFamilyIndex(dstQueue);
+            imageBarrier.image = image;
+            imageBarrier.subresourceRange = range;
+            cmdBuffer.pipelineBarrier(vk::PipelineStageFlagBits::eTopOfPipe, dstStage, vk::DependencyFlags(), nullptr, nullptr, imageBarrier);
         }
 
         CreateImageResult createImage(const vk::ImageCreateInfo& imageCreateInfo, const vk::MemoryPropertyFlags& memoryPropertyFlags) {
@@ -240,13 +453,18 @@ namespace vkx {
             vk::MemoryRequirements memReqs = device.getImageMemoryRequirements(result.image);
             vk::MemoryAllocateInfo memAllocInfo;
             memAllocInfo.allocationSize = result.allocSize = memReqs.size;
-            memAllocInfo.memoryTypeIndex = getMemoryType(memReqs.memoryTypeBits, vk::MemoryPropertyFlagBits::eDeviceLocal);
+            memAllocInfo.memoryTypeIndex = getMemoryType(memReqs.memoryTypeBits, memoryPropertyFlags);
+            result.memoryPropertyFlags = deviceMemoryProperties.memoryTypes[memAllocInfo.memoryTypeIndex].propertyFlags;
+            result.nonCoherentAtomSize = deviceProperties.limits.nonCoherentAtomSize;
             result.memory = device.allocateMemory(memAllocInfo);
             device.bindImageMemory(result.image, result.memory, 0);
+            ResourceRegistry::get().add(result.memory, ResourceKind::Image, ResourceRegistry::categorize(imageCreateInfo.usage), result.allocSize);
             return result;
         }
 
-        CreateBufferResult createBuffer(const vk::BufferUsageFlags& usageFlags, const vk::MemoryPropertyFlags& memoryPropertyFlags, vk::DeviceSize size, const void * data = nullptr) const {
+        // Allocates from a memory type with all of memoryPropertyFlags, one that also has the
+        // preferredPropertyFlags if there is one
+        CreateBufferResult createBuffer(const vk::BufferUsageFlags& usageFlags, const vk::MemoryPropertyFlags& memoryPropertyFlags, const vk::MemoryPropertyFlags& preferredPropertyFlags, vk::DeviceSize size, const void * data = nullptr) const {
             CreateBufferResult result;
             result.device = device;
             result.size = size;
@@ -262,17 +480,39 @@ namespace vkx {
             vk::MemoryRequirements memReqs = device.getBufferMemoryRequirements(result.buffer);
             vk::MemoryAllocateInfo memAlloc;
             result.allocSize = memAlloc.allocationSize = memReqs.size;
-            memAlloc.memoryTypeIndex = getMemoryType(memReqs.memoryTypeBits, memoryPropertyFlags);
+            memAlloc.memoryTypeIndex = getMemoryType(memReqs.memoryTypeBits, memoryPropertyFlags, preferredPropertyFlags);
+            result.memoryPropertyFlags = deviceMemoryProperties.memoryTypes[memAlloc.memoryTypeIndex].propertyFlags;
+            result.nonCoherentAtomSize = deviceProperties.limits.nonCoherentAtomSize;
             result.memory = device.allocateMemory(memAlloc);
-            if (data != nullptr) {
-                copyToMemory(result.memory, data, size);
-            }
             device.bindBufferMemory(result.buffer, result.memory, 0);
+            ResourceRegistry::get().add(result.memory, ResourceKind::Buffer, ResourceRegistry::categorize(usageFlags), result.allocSize);
+            // Host visible memory stays mapped for the lifetime of the buffer
+            if (result.memoryPropertyFlags & vk::MemoryPropertyFlagBits::eHostVisible) {
+                result.mapped = device.mapMemory(result.memory, 0, VK_WHOLE_SIZE, vk::MemoryMapFlags());
+                result.persistent = true;
+                if (data != nullptr) {
+                    result.copy(size, data);
+                    result.flush(0, size);
+                }
+            } else if (data != nullptr) {
+                throw std::runtime_error("Initial buffer data requires host visible memory, use stageToDeviceBuffer");
+            }
             return result;
         }
 
+        CreateBufferResult createBuffer(const vk::BufferUsageFlags& usageFlags, const vk::MemoryPropertyFlags& memoryPropertyFlags, vk::DeviceSize size, const void * data = nullptr) const {
+            return createBuffer(usageFlags, memoryPropertyFlags, vk::MemoryPropertyFlags(), size, data);
+        }
+
+        // Host visible buffers default to coherent memory, writes through the mapping need no flush
         CreateBufferResult createBuffer(const vk::BufferUsageFlags& usage, vk::DeviceSize size, const void * data = nullptr) const {
-            return createBuffer(usage, vk::MemoryPropertyFlagBits::eHostVisible, size, data);
+            return createBuffer(usage, vk::MemoryPropertyFlagBits::eHostVisible | vk::MemoryPropertyFlagBits::eHostCoherent, size, data);
+        }
+
+        // Destination of device to host copies.  Cached memory is preferred since the host reads it,
+        // it may not be coherent, so invalidate() before reading.
+        CreateBufferResult createReadbackBuffer(vk::DeviceSize size) const {
+            return createBuffer(vk::BufferUsageFlagBits::eTransferDst, vk::MemoryPropertyFlagBits::eHostVisible, vk::MemoryPropertyFlagBits::eHostCached, size);
         }
 
         template <typename T>
@@ -282,7 +522,7 @@ namespace vkx {
 
         template <typename T>
         CreateBufferResult createBuffer(const vk::BufferUsageFlags& usage, const T& data) const {
-            return createBuffer(usage, vk::MemoryPropertyFlagBits::eHostVisible, data);
+            return createBuffer(usage, vk::MemoryPropertyFlagBits::eHostVisible | vk::MemoryPropertyFlagBits::eHostCoherent, data);
         }
 
         template <typename T>
@@ -292,7 +532,7 @@ namespace vkx {
 
         template <typename T>
         CreateBufferResult createBuffer(const vk::BufferUsageFlags& usage, const std::vector<T>& data) const {
-            return createBuffer(usage, vk::MemoryPropertyFlagBits::eHostVisible, data);
+            return createBuffer(usage, vk::MemoryPropertyFlagBits::eHostVisible | vk::MemoryPropertyFlagBits::eHostCoherent, data);
         }
 
         template <typename T>
@@ -300,6 +540,24 @@ namespace vkx {
             return createBuffer(vk::BufferUsageFlagBits::eUniformBuffer, vk::MemoryPropertyFlagBits::eHostVisible | vk::MemoryPropertyFlagBits::eHostCoherent, data);
         }
 
+        // Moves a registered allocation to another category of the resource registry and names it,
+        // and with the debug marker extension the buffer or image and its memory
+        void nameResource(vk::Buffer buffer, vk::DeviceMemory memory, ResourceCategory category, const std::string& name) const {
+            ResourceRegistry::get().tag(memory, category, name);
+            if (debug::marker::active) {
+                debug::marker::setBufferName((VkDevice)device, (VkBuffer)buffer, name.c_str());
+                debug::marker::setDeviceMemoryName((VkDevice)device, (VkDeviceMemory)memory, name.c_str());
+            }
+        }
+
+        void nameResource(vk::Image image, vk::DeviceMemory memory, ResourceCategory category, const std::string& name) const {
+            ResourceRegistry::get().tag(memory, category, name);
+            if (debug::marker::active) {
+                debug::marker::setImageName((VkDevice)device, (VkImage)image, name.c_str());
+                debug::marker::setDeviceMemoryName((VkDevice)device, (VkDeviceMemory)memory, name.c_str());
+            }
+        }
+
         void copyToMemory(const vk::DeviceMemory & memory, const void* data, vk::DeviceSize size, vk::DeviceSize offset = 0) const {
             void *mapped = device.mapMemory(memory, offset, size, vk::MemoryMapFlags());
             memcpy(mapped, data, size);
@@ -322,8 +580,7 @@ namespace vkx {
             withPrimaryCommandBuffer([&](vk::CommandBuffer copyCmd) {
                 copyCmd.copyBuffer(staging.buffer, result.buffer, vk::BufferCopy(0, 0, size));
             });
-            device.freeMemory(staging.memory);
-            device.destroyBuffer(staging.buffer);
+            staging.destroy();
             return result;
         }
 
@@ -351,6 +608,14 @@ namespace vkx {
             return false;
         }
 
+        uint32_t getMemoryType(uint32_t typeBits, const vk::MemoryPropertyFlags& properties, const vk::MemoryPropertyFlags& preferred) const {
+            uint32_t result = 0;
+            if (preferred && getMemoryType(typeBits, properties | preferred, &result)) {
+                return result;
+            }
+            return getMemoryType(typeBits, properties);
+        }
+
         uint32_t getMemoryType(uint32_t typeBits, const vk::MemoryPropertyFlags& properties) const {
             uint32_t result = 0;
             if (!getMemoryType(typeBits, properties, &result)) {
@@ -0,0 +1,103 @@
+/*
+* Deferred destruction of Vulkan resources
+*
+* This code is licensed under the MIT license (MIT) (http://opensource.org/licenses/MIT)
+*/
+
+#include "vulkanDeletionQueue.h"
+
+#include "vulkanResourceRegistry.h"
+
+using namespace vkx;
+
+void DeletionQueue::retire(const std::function<void()>& destroy) {
+    entries.push_back({ frame, destroy });
+}
+
+void DeletionQueue::retire(vk::Buffer buffer) {
+    if (buffer) {
+        vk::Device device = this->device;
+        retire([=] { device.destroyBuffer(buffer); });
+    }
+}
+
+void DeletionQueue::retire(vk::Image image) {
+    if (image) {
+        vk::Device device = this->device;
+        retire([=] { device.destroyImage(image); });
+    }
+}
+
+void DeletionQueue::retire(vk::ImageView view) {
+    if (view) {
+        vk::Device device = this->device;
+        retire([=] { device.destroyImageView(view); });
+    }
+}
+
+void DeletionQueue::retire(vk::Sampler sampler) {
+    if (sampler) {
+        vk::Device device = this->device;
+        retire([=] { device.destroySampler(sampler); });
+    }
+}
+
+void DeletionQueue::retire(vk::DeviceMemory memory) {
+    if (memory) {
+        vk::Device device = this->device;
+        retire([=] {
+            ResourceRegistry::get().remove(memory);
+            device.freeMemory(memory);
+        });
+    }
+}
+
+void DeletionQueue::retire(vk::Framebuffer framebuffer) {
+    if (framebuffer) {
+        vk::Device device = this->device;
+        retire([=] { device.destroyFramebuffer(framebuffer); });
+    }
+}
+
+void DeletionQueue::retire(vk::Pipeline pipeline) {
+    if (pipeline) {
+        vk::Device device = this->device;
+        retire([=] { device.destroyPipeline(pipeline); });
+    }
+}
+
+void DeletionQueue::retire(vk::DescriptorPool descriptorPool) {
+    if (descriptorPool) {
+        vk::Device device = this->device;
+        retire([=] { device.destroyDescriptorPool(descriptorPool); });
+    }
+}
+
+void DeletionQueue::retire(vk::SwapchainKHR swapChain) {
+    if (swapChain) {
+        vk::Device device = this->device;
+        retire([=] { device.destroySwapchainKHR(swapChain); });
+    }
+}
+
+void DeletionQueue::retire(vk::CommandPool cmdPool, const std::vector<vk::CommandBuffer>& cmdBuffers) {
+    if (!cmdBuffers.empty()) {
+        vk::Device device = this->device;
+        retire([=] { device.freeCommandBuffers(cmdPool, cmdBuffers); });
+    }
+}
+
+void DeletionQueue::collect(uint64_t completedFrame) {
+    // Entries are ordered by frame
+    while (!entries.empty() && entries.front().frame <= completedFrame) {
+        entries.front().destroy();
+        entries.pop_front();
+    }
+}
+
+void DeletionQueue::flush() {
+    for (auto& entry : entries) {
+        entry.destroy();
+    }
+    entries.clear();
+}
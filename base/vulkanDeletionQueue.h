@@ -0,0 +1,65 @@
+/*
+* Deferred destruction of Vulkan resources
+*
+* This code is licensed under the MIT license (MIT) (http://opensource.org/licenses/MIT)
+*/
+
+#pragma once
+
+#include <stdint.h>
+#include <deque>
+#include <functional>
+#include <vector>
+
+#include <vulkan/vk_cpp.hpp>
+
+namespace vkx {
+
+    // Defers the destruction of resources that frames still in flight may use, so replacing them
+    // doesn't require waiting for the device to go idle.  Resources retired while frame N is
+    // recorded are destroyed by collect() once the owner has seen frame N's fence signal.
+    class DeletionQueue {
+    public:
+        DeletionQueue(const vk::Device& device) : device(device) {}
+
+        void retire(const std::function<void()>& destroy);
+        void retire(vk::Buffer buffer);
+        void retire(vk::Image image);
+        void retire(vk::ImageView view);
+        void retire(vk::Sampler sampler);
+        void retire(vk::DeviceMemory memory);
+        void retire(vk::Framebuffer framebuffer);
+        void retire(vk::Pipeline pipeline);
+        void retire(vk::DescriptorPool descriptorPool);
+        void retire(vk::SwapchainKHR swapChain);
+        void retire(vk::CommandPool cmdPool, const std::vector<vk::CommandBuffer>& cmdBuffers);
+
+        // Allocated buffers, images and textures are destroyed as a whole, the passed object is
+        // cleared so it can be recreated right away
+        template <typename T>
+        void retire(T& resource) {
+            T retired = resource;
+            resource = T();
+            retire(std::function<void()>([retired]() mutable { retired.destroy(); }));
+        }
+
+        // Ends the frame being recorded and returns its index
+        uint64_t endFrame() { return frame++; }
+        // Destroys the resources retired during the frames up to and including completedFrame
+        void collect(uint64_t completedFrame);
+        // Destroys all retired resources, the device has to be idle
+        void flush();
+
+        size_t size() const { return entries.size(); }
+
+    private:
+        struct Entry {
+            uint64_t frame;
+            std::function<void()> destroy;
+        };
+
+        const vk::Device& device;
+        std::deque<Entry> entries;
+        uint64_t frame{ 0 };
+    };
+}
@@ -0,0 +1,116 @@
+/*
+* Dynamic resolution controller
+*
+* This code is licensed under the MIT license (MIT) (http://opensource.org/licenses/MIT)
+*/
+
+#include "vulkanDynamicResolution.h"
+
+#include <algorithm>
+#include <cmath>
+#include <fstream>
+#include <iomanip>
+#include <sstream>
+
+#include "vulkanContext.hpp"
+
+namespace vkx {
+
+void DynamicResolution::prepare() {
+    vk::QueryPoolCreateInfo queryPoolInfo;
+    queryPoolInfo.queryType = vk::QueryType::eTimestamp;
+    queryPoolInfo.queryCount = 2;
+    queryPool = context.device.createQueryPool(queryPoolInfo);
+}
+
+void DynamicResolution::destroy() {
+    if (queryPool) {
+        context.device.destroyQueryPool(queryPool);
+        queryPool = vk::QueryPool();
+    }
+}
+
+void DynamicResolution::beginFrame(const vk::CommandBuffer& cmdBuffer) const {
+    cmdBuffer.resetQueryPool(queryPool, 0, 2);
+    cmdBuffer.writeTimestamp(vk::PipelineStageFlagBits::eTopOfPipe, queryPool, 0);
+}
+
+void DynamicResolution::endFrame(const vk::CommandBuffer& cmdBuffer) const {
+    cmdBuffer.writeTimestamp(vk::PipelineStageFlagBits::eBottomOfPipe, queryPool, 1);
+}
+
+bool DynamicResolution::update() {
+    if (!queryPool) {
+        return false;
+    }
+    // No wait, the queries are not available if the frame did not record beginFrame() / endFrame()
+    uint64_t timestamps[2];
+    vk::Result result = context.device.getQueryPoolResults(queryPool, 0, 2, sizeof(timestamps), timestamps, sizeof(uint64_t), vk::QueryResultFlagBits::e64);
+    if (result != vk::Result::eSuccess) {
+        return false;
+    }
+    float timestampPeriod = context.deviceProperties.limits.timestampPeriod / 1000000.0f;
+    gpuTime = (float)(timestamps[1] - timestamps[0]) * timestampPeriod;
+    smoothedTime = history.empty() ? gpuTime : smoothedTime + (gpuTime - smoothedTime) * smoothing;
+
+    // The cost of the scaled passes is roughly proportional to the pixel count, i.e. the
+    // square of the scale
+    float newScale = scale;
+    if (smoothedTime > 0.0f) {
+        newScale = std::min(std::max(scale * sqrtf(targetFrameTime / smoothedTime), minScale), maxScale);
+    }
+    // Always settle on the bounds, even if they are closer than the threshold
+    bool changed = fabsf(newScale - scale) >= threshold ||
+        (newScale != scale && (newScale == minScale || newScale == maxScale));
+    if (changed) {
+        scale = newScale;
+    }
+    history.push_back({ frame++, gpuTime, smoothedTime, scale });
+    while (history.size() > maxHistory) {
+        history.pop_front();
+    }
+    return changed;
+}
+
+vk::Extent2D DynamicResolution::scaled(const vk::Extent2D& extent) const {
+    vk::Extent2D result;
+    result.width = std::max(1u, (uint32_t)(extent.width * scale + 0.5f));
+    result.height = std::max(1u, (uint32_t)(extent.height * scale + 0.5f));
+    return result;
+}
+
+bool DynamicResolution::writeLog(const std::string& filename) const {
+    std::ofstream file(filename);
+    if (!file.is_open()) {
+        return false;
+    }
+    file << "frame,gpu_ms,smoothed_ms,scale" << std::endl;
+    for (const auto& sample : history) {
+        file << sample.frame << "," << sample.gpuTime << "," << sample.smoothedTime << "," << sample.scale << std::endl;
+    }
+    return (bool)file;
+}
+
+std::string DynamicResolution::summary() const {
+    if (history.empty()) {
+        return std::string();
+    }
+    float minTime = history.front().gpuTime, maxTime = 0.0f, sumTime = 0.0f, sumScale = 0.0f;
+    uint32_t overTarget = 0;
+    for (const auto& sample : history) {
+        minTime = std::min(minTime, sample.gpuTime);
+        maxTime = std::max(maxTime, sample.gpuTime);
+        sumTime += sample.gpuTime;
+        sumScale += sample.scale;
+        if (sample.gpuTime > targetFrameTime) {
+            ++overTarget;
+        }
+    }
+    float count = (float)history.size();
+    std::stringstream ss;
+    ss << "last " << history.size() << " frames, GPU " << std::fixed << std::setprecision(2) << sumTime / count << " ms avg (" << minTime << " - "
+        << maxTime << "), " << overTarget << " over target, scale " << sumScale / count << " avg";
+    return ss.str();
+}
+
+}
@@ -0,0 +1,78 @@
+/*
+* Dynamic resolution controller
+*
+* This code is licensed under the MIT license (MIT) (http://opensource.org/licenses/MIT)
+*/
+
+#pragma once
+
+#include <stdint.h>
+#include <deque>
+#include <string>
+
+#include <vulkan/vk_cpp.hpp>
+
+namespace vkx {
+    class Context;
+
+    // Scales the internal render resolution to hold a target GPU frame time.
+    //
+    // The frame is bracketed with two timestamps (beginFrame() / endFrame()), update() reads
+    // them back once the frame has completed and adjusts the scale.  The render targets keep
+    // their size, passes render into a scaled viewport in the top left corner of them and
+    // the final pass upscales by sampling with texture coordinates multiplied by the scale.
+    class DynamicResolution {
+    public:
+        struct Sample {
+            uint32_t frame;
+            float gpuTime;
+            float smoothedTime;
+            float scale;
+        };
+
+        // GPU frame time to hold in ms
+        float targetFrameTime{ 16.6f };
+        float minScale{ 0.5f };
+        float maxScale{ 1.0f };
+        // Weight of the latest measurement in the smoothed frame time
+        float smoothing{ 0.1f };
+        // Smaller changes of the scale are ignored, so the command buffers are not re-recorded
+        // every frame because of measurement noise
+        float threshold{ 0.05f };
+
+        // Current scale of the render resolution in both dimensions
+        float scale{ 1.0f };
+        // Last measured and smoothed GPU frame time in ms
+        float gpuTime{ 0.0f };
+        float smoothedTime{ 0.0f };
+        // One sample per update() for the last maxHistory frames, see writeLog()
+        std::deque<Sample> history;
+        size_t maxHistory{ 3600 };
+
+        DynamicResolution(const Context& context) : context(context) {}
+        ~DynamicResolution() { destroy(); }
+
+        void prepare();
+        void destroy();
+
+        // Record at the start of the first and at the end of the last command buffer of the frame
+        void beginFrame(const vk::CommandBuffer& cmdBuffer) const;
+        void endFrame(const vk::CommandBuffer& cmdBuffer) const;
+        // Reads back the timestamps of the last frame, which must have completed.  Returns true
+        // if the scale changed and the command buffers have to be rebuilt.
+        bool update();
+
+        // The part of a render target of the given size that is rendered to
+        vk::Extent2D scaled(const vk::Extent2D& extent) const;
+        // Writes the history as CSV (frame, GPU time, smoothed GPU time, scale), returns false if
+        // the file couldn't be written
+        bool writeLog(const std::string& filename) const;
+        // Average, range and time over target of the GPU frame times and the average scale
+        std::string summary() const;
+
+    private:
+        const Context& context;
+        vk::QueryPool queryPool;
+        uint32_t frame{ 0 };
+    };
+}
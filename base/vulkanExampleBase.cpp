@@ -11,31 +11,76 @@
 
 
 #include "vulkanExampleBase.h"
+#include "vulkanAssetPack.h"
 
 using namespace vkx;
 
+std::vector<std::string> ExampleBase::arguments;
+int ExampleBase::exitCode = 0;
+
 ExampleBase::ExampleBase(bool enableValidation) {
-    // Check for validation command line flag
 #if defined(_WIN32)
-    for (int32_t i = 0; i < __argc; i++) {
-        if (__argv[i] == std::string("-validation")) {
-            enableValidation = true;
-        }
+    if (arguments.empty()) {
+        arguments.assign(__argv, __argv + __argc);
     }
-#elif defined(__ANDROID__)
+#endif
+#if defined(__ANDROID__)
     // Vulkan library is loaded dynamically on Android
     bool libLoaded = loadVulkanLibrary();
     assert(libLoaded);
 #endif
 
 #if !defined(__ANDROID__)
+    parseArguments(enableValidation);
     // Android Vulkan initialization is handled in APP_CMD_INIT_WINDOW event
     initVulkan(enableValidation);
 #endif
 }
 
+void ExampleBase::parseArguments(bool& enableValidation) {
+    for (size_t i = 1; i < arguments.size(); ++i) {
+        const std::string& argument = arguments[i];
+        bool hasValue = i + 1 < arguments.size();
+        if (argument == "-validation") {
+            enableValidation = true;
+        } else if (argument == "-headless") {
+            golden.headless = true;
+        } else if (argument == "-golden" && hasValue) {
+            golden.headless = true;
+            golden.referenceDir = arguments[++i];
+        } else if (argument == "-update-golden") {
+            golden.update = true;
+        } else if (argument == "-timer" && hasValue) {
+            golden.timer = std::stof(arguments[++i]);
+        } else if (argument == "-tolerance" && hasValue) {
+            golden.tolerance = (uint32_t)std::stoul(arguments[++i]);
+        } else if (argument == "-host-allocations") {
+            enableHostAllocationTracking = true;
+        } else if (argument == "-host-arena" && hasValue) {
+            enableHostAllocationTracking = true;
+            hostAllocationArenaSize = (size_t)std::stoul(arguments[++i]) * 1024;
+        } else if (argument == "-memory-report" && hasValue) {
+            resourceReport.filename = arguments[++i];
+        } else if (argument == "-dynres-log" && hasValue) {
+            dynamicResolutionLog = arguments[++i];
+        } else if (argument == "-verbose") {
+            verbose = true;
+        }
+    }
+    if (golden.update && golden.referenceDir.empty()) {
+        throw std::runtime_error("-update-golden requires -golden <dir>");
+    }
+}
+
 ExampleBase::~ExampleBase() {
     // Clean up Vulkan resources
+    device.waitIdle();
+    readback.destroy();
+    stopCapture();
+    deletionQueue.flush();
+    for (auto& fence : frameFences) {
+        device.destroyFence(fence);
+    }
     swapChain.cleanup();
     if (descriptorPool) {
         device.destroyDescriptorPool(descriptorPool);
@@ -59,24 +104,38 @@ ExampleBase::~ExampleBase() {
         delete textOverlay;
     }
 
+    dynamicResolution.destroy();
+
     device.destroySemaphore(semaphores.presentComplete);
     device.destroySemaphore(semaphores.renderComplete);
     device.destroySemaphore(semaphores.textOverlayComplete);
 
+    // Everything the example and the base class created is destroyed by now, allocations still
+    // listed in the report were leaked
+    resourceReport.write();
+
     destroyContext();
+    // Whatever is left was leaked by the example or the implementation
+    if (hostAllocationReport.enabled()) {
+        std::cout << "Host allocations at exit:" << std::endl << hostAllocationReport.report();
+    }
 
 #if defined(__ANDROID__)
     // todo : android cleanup (if required)
 #else
-    glfwDestroyWindow(window);
-    glfwTerminate();
+    if (window) {
+        glfwDestroyWindow(window);
+        glfwTerminate();
+    }
 #endif
 }
 
 
 void ExampleBase::run() {
 #if defined(_WIN32)
-    setupWindow();
+    if (!golden.headless) {
+        setupWindow();
+    }
 #elif defined(__ANDROID__)
     // Attach vulkan example to global android application state
     state->userData = vulkanExample;
@@ -84,7 +143,9 @@ void ExampleBase::run() {
     state->onInputEvent = VulkanExample::handleAppInput;
     androidApp = state;
 #elif defined(__linux__)
-    setupWindow();
+    if (!golden.headless) {
+        setupWindow();
+    }
 #endif
 #if !defined(__ANDROID__)
     initSwapchain();
@@ -158,7 +219,11 @@ void ExampleBase::renderLoop() {
             auto tStart = std::chrono::high_resolution_clock::now();
             render();
             frameCounter++;
+            if (enableDynamicResolution && dynamicResolution.update()) {
+                renderScaleChanged();
+            }
             auto tEnd = std::chrono::high_resolution_clock::now();
+            frameCompleted(tEnd);
             auto tDiff = std::chrono::duration<double, std::milli>(tEnd - tStart).count();
             frameTimer = tDiff / 1000.0f;
             // Convert to clamped timer value
@@ -171,6 +236,7 @@ void ExampleBase::renderLoop() {
             fpsTimer += (float)tDiff;
             if (fpsTimer > 1000.0f) {
                 lastFPS = frameCounter;
+                hostAllocationReport.sample(lastFPS);
                 updateTextOverlay();
                 fpsTimer = 0.0f;
                 frameCounter = 0;
@@ -202,12 +268,20 @@ void ExampleBase::renderLoop() {
         }
     }
 #else
+    if (golden.headless) {
+        renderHeadless();
+        return;
+    }
     while (!glfwWindowShouldClose(window)) {
         auto tStart = std::chrono::high_resolution_clock::now();
         glfwPollEvents();
         render();
         frameCounter++;
+        if (enableDynamicResolution && dynamicResolution.update()) {
+            renderScaleChanged();
+        }
         auto tEnd = std::chrono::high_resolution_clock::now();
+        frameCompleted(tEnd);
         auto tDiff = std::chrono::duration<double, std::milli>(tEnd - tStart).count();
         frameTimer = (float)tDiff / 1000.0f;
         // Convert to clamped timer value
@@ -224,11 +298,94 @@ void ExampleBase::renderLoop() {
                 glfwSetWindowTitle(window, windowTitle.c_str());
             }
             lastFPS = frameCounter;
+            hostAllocationReport.sample(lastFPS);
             updateTextOverlay();
             fpsTimer = 0.0f;
             frameCounter = 0;
         }
     }
+    if (enableDynamicResolution && verbose && !dynamicResolution.history.empty()) {
+        std::cout << "Dynamic resolution: " << dynamicResolution.summary() << std::endl;
+    }
+    if (enableDynamicResolution && !dynamicResolutionLog.empty() && !dynamicResolution.writeLog(dynamicResolutionLog)) {
+        std::cerr << "Unable to write the dynamic resolution log " << dynamicResolutionLog << std::endl;
+    }
+#endif
+}
+
+void ExampleBase::renderHeadless() {
+    // The timer stays at the given value and every frame steps the same time, so examples
+    // animating with either render the same frame on every run.  The text overlay shows
+    // timings and the dynamic resolution follows them, both are left out.
+    timer = golden.timer;
+    timerSpeed = 0.0f;
+    frameTimer = 1.0f / 60.0f;
+    if (enableTextOverlay) {
+        textOverlay->visible = false;
+    }
+
+    uint32_t frames = golden.warmupFrames + golden.timedFrames;
+    std::chrono::high_resolution_clock::time_point tStart;
+    for (uint32_t i = 0; i < frames; ++i) {
+        if (i == golden.warmupFrames) {
+            device.waitIdle();
+            tStart = std::chrono::high_resolution_clock::now();
+            hostAllocationReport.mark();
+        }
+        golden.capture = golden.comparing() && i + 1 == frames;
+        render();
+        frameCompleted(std::chrono::high_resolution_clock::now());
+    }
+    // Includes the time the device needs for the frames still in flight
+    device.waitIdle();
+    auto tEnd = std::chrono::high_resolution_clock::now();
+    uint32_t timedFrames = std::max(golden.timedFrames, 1u);
+    double frameMs = std::chrono::duration<double, std::milli>(tEnd - tStart).count() / timedFrames;
+    std::ostringstream timing;
+    timing << std::fixed << std::setprecision(2) << frameMs << " ms per frame, ";
+    if (hostAllocationReport.enabled()) {
+        timing << hostAllocationReport.perFrame(timedFrames) << ", ";
+    }
+    timing << resourceReport.summary();
+
+    if (!golden.comparing()) {
+        std::cout << "headless " << exampleName() << ": " << timing.str() << std::endl;
+        return;
+    }
+    readback.flush();
+    ReadbackData frame = golden.frame.valid() ? golden.frame.get() : ReadbackData();
+    if (golden.compare(frame, exampleName(), timing.str()) == GoldenImage::Result::Fail) {
+        exitCode = 1;
+    }
+}
+
+std::string ExampleBase::exampleName() const {
+    if (arguments.empty()) {
+        return name;
+    }
+    std::string result = arguments[0];
+    size_t separator = result.find_last_of("/\\");
+    if (separator != std::string::npos) {
+        result = result.substr(separator + 1);
+    }
+    size_t extension = result.rfind(".exe");
+    if (extension != std::string::npos && extension + 4 == result.size()) {
+        result.resize(extension);
+    }
+    return result;
+}
+
+void ExampleBase::frameCompleted(const std::chrono::high_resolution_clock::time_point& frameEnd) {
+    if (timeToFirstFrame > 0.0f) {
+        return;
+    }
+    timeToFirstFrame = (float)std::chrono::duration<double, std::milli>(frameEnd - startTime).count();
+#if defined(__ANDROID__)
+    LOGD("Time to first frame: %.1f ms", timeToFirstFrame);
+#else
+    if (verbose) {
+        std::cout << "Time to first frame: " << timeToFirstFrame << " ms" << std::endl;
+    }
 #endif
 }
 
@@ -292,6 +449,22 @@ void ExampleBase::prepare() {
         debug::marker::setup(device);
     }
     createCommandPool();
+    frameFences.resize(std::max(framesInFlight, 1u));
+    for (auto& fence : frameFences) {
+        fence = device.createFence(vk::FenceCreateInfo());
+    }
+    // Shaders, textures and meshes are read from the asset pack when one has been built
+    // with the assetpack tool, files missing from the pack still come from the data folder
+    if (!AssetPack::mounted()) {
+#if defined(__ANDROID__)
+        bool mounted = AssetPack::mount(androidApp->activity->assetManager, "assets.pack", getAssetPath());
+#else
+        bool mounted = AssetPack::mount(getAssetPath() + "assets.pack", getAssetPath());
+#endif
+        if (mounted && verbose) {
+            std::cout << "Using asset pack with " << AssetPack::mounted()->entries().size() << " files" << std::endl;
+        }
+    }
     withPrimaryCommandBuffer([&](vk::CommandBuffer setupCmdBuffer) {
         setupSwapChain(setupCmdBuffer);
         setupDepthStencil(setupCmdBuffer);
@@ -303,6 +476,9 @@ void ExampleBase::prepare() {
     textureLoader = new TextureLoader(*this);
 #if defined(__ANDROID__)
     textureLoader->assetManager = androidApp->activity->assetManager;
+#else
+    // Compute fallback for formats without linear blit support
+    textureLoader->mipGenerator.shaderPath = getAssetPath() + "shaders/base/mipgen.comp";
 #endif
     if (enableTextOverlay) {
         // Load the text rendering shaders
@@ -319,13 +495,16 @@ void ExampleBase::prepare() {
             );
         updateTextOverlay();
     }
+    if (enableDynamicResolution) {
+        dynamicResolution.prepare();
+    }
 }
 
-vk::PipelineShaderStageCreateInfo ExampleBase::loadGlslShader(const std::string& fileName, vk::ShaderStageFlagBits stage) {
+vk::PipelineShaderStageCreateInfo ExampleBase::loadGlslShader(const std::string& fileName, vk::ShaderStageFlagBits stage, const std::string& preamble) {
     auto source = readTextFile(fileName.c_str());
     vk::PipelineShaderStageCreateInfo shaderStage;
     shaderStage.stage = stage;
-    shaderStage.module = shader::glslToShaderModule(device, stage, source);
+    shaderStage.module = shader::glslToShaderModule(device, stage, source, preamble);
     shaderStage.pName = "main";
     shaderModules.push_back(shaderStage.module);
     return shaderStage;
@@ -360,14 +539,16 @@ void ExampleBase::submitPrePresentBarrier(const vk::Image& image) {
 
     prePresentCmdBuffer.begin(cmdBufInfo);
 
-    vk::ImageMemoryBarrier prePresentBarrier;
-    prePresentBarrier.srcAccessMask = vk::AccessFlagBits::eColorAttachmentWrite;
-    prePresentBarrier.oldLayout = vk::ImageLayout::eColorAttachmentOptimal;
-    prePresentBarrier.newLayout = vk::ImageLayout::ePresentSrcKHR;
-    prePresentBarrier.subresourceRange = { vk::ImageAspectFlagBits::eColor, 0, 1, 0, 1 };
-    prePresentBarrier.image = image;
+    if (!recordCapture(image)) {
+        vk::ImageMemoryBarrier prePresentBarrier;
+        prePresentBarrier.srcAccessMask = vk::AccessFlagBits::eColorAttachmentWrite;
+        prePresentBarrier.oldLayout = vk::ImageLayout::eColorAttachmentOptimal;
+        prePresentBarrier.newLayout = vk::ImageLayout::ePresentSrcKHR;
+        prePresentBarrier.subresourceRange = { vk::ImageAspectFlagBits::eColor, 0, 1, 0, 1 };
+        prePresentBarrier.image = image;
 
-    prePresentCmdBuffer.pipelineBarrier(vk::PipelineStageFlagBits::eAllCommands, vk::PipelineStageFlagBits::eTopOfPipe, vk::DependencyFlags(), nullptr, nullptr, prePresentBarrier);
+        prePresentCmdBuffer.pipelineBarrier(vk::PipelineStageFlagBits::eAllCommands, vk::PipelineStageFlagBits::eTopOfPipe, vk::DependencyFlags(), nullptr, nullptr, prePresentBarrier);
+    }
 
     prePresentCmdBuffer.end();
 
@@ -378,6 +559,43 @@ void ExampleBase::submitPrePresentBarrier(const vk::Image& image) {
     queue.submit(submitInfo, VK_NULL_HANDLE);
 }
 
+bool ExampleBase::recordCapture(const vk::Image& image) {
+    if (!frameCapture.requested() && !golden.capture) {
+        return false;
+    }
+
+    PixelLayout layout;
+    if (!FrameCapture::pixelLayout(colorformat, layout)) {
+        std::cerr << "Frame capture doesn't support the swap chain format " << vk::to_string(colorformat) << std::endl;
+        frameCapture.cancel();
+        golden.capture = false;
+        return false;
+    }
+    if (!swapChain.transferSource) {
+        std::cerr << "Frame capture requires swap chain images that can be copied from" << std::endl;
+        frameCapture.cancel();
+        golden.capture = false;
+        return false;
+    }
+
+    if (golden.capture) {
+        golden.capture = false;
+        golden.frame = readback.readImage(prePresentCmdBuffer, image, colorformat, vk::Extent2D{ width, height },
+            vk::ImageLayout::eColorAttachmentOptimal, vk::ImageLayout::ePresentSrcKHR);
+        return true;
+    }
+
+    return frameCapture.record(prePresentCmdBuffer, image, colorformat, vk::Extent2D{ width, height },
+        vk::ImageLayout::eColorAttachmentOptimal, vk::ImageLayout::ePresentSrcKHR);
+}
+
+void ExampleBase::stopCapture() {
+    std::string stats = frameCapture.stop();
+    if (verbose && !stats.empty()) {
+        std::cout << stats << std::endl;
+    }
+}
+
 void ExampleBase::submitPostPresentBarrier(const vk::Image& image) {
     vk::CommandBufferBeginInfo cmdBufInfo;
 
@@ -428,6 +646,15 @@ void ExampleBase::updateTextOverlay() {
 
     textOverlay->addText(deviceProperties.deviceName, 5.0f, 45.0f, TextOverlay::alignLeft);
 
+    float bottom = (float)height - 20.0f;
+    if (hostAllocationReport.enabled()) {
+        textOverlay->addText(hostAllocationReport.lastSample(), 5.0f, bottom, TextOverlay::alignLeft);
+        bottom -= 20.0f;
+    }
+    if (!resourceReport.filename.empty()) {
+        textOverlay->addText(resourceReport.summary(), 5.0f, bottom, TextOverlay::alignLeft);
+    }
+
     getOverlayText(textOverlay);
 
     textOverlay->endTextUpdate();
@@ -482,7 +709,23 @@ void ExampleBase::submitFrame() {
 
     swapChain.queuePresent(queue, currentBuffer, submitTextOverlay ? semaphores.textOverlayComplete : semaphores.renderComplete);
 
-    queue.waitIdle();
+    // A submission without command buffers signals the frame's fence once everything submitted
+    // so far has completed.  Then wait until at most framesInFlight - 1 frames are pending.
+    uint64_t frame = deletionQueue.endFrame();
+    readback.endFrame();
+    ResourceRegistry::get().endFrame();
+    queue.submit(nullptr, frameFences[frame % frameFences.size()]);
+    if (frame + 1 >= frameFences.size()) {
+        waitForFrame(frame + 1 - frameFences.size());
+    }
+}
+
+void ExampleBase::waitForFrame(uint64_t frame) {
+    vk::Fence fence = frameFences[frame % frameFences.size()];
+    device.waitForFences(fence, VK_TRUE, UINT64_MAX);
+    device.resetFences(fence);
+    deletionQueue.collect(frame);
+    readback.collect(frame);
 }
 
 #if defined(__ANDROID__)
@@ -587,6 +830,18 @@ void ExampleBase::KeyboardHandler(GLFWwindow* window, int key, int scancode, int
             }
             break;
 
+        case GLFW_KEY_F11:
+            if (example->frameCapture.sequenceRunning()) {
+                example->stopCapture();
+            } else {
+                example->frameCapture.startSequence();
+            }
+            break;
+
+        case GLFW_KEY_F12:
+            example->frameCapture.requestScreenshot();
+            break;
+
         case GLFW_KEY_ESCAPE:
             glfwSetWindowShouldClose(window, 1);
             break;
@@ -734,7 +989,7 @@ void ExampleBase::createCommandPool() {
 }
 
 void ExampleBase::setupDepthStencil(const vk::CommandBuffer& setupCmdBuffer) {
-    depthStencil.destroy();
+    deletionQueue.retire(depthStencil);
 
     vk::ImageCreateInfo image;
     image.imageType = vk::ImageType::e2D;
@@ -747,6 +1002,7 @@ void ExampleBase::setupDepthStencil(const vk::CommandBuffer& setupCmdBuffer) {
     image.usage = vk::ImageUsageFlagBits::eDepthStencilAttachment | vk::ImageUsageFlagBits::eTransferSrc;
 
     depthStencil = createImage(image, vk::MemoryPropertyFlagBits::eDeviceLocal);
+    nameResource(depthStencil.image, depthStencil.memory, ResourceCategory::RenderTarget, "depth stencil");
 
     setImageLayout(
         setupCmdBuffer,
@@ -833,6 +1089,9 @@ void ExampleBase::windowResize() {
     }
     prepared = false;
 
+    // Frames still in flight may use the old swap chain, frame buffers, depth stencil and
+    // command buffers, so they are retired instead of waiting for the device to go idle
+
     // Recreate swap chain
     width = destWidth;
     height = destHeight;
@@ -842,24 +1101,22 @@ void ExampleBase::windowResize() {
     });
 
     // Recreate the frame buffers
-
-
     for (uint32_t i = 0; i < frameBuffers.size(); i++) {
-        device.destroyFramebuffer(frameBuffers[i]);
+        deletionQueue.retire(frameBuffers[i]);
     }
     setupFrameBuffer();
 
     // Command buffers need to be recreated as they may store
     // references to the recreated frame buffer
-    destroyCommandBuffers();
+    std::vector<vk::CommandBuffer> retiredCmdBuffers = drawCmdBuffers;
+    retiredCmdBuffers.push_back(prePresentCmdBuffer);
+    retiredCmdBuffers.push_back(postPresentCmdBuffer);
+    deletionQueue.retire(cmdPool, retiredCmdBuffers);
     createCommandBuffers();
     buildCommandBuffers();
 
-    queue.waitIdle();
-    device.waitIdle();
-
     if (enableTextOverlay) {
-        textOverlay->reallocateCommandBuffers();
+        textOverlay->reallocateCommandBuffers(&deletionQueue);
         updateTextOverlay();
     }
 
@@ -874,7 +1131,16 @@ void ExampleBase::windowResized() {
     // Can be overriden in derived class
 }
 
+void ExampleBase::renderScaleChanged() {
+    // Can be overriden in derived class
+    buildCommandBuffers();
+}
+
 void ExampleBase::initSwapchain() {
+    if (golden.headless) {
+        swapChain.initHeadless(colorformat);
+        return;
+    }
 #if defined(_WIN32)
     swapChain.initSurface(GetModuleHandle(NULL), glfwGetWin32Window(window));
 #elif defined(__ANDROID__)    
@@ -885,7 +1151,7 @@ void ExampleBase::initSwapchain() {
 }
 
 void ExampleBase::setupSwapChain(const vk::CommandBuffer& setupCmdBuffer) {
-    swapChain.create(setupCmdBuffer, &width, &height);
+    swapChain.create(setupCmdBuffer, &width, &height, &deletionQueue);
 }
 
 void ExampleBase::drawCommandBuffers(const std::vector<vk::CommandBuffer>& commandBuffers) {
@@ -32,11 +32,14 @@
 #include <time.h>
 
 #include <array>
+#include <atomic>
 #include <chrono>
 #include <fstream>
 #include <functional>
+#include <future>
 #include <iostream>
 #include <iomanip>
+#include <mutex>
 #include <random>
 #include <string>
 #include <sstream>
@@ -67,6 +70,11 @@ using glm::quat;
 #include "vulkanTextureLoader.hpp"
 #include "vulkanMeshLoader.hpp"
 #include "vulkanTextOverlay.hpp"
+#include "vulkanDynamicResolution.h"
+#include "vulkanDeletionQueue.h"
+#include "vulkanReadback.h"
+#include "vulkanFrameCapture.h"
+#include "vulkanGoldenImage.h"
 
 #define GAMEPAD_BUTTON_A 0x1000
 #define GAMEPAD_BUTTON_B 0x1001
@@ -88,6 +96,11 @@ namespace vkx {
         ~ExampleBase();
 
     public:
+        // Command line of the example, set by the entry point on desktop platforms
+        static std::vector<std::string> arguments;
+        // Returned by the entry point, non zero if the golden image comparison failed
+        static int exitCode;
+
         void run();
         // Called if the window is resized and some resources have to be recreatesd
         void windowResize();
@@ -99,6 +112,41 @@ namespace vkx {
         bool enableDebugMarkers = false;
         // fps timer (one second interval)
         float fpsTimer = 0.0f;
+        // Creation of the example, start of the time to first frame
+        std::chrono::high_resolution_clock::time_point startTime{ std::chrono::high_resolution_clock::now() };
+        void frameCompleted(const std::chrono::high_resolution_clock::time_point& frameEnd);
+        // One fence per frame in flight, signaled when all work submitted for the frame completed
+        std::vector<vk::Fence> frameFences;
+        void waitForFrame(uint64_t frame);
+        // Host allocations of the implementation with -host-allocations: allocations per frame over
+        // the last second in the text overlay, per timed frame in headless runs and per scope at
+        // exit
+        HostAllocationReport hostAllocationReport{ hostAllocations };
+        // Device memory of the resource registry in the headless timing.  -memory-report <file>
+        // also shows it in the text overlay and writes the JSON report to the file at exit.
+        ResourceReport resourceReport;
+        // Records the copy of the swap chain image into the pre present command buffer if a
+        // capture or the golden image is requested, including the transition to the present layout
+        bool recordCapture(const vk::Image& image);
+        // Ends a capture sequence, -verbose prints its statistics
+        void stopCapture();
+
+        // Headless golden image run, set from the command line:
+        //   -headless             render a fixed frame into offscreen images and print the frame time
+        //   -golden <dir>         headless, and compare the frame with <dir>/<example>.ppm
+        //   -update-golden        write the reference instead of comparing with it
+        //   -timer <value>        timer value of the fixed frame
+        //   -tolerance <value>    channel difference that still counts as equal
+        // With -host-allocations or -host-arena <KB> the timing also includes the host
+        // allocations of the implementation.
+        // A failed comparison writes <example>_actual.png and <example>_diff.png to the working
+        // directory and sets exitCode, an example without a reference is skipped.
+        GoldenImage golden;
+        void parseArguments(bool& enableValidation);
+        // Renders the fixed frame with a deterministic timer, replaces the render loop
+        void renderHeadless();
+        // Executable name without path and extension, names the reference image
+        std::string exampleName() const;
         // Get window title with example name, device, et.
         std::string getWindowTitle();
         // Destination dimensions for resizing the window
@@ -111,6 +159,11 @@ namespace vkx {
         // Frame counter to display fps
         uint32_t frameCounter = 0;
         uint32_t lastFPS = 0;
+        // Time from the creation of the example to the end of the first frame in ms, 0 before
+        float timeToFirstFrame = 0.0f;
+        // -verbose prints startup and per example statistics to the console, otherwise they are
+        // only shown in the text overlay, if at all
+        bool verbose = false;
 
         // Color buffer format
         vk::Format colorformat = vk::Format::eB8G8R8A8Unorm;
@@ -141,6 +194,22 @@ namespace vkx {
         std::vector<vk::ShaderModule> shaderModules;
         // Wraps the swap chain to present images (framebuffers) to the windowing system
         SwapChain swapChain;
+        // Number of frames the CPU may record ahead of the GPU.  With 1 submitFrame waits for the
+        // frame it submitted.  Set before prepare().  The examples keep the default, they update a
+        // single set of uniform buffers and command buffers per frame, which a frame still in
+        // flight may be reading.  Only the base class retires its resize resources through the
+        // deletion queue, the overrides of examples (e.g. bloom's destroyBloomChain or a
+        // RenderGraph::compile on resize) destroy theirs immediately, so those examples don't
+        // support more than 1.
+        uint32_t framesInFlight = 1;
+        // Resources replaced while frames are in flight (e.g. on resize) are retired here instead
+        // of being destroyed, they are destroyed once the frames using them have completed
+        DeletionQueue deletionQueue{ device };
+        // Copies of images and buffers back to the host, collected with the frame fences like
+        // the deletion queue
+        Readback readback{ *this };
+        // F12 writes the next frame to a PNG file and F11 toggles writing every frame
+        FrameCapture frameCapture{ readback };
         // Synchronization semaphores
         struct {
             // Swap chain image presentation
@@ -176,6 +245,14 @@ namespace vkx {
         bool enableTextOverlay = false;
         TextOverlay *textOverlay{ nullptr };
 
+        // Scales the render resolution to hold dynamicResolution.targetFrameTime, the example
+        // has to bracket its frame with dynamicResolution.beginFrame() / endFrame() and apply
+        // the scale in renderScaleChanged().  -dynres-log <file> writes the history of the last
+        // frames as CSV at exit, -verbose prints its summary.
+        bool enableDynamicResolution = false;
+        DynamicResolution dynamicResolution{ *this };
+        std::string dynamicResolutionLog;
+
         // Use to adjust mouse rotation speed
         float rotationSpeed = 1.0f;
         // Use to adjust mouse zoom speed
@@ -207,7 +284,7 @@ namespace vkx {
         // true if application has focused, false if moved to background
         bool focused = false;
 #else 
-        GLFWwindow* window;
+        GLFWwindow* window{ nullptr };
 #endif
 
         // Setup the vulkan instance, enable required extensions and connect to the physical device (GPU)
@@ -241,6 +318,9 @@ namespace vkx {
         // Called when the window has been resized
         // Can be overriden in derived class to recreate or rebuild resources attached to the frame buffer / swapchain
         virtual void windowResized();
+        // Called after a frame if the dynamic resolution scale changed
+        // Default implementation rebuilds the command buffers
+        virtual void renderScaleChanged();
         // Pure virtual function to be overriden by the dervice class
         // Called in case of an event where e.g. the framebuffer has to be rebuild and thus
         // all command buffers that may reference this
@@ -284,7 +364,7 @@ namespace vkx {
         // Load a SPIR-V shader
         vk::PipelineShaderStageCreateInfo loadShader(const std::string& fileName, vk::ShaderStageFlagBits stage);
 
-        vk::PipelineShaderStageCreateInfo loadGlslShader(const std::string& fileName, vk::ShaderStageFlagBits stage);
+        vk::PipelineShaderStageCreateInfo loadGlslShader(const std::string& fileName, vk::ShaderStageFlagBits stage, const std::string& preamble = "");
 
 
         // Load a mesh (using ASSIMP) and create vulkan vertex and index buffers with given vertex layout
@@ -351,9 +431,11 @@ namespace vkx {
         }
 #else 
 #define ENTRY_POINT_START \
-        int main(const int argc, const char *argv[]) { 
+        int main(const int argc, const char *argv[]) { \
+            vkx::ExampleBase::arguments.assign(argv, argv + argc);
 
 #define ENTRY_POINT_END \
+            return vkx::ExampleBase::exitCode; \
         }
 #endif
 
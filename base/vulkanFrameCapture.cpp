@@ -0,0 +1,91 @@
+/*
+* Screenshots and capture sequences of the presented frames
+*
+* This code is licensed under the MIT license (MIT) (http://opensource.org/licenses/MIT)
+*/
+
+#include "vulkanFrameCapture.h"
+
+#include <chrono>
+#include <iomanip>
+#include <iostream>
+#include <sstream>
+
+using namespace vkx;
+
+bool FrameCapture::pixelLayout(vk::Format format, PixelLayout& layout) {
+    if (format == vk::Format::eB8G8R8A8Unorm || format == vk::Format::eB8G8R8A8Srgb) {
+        layout = PixelLayout::BGRA8;
+    } else if (format == vk::Format::eR8G8B8A8Unorm || format == vk::Format::eR8G8B8A8Srgb) {
+        layout = PixelLayout::RGBA8;
+    } else {
+        return false;
+    }
+    return true;
+}
+
+bool FrameCapture::record(const vk::CommandBuffer& cmdBuffer, vk::Image image, vk::Format format, const vk::Extent2D& extent,
+    vk::ImageLayout oldLayout, vk::ImageLayout newLayout) {
+    PixelLayout layout;
+    if (!requested() || !pixelLayout(format, layout)) {
+        return false;
+    }
+
+    std::ostringstream filename;
+    if (screenshot) {
+        filename << "screenshot_" << screenshots++ << ".png";
+        screenshot = false;
+    } else {
+        filename << "capture_" << std::setw(6) << std::setfill('0') << sequenceFrames++ << ".png";
+    }
+
+    // Runs on the readback worker, which only hands the pixels on so it can serve the next frame
+    std::string name = filename.str();
+    bool recorded = readback.readImage(cmdBuffer, image, format, extent, oldLayout, newLayout, [this, name, layout](ReadbackData& result) {
+        // Encoding is slower than the copy, a backlog would only grow
+        if (pendingEncodes >= readback.maxSlots) {
+            ++dropped;
+            return;
+        }
+        ++pendingEncodes;
+        auto frame = std::make_shared<ReadbackData>(std::move(result));
+        encoder.addJob([this, name, layout, frame] {
+            auto tStart = std::chrono::high_resolution_clock::now();
+            bool fileWritten = writeImage(name, frame->data.data(), frame->width, frame->height, frame->width * 4, layout);
+            auto tEnd = std::chrono::high_resolution_clock::now();
+            std::lock_guard<std::mutex> lock(statsMutex);
+            if (fileWritten) {
+                ++written;
+                bytes += frame->data.size();
+                encodeMs += std::chrono::duration<double, std::milli>(tEnd - tStart).count();
+            } else {
+                std::cerr << "Failed to write " << name << std::endl;
+            }
+            --pendingEncodes;
+        });
+    });
+    if (!recorded) {
+        ++dropped;
+    }
+    return true;
+}
+
+std::string FrameCapture::stop() {
+    bool wasSequence = sequence;
+    sequence = false;
+    // Frames already recorded are still written, before the statistics are taken
+    encoder.wait();
+    std::lock_guard<std::mutex> lock(statsMutex);
+    if (!wasSequence || written == 0) {
+        return std::string();
+    }
+    double seconds = encodeMs / 1000.0;
+    std::ostringstream stats;
+    stats << "Captured " << written << " frames, " << dropped << " dropped, " << std::fixed << std::setprecision(2) << encodeMs / written
+        << " ms to encode and write a frame (" << bytes / (1024.0 * 1024.0) / seconds << " MB/s)";
+    written = 0;
+    bytes = 0;
+    encodeMs = 0.0;
+    dropped = 0;
+    return stats.str();
+}
@@ -0,0 +1,65 @@
+/*
+* Screenshots and capture sequences of the presented frames
+*
+* This code is licensed under the MIT license (MIT) (http://opensource.org/licenses/MIT)
+*/
+
+#pragma once
+
+#include <stdint.h>
+#include <atomic>
+#include <mutex>
+#include <string>
+
+#include "vulkanReadback.h"
+#include "imageWriter.h"
+
+namespace vkx {
+
+    // Writes single frames (screenshot_<n>.png) or every frame (capture_<nnnnnn>.png) to the
+    // working directory.  The copy goes through the readback, whose worker only hands the pixels
+    // to a separate encoder thread, so neither the render loop nor the readback wait for the PNG
+    // encoding and the file writes.  Frames the readback or the encoder have no room for are
+    // dropped and counted.
+    class FrameCapture {
+    public:
+        FrameCapture(Readback& readback) : readback(readback) {}
+
+        // Channel order of the formats that can be captured, false for others
+        static bool pixelLayout(vk::Format format, PixelLayout& layout);
+
+        // Captures the next frame
+        void requestScreenshot() { screenshot = true; }
+        // Captures every frame until stop()
+        void startSequence() { sequence = true; }
+        bool sequenceRunning() const { return sequence; }
+        bool requested() const { return screenshot || sequence; }
+        // Drops the pending requests, e.g. if the frames can't be captured
+        void cancel() { screenshot = sequence = false; }
+
+        // Records the copy of the image if a capture is requested.  The image is transitioned from
+        // oldLayout to newLayout as by Readback::readImage.  Returns false if nothing was recorded.
+        bool record(const vk::CommandBuffer& cmdBuffer, vk::Image image, vk::Format format, const vk::Extent2D& extent,
+            vk::ImageLayout oldLayout, vk::ImageLayout newLayout);
+
+        // Ends a sequence and waits until its frames are written.  Returns the statistics of the
+        // sequence, empty if none was running or nothing was written.
+        std::string stop();
+
+    private:
+        Readback& readback;
+        bool screenshot{ false };
+        bool sequence{ false };
+        uint32_t screenshots{ 0 };
+        uint32_t sequenceFrames{ 0 };
+        // Written by the encoder thread
+        std::mutex statsMutex;
+        uint32_t written{ 0 };
+        uint64_t bytes{ 0 };
+        double encodeMs{ 0.0 };
+        std::atomic<uint32_t> dropped{ 0 };
+        std::atomic<uint32_t> pendingEncodes{ 0 };
+        // Declared last, joined before the counters its jobs use are destroyed
+        Thread encoder;
+    };
+}
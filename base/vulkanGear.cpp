@@ -10,6 +10,138 @@
 
 #include "vulkanGear.h"
 
+namespace {
+    // Emits the mesh of a gear centered at the origin through vertex(x, y, z, normal), which
+    // returns the index of the new vertex, and face(a, b, c).  Writes exactly
+    // VulkanGear::vertexCount(teeth) vertices and VulkanGear::indexCount(teeth) indices.
+    template <typename VertexFunc, typename FaceFunc>
+    void gearGeometry(float inner_radius, float outer_radius, float width, int teeth, float tooth_depth, VertexFunc vertex, FaceFunc face) {
+        int i;
+        float r0, r1, r2;
+        float ta, da;
+        float u1, v1, u2, v2, len;
+        float cos_ta, cos_ta_1da, cos_ta_2da, cos_ta_3da, cos_ta_4da;
+        float sin_ta, sin_ta_1da, sin_ta_2da, sin_ta_3da, sin_ta_4da;
+        int32_t ix0, ix1, ix2, ix3, ix4, ix5;
+
+        r0 = inner_radius;
+        r1 = outer_radius - tooth_depth / 2.0;
+        r2 = outer_radius + tooth_depth / 2.0;
+        da = 2.0 * M_PI / teeth / 4.0;
+
+        glm::vec3 normal;
+
+        for (i = 0; i < teeth; i++) {
+            ta = i * 2.0 * M_PI / teeth;
+            // todo : naming
+            cos_ta = cos(ta);
+            cos_ta_1da = cos(ta + da);
+            cos_ta_2da = cos(ta + 2 * da);
+            cos_ta_3da = cos(ta + 3 * da);
+            cos_ta_4da = cos(ta + 4 * da);
+            sin_ta = sin(ta);
+            sin_ta_1da = sin(ta + da);
+            sin_ta_2da = sin(ta + 2 * da);
+            sin_ta_3da = sin(ta + 3 * da);
+            sin_ta_4da = sin(ta + 4 * da);
+
+            u1 = r2 * cos_ta_1da - r1 * cos_ta;
+            v1 = r2 * sin_ta_1da - r1 * sin_ta;
+            len = sqrt(u1 * u1 + v1 * v1);
+            u1 /= len;
+            v1 /= len;
+            u2 = r1 * cos_ta_3da - r2 * cos_ta_2da;
+            v2 = r1 * sin_ta_3da - r2 * sin_ta_2da;
+
+            // front face
+            normal = glm::vec3(0.0, 0.0, 1.0);
+            ix0 = vertex(r0 * cos_ta, r0 * sin_ta, width * 0.5, normal);
+            ix1 = vertex(r1 * cos_ta, r1 * sin_ta, width * 0.5, normal);
+            ix2 = vertex(r0 * cos_ta, r0 * sin_ta, width * 0.5, normal);
+            ix3 = vertex(r1 * cos_ta_3da, r1 * sin_ta_3da, width * 0.5, normal);
+            ix4 = vertex(r0 * cos_ta_4da, r0 * sin_ta_4da, width * 0.5, normal);
+            ix5 = vertex(r1 * cos_ta_4da, r1 * sin_ta_4da, width * 0.5, normal);
+            face(ix0, ix1, ix2);
+            face(ix1, ix3, ix2);
+            face(ix2, ix3, ix4);
+            face(ix3, ix5, ix4);
+
+            // front sides of teeth
+            normal = glm::vec3(0.0, 0.0, 1.0);
+            ix0 = vertex(r1 * cos_ta, r1 * sin_ta, width * 0.5, normal);
+            ix1 = vertex(r2 * cos_ta_1da, r2 * sin_ta_1da, width * 0.5, normal);
+            ix2 = vertex(r1 * cos_ta_3da, r1 * sin_ta_3da, width * 0.5, normal);
+            ix3 = vertex(r2 * cos_ta_2da, r2 * sin_ta_2da, width * 0.5, normal);
+            face(ix0, ix1, ix2);
+            face(ix1, ix3, ix2);
+
+            // back face 
+            normal = glm::vec3(0.0, 0.0, -1.0);
+            ix0 = vertex(r1 * cos_ta, r1 * sin_ta, -width * 0.5, normal);
+            ix1 = vertex(r0 * cos_ta, r0 * sin_ta, -width * 0.5, normal);
+            ix2 = vertex(r1 * cos_ta_3da, r1 * sin_ta_3da, -width * 0.5, normal);
+            ix3 = vertex(r0 * cos_ta, r0 * sin_ta, -width * 0.5, normal);
+            ix4 = vertex(r1 * cos_ta_4da, r1 * sin_ta_4da, -width * 0.5, normal);
+            ix5 = vertex(r0 * cos_ta_4da, r0 * sin_ta_4da, -width * 0.5, normal);
+            face(ix0, ix1, ix2);
+            face(ix1, ix3, ix2);
+            face(ix2, ix3, ix4);
+            face(ix3, ix5, ix4);
+
+            // back sides of teeth 
+            normal = glm::vec3(0.0, 0.0, -1.0);
+            ix0 = vertex(r1 * cos_ta_3da, r1 * sin_ta_3da, -width * 0.5, normal);
+            ix1 = vertex(r2 * cos_ta_2da, r2 * sin_ta_2da, -width * 0.5, normal);
+            ix2 = vertex(r1 * cos_ta, r1 * sin_ta, -width * 0.5, normal);
+            ix3 = vertex(r2 * cos_ta_1da, r2 * sin_ta_1da, -width * 0.5, normal);
+            face(ix0, ix1, ix2);
+            face(ix1, ix3, ix2);
+
+            // draw outward faces of teeth 
+            normal = glm::vec3(v1, -u1, 0.0);
+            ix0 = vertex(r1 * cos_ta, r1 * sin_ta, width * 0.5, normal);
+            ix1 = vertex(r1 * cos_ta, r1 * sin_ta, -width * 0.5, normal);
+            ix2 = vertex(r2 * cos_ta_1da, r2 * sin_ta_1da, width * 0.5, normal);
+            ix3 = vertex(r2 * cos_ta_1da, r2 * sin_ta_1da, -width * 0.5, normal);
+            face(ix0, ix1, ix2);
+            face(ix1, ix3, ix2);
+
+            normal = glm::vec3(cos_ta, sin_ta, 0.0);
+            ix0 = vertex(r2 * cos_ta_1da, r2 * sin_ta_1da, width * 0.5, normal);
+            ix1 = vertex(r2 * cos_ta_1da, r2 * sin_ta_1da, -width * 0.5, normal);
+            ix2 = vertex(r2 * cos_ta_2da, r2 * sin_ta_2da, width * 0.5, normal);
+            ix3 = vertex(r2 * cos_ta_2da, r2 * sin_ta_2da, -width * 0.5, normal);
+            face(ix0, ix1, ix2);
+            face(ix1, ix3, ix2);
+
+            normal = glm::vec3(v2, -u2, 0.0);
+            ix0 = vertex(r2 * cos_ta_2da, r2 * sin_ta_2da, width * 0.5, normal);
+            ix1 = vertex(r2 * cos_ta_2da, r2 * sin_ta_2da, -width * 0.5, normal);
+            ix2 = vertex(r1 * cos_ta_3da, r1 * sin_ta_3da, width * 0.5, normal);
+            ix3 = vertex(r1 * cos_ta_3da, r1 * sin_ta_3da, -width * 0.5, normal);
+            face(ix0, ix1, ix2);
+            face(ix1, ix3, ix2);
+
+            normal = glm::vec3(cos_ta, sin_ta, 0.0);
+            ix0 = vertex(r1 * cos_ta_3da, r1 * sin_ta_3da, width * 0.5, normal);
+            ix1 = vertex(r1 * cos_ta_3da, r1 * sin_ta_3da, -width * 0.5, normal);
+            ix2 = vertex(r1 * cos_ta_4da, r1 * sin_ta_4da, width * 0.5, normal);
+            ix3 = vertex(r1 * cos_ta_4da, r1 * sin_ta_4da, -width * 0.5, normal);
+            face(ix0, ix1, ix2);
+            face(ix1, ix3, ix2);
+
+            // draw inside radius cylinder 
+            ix0 = vertex(r0 * cos_ta, r0 * sin_ta, -width * 0.5, glm::vec3(-cos_ta, -sin_ta, 0.0));
+            ix1 = vertex(r0 * cos_ta, r0 * sin_ta, width * 0.5, glm::vec3(-cos_ta, -sin_ta, 0.0));
+            ix2 = vertex(r0 * cos_ta_4da, r0 * sin_ta_4da, -width * 0.5, glm::vec3(-cos_ta_4da, -sin_ta_4da, 0.0));
+            ix3 = vertex(r0 * cos_ta_4da, r0 * sin_ta_4da, width * 0.5, glm::vec3(-cos_ta_4da, -sin_ta_4da, 0.0));
+            face(ix0, ix1, ix2);
+            face(ix1, ix3, ix2);
+        }
+    }
+}
+
+
 int32_t VulkanGear::newVertex(std::vector<Vertex> *vBuffer, float x, float y, float z, const glm::vec3& normal) {
     Vertex v(
         glm::vec3(x, y, z),
@@ -42,129 +174,12 @@ void VulkanGear::generate(float inner_radius, float outer_radius, float width, i
 
     std::vector<Vertex> vBuffer;
     std::vector<uint32_t> iBuffer;
+    vBuffer.reserve(vertexCount(teeth));
+    iBuffer.reserve(indexCount(teeth));
 
-    int i;
-    float r0, r1, r2;
-    float ta, da;
-    float u1, v1, u2, v2, len;
-    float cos_ta, cos_ta_1da, cos_ta_2da, cos_ta_3da, cos_ta_4da;
-    float sin_ta, sin_ta_1da, sin_ta_2da, sin_ta_3da, sin_ta_4da;
-    int32_t ix0, ix1, ix2, ix3, ix4, ix5;
-
-    r0 = inner_radius;
-    r1 = outer_radius - tooth_depth / 2.0;
-    r2 = outer_radius + tooth_depth / 2.0;
-    da = 2.0 * M_PI / teeth / 4.0;
-
-    glm::vec3 normal;
-
-    for (i = 0; i < teeth; i++) {
-        ta = i * 2.0 * M_PI / teeth;
-        // todo : naming
-        cos_ta = cos(ta);
-        cos_ta_1da = cos(ta + da);
-        cos_ta_2da = cos(ta + 2 * da);
-        cos_ta_3da = cos(ta + 3 * da);
-        cos_ta_4da = cos(ta + 4 * da);
-        sin_ta = sin(ta);
-        sin_ta_1da = sin(ta + da);
-        sin_ta_2da = sin(ta + 2 * da);
-        sin_ta_3da = sin(ta + 3 * da);
-        sin_ta_4da = sin(ta + 4 * da);
-
-        u1 = r2 * cos_ta_1da - r1 * cos_ta;
-        v1 = r2 * sin_ta_1da - r1 * sin_ta;
-        len = sqrt(u1 * u1 + v1 * v1);
-        u1 /= len;
-        v1 /= len;
-        u2 = r1 * cos_ta_3da - r2 * cos_ta_2da;
-        v2 = r1 * sin_ta_3da - r2 * sin_ta_2da;
-
-        // front face
-        normal = glm::vec3(0.0, 0.0, 1.0);
-        ix0 = newVertex(&vBuffer, r0 * cos_ta, r0 * sin_ta, width * 0.5, normal);
-        ix1 = newVertex(&vBuffer, r1 * cos_ta, r1 * sin_ta, width * 0.5, normal);
-        ix2 = newVertex(&vBuffer, r0 * cos_ta, r0 * sin_ta, width * 0.5, normal);
-        ix3 = newVertex(&vBuffer, r1 * cos_ta_3da, r1 * sin_ta_3da, width * 0.5, normal);
-        ix4 = newVertex(&vBuffer, r0 * cos_ta_4da, r0 * sin_ta_4da, width * 0.5, normal);
-        ix5 = newVertex(&vBuffer, r1 * cos_ta_4da, r1 * sin_ta_4da, width * 0.5, normal);
-        newFace(&iBuffer, ix0, ix1, ix2);
-        newFace(&iBuffer, ix1, ix3, ix2);
-        newFace(&iBuffer, ix2, ix3, ix4);
-        newFace(&iBuffer, ix3, ix5, ix4);
-
-        // front sides of teeth
-        normal = glm::vec3(0.0, 0.0, 1.0);
-        ix0 = newVertex(&vBuffer, r1 * cos_ta, r1 * sin_ta, width * 0.5, normal);
-        ix1 = newVertex(&vBuffer, r2 * cos_ta_1da, r2 * sin_ta_1da, width * 0.5, normal);
-        ix2 = newVertex(&vBuffer, r1 * cos_ta_3da, r1 * sin_ta_3da, width * 0.5, normal);
-        ix3 = newVertex(&vBuffer, r2 * cos_ta_2da, r2 * sin_ta_2da, width * 0.5, normal);
-        newFace(&iBuffer, ix0, ix1, ix2);
-        newFace(&iBuffer, ix1, ix3, ix2);
-
-        // back face 
-        normal = glm::vec3(0.0, 0.0, -1.0);
-        ix0 = newVertex(&vBuffer, r1 * cos_ta, r1 * sin_ta, -width * 0.5, normal);
-        ix1 = newVertex(&vBuffer, r0 * cos_ta, r0 * sin_ta, -width * 0.5, normal);
-        ix2 = newVertex(&vBuffer, r1 * cos_ta_3da, r1 * sin_ta_3da, -width * 0.5, normal);
-        ix3 = newVertex(&vBuffer, r0 * cos_ta, r0 * sin_ta, -width * 0.5, normal);
-        ix4 = newVertex(&vBuffer, r1 * cos_ta_4da, r1 * sin_ta_4da, -width * 0.5, normal);
-        ix5 = newVertex(&vBuffer, r0 * cos_ta_4da, r0 * sin_ta_4da, -width * 0.5, normal);
-        newFace(&iBuffer, ix0, ix1, ix2);
-        newFace(&iBuffer, ix1, ix3, ix2);
-        newFace(&iBuffer, ix2, ix3, ix4);
-        newFace(&iBuffer, ix3, ix5, ix4);
-
-        // back sides of teeth 
-        normal = glm::vec3(0.0, 0.0, -1.0);
-        ix0 = newVertex(&vBuffer, r1 * cos_ta_3da, r1 * sin_ta_3da, -width * 0.5, normal);
-        ix1 = newVertex(&vBuffer, r2 * cos_ta_2da, r2 * sin_ta_2da, -width * 0.5, normal);
-        ix2 = newVertex(&vBuffer, r1 * cos_ta, r1 * sin_ta, -width * 0.5, normal);
-        ix3 = newVertex(&vBuffer, r2 * cos_ta_1da, r2 * sin_ta_1da, -width * 0.5, normal);
-        newFace(&iBuffer, ix0, ix1, ix2);
-        newFace(&iBuffer, ix1, ix3, ix2);
-
-        // draw outward faces of teeth 
-        normal = glm::vec3(v1, -u1, 0.0);
-        ix0 = newVertex(&vBuffer, r1 * cos_ta, r1 * sin_ta, width * 0.5, normal);
-        ix1 = newVertex(&vBuffer, r1 * cos_ta, r1 * sin_ta, -width * 0.5, normal);
-        ix2 = newVertex(&vBuffer, r2 * cos_ta_1da, r2 * sin_ta_1da, width * 0.5, normal);
-        ix3 = newVertex(&vBuffer, r2 * cos_ta_1da, r2 * sin_ta_1da, -width * 0.5, normal);
-        newFace(&iBuffer, ix0, ix1, ix2);
-        newFace(&iBuffer, ix1, ix3, ix2);
-
-        normal = glm::vec3(cos_ta, sin_ta, 0.0);
-        ix0 = newVertex(&vBuffer, r2 * cos_ta_1da, r2 * sin_ta_1da, width * 0.5, normal);
-        ix1 = newVertex(&vBuffer, r2 * cos_ta_1da, r2 * sin_ta_1da, -width * 0.5, normal);
-        ix2 = newVertex(&vBuffer, r2 * cos_ta_2da, r2 * sin_ta_2da, width * 0.5, normal);
-        ix3 = newVertex(&vBuffer, r2 * cos_ta_2da, r2 * sin_ta_2da, -width * 0.5, normal);
-        newFace(&iBuffer, ix0, ix1, ix2);
-        newFace(&iBuffer, ix1, ix3, ix2);
-
-        normal = glm::vec3(v2, -u2, 0.0);
-        ix0 = newVertex(&vBuffer, r2 * cos_ta_2da, r2 * sin_ta_2da, width * 0.5, normal);
-        ix1 = newVertex(&vBuffer, r2 * cos_ta_2da, r2 * sin_ta_2da, -width * 0.5, normal);
-        ix2 = newVertex(&vBuffer, r1 * cos_ta_3da, r1 * sin_ta_3da, width * 0.5, normal);
-        ix3 = newVertex(&vBuffer, r1 * cos_ta_3da, r1 * sin_ta_3da, -width * 0.5, normal);
-        newFace(&iBuffer, ix0, ix1, ix2);
-        newFace(&iBuffer, ix1, ix3, ix2);
-
-        normal = glm::vec3(cos_ta, sin_ta, 0.0);
-        ix0 = newVertex(&vBuffer, r1 * cos_ta_3da, r1 * sin_ta_3da, width * 0.5, normal);
-        ix1 = newVertex(&vBuffer, r1 * cos_ta_3da, r1 * sin_ta_3da, -width * 0.5, normal);
-        ix2 = newVertex(&vBuffer, r1 * cos_ta_4da, r1 * sin_ta_4da, width * 0.5, normal);
-        ix3 = newVertex(&vBuffer, r1 * cos_ta_4da, r1 * sin_ta_4da, -width * 0.5, normal);
-        newFace(&iBuffer, ix0, ix1, ix2);
-        newFace(&iBuffer, ix1, ix3, ix2);
-
-        // draw inside radius cylinder 
-        ix0 = newVertex(&vBuffer, r0 * cos_ta, r0 * sin_ta, -width * 0.5, glm::vec3(-cos_ta, -sin_ta, 0.0));
-        ix1 = newVertex(&vBuffer, r0 * cos_ta, r0 * sin_ta, width * 0.5, glm::vec3(-cos_ta, -sin_ta, 0.0));
-        ix2 = newVertex(&vBuffer, r0 * cos_ta_4da, r0 * sin_ta_4da, -width * 0.5, glm::vec3(-cos_ta_4da, -sin_ta_4da, 0.0));
-        ix3 = newVertex(&vBuffer, r0 * cos_ta_4da, r0 * sin_ta_4da, width * 0.5, glm::vec3(-cos_ta_4da, -sin_ta_4da, 0.0));
-        newFace(&iBuffer, ix0, ix1, ix2);
-        newFace(&iBuffer, ix1, ix3, ix2);
-    }
+    gearGeometry(inner_radius, outer_radius, width, teeth, tooth_depth,
+        [&](float x, float y, float z, const glm::vec3& normal) { return newVertex(&vBuffer, x, y, z, normal); },
+        [&](int a, int b, int c) { newFace(&iBuffer, a, b, c); });
 
     // Generate vertex & index buffers
     meshInfo.vertices = context.stageToDeviceBuffer(vk::BufferUsageFlagBits::eVertexBuffer, vBuffer);
@@ -226,3 +241,143 @@ void VulkanGear::prepareUniformBuffer() {
     uniformData = context.createUniformBuffer(ubo);
     uniformData.map();
 }
+
+void VulkanGearBatch::generate(const std::vector<GearInfo>& gears, vkx::ThreadPool* pool) {
+    destroy();
+    this->gears = gears;
+
+    // Offsets of every gear's mesh in the shared buffers
+    std::vector<uint32_t> firstVertex(gears.size());
+    std::vector<uint32_t> firstIndex(gears.size());
+    for (size_t i = 0; i < gears.size(); ++i) {
+        firstVertex[i] = vertexTotal;
+        firstIndex[i] = indexTotal;
+        vertexTotal += VulkanGear::vertexCount(gears[i].teeth);
+        indexTotal += VulkanGear::indexCount(gears[i].teeth);
+    }
+
+    vk::DeviceSize vertexSize = vertexTotal * sizeof(GearVertex);
+    vk::DeviceSize indexSize = indexTotal * sizeof(uint32_t);
+    vkx::CreateBufferResult staging = context.createBuffer(vk::BufferUsageFlagBits::eTransferSrc, vk::MemoryPropertyFlagBits::eHostVisible | vk::MemoryPropertyFlagBits::eHostCoherent, vertexSize + indexSize);
+    uint8_t* arena = staging.map<uint8_t>();
+    GearVertex* vertexArena = (GearVertex*)arena;
+    uint32_t* indexArena = (uint32_t*)(arena + vertexSize);
+
+    auto generateRange = [&](size_t begin, size_t end) {
+        for (size_t g = begin; g < end; ++g) {
+            const GearInfo& info = gears[g];
+            GearVertex* vertex = vertexArena + firstVertex[g];
+            uint32_t* index = indexArena + firstIndex[g];
+            int32_t nextVertex = (int32_t)firstVertex[g];
+            uint32_t gear = (uint32_t)g;
+            gearGeometry(info.innerRadius, info.outerRadius, info.width, info.teeth, info.toothDepth,
+                [&](float x, float y, float z, const glm::vec3& normal) {
+                    *vertex++ = { { x, y, z }, { normal.x, normal.y, normal.z }, gear };
+                    return nextVertex++;
+                },
+                [&](int a, int b, int c) {
+                    *index++ = a;
+                    *index++ = b;
+                    *index++ = c;
+                });
+        }
+    };
+
+    const uint32_t threadCount = pool ? (uint32_t)pool->threads.size() : 0;
+    if (threadCount < 2 || gears.size() < threadCount * 4) {
+        generateRange(0, gears.size());
+    } else {
+        size_t chunk = (gears.size() + threadCount - 1) / threadCount;
+        for (uint32_t t = 0; t < threadCount; ++t) {
+            size_t begin = std::min(gears.size(), t * chunk);
+            size_t end = std::min(gears.size(), begin + chunk);
+            pool->threads[t]->addJob([=, &generateRange] { generateRange(begin, end); });
+        }
+        pool->wait();
+    }
+
+    vertices = context.createBuffer(vk::BufferUsageFlagBits::eVertexBuffer | vk::BufferUsageFlagBits::eTransferDst, vk::MemoryPropertyFlagBits::eDeviceLocal, vertexSize);
+    indices = context.createBuffer(vk::BufferUsageFlagBits::eIndexBuffer | vk::BufferUsageFlagBits::eTransferDst, vk::MemoryPropertyFlagBits::eDeviceLocal, indexSize);
+    context.withPrimaryCommandBuffer([&](vk::CommandBuffer copyCmd) {
+        copyCmd.copyBuffer(staging.buffer, vertices.buffer, vk::BufferCopy(0, 0, vertexSize));
+        copyCmd.copyBuffer(staging.buffer, indices.buffer, vk::BufferCopy(vertexSize, 0, indexSize));
+    });
+    staging.destroy();
+
+    uniformData = context.createUniformBuffer(ubo);
+    uniformData.map();
+
+    // The colors are static, the transforms are written by updateUniformBuffer
+    instances = context.createBuffer(vk::BufferUsageFlagBits::eStorageBuffer, vk::MemoryPropertyFlagBits::eHostVisible | vk::MemoryPropertyFlagBits::eHostCoherent, gears.size() * sizeof(Instance));
+    Instance* instance = instances.map<Instance>();
+    for (const GearInfo& info : gears) {
+        (instance++)->color = glm::vec4(info.color, 1.0f);
+    }
+}
+
+void VulkanGearBatch::setupDescriptorSet(vk::DescriptorPool pool, vk::DescriptorSetLayout descriptorSetLayout) {
+    if (!descriptorSet) {
+        vk::DescriptorSetAllocateInfo allocInfo =
+            vkx::descriptorSetAllocateInfo(pool, &descriptorSetLayout, 1);
+        descriptorSet = context.device.allocateDescriptorSets(allocInfo)[0];
+    }
+
+    std::vector<vk::WriteDescriptorSet> writeDescriptorSets =
+    {
+        // Binding 0 : Vertex shader uniform buffer
+        vkx::writeDescriptorSet(descriptorSet, vk::DescriptorType::eUniformBuffer, 0, &uniformData.descriptor),
+        // Binding 1 : Vertex shader instance buffer
+        vkx::writeDescriptorSet(descriptorSet, vk::DescriptorType::eStorageBuffer, 1, &instances.descriptor)
+    };
+
+    context.device.updateDescriptorSets(writeDescriptorSets, nullptr);
+}
+
+void VulkanGearBatch::updateUniformBuffer(glm::mat4 perspective, glm::vec3 rotation, float zoom, float timer) {
+    ubo.projection = perspective;
+
+    ubo.view = glm::lookAt(
+        glm::vec3(0, 0, -zoom),
+        glm::vec3(-1.0, -1.5, 0),
+        glm::vec3(0, 1, 0)
+        );
+    ubo.view = glm::rotate(ubo.view, glm::radians(rotation.x), glm::vec3(1.0f, 0.0f, 0.0f));
+    ubo.view = glm::rotate(ubo.view, glm::radians(rotation.y), glm::vec3(0.0f, 1.0f, 0.0f));
+
+    ubo.lightPos = glm::vec4(0.0f, 0.0f, 2.5f, 1.0f);
+    ubo.lightPos.x = sin(glm::radians(timer)) * 8.0f;
+    ubo.lightPos.z = cos(glm::radians(timer)) * 8.0f;
+
+    uniformData.copy(ubo);
+
+    // translate(pos) * rotate(angle, z), written column by column
+    Instance* instance = (Instance*)instances.mapped;
+    for (const GearInfo& info : gears) {
+        float angle = glm::radians((info.rotSpeed * timer) + info.rotOffset);
+        float c = cos(angle);
+        float s = sin(angle);
+        glm::mat4& model = (instance++)->model;
+        model[0] = glm::vec4(c, s, 0.0f, 0.0f);
+        model[1] = glm::vec4(-s, c, 0.0f, 0.0f);
+        model[2] = glm::vec4(0.0f, 0.0f, 1.0f, 0.0f);
+        model[3] = glm::vec4(info.pos, 1.0f);
+    }
+}
+
+void VulkanGearBatch::draw(vk::CommandBuffer cmdbuffer, vk::PipelineLayout pipelineLayout) {
+    vk::DeviceSize offsets = 0;
+    cmdbuffer.bindDescriptorSets(vk::PipelineBindPoint::eGraphics, pipelineLayout, 0, descriptorSet, nullptr);
+    cmdbuffer.bindVertexBuffers(0, vertices.buffer, offsets);
+    cmdbuffer.bindIndexBuffer(indices.buffer, 0, vk::IndexType::eUint32);
+    cmdbuffer.drawIndexed(indexTotal, 1, 0, 0, 0);
+}
+
+void VulkanGearBatch::destroy() {
+    vertices.destroy();
+    indices.destroy();
+    uniformData.destroy();
+    instances.destroy();
+    gears.clear();
+    vertexTotal = 0;
+    indexTotal = 0;
+}
@@ -11,6 +11,7 @@
 #pragma once
 
 #include "vulkanExampleBase.h"
+#include "threadPool.hpp"
 
 struct Vertex
 {
@@ -80,7 +81,89 @@ public:
     VulkanGear(const vkx::Context& context);
     ~VulkanGear();
 
+    // Exact size of the mesh of a gear with the given number of teeth
+    static uint32_t vertexCount(int teeth) { return teeth * 40; }
+    static uint32_t indexCount(int teeth) { return teeth * 66; }
+
     void generate(float inner_radius, float outer_radius, float width, int teeth, float tooth_depth, glm::vec3 color, glm::vec3 pos, float rotSpeed, float rotOffset);
 
 };
 
+// Parameters of one gear of a VulkanGearBatch
+struct GearInfo
+{
+    float innerRadius;
+    float outerRadius;
+    float width;
+    int teeth;
+    float toothDepth;
+    glm::vec3 color;
+    glm::vec3 pos;
+    float rotSpeed;
+    float rotOffset;
+};
+
+// Vertex of a batched gear, the color and transform are looked up with the gear index
+struct GearVertex
+{
+    float pos[3];
+    float normal[3];
+    uint32_t gear;
+};
+
+// Draws any number of gears with one indexed draw
+//
+// The meshes of all gears share one vertex and one index buffer, the per gear transforms
+// and colors are stored in one storage buffer indexed with the gear index of each vertex.
+// A single descriptor set holds the shared uniform buffer (binding 0) and the instance
+// buffer (binding 1).
+class VulkanGearBatch
+{
+private:
+    struct UBO
+    {
+        glm::mat4 projection;
+        glm::mat4 view;
+        glm::vec4 lightPos;
+    };
+
+    // std430 layout of the instance buffer
+    struct Instance
+    {
+        glm::mat4 model;
+        glm::vec4 color;
+    };
+
+    const vkx::Context& context;
+
+    std::vector<GearInfo> gears;
+    vkx::CreateBufferResult vertices;
+    vkx::CreateBufferResult indices;
+    uint32_t vertexTotal{ 0 };
+    uint32_t indexTotal{ 0 };
+
+    UBO ubo;
+    vkx::UniformData uniformData;
+    vkx::CreateBufferResult instances;
+
+public:
+    vk::DescriptorSet descriptorSet;
+
+    VulkanGearBatch(const vkx::Context& context) : context(context) {}
+    ~VulkanGearBatch() { destroy(); }
+
+    // Generates the meshes of all gears.  The mesh sizes are known up front, so every gear is
+    // written at its own offset straight into one mapped staging buffer, in parallel if a pool
+    // is given, and copied to the device with a single submission.
+    void generate(const std::vector<GearInfo>& gears, vkx::ThreadPool* pool = nullptr);
+    // Allocates the descriptor set on first use and points it at the current buffers
+    void setupDescriptorSet(vk::DescriptorPool pool, vk::DescriptorSetLayout descriptorSetLayout);
+    void updateUniformBuffer(glm::mat4 perspective, glm::vec3 rotation, float zoom, float timer);
+    void draw(vk::CommandBuffer cmdbuffer, vk::PipelineLayout pipelineLayout);
+
+    uint32_t gearCount() const { return (uint32_t)gears.size(); }
+    uint32_t vertexCount() const { return vertexTotal; }
+    uint32_t indexCount() const { return indexTotal; }
+
+    void destroy();
+};
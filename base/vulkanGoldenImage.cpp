@@ -0,0 +1,74 @@
+/*
+* Comparison of a headless frame with a stored golden image
+*
+* This code is licensed under the MIT license (MIT) (http://opensource.org/licenses/MIT)
+*/
+
+#include "vulkanGoldenImage.h"
+
+#include <iomanip>
+#include <iostream>
+#include <vector>
+
+#include "vulkanFrameCapture.h"
+#include "imageCompare.h"
+#include "imageWriter.h"
+
+using namespace vkx;
+
+GoldenImage::Result GoldenImage::compare(const ReadbackData& frame, const std::string& example, const std::string& timing) const {
+    std::string referenceFile = referenceDir + "/" + example + ".ppm";
+    std::cout << "golden " << example << ": ";
+    PixelLayout layout;
+    if (frame.data.empty() || !FrameCapture::pixelLayout(frame.format, layout)) {
+        std::cout << "FAIL, the frame couldn't be read back" << std::endl;
+        return Result::Fail;
+    }
+    size_t rowPitch = (size_t)frame.width * 4;
+
+    if (update) {
+        if (!writeImage(referenceFile, frame.data.data(), frame.width, frame.height, rowPitch, layout)) {
+            std::cout << "FAIL, couldn't write " << referenceFile << std::endl;
+            return Result::Fail;
+        }
+        std::cout << "updated " << referenceFile << std::endl;
+        return Result::Updated;
+    }
+
+    std::vector<uint8_t> reference;
+    uint32_t referenceWidth, referenceHeight;
+    if (!readPpm(referenceFile, reference, referenceWidth, referenceHeight)) {
+        // Not a failure, references are only committed for the examples a driver renders
+        // reproducibly
+        std::cout << "SKIP, no reference " << referenceFile << ", create it with -update-golden" << std::endl;
+        return Result::Skip;
+    }
+    if (referenceWidth != frame.width || referenceHeight != frame.height) {
+        std::cout << "FAIL, the reference is " << referenceWidth << "x" << referenceHeight << ", the frame "
+            << frame.width << "x" << frame.height << std::endl;
+        return Result::Fail;
+    }
+
+    std::vector<uint8_t> pixels((size_t)frame.width * frame.height * 3);
+    const uint8_t* in = frame.data.data();
+    uint32_t red = layout == PixelLayout::BGRA8 ? 2 : 0;
+    for (size_t i = 0; i < (size_t)frame.width * frame.height; ++i, in += 4) {
+        pixels[i * 3] = in[red];
+        pixels[i * 3 + 1] = in[1];
+        pixels[i * 3 + 2] = in[2 - red];
+    }
+    ImageComparison comparison = compareImages(reference.data(), pixels.data(), frame.width, frame.height, tolerance);
+    double differing = (double)comparison.differingPixels / ((double)frame.width * frame.height);
+    bool passed = differing <= maxDifferingPixels && comparison.ssim >= minSsim;
+
+    std::cout << (passed ? "PASS" : "FAIL") << ", max difference " << comparison.maxDifference << ", "
+        << std::fixed << std::setprecision(3) << differing * 100.0 << "% of the pixels over " << tolerance
+        << ", PSNR " << std::setprecision(1) << comparison.psnr << " dB, SSIM " << std::setprecision(4) << comparison.ssim
+        << ", " << timing << std::endl;
+    if (!passed) {
+        writeImage(example + "_actual.png", pixels.data(), frame.width, frame.height, (size_t)frame.width * 3, PixelLayout::RGB8);
+        writeImage(example + "_diff.png", comparison.diff.data(), frame.width, frame.height, (size_t)frame.width * 3, PixelLayout::RGB8);
+        return Result::Fail;
+    }
+    return Result::Pass;
+}
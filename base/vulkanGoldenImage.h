@@ -0,0 +1,57 @@
+/*
+* Comparison of a headless frame with a stored golden image
+*
+* This code is licensed under the MIT license (MIT) (http://opensource.org/licenses/MIT)
+*/
+
+#pragma once
+
+#include <stdint.h>
+#include <future>
+#include <string>
+
+#include "vulkanReadback.h"
+
+namespace vkx {
+
+    // Settings of a headless run and the comparison of its last frame with <referenceDir>/<example>.ppm.
+    // The owner renders the frames with the fixed timer, reads back the last one into frame when
+    // capture is set and passes it to compare().
+    class GoldenImage {
+    public:
+        enum class Result {
+            Pass,
+            Fail,
+            // No reference to compare with
+            Skip,
+            // The reference was written
+            Updated,
+        };
+
+        // Render into offscreen images instead of a window
+        bool headless{ false };
+        // Compare with the references in this directory, only print the timing if empty
+        std::string referenceDir;
+        // Write the reference instead of comparing with it
+        bool update{ false };
+        // Timer value of the fixed frame
+        float timer{ 0.25f };
+        // Channel difference that still counts as equal
+        uint32_t tolerance{ 2 };
+        // Share of the pixels that may differ by more than the tolerance
+        double maxDifferingPixels{ 0.001 };
+        double minSsim{ 0.99 };
+        // Frames before the timed ones, for examples that settle over a few frames
+        uint32_t warmupFrames{ 4 };
+        uint32_t timedFrames{ 60 };
+        // Last timed frame, read back in the pre present command buffer
+        bool capture{ false };
+        std::future<ReadbackData> frame;
+
+        bool comparing() const { return !referenceDir.empty(); }
+
+        // Prints one line with the result and the timing.  A frame that differs is written to
+        // <example>_actual.png along with <example>_diff.png in the working directory.
+        Result compare(const ReadbackData& frame, const std::string& example, const std::string& timing) const;
+    };
+}
@@ -0,0 +1,208 @@
+/*
+* Tracking of the host memory allocated by the Vulkan implementation
+*
+* This code is licensed under the MIT license (MIT) (http://opensource.org/licenses/MIT)
+*/
+
+#include "vulkanHostAllocations.h"
+
+#include <stdlib.h>
+#include <string.h>
+#include <initializer_list>
+#include <iomanip>
+#include <sstream>
+
+using namespace vkx;
+
+namespace {
+    // Stored in front of every allocation, frees and reallocations don't pass the size
+    struct Header {
+        size_t size;
+        // Distance from the start of the underlying block to the returned pointer
+        uint32_t offset;
+        uint8_t scope;
+        uint8_t inArena;
+    };
+
+    const char* const SCOPE_NAMES[HostAllocationTracker::SCOPE_COUNT] = { "command", "object", "cache", "device", "instance" };
+
+    inline Header* header(void* memory) {
+        return (Header*)memory - 1;
+    }
+
+    void raise(std::atomic<uint64_t>& peak, uint64_t value) {
+        uint64_t current = peak.load(std::memory_order_relaxed);
+        while (value > current && !peak.compare_exchange_weak(current, value, std::memory_order_relaxed)) {
+        }
+    }
+}
+
+HostAllocationTracker::HostAllocationTracker(size_t arenaSize) : arenaSize(arenaSize) {
+    if (arenaSize) {
+        arena.reset(new uint8_t[arenaSize]);
+    }
+    allocationCallbacks.pUserData = this;
+    allocationCallbacks.pfnAllocation = allocationFunction;
+    allocationCallbacks.pfnReallocation = reallocationFunction;
+    allocationCallbacks.pfnFree = freeFunction;
+    allocationCallbacks.pfnInternalAllocation = internalAllocationNotification;
+    allocationCallbacks.pfnInternalFree = internalFreeNotification;
+}
+
+void* HostAllocationTracker::allocate(size_t size, size_t alignment, uint32_t scope) {
+    alignment = std::max(alignment, alignof(Header));
+    size_t blockSize = sizeof(Header) + alignment - 1 + size;
+
+    uint8_t* block = nullptr;
+    bool inArena = false;
+    if (arena && (arenaScopes & (1u << scope))) {
+        size_t offset = arenaOffset.fetch_add(blockSize);
+        if (offset + blockSize <= arenaSize) {
+            block = arena.get() + offset;
+            inArena = true;
+        }
+    }
+    if (!block) {
+        block = (uint8_t*)malloc(blockSize);
+        if (!block) {
+            return nullptr;
+        }
+    }
+
+    uint8_t* memory = (uint8_t*)(((uintptr_t)block + sizeof(Header) + alignment - 1) & ~(uintptr_t)(alignment - 1));
+    Header* h = header(memory);
+    h->size = size;
+    h->offset = (uint32_t)(memory - block);
+    h->scope = (uint8_t)scope;
+    h->inArena = inArena;
+    added(scope, size);
+    return memory;
+}
+
+void HostAllocationTracker::release(void* memory) {
+    Header* h = header(memory);
+    removed(h->scope, h->size);
+    if (!h->inArena) {
+        free((uint8_t*)memory - h->offset);
+    }
+}
+
+void HostAllocationTracker::added(uint32_t scope, size_t size) {
+    for (Counters* c : { &counters[scope], &totals }) {
+        raise(c->peakBytes, c->bytes.fetch_add(size, std::memory_order_relaxed) + size);
+    }
+}
+
+void HostAllocationTracker::removed(uint32_t scope, size_t size) {
+    counters[scope].bytes.fetch_sub(size, std::memory_order_relaxed);
+    totals.bytes.fetch_sub(size, std::memory_order_relaxed);
+}
+
+VKAPI_ATTR void* VKAPI_CALL HostAllocationTracker::allocationFunction(void* userData, size_t size, size_t alignment, VkSystemAllocationScope scope) {
+    HostAllocationTracker* tracker = (HostAllocationTracker*)userData;
+    void* memory = tracker->allocate(size, alignment, scope);
+    if (memory) {
+        tracker->counters[scope].allocations.fetch_add(1, std::memory_order_relaxed);
+        tracker->totals.allocations.fetch_add(1, std::memory_order_relaxed);
+    }
+    return memory;
+}
+
+VKAPI_ATTR void* VKAPI_CALL HostAllocationTracker::reallocationFunction(void* userData, void* original, size_t size, size_t alignment, VkSystemAllocationScope scope) {
+    HostAllocationTracker* tracker = (HostAllocationTracker*)userData;
+    if (!original) {
+        return allocationFunction(userData, size, alignment, scope);
+    }
+    if (size == 0) {
+        freeFunction(userData, original);
+        return nullptr;
+    }
+    // The original allocation stays valid if the new one fails
+    void* memory = tracker->allocate(size, alignment, scope);
+    if (memory) {
+        memcpy(memory, original, std::min(size, header(original)->size));
+        tracker->release(original);
+        tracker->counters[scope].reallocations.fetch_add(1, std::memory_order_relaxed);
+        tracker->totals.reallocations.fetch_add(1, std::memory_order_relaxed);
+    }
+    return memory;
+}
+
+VKAPI_ATTR void VKAPI_CALL HostAllocationTracker::freeFunction(void* userData, void* memory) {
+    if (!memory) {
+        return;
+    }
+    HostAllocationTracker* tracker = (HostAllocationTracker*)userData;
+    uint32_t scope = header(memory)->scope;
+    tracker->release(memory);
+    tracker->counters[scope].frees.fetch_add(1, std::memory_order_relaxed);
+    tracker->totals.frees.fetch_add(1, std::memory_order_relaxed);
+}
+
+VKAPI_ATTR void VKAPI_CALL HostAllocationTracker::internalAllocationNotification(void* userData, size_t size, VkInternalAllocationType, VkSystemAllocationScope scope) {
+    HostAllocationTracker* tracker = (HostAllocationTracker*)userData;
+    tracker->counters[scope].internalBytes.fetch_add(size, std::memory_order_relaxed);
+    tracker->totals.internalBytes.fetch_add(size, std::memory_order_relaxed);
+}
+
+VKAPI_ATTR void VKAPI_CALL HostAllocationTracker::internalFreeNotification(void* userData, size_t size, VkInternalAllocationType, VkSystemAllocationScope scope) {
+    HostAllocationTracker* tracker = (HostAllocationTracker*)userData;
+    tracker->counters[scope].internalBytes.fetch_sub(size, std::memory_order_relaxed);
+    tracker->totals.internalBytes.fetch_sub(size, std::memory_order_relaxed);
+}
+
+HostAllocationStats HostAllocationTracker::read(const Counters& counters) {
+    HostAllocationStats result;
+    result.allocations = counters.allocations.load(std::memory_order_relaxed);
+    result.reallocations = counters.reallocations.load(std::memory_order_relaxed);
+    result.frees = counters.frees.load(std::memory_order_relaxed);
+    result.bytes = counters.bytes.load(std::memory_order_relaxed);
+    result.peakBytes = counters.peakBytes.load(std::memory_order_relaxed);
+    result.internalBytes = counters.internalBytes.load(std::memory_order_relaxed);
+    return result;
+}
+
+std::string HostAllocationTracker::report() const {
+    std::ostringstream ss;
+    ss << std::left << std::setw(10) << "scope" << std::right << std::setw(12) << "allocs" << std::setw(12) << "reallocs"
+        << std::setw(12) << "frees" << std::setw(12) << "live KB" << std::setw(12) << "peak KB" << std::setw(12) << "internal KB" << std::endl;
+    auto line = [&](const char* name, const HostAllocationStats& stats) {
+        ss << std::left << std::setw(10) << name << std::right << std::setw(12) << stats.allocations << std::setw(12) << stats.reallocations
+            << std::setw(12) << stats.frees << std::fixed << std::setprecision(1) << std::setw(12) << stats.bytes / 1024.0
+            << std::setw(12) << stats.peakBytes / 1024.0 << std::setw(12) << stats.internalBytes / 1024.0 << std::endl;
+    };
+    for (size_t i = 0; i < SCOPE_COUNT; ++i) {
+        HostAllocationStats stats = read(counters[i]);
+        if (stats.allocations || stats.internalBytes) {
+            line(SCOPE_NAMES[i], stats);
+        }
+    }
+    line("total", total());
+    if (arenaSize) {
+        ss << "arena " << arenaUsed() / 1024.0 << " of " << arenaSize / 1024.0 << " KB used" << std::endl;
+    }
+    return ss.str();
+}
+
+void HostAllocationReport::mark() {
+    if (tracker) {
+        marked = tracker->total();
+    }
+}
+
+std::string HostAllocationReport::perFrame(uint32_t frames) {
+    if (!tracker) {
+        return std::string();
+    }
+    HostAllocationStats host = tracker->total();
+    uint64_t allocations = host.allocations + host.reallocations - marked.allocations - marked.reallocations;
+    marked = host;
+    std::ostringstream ss;
+    ss << std::fixed << std::setprecision(1) << (frames ? (double)allocations / frames : 0.0) << " host allocs/frame, "
+        << host.bytes / 1024 << " KB host memory (peak " << host.peakBytes / 1024 << " KB)";
+    return ss.str();
+}
+
+std::string HostAllocationReport::report() const {
+    return tracker ? tracker->report() : std::string();
+}
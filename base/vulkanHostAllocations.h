@@ -0,0 +1,115 @@
+/*
+* Tracking of the host memory allocated by the Vulkan implementation
+*
+* This code is licensed under the MIT license (MIT) (http://opensource.org/licenses/MIT)
+*/
+
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <memory>
+#include <string>
+
+#include <vulkan/vk_cpp.hpp>
+
+namespace vkx {
+
+    // Counters of one allocation scope, or of all of them
+    struct HostAllocationStats {
+        uint64_t allocations{ 0 };
+        uint64_t reallocations{ 0 };
+        uint64_t frees{ 0 };
+        // Bytes currently allocated through the callbacks and their high-water mark
+        uint64_t bytes{ 0 };
+        uint64_t peakBytes{ 0 };
+        // Bytes the implementation allocated itself and reported through the internal
+        // allocation notifications, e.g. executable memory for shaders
+        uint64_t internalBytes{ 0 };
+    };
+
+    // Allocation callbacks that count the host memory the implementation allocates, per
+    // VkSystemAllocationScope.  Allocations are served by malloc, or by a bump allocated arena
+    // for the scopes routed to it.  Arena memory is only reclaimed with the tracker, so only
+    // long lived scopes (instance, device) should be routed there; allocations that don't fit
+    // anymore fall back to malloc.
+    //
+    // The callbacks are called from whichever thread calls into the implementation, the
+    // counters are atomic.  The tracker has to outlive every object created with its callbacks.
+    class HostAllocationTracker {
+    public:
+        static const size_t SCOPE_COUNT = 5;
+
+        HostAllocationTracker(size_t arenaSize = 0);
+
+        const vk::AllocationCallbacks& callbacks() const { return allocationCallbacks; }
+
+        void routeToArena(vk::SystemAllocationScope scope) { arenaScopes |= 1u << (uint32_t)scope; }
+        size_t arenaCapacity() const { return arenaSize; }
+        size_t arenaUsed() const { return std::min<size_t>(arenaOffset, arenaSize); }
+
+        HostAllocationStats stats(vk::SystemAllocationScope scope) const { return read(counters[(size_t)scope]); }
+        HostAllocationStats total() const { return read(totals); }
+        // One line per scope with any allocations, and the totals
+        std::string report() const;
+
+    private:
+        struct Counters {
+            std::atomic<uint64_t> allocations{ 0 };
+            std::atomic<uint64_t> reallocations{ 0 };
+            std::atomic<uint64_t> frees{ 0 };
+            std::atomic<uint64_t> bytes{ 0 };
+            std::atomic<uint64_t> peakBytes{ 0 };
+            std::atomic<uint64_t> internalBytes{ 0 };
+        };
+
+        static VKAPI_ATTR void* VKAPI_CALL allocationFunction(void* userData, size_t size, size_t alignment, VkSystemAllocationScope scope);
+        static VKAPI_ATTR void* VKAPI_CALL reallocationFunction(void* userData, void* original, size_t size, size_t alignment, VkSystemAllocationScope scope);
+        static VKAPI_ATTR void VKAPI_CALL freeFunction(void* userData, void* memory);
+        static VKAPI_ATTR void VKAPI_CALL internalAllocationNotification(void* userData, size_t size, VkInternalAllocationType type, VkSystemAllocationScope scope);
+        static VKAPI_ATTR void VKAPI_CALL internalFreeNotification(void* userData, size_t size, VkInternalAllocationType type, VkSystemAllocationScope scope);
+
+        void* allocate(size_t size, size_t alignment, uint32_t scope);
+        void release(void* memory);
+        void added(uint32_t scope, size_t size);
+        void removed(uint32_t scope, size_t size);
+        static HostAllocationStats read(const Counters& counters);
+
+        vk::AllocationCallbacks allocationCallbacks;
+        std::array<Counters, SCOPE_COUNT> counters;
+        Counters totals;
+
+        std::unique_ptr<uint8_t[]> arena;
+        size_t arenaSize{ 0 };
+        std::atomic<size_t> arenaOffset{ 0 };
+        uint32_t arenaScopes{ 0 };
+    };
+
+    // Reports the counters of a tracker over intervals of frames, for the text overlay and the
+    // headless timing.  Refers to the tracker of a context, which is only created if tracking
+    // is enabled, without one there is nothing to report.
+    class HostAllocationReport {
+    public:
+        HostAllocationReport(const std::shared_ptr<HostAllocationTracker>& tracker) : tracker(tracker) {}
+
+        bool enabled() const { return (bool)tracker; }
+        // Starts an interval
+        void mark();
+        // Allocations per frame since the last mark and the bytes held, and starts the next
+        // interval.  Empty without tracking.
+        std::string perFrame(uint32_t frames);
+        // perFrame() kept for display, so redrawing doesn't end the interval early
+        void sample(uint32_t frames) { lastText = perFrame(frames); }
+        const std::string& lastSample() const { return lastText; }
+        // Full report of the tracker, empty without tracking
+        std::string report() const;
+
+    private:
+        const std::shared_ptr<HostAllocationTracker>& tracker;
+        HostAllocationStats marked;
+        std::string lastText;
+    };
+}
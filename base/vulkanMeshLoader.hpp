@@ -37,6 +37,7 @@
 #endif
 
 #include "vulkanTools.h"
+#include "vulkanAssetPack.h"
 
 namespace vkx {
     typedef enum VertexLayout {
@@ -189,6 +190,8 @@ namespace vkx {
         } dim;
 
         uint32_t numVertices{ 0 };
+        // Name of the buffers in the resource registry
+        std::string filename;
 
         // Optional
         struct {
@@ -223,6 +226,24 @@ namespace vkx {
 
         // Load the mesh with custom flags
         bool load(const std::string& filename, int flags) {
+            AssetPack* pack = AssetPack::mounted();
+            const pack::Entry* packed = pack ? pack->find(filename) : nullptr;
+            if (packed) {
+                // The extension is passed as a hint since assimp can't see the file name
+                std::string extension = filename.substr(filename.find_last_of('.') + 1);
+                std::vector<uint8_t> decompressed;
+                const uint8_t* meshData = pack->map(*packed);
+                if (!meshData) {
+                    decompressed = pack->read(*packed);
+                    meshData = decompressed.data();
+                }
+                pScene = Importer.ReadFileFromMemory(meshData, packed->size, flags, extension.c_str());
+                if (!pScene) {
+                    throw std::runtime_error("Unable to parse " + filename);
+                }
+                return parse(pScene, filename);
+            }
+
 #if defined(__ANDROID__)
             // Meshes are stored inside the apk on Android (compressed)
             // So they need to be loaded via the asset manager
@@ -251,6 +272,7 @@ namespace vkx {
 
     private:
         bool parse(const aiScene* pScene, const std::string& Filename) {
+            filename = Filename;
             m_Entries.resize(pScene->mNumMeshes);
 
             // Counters
@@ -398,6 +420,8 @@ namespace vkx {
             meshBuffer.vertices = context.stageToDeviceBuffer(vk::BufferUsageFlagBits::eVertexBuffer, vertexBuffer);
             // Index buffer
             meshBuffer.indices = context.stageToDeviceBuffer(vk::BufferUsageFlagBits::eIndexBuffer, indexBuffer);
+            context.nameResource(meshBuffer.vertices.buffer, meshBuffer.vertices.memory, ResourceCategory::Mesh, filename + " vertices");
+            context.nameResource(meshBuffer.indices.buffer, meshBuffer.indices.memory, ResourceCategory::Mesh, filename + " indices");
             meshBuffer.dim = dim.size;
             return meshBuffer;
         }
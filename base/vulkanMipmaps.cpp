@@ -0,0 +1,465 @@
+/*
+* Mip chain generation
+*
+* This code is licensed under the MIT license (MIT) (http://opensource.org/licenses/MIT)
+*/
+
+#include "vulkanMipmaps.h"
+
+#include <algorithm>
+#include <cmath>
+#include <stdexcept>
+
+#include "vulkanContext.hpp"
+#include "vulkanShaders.h"
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define MIPMAP_SSE
+#endif
+
+namespace vkx {
+
+namespace {
+    static const uint32_t GROUP_SIZE = 8;
+
+    struct PushConstants {
+        int32_t srcSize[2];
+        int32_t dstSize[2];
+    };
+
+    struct StorageFormat {
+        vk::Format format;
+        const char* qualifier;
+        bool srgb;
+    };
+
+    // Format of the storage view written by the compute method, sRGB images are written
+    // through a UNORM view with the encoding done in the shader
+    bool storageFormat(vk::Format format, StorageFormat& result) {
+        switch (format) {
+        case vk::Format::eR8G8B8A8Unorm: result = { format, "rgba8", false }; return true;
+        case vk::Format::eR8G8B8A8Srgb: result = { vk::Format::eR8G8B8A8Unorm, "rgba8", true }; return true;
+        case vk::Format::eR8G8Unorm: result = { format, "rg8", false }; return true;
+        case vk::Format::eR8Unorm: result = { format, "r8", false }; return true;
+        case vk::Format::eR16G16B16A16Unorm: result = { format, "rgba16", false }; return true;
+        case vk::Format::eR16G16B16A16Sfloat: result = { format, "rgba16f", false }; return true;
+        case vk::Format::eR16G16Sfloat: result = { format, "rg16f", false }; return true;
+        case vk::Format::eR16Sfloat: result = { format, "r16f", false }; return true;
+        case vk::Format::eR32G32B32A32Sfloat: result = { format, "rgba32f", false }; return true;
+        case vk::Format::eR32G32Sfloat: result = { format, "rg32f", false }; return true;
+        case vk::Format::eR32Sfloat: result = { format, "r32f", false }; return true;
+        default: return false;
+        }
+    }
+
+    void levelBarrier(const vk::CommandBuffer& cmdBuffer, vk::Image image, uint32_t baseLevel, uint32_t levelCount, uint32_t layers,
+        vk::ImageLayout oldLayout, vk::ImageLayout newLayout, vk::AccessFlags srcAccess, vk::AccessFlags dstAccess,
+        vk::PipelineStageFlags srcStages, vk::PipelineStageFlags dstStages) {
+        if (levelCount == 0) {
+            return;
+        }
+        vk::ImageMemoryBarrier barrier;
+        barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+        barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+        barrier.oldLayout = oldLayout;
+        barrier.newLayout = newLayout;
+        barrier.srcAccessMask = srcAccess;
+        barrier.dstAccessMask = dstAccess;
+        barrier.image = image;
+        barrier.subresourceRange = { vk::ImageAspectFlagBits::eColor, baseLevel, levelCount, 0, layers };
+        cmdBuffer.pipelineBarrier(srcStages, dstStages, vk::DependencyFlags(), nullptr, nullptr, barrier);
+    }
+
+    uint32_t levelSize(uint32_t size, uint32_t level) {
+        return std::max(size >> level, 1u);
+    }
+}
+
+uint32_t mipLevelCount(uint32_t width, uint32_t height) {
+    uint32_t levels = 1;
+    for (uint32_t size = std::max(width, height); size > 1; size >>= 1) {
+        ++levels;
+    }
+    return levels;
+}
+
+MipGenerator::Method MipGenerator::method(vk::Format format) const {
+    vk::FormatProperties properties = context.physicalDevice.getFormatProperties(format);
+    const vk::FormatFeatureFlags blitFeatures = vk::FormatFeatureFlagBits::eBlitSrc | vk::FormatFeatureFlagBits::eBlitDst | vk::FormatFeatureFlagBits::eSampledImageFilterLinear;
+    if ((properties.optimalTilingFeatures & blitFeatures) == blitFeatures) {
+        return Method::Blit;
+    }
+    StorageFormat storage;
+    if (shaderPath.empty() || !storageFormat(format, storage) || !(properties.optimalTilingFeatures & vk::FormatFeatureFlagBits::eSampledImage)) {
+        return Method::None;
+    }
+    vk::FormatProperties storageProperties = context.physicalDevice.getFormatProperties(storage.format);
+    if (!(storageProperties.optimalTilingFeatures & vk::FormatFeatureFlagBits::eStorageImage)) {
+        return Method::None;
+    }
+    return Method::Compute;
+}
+
+vk::ImageUsageFlags MipGenerator::imageUsage(Method method) const {
+    switch (method) {
+    case Method::Blit: return vk::ImageUsageFlagBits::eTransferSrc;
+    case Method::Compute: return vk::ImageUsageFlagBits::eStorage | vk::ImageUsageFlagBits::eSampled;
+    default: return vk::ImageUsageFlags();
+    }
+}
+
+vk::ImageCreateFlags MipGenerator::imageFlags(Method method, vk::Format format) const {
+    StorageFormat storage;
+    if (method == Method::Compute && storageFormat(format, storage) && storage.format != format) {
+        return vk::ImageCreateFlagBits::eMutableFormat;
+    }
+    return vk::ImageCreateFlags();
+}
+
+void MipGenerator::generate(const vk::CommandBuffer& cmdBuffer, vk::Image image, vk::Format format, const vk::Extent2D& extent, uint32_t baseLevels, uint32_t levels, uint32_t layers) {
+    switch (method(format)) {
+    case Method::Blit:
+        blit(cmdBuffer, image, extent, baseLevels, levels, layers);
+        break;
+    case Method::Compute:
+        compute(cmdBuffer, image, format, extent, baseLevels, levels, layers);
+        break;
+    default:
+        throw std::runtime_error("Mip levels can't be generated for this format");
+    }
+}
+
+void MipGenerator::blit(const vk::CommandBuffer& cmdBuffer, vk::Image image, const vk::Extent2D& extent, uint32_t baseLevels, uint32_t levels, uint32_t layers) {
+    for (uint32_t level = baseLevels; level < levels; ++level) {
+        levelBarrier(cmdBuffer, image, level - 1, 1, layers,
+            vk::ImageLayout::eTransferDstOptimal, vk::ImageLayout::eTransferSrcOptimal,
+            vk::AccessFlagBits::eTransferWrite, vk::AccessFlagBits::eTransferRead,
+            vk::PipelineStageFlagBits::eTransfer, vk::PipelineStageFlagBits::eTransfer);
+
+        vk::ImageBlit region;
+        region.srcSubresource = { vk::ImageAspectFlagBits::eColor, level - 1, 0, layers };
+        region.srcOffsets[1] = vk::Offset3D{ (int32_t)levelSize(extent.width, level - 1), (int32_t)levelSize(extent.height, level - 1), 1 };
+        region.dstSubresource = { vk::ImageAspectFlagBits::eColor, level, 0, layers };
+        region.dstOffsets[1] = vk::Offset3D{ (int32_t)levelSize(extent.width, level), (int32_t)levelSize(extent.height, level), 1 };
+        cmdBuffer.blitImage(image, vk::ImageLayout::eTransferSrcOptimal, image, vk::ImageLayout::eTransferDstOptimal, region, vk::Filter::eLinear);
+    }
+
+    // Stored levels still in transfer dst, blit sources and the last level
+    const vk::PipelineStageFlags dstStages = vk::PipelineStageFlagBits::eAllCommands;
+    levelBarrier(cmdBuffer, image, 0, baseLevels - 1, layers,
+        vk::ImageLayout::eTransferDstOptimal, vk::ImageLayout::eShaderReadOnlyOptimal,
+        vk::AccessFlagBits::eTransferWrite, vk::AccessFlagBits::eShaderRead,
+        vk::PipelineStageFlagBits::eTransfer, dstStages);
+    levelBarrier(cmdBuffer, image, baseLevels - 1, levels - baseLevels, layers,
+        vk::ImageLayout::eTransferSrcOptimal, vk::ImageLayout::eShaderReadOnlyOptimal,
+        vk::AccessFlagBits::eTransferRead, vk::AccessFlagBits::eShaderRead,
+        vk::PipelineStageFlagBits::eTransfer, dstStages);
+    levelBarrier(cmdBuffer, image, levels - 1, 1, layers,
+        vk::ImageLayout::eTransferDstOptimal, vk::ImageLayout::eShaderReadOnlyOptimal,
+        vk::AccessFlagBits::eTransferWrite, vk::AccessFlagBits::eShaderRead,
+        vk::PipelineStageFlagBits::eTransfer, dstStages);
+}
+
+vk::Pipeline MipGenerator::computePipeline(vk::Format format) {
+    StorageFormat storage;
+    storageFormat(format, storage);
+    auto it = pipelines.find(format);
+    if (it != pipelines.end()) {
+        return it->second;
+    }
+
+    if (!descriptorSetLayout) {
+        std::vector<vk::DescriptorSetLayoutBinding> bindings{
+            descriptorSetLayoutBinding(vk::DescriptorType::eCombinedImageSampler, vk::ShaderStageFlagBits::eCompute, 0),
+            descriptorSetLayoutBinding(vk::DescriptorType::eStorageImage, vk::ShaderStageFlagBits::eCompute, 1),
+        };
+        descriptorSetLayout = context.device.createDescriptorSetLayout(descriptorSetLayoutCreateInfo(bindings.data(), (uint32_t)bindings.size()));
+        vk::PushConstantRange pushConstant = pushConstantRange(vk::ShaderStageFlagBits::eCompute, sizeof(PushConstants), 0);
+        vk::PipelineLayoutCreateInfo layoutInfo = pipelineLayoutCreateInfo(&descriptorSetLayout, 1);
+        layoutInfo.pushConstantRangeCount = 1;
+        layoutInfo.pPushConstantRanges = &pushConstant;
+        pipelineLayout = context.device.createPipelineLayout(layoutInfo);
+
+        // Texels are fetched, the sampler only has to be valid
+        vk::SamplerCreateInfo samplerInfo;
+        samplerInfo.magFilter = vk::Filter::eNearest;
+        samplerInfo.minFilter = vk::Filter::eNearest;
+        samplerInfo.addressModeU = vk::SamplerAddressMode::eClampToEdge;
+        samplerInfo.addressModeV = samplerInfo.addressModeU;
+        samplerInfo.addressModeW = samplerInfo.addressModeU;
+        sampler = context.device.createSampler(samplerInfo);
+    }
+
+    std::string preamble = std::string("#define STORAGE_FORMAT ") + storage.qualifier + "\n";
+    if (storage.srgb) {
+        preamble += "#define SRGB\n";
+    }
+    shader::initGlsl();
+    vk::ShaderModule shaderModule = shader::glslToShaderModule(context.device, vk::ShaderStageFlagBits::eCompute, readTextFile(shaderPath), preamble);
+    shader::finalizeGlsl();
+
+    vk::ComputePipelineCreateInfo pipelineInfo = computePipelineCreateInfo(pipelineLayout);
+    pipelineInfo.stage.stage = vk::ShaderStageFlagBits::eCompute;
+    pipelineInfo.stage.module = shaderModule;
+    pipelineInfo.stage.pName = "main";
+    vk::Pipeline pipeline = context.device.createComputePipelines(context.pipelineCache, pipelineInfo, nullptr)[0];
+    context.device.destroyShaderModule(shaderModule);
+    pipelines[format] = pipeline;
+    return pipeline;
+}
+
+void MipGenerator::compute(const vk::CommandBuffer& cmdBuffer, vk::Image image, vk::Format format, const vk::Extent2D& extent, uint32_t baseLevels, uint32_t levels, uint32_t layers) {
+    StorageFormat storage;
+    storageFormat(format, storage);
+    vk::Pipeline pipeline = computePipeline(format);
+    uint32_t count = levels - baseLevels;
+
+    std::vector<vk::DescriptorPoolSize> poolSizes{
+        descriptorPoolSize(vk::DescriptorType::eCombinedImageSampler, count),
+        descriptorPoolSize(vk::DescriptorType::eStorageImage, count),
+    };
+    vk::DescriptorPool descriptorPool = context.device.createDescriptorPool(descriptorPoolCreateInfo((uint32_t)poolSizes.size(), poolSizes.data(), count));
+    transientPools.push_back(descriptorPool);
+    std::vector<vk::DescriptorSetLayout> setLayouts(count, descriptorSetLayout);
+    std::vector<vk::DescriptorSet> descriptorSets = context.device.allocateDescriptorSets(descriptorSetAllocateInfo(descriptorPool, setLayouts.data(), count));
+
+    for (uint32_t i = 0; i < count; ++i) {
+        uint32_t level = baseLevels + i;
+        vk::ImageViewCreateInfo viewInfo;
+        viewInfo.image = image;
+        viewInfo.viewType = vk::ImageViewType::e2DArray;
+        viewInfo.format = format;
+        viewInfo.subresourceRange = { vk::ImageAspectFlagBits::eColor, level - 1, 1, 0, layers };
+        vk::ImageView srcView = context.device.createImageView(viewInfo);
+        viewInfo.format = storage.format;
+        viewInfo.subresourceRange.baseMipLevel = level;
+        vk::ImageView dstView = context.device.createImageView(viewInfo);
+        transientViews.push_back(srcView);
+        transientViews.push_back(dstView);
+
+        vk::DescriptorImageInfo srcInfo = descriptorImageInfo(sampler, srcView, vk::ImageLayout::eShaderReadOnlyOptimal);
+        vk::DescriptorImageInfo dstInfo = descriptorImageInfo(vk::Sampler(), dstView, vk::ImageLayout::eGeneral);
+        std::vector<vk::WriteDescriptorSet> writes{
+            writeDescriptorSet(descriptorSets[i], vk::DescriptorType::eCombinedImageSampler, 0, &srcInfo),
+            writeDescriptorSet(descriptorSets[i], vk::DescriptorType::eStorageImage, 1, &dstInfo),
+        };
+        context.device.updateDescriptorSets((uint32_t)writes.size(), writes.data(), 0, nullptr);
+    }
+
+    // Generated levels are written in the general layout
+    levelBarrier(cmdBuffer, image, baseLevels, count, layers,
+        vk::ImageLayout::eTransferDstOptimal, vk::ImageLayout::eGeneral,
+        vk::AccessFlags(), vk::AccessFlagBits::eShaderWrite,
+        vk::PipelineStageFlagBits::eTopOfPipe, vk::PipelineStageFlagBits::eComputeShader);
+
+    cmdBuffer.bindPipeline(vk::PipelineBindPoint::eCompute, pipeline);
+    for (uint32_t i = 0; i < count; ++i) {
+        uint32_t level = baseLevels + i;
+        if (level == baseLevels) {
+            levelBarrier(cmdBuffer, image, level - 1, 1, layers,
+                vk::ImageLayout::eTransferDstOptimal, vk::ImageLayout::eShaderReadOnlyOptimal,
+                vk::AccessFlagBits::eTransferWrite, vk::AccessFlagBits::eShaderRead,
+                vk::PipelineStageFlagBits::eTransfer, vk::PipelineStageFlagBits::eComputeShader);
+        } else {
+            levelBarrier(cmdBuffer, image, level - 1, 1, layers,
+                vk::ImageLayout::eGeneral, vk::ImageLayout::eShaderReadOnlyOptimal,
+                vk::AccessFlagBits::eShaderWrite, vk::AccessFlagBits::eShaderRead,
+                vk::PipelineStageFlagBits::eComputeShader, vk::PipelineStageFlagBits::eComputeShader);
+        }
+
+        PushConstants pushConstants;
+        pushConstants.srcSize[0] = (int32_t)levelSize(extent.width, level - 1);
+        pushConstants.srcSize[1] = (int32_t)levelSize(extent.height, level - 1);
+        pushConstants.dstSize[0] = (int32_t)levelSize(extent.width, level);
+        pushConstants.dstSize[1] = (int32_t)levelSize(extent.height, level);
+        cmdBuffer.pushConstants(pipelineLayout, vk::ShaderStageFlagBits::eCompute, 0, sizeof(PushConstants), &pushConstants);
+        cmdBuffer.bindDescriptorSets(vk::PipelineBindPoint::eCompute, pipelineLayout, 0, descriptorSets[i], nullptr);
+        cmdBuffer.dispatch((pushConstants.dstSize[0] + GROUP_SIZE - 1) / GROUP_SIZE, (pushConstants.dstSize[1] + GROUP_SIZE - 1) / GROUP_SIZE, layers);
+    }
+
+    const vk::PipelineStageFlags dstStages = vk::PipelineStageFlagBits::eAllCommands;
+    levelBarrier(cmdBuffer, image, 0, baseLevels - 1, layers,
+        vk::ImageLayout::eTransferDstOptimal, vk::ImageLayout::eShaderReadOnlyOptimal,
+        vk::AccessFlagBits::eTransferWrite, vk::AccessFlagBits::eShaderRead,
+        vk::PipelineStageFlagBits::eTransfer, dstStages);
+    levelBarrier(cmdBuffer, image, levels - 1, 1, layers,
+        vk::ImageLayout::eGeneral, vk::ImageLayout::eShaderReadOnlyOptimal,
+        vk::AccessFlagBits::eShaderWrite, vk::AccessFlagBits::eShaderRead,
+        vk::PipelineStageFlagBits::eComputeShader, dstStages);
+}
+
+void MipGenerator::releaseTransient() {
+    for (auto& view : transientViews) {
+        context.device.destroyImageView(view);
+    }
+    for (auto& pool : transientPools) {
+        context.device.destroyDescriptorPool(pool);
+    }
+    transientViews.clear();
+    transientPools.clear();
+}
+
+void MipGenerator::destroy() {
+    releaseTransient();
+    for (auto& pipeline : pipelines) {
+        context.device.destroyPipeline(pipeline.second);
+    }
+    pipelines.clear();
+    if (pipelineLayout) {
+        context.device.destroyPipelineLayout(pipelineLayout);
+        pipelineLayout = vk::PipelineLayout();
+    }
+    if (descriptorSetLayout) {
+        context.device.destroyDescriptorSetLayout(descriptorSetLayout);
+        descriptorSetLayout = vk::DescriptorSetLayout();
+    }
+    if (sampler) {
+        context.device.destroySampler(sampler);
+        sampler = vk::Sampler();
+    }
+}
+
+namespace mipmap {
+    namespace {
+        struct Tap {
+            uint32_t index;
+            float weight;
+        };
+
+        // One RGBA pixel (4 floats) per SSE register
+        inline void filterPixel(float* dst, const float* src, size_t stride, const Tap* taps, size_t tapCount) {
+#if defined(MIPMAP_SSE)
+            __m128 sum = _mm_setzero_ps();
+            for (size_t i = 0; i < tapCount; ++i) {
+                sum = _mm_add_ps(sum, _mm_mul_ps(_mm_loadu_ps(src + taps[i].index * stride), _mm_set1_ps(taps[i].weight)));
+            }
+            _mm_storeu_ps(dst, sum);
+#else
+            float sum[4] = { 0, 0, 0, 0 };
+            for (size_t i = 0; i < tapCount; ++i) {
+                const float* pixel = src + taps[i].index * stride;
+                for (int c = 0; c < 4; ++c) {
+                    sum[c] += pixel[c] * taps[i].weight;
+                }
+            }
+            std::copy(sum, sum + 4, dst);
+#endif
+        }
+
+        float besselI0(float x) {
+            float sum = 1.0f, term = 1.0f;
+            for (int k = 1; k < 20; ++k) {
+                term *= (x * 0.5f / k) * (x * 0.5f / k);
+                sum += term;
+            }
+            return sum;
+        }
+
+        // Taps of every destination pixel along one axis, all destination pixels have the same tap count
+        std::vector<Tap> computeTaps(uint32_t srcSize, uint32_t dstSize, Filter filter, size_t& tapCount) {
+            const float scale = (float)srcSize / (float)dstSize;
+            // Support in destination pixels
+            const float radius = filter == Filter::Box ? 0.5f : 3.0f;
+            const float alpha = 4.0f;
+            tapCount = (size_t)std::ceil(radius * scale * 2.0f);
+            std::vector<Tap> taps(dstSize * tapCount);
+            for (uint32_t i = 0; i < dstSize; ++i) {
+                float center = (i + 0.5f) * scale;
+                int32_t first = (int32_t)std::floor(center - radius * scale + 0.5f);
+                float total = 0.0f;
+                for (size_t t = 0; t < tapCount; ++t) {
+                    int32_t src = first + (int32_t)t;
+                    float x = (src + 0.5f - center) / scale;
+                    float weight;
+                    if (filter == Filter::Box) {
+                        weight = std::abs(x) <= radius ? 1.0f : 0.0f;
+                    } else {
+                        float sinc = x == 0.0f ? 1.0f : std::sin((float)M_PI * x) / ((float)M_PI * x);
+                        float r = x / radius;
+                        weight = r * r < 1.0f ? sinc * besselI0(alpha * std::sqrt(1.0f - r * r)) / besselI0(alpha) : 0.0f;
+                    }
+                    Tap& tap = taps[i * tapCount + t];
+                    tap.index = (uint32_t)std::min(std::max(src, 0), (int32_t)srcSize - 1);
+                    tap.weight = weight;
+                    total += weight;
+                }
+                for (size_t t = 0; t < tapCount; ++t) {
+                    taps[i * tapCount + t].weight /= total;
+                }
+            }
+            return taps;
+        }
+
+        // Separable downsample of an RGBA float image
+        std::vector<float> downsample(const std::vector<float>& src, uint32_t width, uint32_t height, uint32_t dstWidth, uint32_t dstHeight, Filter filter) {
+            size_t tapCountX, tapCountY;
+            std::vector<Tap> tapsX = computeTaps(width, dstWidth, filter, tapCountX);
+            std::vector<Tap> tapsY = computeTaps(height, dstHeight, filter, tapCountY);
+
+            std::vector<float> horizontal(dstWidth * height * 4);
+            for (uint32_t y = 0; y < height; ++y) {
+                for (uint32_t x = 0; x < dstWidth; ++x) {
+                    filterPixel(&horizontal[(y * dstWidth + x) * 4], &src[y * width * 4], 4, &tapsX[x * tapCountX], tapCountX);
+                }
+            }
+            std::vector<float> result(dstWidth * dstHeight * 4);
+            for (uint32_t y = 0; y < dstHeight; ++y) {
+                for (uint32_t x = 0; x < dstWidth; ++x) {
+                    filterPixel(&result[(y * dstWidth + x) * 4], &horizontal[x * 4], dstWidth * 4, &tapsY[y * tapCountY], tapCountY);
+                }
+            }
+            return result;
+        }
+
+        float srgbToLinear(float value) {
+            return value <= 0.04045f ? value / 12.92f : std::pow((value + 0.055f) / 1.055f, 2.4f);
+        }
+
+        float linearToSrgb(float value) {
+            return value <= 0.0031308f ? value * 12.92f : 1.055f * std::pow(value, 1.0f / 2.4f) - 0.055f;
+        }
+    }
+
+    std::vector<uint8_t> generateRGBA8(const uint8_t* data, uint32_t width, uint32_t height, bool srgb, Filter filter) {
+        static const uint32_t ENCODE_TABLE_SIZE = 4096;
+        float decodeTable[256];
+        for (uint32_t i = 0; i < 256; ++i) {
+            decodeTable[i] = srgb ? srgbToLinear(i / 255.0f) : i / 255.0f;
+        }
+        std::vector<uint8_t> encodeTable(ENCODE_TABLE_SIZE);
+        for (uint32_t i = 0; i < ENCODE_TABLE_SIZE; ++i) {
+            float value = i / (float)(ENCODE_TABLE_SIZE - 1);
+            encodeTable[i] = (uint8_t)((srgb ? linearToSrgb(value) : value) * 255.0f + 0.5f);
+        }
+
+        uint32_t levels = mipLevelCount(width, height);
+        size_t totalSize = 0;
+        for (uint32_t level = 0; level < levels; ++level) {
+            totalSize += levelSize(width, level) * levelSize(height, level) * 4;
+        }
+        std::vector<uint8_t> result(totalSize);
+        std::copy(data, data + width * height * 4, result.begin());
+
+        // Alpha is always linear
+        std::vector<float> current(width * height * 4);
+        for (size_t i = 0; i < current.size(); ++i) {
+            current[i] = (i & 3) == 3 ? data[i] / 255.0f : decodeTable[data[i]];
+        }
+
+        size_t offset = width * height * 4;
+        for (uint32_t level = 1; level < levels; ++level) {
+            uint32_t srcWidth = levelSize(width, level - 1), srcHeight = levelSize(height, level - 1);
+            uint32_t dstWidth = levelSize(width, level), dstHeight = levelSize(height, level);
+            current = downsample(current, srcWidth, srcHeight, dstWidth, dstHeight, filter);
+            for (size_t i = 0; i < current.size(); ++i) {
+                float value = std::min(std::max(current[i], 0.0f), 1.0f);
+                result[offset + i] = (i & 3) == 3 ? (uint8_t)(value * 255.0f + 0.5f) : encodeTable[(uint32_t)(value * (ENCODE_TABLE_SIZE - 1) + 0.5f)];
+            }
+            offset += current.size();
+        }
+        return result;
+    }
+}
+
+}
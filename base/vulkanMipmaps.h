@@ -0,0 +1,82 @@
+/*
+* Mip chain generation
+*
+* This code is licensed under the MIT license (MIT) (http://opensource.org/licenses/MIT)
+*/
+
+#pragma once
+
+#include <stdint.h>
+#include <map>
+#include <string>
+#include <vector>
+
+#include <vulkan/vk_cpp.hpp>
+
+namespace vkx {
+    class Context;
+
+    // Number of levels of a complete mip chain
+    uint32_t mipLevelCount(uint32_t width, uint32_t height);
+
+    // Fills the missing levels of an image's mip chain on the GPU, each level is downsampled
+    // from the previous one:
+    //
+    // - Blit: vkCmdBlitImage with linear filtering, for formats supporting linear blits
+    // - Compute: a 2x2 box filter compute shader writing the level through a storage image
+    //   view, for uncompressed formats without linear blit support
+    //
+    // Both filter sRGB formats in linear space.  Compressed formats can't be written on the
+    // GPU, their chains have to be stored in the file (see mipmap::generateRGBA8 for baking).
+    class MipGenerator {
+    public:
+        enum class Method { None, Blit, Compute };
+
+        // GLSL source of the compute downsampler (shaders/base/mipgen.comp), the compute
+        // method is not available without it
+        std::string shaderPath;
+
+        MipGenerator(const Context& context) : context(context) {}
+        ~MipGenerator() { destroy(); }
+
+        Method method(vk::Format format) const;
+        // Usage and create flags the image needs for the method, in addition to transfer dst
+        vk::ImageUsageFlags imageUsage(Method method) const;
+        vk::ImageCreateFlags imageFlags(Method method, vk::Format format) const;
+
+        // Generates the levels [baseLevels, levels) of all layers from level baseLevels - 1.  All
+        // levels have to be in the transfer dst layout and are left in the shader read only layout.
+        void generate(const vk::CommandBuffer& cmdBuffer, vk::Image image, vk::Format format, const vk::Extent2D& extent, uint32_t baseLevels, uint32_t levels, uint32_t layers = 1);
+        // Destroys the views and descriptors used by the recorded generate() calls, the command
+        // buffers have to have completed execution
+        void releaseTransient();
+        void destroy();
+
+    private:
+        void blit(const vk::CommandBuffer& cmdBuffer, vk::Image image, const vk::Extent2D& extent, uint32_t baseLevels, uint32_t levels, uint32_t layers);
+        void compute(const vk::CommandBuffer& cmdBuffer, vk::Image image, vk::Format format, const vk::Extent2D& extent, uint32_t baseLevels, uint32_t levels, uint32_t layers);
+        vk::Pipeline computePipeline(vk::Format format);
+
+        const Context& context;
+        vk::DescriptorSetLayout descriptorSetLayout;
+        vk::PipelineLayout pipelineLayout;
+        vk::Sampler sampler;
+        std::map<vk::Format, vk::Pipeline> pipelines;
+        std::vector<vk::ImageView> transientViews;
+        std::vector<vk::DescriptorPool> transientPools;
+    };
+
+    namespace mipmap {
+        enum class Filter {
+            // 2x2 average, matches the GPU methods
+            Box,
+            // Kaiser windowed sinc, sharper, for offline baking
+            Kaiser
+        };
+
+        // CPU fallback for devices without GPU generation and for offline baking: returns all
+        // levels of an 8 bit RGBA image, tightly packed starting with a copy of level 0.
+        // sRGB images are filtered in linear space.
+        std::vector<uint8_t> generateRGBA8(const uint8_t* data, uint32_t width, uint32_t height, bool srgb, Filter filter = Filter::Box);
+    }
+}
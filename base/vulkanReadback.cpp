@@ -0,0 +1,215 @@
+/*
+* Asynchronous device to host readback
+*
+* This code is licensed under the MIT license (MIT) (http://opensource.org/licenses/MIT)
+*/
+
+#include "vulkanReadback.h"
+
+#include <string.h>
+#include <stdexcept>
+
+using namespace vkx;
+
+namespace {
+    // Forwards a callback request to a promise, a dropped request resolves with empty data
+    template <typename F>
+    std::future<ReadbackData> toFuture(F request) {
+        auto promise = std::make_shared<std::promise<ReadbackData>>();
+        std::future<ReadbackData> future = promise->get_future();
+        if (!request([promise](ReadbackData& data) { promise->set_value(std::move(data)); })) {
+            promise->set_value(ReadbackData());
+        }
+        return future;
+    }
+
+    // Makes the transfer writes of the staging buffer visible to host reads
+    void stagingBarrier(const vk::CommandBuffer& cmdBuffer, vk::Buffer buffer, vk::DeviceSize size) {
+        vk::BufferMemoryBarrier barrier;
+        barrier.srcAccessMask = vk::AccessFlagBits::eTransferWrite;
+        barrier.dstAccessMask = vk::AccessFlagBits::eHostRead;
+        barrier.buffer = buffer;
+        barrier.size = size;
+        cmdBuffer.pipelineBarrier(vk::PipelineStageFlagBits::eTransfer, vk::PipelineStageFlagBits::eHost, vk::DependencyFlags(), nullptr, barrier, nullptr);
+    }
+}
+
+uint32_t Readback::texelSize(vk::Format format) {
+    switch (format) {
+    case vk::Format::eR8Unorm:
+        return 1;
+    case vk::Format::eR8G8B8A8Unorm:
+    case vk::Format::eR8G8B8A8Srgb:
+    case vk::Format::eB8G8R8A8Unorm:
+    case vk::Format::eB8G8R8A8Srgb:
+    case vk::Format::eA2B10G10R10UnormPack32:
+    case vk::Format::eR16G16Sfloat:
+    case vk::Format::eR32Sfloat:
+    case vk::Format::eR32Uint:
+        return 4;
+    case vk::Format::eR16G16B16A16Sfloat:
+    case vk::Format::eR32G32Sfloat:
+        return 8;
+    case vk::Format::eR32G32B32A32Sfloat:
+        return 16;
+    default:
+        return 0;
+    }
+}
+
+std::future<ReadbackData> Readback::readImage(const vk::CommandBuffer& cmdBuffer, vk::Image image, vk::Format format, const vk::Extent2D& extent,
+    vk::ImageLayout oldLayout, vk::ImageLayout newLayout) {
+    return toFuture([&](const Callback& callback) {
+        return readImage(cmdBuffer, image, format, extent, oldLayout, newLayout, callback);
+    });
+}
+
+bool Readback::readImage(const vk::CommandBuffer& cmdBuffer, vk::Image image, vk::Format format, const vk::Extent2D& extent,
+    vk::ImageLayout oldLayout, vk::ImageLayout newLayout, const Callback& callback) {
+    uint32_t texel = texelSize(format);
+    if (texel == 0) {
+        throw std::runtime_error("Unsupported readback format " + vk::to_string(format));
+    }
+    vk::DeviceSize size = (vk::DeviceSize)extent.width * extent.height * texel;
+
+    vk::ImageMemoryBarrier barrier;
+    barrier.srcAccessMask = vk::AccessFlagBits::eMemoryWrite;
+    barrier.oldLayout = oldLayout;
+    barrier.image = image;
+    barrier.subresourceRange = { vk::ImageAspectFlagBits::eColor, 0, 1, 0, 1 };
+
+    Slot* slot = acquire(size);
+    if (!slot) {
+        // The caller relies on the image ending up in newLayout
+        barrier.dstAccessMask = vk::AccessFlagBits::eMemoryRead;
+        barrier.newLayout = newLayout;
+        cmdBuffer.pipelineBarrier(vk::PipelineStageFlagBits::eAllCommands, vk::PipelineStageFlagBits::eAllCommands, vk::DependencyFlags(), nullptr, nullptr, barrier);
+        ++dropped;
+        return false;
+    }
+
+    barrier.dstAccessMask = vk::AccessFlagBits::eTransferRead;
+    barrier.newLayout = vk::ImageLayout::eTransferSrcOptimal;
+    cmdBuffer.pipelineBarrier(vk::PipelineStageFlagBits::eAllCommands, vk::PipelineStageFlagBits::eTransfer, vk::DependencyFlags(), nullptr, nullptr, barrier);
+
+    vk::BufferImageCopy region;
+    region.imageSubresource = { vk::ImageAspectFlagBits::eColor, 0, 0, 1 };
+    region.imageExtent = vk::Extent3D{ extent.width, extent.height, 1 };
+    cmdBuffer.copyImageToBuffer(image, vk::ImageLayout::eTransferSrcOptimal, slot->buffer.buffer, region);
+
+    barrier.srcAccessMask = vk::AccessFlagBits::eTransferRead;
+    barrier.dstAccessMask = vk::AccessFlagBits::eMemoryRead;
+    barrier.oldLayout = vk::ImageLayout::eTransferSrcOptimal;
+    barrier.newLayout = newLayout;
+    cmdBuffer.pipelineBarrier(vk::PipelineStageFlagBits::eTransfer, vk::PipelineStageFlagBits::eAllCommands, vk::DependencyFlags(), nullptr, nullptr, barrier);
+    stagingBarrier(cmdBuffer, slot->buffer.buffer, size);
+
+    slot->result.width = extent.width;
+    slot->result.height = extent.height;
+    slot->result.format = format;
+    slot->callback = callback;
+    return true;
+}
+
+std::future<ReadbackData> Readback::readBuffer(const vk::CommandBuffer& cmdBuffer, vk::Buffer buffer, vk::DeviceSize offset, vk::DeviceSize size) {
+    return toFuture([&](const Callback& callback) {
+        return readBuffer(cmdBuffer, buffer, offset, size, callback);
+    });
+}
+
+bool Readback::readBuffer(const vk::CommandBuffer& cmdBuffer, vk::Buffer buffer, vk::DeviceSize offset, vk::DeviceSize size, const Callback& callback) {
+    Slot* slot = acquire(size);
+    if (!slot) {
+        ++dropped;
+        return false;
+    }
+
+    vk::MemoryBarrier barrier;
+    barrier.srcAccessMask = vk::AccessFlagBits::eMemoryWrite;
+    barrier.dstAccessMask = vk::AccessFlagBits::eTransferRead;
+    cmdBuffer.pipelineBarrier(vk::PipelineStageFlagBits::eAllCommands, vk::PipelineStageFlagBits::eTransfer, vk::DependencyFlags(), barrier, nullptr, nullptr);
+
+    vk::BufferCopy region;
+    region.srcOffset = offset;
+    region.size = size;
+    cmdBuffer.copyBuffer(buffer, slot->buffer.buffer, region);
+    stagingBarrier(cmdBuffer, slot->buffer.buffer, size);
+
+    slot->result.width = (uint32_t)size;
+    slot->result.height = 1;
+    slot->result.format = vk::Format::eUndefined;
+    slot->callback = callback;
+    return true;
+}
+
+Readback::Slot* Readback::acquire(vk::DeviceSize size) {
+    Slot* result = nullptr;
+    {
+        std::lock_guard<std::mutex> lock(slotMutex);
+        // Prefer a free slot that is large enough, then any free one
+        for (auto& slot : slots) {
+            if (slot->state != SlotState::Free) {
+                continue;
+            }
+            if (slot->buffer.size >= size) {
+                result = slot.get();
+                break;
+            }
+            if (!result) {
+                result = slot.get();
+            }
+        }
+        if (!result && slots.size() < maxSlots) {
+            slots.push_back(std::make_unique<Slot>());
+            result = slots.back().get();
+        }
+        if (!result) {
+            return nullptr;
+        }
+        result->state = SlotState::Recorded;
+    }
+
+    // Free slots aren't used by the device or the worker anymore
+    if (result->buffer.size < size) {
+        result->buffer.destroy();
+        result->buffer = context.createReadbackBuffer(size);
+    }
+    result->size = size;
+    result->result.frame = frame;
+    return result;
+}
+
+void Readback::collect(uint64_t completedFrame) {
+    std::lock_guard<std::mutex> lock(slotMutex);
+    for (auto& entry : slots) {
+        Slot* slot = entry.get();
+        if (slot->state != SlotState::Recorded || slot->result.frame > completedFrame) {
+            continue;
+        }
+        slot->state = SlotState::Reading;
+        worker.addJob([this, slot] {
+            slot->buffer.invalidate(0, slot->size);
+            const uint8_t* mapped = (const uint8_t*)slot->buffer.mapped;
+            slot->result.data.assign(mapped, mapped + slot->size);
+            Callback callback;
+            std::swap(callback, slot->callback);
+            callback(slot->result);
+            slot->result.data = std::vector<uint8_t>();
+            std::lock_guard<std::mutex> lock(slotMutex);
+            slot->state = SlotState::Free;
+        });
+    }
+}
+
+void Readback::flush() {
+    collect(UINT64_MAX);
+    worker.wait();
+}
+
+void Readback::destroy() {
+    flush();
+    for (auto& slot : slots) {
+        slot->buffer.destroy();
+    }
+    slots.clear();
+}
@@ -0,0 +1,110 @@
+/*
+* Asynchronous device to host readback
+*
+* This code is licensed under the MIT license (MIT) (http://opensource.org/licenses/MIT)
+*/
+
+#pragma once
+
+#include <stdint.h>
+#include <functional>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+#include "vulkanContext.hpp"
+#include "threadPool.hpp"
+
+namespace vkx {
+
+    // Result of a readback
+    struct ReadbackData {
+        // Tightly packed texels of the image or bytes of the buffer range, empty if the request
+        // was dropped
+        std::vector<uint8_t> data;
+        // Image size, width is the byte count and height 1 for buffers
+        uint32_t width{ 0 };
+        uint32_t height{ 0 };
+        vk::Format format{ vk::Format::eUndefined };
+        // Frame the copy was recorded in
+        uint64_t frame{ 0 };
+    };
+
+    // Copies images and buffers into host cached staging buffers without stalling the frame loop.
+    //
+    // The copy is recorded into a command buffer of the current frame, into the next free slot of
+    // a small ring of staging buffers.  Once the owner has seen the frame's fence signal, collect()
+    // hands the slot to a worker thread that invalidates the memory, copies the data out and
+    // resolves the future or calls the callback, then frees the slot.  Frame numbering follows the
+    // DeletionQueue: endFrame() after the frame was submitted, collect() after its fence signaled.
+    //
+    // Requests never wait: if all slots are busy the request is dropped, the future resolves right
+    // away with empty data and the callback form returns false.
+    class Readback {
+    public:
+        // Called on the worker thread, the data may be moved out
+        using Callback = std::function<void(ReadbackData&)>;
+
+        // Number of staging buffers, two per frame in flight keep a capture of every frame going
+        uint32_t maxSlots{ 4 };
+
+        Readback(const Context& context) : context(context) {}
+        ~Readback() { destroy(); }
+
+        // Records the copy of mip level 0 of a color image.  The image is transitioned from
+        // oldLayout to transfer source and to newLayout after the copy, writes of any earlier
+        // stage are made visible to the copy.
+        std::future<ReadbackData> readImage(const vk::CommandBuffer& cmdBuffer, vk::Image image, vk::Format format, const vk::Extent2D& extent,
+            vk::ImageLayout oldLayout, vk::ImageLayout newLayout);
+        bool readImage(const vk::CommandBuffer& cmdBuffer, vk::Image image, vk::Format format, const vk::Extent2D& extent,
+            vk::ImageLayout oldLayout, vk::ImageLayout newLayout, const Callback& callback);
+
+        // Records the copy of a buffer range, the buffer needs transfer source usage
+        std::future<ReadbackData> readBuffer(const vk::CommandBuffer& cmdBuffer, vk::Buffer buffer, vk::DeviceSize offset, vk::DeviceSize size);
+        bool readBuffer(const vk::CommandBuffer& cmdBuffer, vk::Buffer buffer, vk::DeviceSize offset, vk::DeviceSize size, const Callback& callback);
+
+        // Ends the frame being recorded and returns its index
+        uint64_t endFrame() { return frame++; }
+        // Hands the copies recorded in the frames up to and including completedFrame to the worker
+        void collect(uint64_t completedFrame);
+        // Completes all requests, the device has to be idle
+        void flush();
+        // Flushes and frees the staging buffers
+        void destroy();
+
+        uint32_t droppedCount() const { return dropped; }
+        // Bytes per texel of the formats readImage supports, 0 for others
+        static uint32_t texelSize(vk::Format format);
+
+    private:
+        enum class SlotState {
+            Free,
+            // Copy recorded, waiting for the frame's fence
+            Recorded,
+            // Being read on the worker thread
+            Reading,
+        };
+
+        struct Slot {
+            CreateBufferResult buffer;
+            // Bytes copied by the current request, the buffer may be larger
+            vk::DeviceSize size{ 0 };
+            SlotState state{ SlotState::Free };
+            ReadbackData result;
+            Callback callback;
+        };
+
+        // Free slot with room for size bytes, nullptr if all are busy
+        Slot* acquire(vk::DeviceSize size);
+
+        const Context& context;
+        uint64_t frame{ 0 };
+        uint32_t dropped{ 0 };
+        std::vector<std::unique_ptr<Slot>> slots;
+        // Guards the state of the slots, the worker frees them
+        std::mutex slotMutex;
+        // Declared last, joined before the slots its jobs use are destroyed
+        Thread worker;
+    };
+}
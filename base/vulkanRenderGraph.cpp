@@ -0,0 +1,562 @@
+/*
+* Render graph for offscreen passes
+*
+* This code is licensed under the MIT license (MIT) (http://opensource.org/licenses/MIT)
+*/
+
+#include "vulkanRenderGraph.h"
+
+#include <algorithm>
+#include <stdexcept>
+
+#include "vulkanContext.hpp"
+
+namespace vkx {
+
+namespace {
+    enum class Access {
+        Color,
+        Depth,
+        Sampled,
+    };
+
+    struct Use {
+        uint32_t pass;
+        Access access;
+        // Overrides the stages of the access, set for the read of outputs after the graph
+        vk::PipelineStageFlags stages;
+    };
+
+    vk::PipelineStageFlags stageMask(Access access) {
+        switch (access) {
+        case Access::Color:
+            return vk::PipelineStageFlagBits::eColorAttachmentOutput;
+        case Access::Depth:
+            return vk::PipelineStageFlagBits::eEarlyFragmentTests | vk::PipelineStageFlagBits::eLateFragmentTests;
+        default:
+            return vk::PipelineStageFlagBits::eFragmentShader;
+        }
+    }
+
+    vk::PipelineStageFlags stageMask(const Use& use) {
+        return use.stages ? use.stages : stageMask(use.access);
+    }
+
+    vk::AccessFlags accessMask(Access access) {
+        switch (access) {
+        case Access::Color:
+            return vk::AccessFlagBits::eColorAttachmentRead | vk::AccessFlagBits::eColorAttachmentWrite;
+        case Access::Depth:
+            return vk::AccessFlagBits::eDepthStencilAttachmentRead | vk::AccessFlagBits::eDepthStencilAttachmentWrite;
+        default:
+            return vk::AccessFlagBits::eShaderRead;
+        }
+    }
+
+    // Only writes have to be made available to later accesses, a preceding read just has to
+    // finish executing before its memory is overwritten
+    vk::AccessFlags writeAccessMask(Access access) {
+        switch (access) {
+        case Access::Color:
+            return vk::AccessFlagBits::eColorAttachmentWrite;
+        case Access::Depth:
+            return vk::AccessFlagBits::eDepthStencilAttachmentWrite;
+        default:
+            return vk::AccessFlags();
+        }
+    }
+
+    vk::ImageLayout attachmentLayout(Access access) {
+        return access == Access::Depth ? vk::ImageLayout::eDepthStencilAttachmentOptimal : vk::ImageLayout::eColorAttachmentOptimal;
+    }
+
+    bool isDepthFormat(vk::Format format) {
+        switch (format) {
+        case vk::Format::eD16Unorm:
+        case vk::Format::eX8D24UnormPack32:
+        case vk::Format::eD32Sfloat:
+        case vk::Format::eD16UnormS8Uint:
+        case vk::Format::eD24UnormS8Uint:
+        case vk::Format::eD32SfloatS8Uint:
+            return true;
+        default:
+            return false;
+        }
+    }
+
+    bool hasStencil(vk::Format format) {
+        return format == vk::Format::eD16UnormS8Uint || format == vk::Format::eD24UnormS8Uint || format == vk::Format::eD32SfloatS8Uint;
+    }
+}
+
+RenderGraph::Pass& RenderGraph::Pass::writeColor(Resource resource) {
+    Attachment attachment;
+    attachment.resource = resource;
+    colorAttachments.push_back(attachment);
+    return *this;
+}
+
+RenderGraph::Pass& RenderGraph::Pass::writeColor(Resource resource, const glm::vec4& clearColor) {
+    Attachment attachment;
+    attachment.resource = resource;
+    attachment.clear = true;
+    attachment.clearValue.color = vkx::clearColor(clearColor);
+    colorAttachments.push_back(attachment);
+    return *this;
+}
+
+RenderGraph::Pass& RenderGraph::Pass::writeDepth(Resource resource) {
+    depthAttachment.resource = resource;
+    depthAttachment.clear = true;
+    depthAttachment.clearValue.depthStencil = { 1.0f, 0 };
+    return *this;
+}
+
+RenderGraph::Pass& RenderGraph::Pass::read(Resource resource) {
+    sampled.push_back(resource);
+    return *this;
+}
+
+RenderGraph::Pass& RenderGraph::Pass::setRecord(const RecordFunction& record) {
+    this->record = record;
+    return *this;
+}
+
+vk::Extent2D RenderGraph::Pass::renderExtent() const {
+    vk::Extent2D result;
+    result.width = std::max(1u, (uint32_t)(extent.width * renderScale + 0.5f));
+    result.height = std::max(1u, (uint32_t)(extent.height * renderScale + 0.5f));
+    return result;
+}
+
+RenderGraph::Resource RenderGraph::createImage(const std::string& name, vk::Format format, const vk::Extent2D& extent, vk::Filter filter) {
+    Image image;
+    image.name = name;
+    image.format = format;
+    image.extent = extent;
+    image.filter = filter;
+    images.push_back(image);
+    return (Resource)(images.size() - 1);
+}
+
+void RenderGraph::markOutput(Resource resource, vk::PipelineStageFlags stages) {
+    images[resource].output = true;
+    images[resource].outputStages = stages;
+}
+
+void RenderGraph::setExtent(Resource resource, const vk::Extent2D& extent) {
+    images[resource].extent = extent;
+}
+
+RenderGraph::Pass& RenderGraph::addPass(const std::string& name) {
+    passes.push_back(std::make_unique<Pass>());
+    passes.back()->name = name;
+    return *passes.back();
+}
+
+void RenderGraph::compile() {
+    destroy();
+    const vk::Device& device = context.device;
+    const uint32_t passCount = (uint32_t)passes.size();
+
+    // Accesses of every image in execution order.  Outputs get an extra read after the last
+    // pass, standing in for whatever samples them after the graph.
+    std::vector<std::vector<Use>> uses(images.size());
+    for (uint32_t p = 0; p < passCount; ++p) {
+        const Pass& pass = *passes[p];
+        for (const auto& attachment : pass.colorAttachments) {
+            uses[attachment.resource].push_back({ p, Access::Color, vk::PipelineStageFlags() });
+        }
+        if (pass.depthAttachment.resource != INVALID_RESOURCE) {
+            uses[pass.depthAttachment.resource].push_back({ p, Access::Depth, vk::PipelineStageFlags() });
+        }
+        for (Resource resource : pass.sampled) {
+            if (!uses[resource].empty() && uses[resource].back().pass == p) {
+                throw std::runtime_error("Render graph pass \"" + pass.name + "\" samples its own attachment " + images[resource].name);
+            }
+            uses[resource].push_back({ p, Access::Sampled, vk::PipelineStageFlags() });
+        }
+    }
+
+    for (Resource r = 0; r < images.size(); ++r) {
+        Image& image = images[r];
+        if (image.output) {
+            uses[r].push_back({ passCount, Access::Sampled, image.outputStages });
+        }
+        if (uses[r].empty()) {
+            throw std::runtime_error("Render graph image " + image.name + " is never used");
+        }
+        if (uses[r].front().access == Access::Sampled) {
+            throw std::runtime_error("Render graph image " + image.name + " is sampled before it is written");
+        }
+        image.firstPass = uses[r].front().pass;
+        image.lastPass = uses[r].back().pass;
+        image.usage = vk::ImageUsageFlags();
+        for (const Use& use : uses[r]) {
+            switch (use.access) {
+            case Access::Color:
+                image.usage |= vk::ImageUsageFlagBits::eColorAttachment;
+                break;
+            case Access::Depth:
+                image.usage |= vk::ImageUsageFlagBits::eDepthStencilAttachment;
+                break;
+            case Access::Sampled:
+                image.usage |= vk::ImageUsageFlagBits::eSampled;
+                break;
+            }
+        }
+
+        vk::ImageCreateInfo imageCreateInfo;
+        imageCreateInfo.imageType = vk::ImageType::e2D;
+        imageCreateInfo.format = image.format;
+        imageCreateInfo.extent = vk::Extent3D{ image.extent.width, image.extent.height, 1 };
+        imageCreateInfo.mipLevels = 1;
+        imageCreateInfo.arrayLayers = 1;
+        imageCreateInfo.samples = vk::SampleCountFlagBits::e1;
+        imageCreateInfo.tiling = vk::ImageTiling::eOptimal;
+        imageCreateInfo.usage = image.usage;
+        image.image = device.createImage(imageCreateInfo);
+        image.memReqs = device.getImageMemoryRequirements(image.image);
+        memoryStats.required += image.memReqs.size;
+    }
+
+    // Memory aliasing.  Largest images first, each one goes into the first allocation whose
+    // images are all used strictly before or after it.  The contents of an aliased image are
+    // undefined when its lifetime starts, which is fine since the first access is a write.
+    struct Slot {
+        vk::DeviceSize size{ 0 };
+        uint32_t memoryTypeBits{ ~0U };
+        std::vector<Resource> images;
+    };
+    std::vector<Slot> slots;
+    std::vector<Resource> order(images.size());
+    for (Resource r = 0; r < images.size(); ++r) {
+        order[r] = r;
+    }
+    std::stable_sort(order.begin(), order.end(), [&](Resource a, Resource b) {
+        return images[a].memReqs.size > images[b].memReqs.size;
+    });
+    for (Resource r : order) {
+        Image& image = images[r];
+        uint32_t slotIndex = (uint32_t)slots.size();
+        for (uint32_t s = 0; enableAliasing && s < slots.size(); ++s) {
+            if ((slots[s].memoryTypeBits & image.memReqs.memoryTypeBits) == 0) {
+                continue;
+            }
+            bool disjoint = std::all_of(slots[s].images.begin(), slots[s].images.end(), [&](Resource other) {
+                return images[other].lastPass < image.firstPass || image.lastPass < images[other].firstPass;
+            });
+            if (disjoint) {
+                slotIndex = s;
+                break;
+            }
+        }
+        if (slotIndex == slots.size()) {
+            slots.emplace_back();
+        }
+        Slot& slot = slots[slotIndex];
+        // Offsets are always zero, so the alignment of every image is met
+        slot.size = std::max(slot.size, image.memReqs.size);
+        slot.memoryTypeBits &= image.memReqs.memoryTypeBits;
+        slot.images.push_back(r);
+        image.memorySlot = slotIndex;
+    }
+
+    memory.resize(slots.size());
+    for (uint32_t s = 0; s < slots.size(); ++s) {
+        vk::MemoryAllocateInfo memAlloc;
+        memAlloc.allocationSize = slots[s].size;
+        memAlloc.memoryTypeIndex = context.getMemoryType(slots[s].memoryTypeBits, vk::MemoryPropertyFlagBits::eDeviceLocal);
+        memory[s] = device.allocateMemory(memAlloc);
+        ResourceRegistry::get().add(memory[s], ResourceKind::Memory, ResourceCategory::RenderTarget, slots[s].size, "render graph slot " + std::to_string(s));
+        memoryStats.allocated += slots[s].size;
+        memoryStats.allocationCount++;
+    }
+
+    for (Image& image : images) {
+        device.bindImageMemory(image.image, memory[image.memorySlot], 0);
+
+        vk::ImageViewCreateInfo viewCreateInfo;
+        viewCreateInfo.viewType = vk::ImageViewType::e2D;
+        viewCreateInfo.format = image.format;
+        viewCreateInfo.subresourceRange.levelCount = 1;
+        viewCreateInfo.subresourceRange.layerCount = 1;
+        viewCreateInfo.image = image.image;
+        if (!isDepthFormat(image.format)) {
+            viewCreateInfo.subresourceRange.aspectMask = vk::ImageAspectFlagBits::eColor;
+        } else if (hasStencil(image.format) && !(image.usage & vk::ImageUsageFlagBits::eSampled)) {
+            viewCreateInfo.subresourceRange.aspectMask = vk::ImageAspectFlagBits::eDepth | vk::ImageAspectFlagBits::eStencil;
+        } else {
+            // Sampled views may only contain a single aspect
+            viewCreateInfo.subresourceRange.aspectMask = vk::ImageAspectFlagBits::eDepth;
+        }
+        image.view = device.createImageView(viewCreateInfo);
+
+        if (image.usage & vk::ImageUsageFlagBits::eSampled) {
+            vk::SamplerCreateInfo samplerCreateInfo;
+            samplerCreateInfo.magFilter = image.filter;
+            samplerCreateInfo.minFilter = image.filter;
+            samplerCreateInfo.mipmapMode = vk::SamplerMipmapMode::eNearest;
+            samplerCreateInfo.addressModeU = vk::SamplerAddressMode::eClampToEdge;
+            samplerCreateInfo.addressModeV = samplerCreateInfo.addressModeU;
+            samplerCreateInfo.addressModeW = samplerCreateInfo.addressModeU;
+            samplerCreateInfo.maxLod = 1.0f;
+            samplerCreateInfo.borderColor = vk::BorderColor::eFloatOpaqueWhite;
+            image.sampler = device.createSampler(samplerCreateInfo);
+        }
+
+        if (vkx::debug::marker::active) {
+            vkx::debug::marker::setImageName((VkDevice)device, (VkImage)image.image, image.name.c_str());
+        }
+    }
+
+    // Accesses of every allocation in execution order, used to find what a pass has to wait
+    // for.  An access with nothing before it in the frame waits for the last access of the
+    // previous frame.
+    std::vector<std::vector<Use>> slotUses(slots.size());
+    for (Resource r = 0; r < images.size(); ++r) {
+        auto& list = slotUses[images[r].memorySlot];
+        list.insert(list.end(), uses[r].begin(), uses[r].end());
+    }
+    for (auto& list : slotUses) {
+        std::stable_sort(list.begin(), list.end(), [](const Use& a, const Use& b) {
+            return a.pass < b.pass;
+        });
+    }
+    auto previousUse = [&](Resource r, uint32_t pass) -> const Use& {
+        const auto& list = slotUses[images[r].memorySlot];
+        auto it = std::lower_bound(list.begin(), list.end(), pass, [](const Use& use, uint32_t p) {
+            return use.pass < p;
+        });
+        return it == list.begin() ? list.back() : *(it - 1);
+    };
+
+    std::vector<uint32_t> nextUse(images.size(), 0);
+    std::vector<vk::ImageLayout> layouts(images.size(), vk::ImageLayout::eUndefined);
+    for (uint32_t p = 0; p < passCount; ++p) {
+        Pass& pass = *passes[p];
+
+        std::vector<vk::AttachmentDescription> attachments;
+        std::vector<vk::AttachmentReference> colorReferences;
+        vk::AttachmentReference depthReference;
+        std::vector<vk::ImageView> views;
+
+        vk::SubpassDependency waitDependency;
+        waitDependency.srcSubpass = VK_SUBPASS_EXTERNAL;
+        waitDependency.dstSubpass = 0;
+        vk::SubpassDependency signalDependency;
+        signalDependency.srcSubpass = 0;
+        signalDependency.dstSubpass = VK_SUBPASS_EXTERNAL;
+
+        pass.extent = vk::Extent2D();
+        auto addAttachment = [&](const Attachment& attachment, Access access) {
+            Resource r = attachment.resource;
+            Image& image = images[r];
+            const auto& imageUses = uses[r];
+            uint32_t useIndex = nextUse[r]++;
+            bool earlierWrite = useIndex > 0;
+            bool laterUse = useIndex + 1 < imageUses.size();
+            bool sampledNext = laterUse && imageUses[useIndex + 1].access == Access::Sampled;
+            const Use& next = imageUses[laterUse ? useIndex + 1 : useIndex];
+            bool load = !attachment.clear && earlierWrite;
+
+            if (pass.extent.width == 0) {
+                pass.extent = image.extent;
+            } else if (pass.extent.width != image.extent.width || pass.extent.height != image.extent.height) {
+                throw std::runtime_error("Render graph pass \"" + pass.name + "\" has attachments of different sizes");
+            }
+
+            vk::AttachmentDescription description;
+            description.format = image.format;
+            description.samples = vk::SampleCountFlagBits::e1;
+            description.loadOp = attachment.clear ? vk::AttachmentLoadOp::eClear : load ? vk::AttachmentLoadOp::eLoad : vk::AttachmentLoadOp::eDontCare;
+            // Nothing reads the attachment after this pass (e.g. a depth buffer), so it does
+            // not need to be written back to memory
+            description.storeOp = laterUse ? vk::AttachmentStoreOp::eStore : vk::AttachmentStoreOp::eDontCare;
+            description.stencilLoadOp = hasStencil(image.format) ? description.loadOp : vk::AttachmentLoadOp::eDontCare;
+            description.stencilStoreOp = hasStencil(image.format) ? description.storeOp : vk::AttachmentStoreOp::eDontCare;
+            description.initialLayout = load ? layouts[r] : vk::ImageLayout::eUndefined;
+            // Transition straight into the layout of the next access instead of a barrier
+            description.finalLayout = sampledNext ? vk::ImageLayout::eShaderReadOnlyOptimal : attachmentLayout(access);
+            layouts[r] = description.finalLayout;
+
+            const Use& previous = previousUse(r, p);
+            waitDependency.srcStageMask |= stageMask(previous);
+            waitDependency.srcAccessMask |= writeAccessMask(previous.access);
+            waitDependency.dstStageMask |= stageMask(access);
+            waitDependency.dstAccessMask |= accessMask(access);
+            if (sampledNext) {
+                signalDependency.srcStageMask |= stageMask(access);
+                signalDependency.srcAccessMask |= writeAccessMask(access);
+                signalDependency.dstStageMask |= stageMask(next);
+                signalDependency.dstAccessMask |= accessMask(Access::Sampled);
+            }
+
+            attachments.push_back(description);
+            views.push_back(image.view);
+            return vk::AttachmentReference((uint32_t)attachments.size() - 1, attachmentLayout(access));
+        };
+
+        for (const auto& attachment : pass.colorAttachments) {
+            colorReferences.push_back(addAttachment(attachment, Access::Color));
+        }
+        bool hasDepth = pass.depthAttachment.resource != INVALID_RESOURCE;
+        if (hasDepth) {
+            depthReference = addAttachment(pass.depthAttachment, Access::Depth);
+        }
+        if (attachments.empty()) {
+            throw std::runtime_error("Render graph pass \"" + pass.name + "\" has no attachments");
+        }
+        for (Resource r : pass.sampled) {
+            nextUse[r]++;
+            const Use& previous = previousUse(r, p);
+            waitDependency.srcStageMask |= stageMask(previous);
+            waitDependency.srcAccessMask |= writeAccessMask(previous.access);
+            waitDependency.dstStageMask |= stageMask(Access::Sampled);
+            waitDependency.dstAccessMask |= accessMask(Access::Sampled);
+        }
+
+        std::vector<vk::SubpassDependency> dependencies{ waitDependency };
+        if (signalDependency.srcStageMask) {
+            dependencies.push_back(signalDependency);
+        }
+
+        vk::SubpassDescription subpass;
+        subpass.pipelineBindPoint = vk::PipelineBindPoint::eGraphics;
+        subpass.colorAttachmentCount = (uint32_t)colorReferences.size();
+        subpass.pColorAttachments = colorReferences.data();
+        subpass.pDepthStencilAttachment = hasDepth ? &depthReference : nullptr;
+
+        vk::RenderPassCreateInfo renderPassInfo;
+        renderPassInfo.attachmentCount = (uint32_t)attachments.size();
+        renderPassInfo.pAttachments = attachments.data();
+        renderPassInfo.subpassCount = 1;
+        renderPassInfo.pSubpasses = &subpass;
+        renderPassInfo.dependencyCount = (uint32_t)dependencies.size();
+        renderPassInfo.pDependencies = dependencies.data();
+        pass.renderPass = device.createRenderPass(renderPassInfo);
+
+        vk::FramebufferCreateInfo framebufferInfo;
+        framebufferInfo.renderPass = pass.renderPass;
+        framebufferInfo.attachmentCount = (uint32_t)views.size();
+        framebufferInfo.pAttachments = views.data();
+        framebufferInfo.width = pass.extent.width;
+        framebufferInfo.height = pass.extent.height;
+        framebufferInfo.layers = 1;
+        pass.framebuffer = device.createFramebuffer(framebufferInfo);
+
+        if (vkx::debug::marker::active) {
+            vkx::debug::marker::setRenderPassName((VkDevice)device, (VkRenderPass)pass.renderPass, pass.name.c_str());
+        }
+    }
+
+    if (enableTimestamps && passCount > 0) {
+        vk::QueryPoolCreateInfo queryPoolInfo;
+        queryPoolInfo.queryType = vk::QueryType::eTimestamp;
+        queryPoolInfo.queryCount = passCount * 2;
+        queryPool = device.createQueryPool(queryPoolInfo);
+    }
+}
+
+void RenderGraph::execute(const vk::CommandBuffer& cmdBuffer) const {
+    if (queryPool) {
+        cmdBuffer.resetQueryPool(queryPool, 0, (uint32_t)passes.size() * 2);
+    }
+    for (uint32_t p = 0; p < passes.size(); ++p) {
+        const Pass& pass = *passes[p];
+        vkx::debug::marker::beginRegion((VkCommandBuffer)cmdBuffer, pass.name, glm::vec4(0.5f, 0.76f, 0.34f, 1.0f));
+        if (queryPool) {
+            cmdBuffer.writeTimestamp(vk::PipelineStageFlagBits::eTopOfPipe, queryPool, p * 2);
+        }
+
+        std::vector<vk::ClearValue> clearValues;
+        for (const auto& attachment : pass.colorAttachments) {
+            clearValues.push_back(attachment.clearValue);
+        }
+        if (pass.depthAttachment.resource != INVALID_RESOURCE) {
+            clearValues.push_back(pass.depthAttachment.clearValue);
+        }
+
+        vk::RenderPassBeginInfo renderPassBeginInfo;
+        renderPassBeginInfo.renderPass = pass.renderPass;
+        renderPassBeginInfo.framebuffer = pass.framebuffer;
+        vk::Extent2D extent = pass.renderExtent();
+        renderPassBeginInfo.renderArea.extent = extent;
+        renderPassBeginInfo.clearValueCount = (uint32_t)clearValues.size();
+        renderPassBeginInfo.pClearValues = clearValues.data();
+        cmdBuffer.beginRenderPass(renderPassBeginInfo, vk::SubpassContents::eInline);
+        vk::Viewport viewport = vkx::viewport((float)extent.width, (float)extent.height, 0.0f, 1.0f);
+        cmdBuffer.setViewport(0, viewport);
+        vk::Rect2D scissor = vkx::rect2D(extent.width, extent.height, 0, 0);
+        cmdBuffer.setScissor(0, scissor);
+        if (pass.record) {
+            pass.record(cmdBuffer);
+        }
+        cmdBuffer.endRenderPass();
+
+        if (queryPool) {
+            cmdBuffer.writeTimestamp(vk::PipelineStageFlagBits::eBottomOfPipe, queryPool, p * 2 + 1);
+        }
+        vkx::debug::marker::endRegion((VkCommandBuffer)cmdBuffer);
+    }
+}
+
+void RenderGraph::updateTimings() {
+    if (!queryPool) {
+        return;
+    }
+    std::vector<uint64_t> timestamps(passes.size() * 2);
+    context.device.getQueryPoolResults(queryPool, 0, (uint32_t)timestamps.size(), timestamps.size() * sizeof(uint64_t), timestamps.data(), sizeof(uint64_t), vk::QueryResultFlagBits::e64 | vk::QueryResultFlagBits::eWait);
+    float timestampPeriod = context.deviceProperties.limits.timestampPeriod / 1000000.0f;
+    gpuTime = 0.0f;
+    for (uint32_t p = 0; p < passes.size(); ++p) {
+        passes[p]->gpuTime = (float)(timestamps[p * 2 + 1] - timestamps[p * 2]) * timestampPeriod;
+        gpuTime += passes[p]->gpuTime;
+    }
+}
+
+void RenderGraph::destroy() {
+    const vk::Device& device = context.device;
+    for (auto& pass : passes) {
+        if (pass->framebuffer) {
+            device.destroyFramebuffer(pass->framebuffer);
+            pass->framebuffer = vk::Framebuffer();
+        }
+        if (pass->renderPass) {
+            device.destroyRenderPass(pass->renderPass);
+            pass->renderPass = vk::RenderPass();
+        }
+    }
+    for (Image& image : images) {
+        if (image.sampler) {
+            device.destroySampler(image.sampler);
+            image.sampler = vk::Sampler();
+        }
+        if (image.view) {
+            device.destroyImageView(image.view);
+            image.view = vk::ImageView();
+        }
+        if (image.image) {
+            device.destroyImage(image.image);
+            image.image = vk::Image();
+        }
+        image.memorySlot = ~0U;
+    }
+    for (vk::DeviceMemory& allocation : memory) {
+        ResourceRegistry::get().remove(allocation);
+        device.freeMemory(allocation);
+    }
+    memory.clear();
+    if (queryPool) {
+        device.destroyQueryPool(queryPool);
+        queryPool = vk::QueryPool();
+    }
+    memoryStats = MemoryStats();
+}
+
+vk::DescriptorImageInfo RenderGraph::descriptor(Resource resource) const {
+    const Image& image = images[resource];
+    return vkx::descriptorImageInfo(image.sampler, image.view, vk::ImageLayout::eShaderReadOnlyOptimal);
+}
+
+}
@@ -0,0 +1,151 @@
+/*
+* Render graph for offscreen passes
+*
+* This code is licensed under the MIT license (MIT) (http://opensource.org/licenses/MIT)
+*/
+
+#pragma once
+
+#include <stdint.h>
+#include <functional>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include <vulkan/vk_cpp.hpp>
+#include <glm/glm.hpp>
+
+namespace vkx {
+    class Context;
+
+    // Passes declare which images they render to and which they sample, compile() then
+    // derives everything the examples used to set up by hand:
+    //
+    // - one render pass and framebuffer per pass, with load / store ops and initial / final
+    //   layouts chosen from the neighbouring accesses of every attachment
+    // - the external subpass dependencies between passes, which are the only synchronization
+    //   the graph records (no pipeline barriers, no blits into separate texture targets,
+    //   attachments are sampled directly by later passes)
+    // - the device memory of the images, where images whose lifetimes do not overlap share
+    //   the same allocation
+    //
+    // The graph is executed in order every frame.  Images marked as outputs may be sampled
+    // by fragment shaders recorded after the graph (e.g. in the on screen render pass).
+    class RenderGraph {
+    public:
+        using Resource = uint32_t;
+        using RecordFunction = std::function<void(const vk::CommandBuffer&)>;
+
+        static const Resource INVALID_RESOURCE = ~0U;
+
+        struct Attachment {
+            Resource resource{ INVALID_RESOURCE };
+            bool clear{ false };
+            vk::ClearValue clearValue;
+        };
+
+        class Pass {
+        public:
+            std::string name;
+            std::vector<Attachment> colorAttachments;
+            Attachment depthAttachment;
+            std::vector<Resource> sampled;
+            RecordFunction record;
+            // Fraction of the extent rendered to, the pass only touches the top left part of its
+            // attachments so the images are not reallocated when the scale changes.  Readers have
+            // to scale their texture coordinates by the same factor.
+            float renderScale{ 1.0f };
+
+            // Valid after compile()
+            vk::RenderPass renderPass;
+            vk::Framebuffer framebuffer;
+            vk::Extent2D extent;
+            // GPU time of the last execution in ms, see updateTimings()
+            float gpuTime{ 0.0f };
+
+            // Render to a color attachment, cleared to the given color or left undefined
+            // (i.e. the pass overwrites every pixel) unless an earlier pass wrote it
+            Pass& writeColor(Resource resource);
+            Pass& writeColor(Resource resource, const glm::vec4& clearColor);
+            // Depth is always cleared to 1.0
+            Pass& writeDepth(Resource resource);
+            // Sample an image written by an earlier pass in a fragment shader
+            Pass& read(Resource resource);
+            // Records the draw commands, the render pass is already begun and viewport and
+            // scissor are set to the render extent
+            Pass& setRecord(const RecordFunction& record);
+            // The part of the extent covered by the render area, viewport and scissor
+            vk::Extent2D renderExtent() const;
+        };
+
+        struct MemoryStats {
+            // Sum of the memory requirements of all images
+            vk::DeviceSize required{ 0 };
+            // Memory actually allocated after aliasing
+            vk::DeviceSize allocated{ 0 };
+            uint32_t allocationCount{ 0 };
+        };
+
+        // Share memory between images with disjoint lifetimes
+        bool enableAliasing{ true };
+        // Write timestamps around every pass, see updateTimings()
+        bool enableTimestamps{ true };
+
+        MemoryStats memoryStats;
+        // Sum of the GPU time of all passes in ms
+        float gpuTime{ 0.0f };
+
+        RenderGraph(const Context& context) : context(context) {}
+        ~RenderGraph() { destroy(); }
+
+        Resource createImage(const std::string& name, vk::Format format, const vk::Extent2D& extent, vk::Filter filter = vk::Filter::eLinear);
+        // Keep the image readable by shaders of the given stages after the graph has been executed
+        void markOutput(Resource resource, vk::PipelineStageFlags stages = vk::PipelineStageFlagBits::eFragmentShader);
+        // Resize an image, e.g. with the window, takes effect on the next compile().  Pipelines
+        // created for the passes stay valid since the render passes remain compatible.
+        void setExtent(Resource resource, const vk::Extent2D& extent);
+        // The returned reference is valid for the lifetime of the graph
+        Pass& addPass(const std::string& name);
+
+        // Creates images, memory, render passes and framebuffers
+        void compile();
+        // Records all passes into the command buffer
+        void execute(const vk::CommandBuffer& cmdBuffer) const;
+        // Reads back the timestamps written by the last execution, which must have completed
+        void updateTimings();
+        void destroy();
+
+        vk::ImageView view(Resource resource) const { return images[resource].view; }
+        vk::Image image(Resource resource) const { return images[resource].image; }
+        // Descriptor for sampling the image in a later pass or after the graph
+        vk::DescriptorImageInfo descriptor(Resource resource) const;
+        const std::vector<std::unique_ptr<Pass>>& getPasses() const { return passes; }
+
+    private:
+        struct Image {
+            std::string name;
+            vk::Format format;
+            vk::Extent2D extent;
+            vk::Filter filter;
+            bool output{ false };
+            vk::PipelineStageFlags outputStages;
+
+            vk::ImageUsageFlags usage;
+            // First and last pass accessing the image, outputs live until the end of the graph
+            uint32_t firstPass{ ~0U };
+            uint32_t lastPass{ 0 };
+            vk::MemoryRequirements memReqs;
+            uint32_t memorySlot{ ~0U };
+
+            vk::Image image;
+            vk::ImageView view;
+            vk::Sampler sampler;
+        };
+
+        const Context& context;
+        std::vector<Image> images;
+        std::vector<std::unique_ptr<Pass>> passes;
+        std::vector<vk::DeviceMemory> memory;
+        vk::QueryPool queryPool;
+    };
+}
@@ -0,0 +1,251 @@
+/*
+* Registry of the device memory held by buffers and images, per usage category
+*
+* This code is licensed under the MIT license (MIT) (http://opensource.org/licenses/MIT)
+*/
+
+#include "vulkanResourceRegistry.h"
+
+#include <stdio.h>
+#include <algorithm>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <sstream>
+#include <vector>
+
+using namespace vkx;
+
+namespace {
+    const char* const CATEGORY_NAMES[ResourceRegistry::CATEGORY_COUNT] = { "mesh", "texture", "render target", "uniform", "staging", "other" };
+    const char* const KIND_NAMES[] = { "buffer", "image", "memory" };
+
+    inline uint64_t key(vk::DeviceMemory memory) {
+        return (uint64_t)(VkDeviceMemory)memory;
+    }
+
+    std::string escape(const std::string& text) {
+        std::string result;
+        for (char c : text) {
+            if (c == '"' || c == '\\') {
+                result += '\\';
+                result += c;
+            } else if ((unsigned char)c < 0x20) {
+                char code[8];
+                snprintf(code, sizeof(code), "\\u%04x", (unsigned char)c);
+                result += code;
+            } else {
+                result += c;
+            }
+        }
+        return result;
+    }
+
+    void writeStats(std::ostream& out, const ResourceStats& stats) {
+        out << "{ \"buffers\": " << stats.buffers << ", \"images\": " << stats.images << ", \"allocations\": " << stats.allocations
+            << ", \"bytes\": " << stats.bytes << ", \"peakBytes\": " << stats.peakBytes << ", \"created\": " << stats.created
+            << ", \"destroyed\": " << stats.destroyed << ", \"peakFrameChurn\": " << stats.peakFrameChurn << " }";
+    }
+}
+
+ResourceRegistry& ResourceRegistry::get() {
+    static ResourceRegistry registry;
+    return registry;
+}
+
+const char* ResourceRegistry::categoryName(ResourceCategory category) {
+    return CATEGORY_NAMES[(size_t)category];
+}
+
+ResourceCategory ResourceRegistry::categorize(const vk::BufferUsageFlags& usage) {
+    if (usage & vk::BufferUsageFlagBits::eUniformBuffer) {
+        return ResourceCategory::Uniform;
+    }
+    if (usage & (vk::BufferUsageFlagBits::eVertexBuffer | vk::BufferUsageFlagBits::eIndexBuffer)) {
+        return ResourceCategory::Mesh;
+    }
+    // Buffers that are only copied from or into are uploads and readbacks
+    if (usage == vk::BufferUsageFlagBits::eTransferSrc || usage == vk::BufferUsageFlagBits::eTransferDst) {
+        return ResourceCategory::Staging;
+    }
+    return ResourceCategory::Other;
+}
+
+ResourceCategory ResourceRegistry::categorize(const vk::ImageUsageFlags& usage) {
+    if (usage & (vk::ImageUsageFlagBits::eColorAttachment | vk::ImageUsageFlagBits::eDepthStencilAttachment)) {
+        return ResourceCategory::RenderTarget;
+    }
+    if (usage & vk::ImageUsageFlagBits::eSampled) {
+        return ResourceCategory::Texture;
+    }
+    return ResourceCategory::Other;
+}
+
+void ResourceRegistry::added(ResourceStats& stats, const Entry& entry) {
+    switch (entry.kind) {
+    case ResourceKind::Buffer:
+        ++stats.buffers;
+        break;
+    case ResourceKind::Image:
+        ++stats.images;
+        break;
+    default:
+        break;
+    }
+    ++stats.allocations;
+    ++stats.created;
+    stats.bytes += entry.bytes;
+    stats.peakBytes = std::max(stats.peakBytes, stats.bytes);
+}
+
+void ResourceRegistry::removed(ResourceStats& stats, const Entry& entry) {
+    switch (entry.kind) {
+    case ResourceKind::Buffer:
+        --stats.buffers;
+        break;
+    case ResourceKind::Image:
+        --stats.images;
+        break;
+    default:
+        break;
+    }
+    --stats.allocations;
+    ++stats.destroyed;
+    stats.bytes -= entry.bytes;
+}
+
+void ResourceRegistry::add(vk::DeviceMemory memory, ResourceKind kind, ResourceCategory category, vk::DeviceSize bytes, const std::string& name) {
+    if (!memory) {
+        return;
+    }
+    std::lock_guard<std::mutex> lock(mutex);
+    auto it = entries.find(key(memory));
+    if (it != entries.end()) {
+        // Memory freed without remove(), whose handle the implementation reused
+        removed(categories[(size_t)it->second.category], it->second);
+        removed(totals, it->second);
+        it->second = Entry{ kind, category, bytes, name };
+    } else {
+        it = entries.emplace(key(memory), Entry{ kind, category, bytes, name }).first;
+    }
+    const Entry& entry = it->second;
+    added(categories[(size_t)category], entry);
+    added(totals, entry);
+    ++frameChurn[(size_t)category];
+    ++totalChurn;
+}
+
+void ResourceRegistry::tag(vk::DeviceMemory memory, ResourceCategory category, const std::string& name) {
+    std::lock_guard<std::mutex> lock(mutex);
+    auto it = entries.find(key(memory));
+    if (it == entries.end()) {
+        return;
+    }
+    Entry& entry = it->second;
+    entry.name = name;
+    if (entry.category == category) {
+        return;
+    }
+    // Moving between categories isn't churn, only the live counts change
+    ResourceStats& from = categories[(size_t)entry.category];
+    ResourceStats& to = categories[(size_t)category];
+    removed(from, entry);
+    --from.destroyed;
+    --from.created;
+    entry.category = category;
+    added(to, entry);
+}
+
+void ResourceRegistry::remove(vk::DeviceMemory memory) {
+    if (!memory) {
+        return;
+    }
+    std::lock_guard<std::mutex> lock(mutex);
+    auto it = entries.find(key(memory));
+    if (it == entries.end()) {
+        return;
+    }
+    const Entry& entry = it->second;
+    removed(categories[(size_t)entry.category], entry);
+    removed(totals, entry);
+    ++frameChurn[(size_t)entry.category];
+    ++totalChurn;
+    entries.erase(it);
+}
+
+void ResourceRegistry::endFrame() {
+    std::lock_guard<std::mutex> lock(mutex);
+    for (size_t i = 0; i < CATEGORY_COUNT; ++i) {
+        categories[i].frameChurn = frameChurn[i];
+        categories[i].peakFrameChurn = std::max(categories[i].peakFrameChurn, frameChurn[i]);
+        frameChurn[i] = 0;
+    }
+    totals.frameChurn = totalChurn;
+    totals.peakFrameChurn = std::max(totals.peakFrameChurn, totalChurn);
+    totalChurn = 0;
+}
+
+ResourceStats ResourceRegistry::stats(ResourceCategory category) const {
+    std::lock_guard<std::mutex> lock(mutex);
+    return categories[(size_t)category];
+}
+
+ResourceStats ResourceRegistry::total() const {
+    std::lock_guard<std::mutex> lock(mutex);
+    return totals;
+}
+
+std::string ResourceRegistry::report() const {
+    std::lock_guard<std::mutex> lock(mutex);
+    std::ostringstream out;
+    out << "{" << std::endl << "  \"categories\": {" << std::endl;
+    for (size_t i = 0; i < CATEGORY_COUNT; ++i) {
+        out << "    \"" << CATEGORY_NAMES[i] << "\": ";
+        writeStats(out, categories[i]);
+        out << (i + 1 < CATEGORY_COUNT ? "," : "") << std::endl;
+    }
+    out << "  }," << std::endl << "  \"total\": ";
+    writeStats(out, totals);
+    out << "," << std::endl;
+
+    // Largest first, at exit these are the allocations that were never destroyed
+    std::vector<const Entry*> live;
+    live.reserve(entries.size());
+    for (const auto& entry : entries) {
+        live.push_back(&entry.second);
+    }
+    std::sort(live.begin(), live.end(), [](const Entry* a, const Entry* b) {
+        return a->bytes > b->bytes;
+    });
+    out << "  \"live\": [";
+    for (size_t i = 0; i < live.size(); ++i) {
+        const Entry& entry = *live[i];
+        out << (i ? "," : "") << std::endl << "    { \"name\": \"" << escape(entry.name) << "\", \"category\": \"" << CATEGORY_NAMES[(size_t)entry.category]
+            << "\", \"kind\": \"" << KIND_NAMES[(size_t)entry.kind] << "\", \"bytes\": " << entry.bytes << " }";
+    }
+    out << (live.empty() ? "]" : "\n  ]") << std::endl << "}" << std::endl;
+    return out.str();
+}
+
+bool ResourceRegistry::writeReport(const std::string& filename) const {
+    std::ofstream file(filename);
+    if (!file) {
+        return false;
+    }
+    file << report();
+    return (bool)file;
+}
+
+std::string ResourceReport::summary() const {
+    ResourceStats resources = ResourceRegistry::get().total();
+    std::ostringstream ss;
+    ss << std::fixed << std::setprecision(1) << resources.bytes / (1024.0 * 1024.0) << " MB device memory (peak " << resources.peakBytes / (1024.0 * 1024.0)
+        << " MB), " << resources.buffers << " buffers, " << resources.images << " images, " << resources.frameChurn << " churn/frame";
+    return ss.str();
+}
+
+void ResourceReport::write() const {
+    if (!filename.empty() && !ResourceRegistry::get().writeReport(filename)) {
+        std::cerr << "Unable to write the memory report " << filename << std::endl;
+    }
+}
@@ -0,0 +1,115 @@
+/*
+* Registry of the device memory held by buffers and images, per usage category
+*
+* This code is licensed under the MIT license (MIT) (http://opensource.org/licenses/MIT)
+*/
+
+#pragma once
+
+#include <stdint.h>
+#include <array>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+
+#include <vulkan/vk_cpp.hpp>
+
+namespace vkx {
+
+    enum class ResourceCategory : uint32_t {
+        Mesh,
+        Texture,
+        RenderTarget,
+        Uniform,
+        Staging,
+        Other,
+    };
+
+    enum class ResourceKind : uint32_t {
+        Buffer,
+        Image,
+        // Memory shared by several resources, e.g. aliased render graph attachments
+        Memory,
+    };
+
+    struct ResourceStats {
+        uint32_t buffers{ 0 };
+        uint32_t images{ 0 };
+        uint32_t allocations{ 0 };
+        // Bytes of device memory currently held and their high-water mark
+        uint64_t bytes{ 0 };
+        uint64_t peakBytes{ 0 };
+        // Registrations and releases since the start
+        uint64_t created{ 0 };
+        uint64_t destroyed{ 0 };
+        // Registrations and releases during the last finished frame, and the most of any frame
+        uint32_t frameChurn{ 0 };
+        uint32_t peakFrameChurn{ 0 };
+    };
+
+    // Every device memory allocation made through Context::createBuffer / createImage is
+    // registered here until AllocatedResult::destroy() frees it.  The category is derived from
+    // the usage flags and can be refined with tag() by code that knows better, e.g. the loaders.
+    //
+    // There is one registry per process, shared by all contexts, since allocations are made by
+    // copies of the context in loaders and worker threads.  All functions are thread safe.
+    class ResourceRegistry {
+    public:
+        static const size_t CATEGORY_COUNT = (size_t)ResourceCategory::Other + 1;
+
+        static ResourceRegistry& get();
+        static const char* categoryName(ResourceCategory category);
+        static ResourceCategory categorize(const vk::BufferUsageFlags& usage);
+        static ResourceCategory categorize(const vk::ImageUsageFlags& usage);
+
+        void add(vk::DeviceMemory memory, ResourceKind kind, ResourceCategory category, vk::DeviceSize bytes, const std::string& name = std::string());
+        // Changes the category and name of a registered allocation
+        void tag(vk::DeviceMemory memory, ResourceCategory category, const std::string& name);
+        // Unknown handles are ignored, so this can be called for any memory that is freed
+        void remove(vk::DeviceMemory memory);
+
+        // Closes the churn counters of the current frame
+        void endFrame();
+
+        ResourceStats stats(ResourceCategory category) const;
+        ResourceStats total() const;
+
+        // Categories, totals and every allocation that is still registered, as JSON
+        std::string report() const;
+        bool writeReport(const std::string& filename) const;
+
+    private:
+        struct Entry {
+            ResourceKind kind;
+            ResourceCategory category;
+            vk::DeviceSize bytes;
+            std::string name;
+        };
+
+        ResourceRegistry() = default;
+
+        void added(ResourceStats& stats, const Entry& entry);
+        void removed(ResourceStats& stats, const Entry& entry);
+
+        mutable std::mutex mutex;
+        std::unordered_map<uint64_t, Entry> entries;
+        std::array<ResourceStats, CATEGORY_COUNT> categories;
+        ResourceStats totals;
+        // Churn of the frame in progress, per category and in total
+        std::array<uint32_t, CATEGORY_COUNT> frameChurn{};
+        uint32_t totalChurn{ 0 };
+    };
+
+    // Reports the registry for the examples: the live totals for the text overlay and the
+    // headless timing, and the JSON report at exit
+    class ResourceReport {
+    public:
+        // Written by write(), nothing is written if empty
+        std::string filename;
+
+        // Live and peak bytes, live buffers and images and the churn of the last frame
+        std::string summary() const;
+        // Writes the report if a file is set, failures are printed to stderr
+        void write() const;
+    };
+}
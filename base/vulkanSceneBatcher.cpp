@@ -0,0 +1,144 @@
+/*
+* Multi draw indirect batching of static meshes
+*
+* This code is licensed under the MIT license (MIT) (http://opensource.org/licenses/MIT)
+*/
+
+#include "vulkanSceneBatcher.h"
+
+#include <string.h>
+
+#include <algorithm>
+#include <stdexcept>
+
+#include "vulkanContext.hpp"
+
+namespace vkx {
+
+uint32_t SceneBatcher::addMesh(const void* vertices, uint32_t vertexCount, const std::vector<uint32_t>& indices) {
+    Mesh mesh;
+    mesh.firstIndex = (uint32_t)indexData.size();
+    mesh.indexCount = (uint32_t)indices.size();
+    mesh.vertexOffset = (int32_t)(vertexData.size() / vertexSize);
+    const uint8_t* bytes = (const uint8_t*)vertices;
+    vertexData.insert(vertexData.end(), bytes, bytes + vertexCount * vertexSize);
+    indexData.insert(indexData.end(), indices.begin(), indices.end());
+    meshes.push_back(mesh);
+    return (uint32_t)meshes.size() - 1;
+}
+
+void SceneBatcher::addDraw(uint32_t mesh, uint32_t batch, const void* data) {
+    if (mesh >= meshes.size()) {
+        throw std::runtime_error("Invalid mesh index");
+    }
+    Draw draw;
+    draw.mesh = mesh;
+    draw.batch = batch;
+    draw.dataOffset = (uint32_t)drawDataStorage.size();
+    const uint8_t* bytes = (const uint8_t*)data;
+    drawDataStorage.insert(drawDataStorage.end(), bytes, bytes + drawDataSize);
+    draws.push_back(draw);
+}
+
+void SceneBatcher::build() {
+    if (draws.empty()) {
+        throw std::runtime_error("Scene batcher has no draws");
+    }
+    destroy();
+
+    // Group the draws by batch, the draw data is stored in the same order
+    // so a draw's index into it equals its indirect command's index
+    std::vector<Draw> sorted = draws;
+    std::stable_sort(sorted.begin(), sorted.end(), [](const Draw& a, const Draw& b) {
+        return a.batch < b.batch;
+    });
+
+    batches.clear();
+    batches.resize(sorted.back().batch + 1);
+    commands.clear();
+    commands.reserve(sorted.size());
+    std::vector<uint8_t> sortedDrawData(sorted.size() * drawDataSize);
+    for (uint32_t i = 0; i < sorted.size(); ++i) {
+        const Draw& draw = sorted[i];
+        const Mesh& mesh = meshes[draw.mesh];
+        Batch& batch = batches[draw.batch];
+        if (batch.commandCount == 0) {
+            batch.firstCommand = i;
+        }
+        ++batch.commandCount;
+
+        vk::DrawIndexedIndirectCommand command;
+        command.indexCount = mesh.indexCount;
+        command.instanceCount = 1;
+        command.firstIndex = mesh.firstIndex;
+        command.vertexOffset = mesh.vertexOffset;
+        command.firstInstance = i;
+        commands.push_back(command);
+
+        memcpy(sortedDrawData.data() + i * drawDataSize, drawDataStorage.data() + draw.dataOffset, drawDataSize);
+    }
+
+    vertices = context.stageToDeviceBuffer(vk::BufferUsageFlagBits::eVertexBuffer, vertexData);
+    indices = context.stageToDeviceBuffer(vk::BufferUsageFlagBits::eIndexBuffer, indexData);
+    drawData = context.stageToDeviceBuffer(vk::BufferUsageFlagBits::eStorageBuffer, sortedDrawData);
+    indirectCommands = context.stageToDeviceBuffer(vk::BufferUsageFlagBits::eIndirectBuffer, commands);
+}
+
+void SceneBatcher::bindBuffers(const vk::CommandBuffer& cmdBuffer, uint32_t binding) const {
+    vk::DeviceSize offsets = 0;
+    cmdBuffer.bindVertexBuffers(binding, vertices.buffer, offsets);
+    cmdBuffer.bindIndexBuffer(indices.buffer, 0, vk::IndexType::eUint32);
+}
+
+void SceneBatcher::drawBatch(const vk::CommandBuffer& cmdBuffer, uint32_t batch) {
+    if (batch >= batches.size() || batches[batch].commandCount == 0) {
+        return;
+    }
+    const Batch& range = batches[batch];
+    const vk::PhysicalDeviceFeatures& features = context.deviceFeatures;
+
+    // The first instance of indirect draws is ignored without this feature,
+    // issue the commands directly instead
+    if (!features.drawIndirectFirstInstance) {
+        for (uint32_t i = range.firstCommand; i < range.firstCommand + range.commandCount; ++i) {
+            const auto& command = commands[i];
+            cmdBuffer.drawIndexed(command.indexCount, command.instanceCount, command.firstIndex, command.vertexOffset, command.firstInstance);
+            ++drawCalls;
+        }
+        return;
+    }
+
+    uint32_t stride = sizeof(vk::DrawIndexedIndirectCommand);
+    uint32_t maxDrawCount = features.multiDrawIndirect ? context.deviceProperties.limits.maxDrawIndirectCount : 1;
+    for (uint32_t first = 0; first < range.commandCount; first += maxDrawCount) {
+        uint32_t count = std::min(maxDrawCount, range.commandCount - first);
+        cmdBuffer.drawIndexedIndirect(indirectCommands.buffer, (range.firstCommand + first) * stride, count, stride);
+        ++drawCalls;
+    }
+}
+
+void SceneBatcher::drawBatchUnbatched(const vk::CommandBuffer& cmdBuffer, uint32_t batch, uint32_t binding, const vk::Pipeline& pipeline) {
+    if (batch >= batches.size()) {
+        return;
+    }
+    const Batch& range = batches[batch];
+    for (uint32_t i = range.firstCommand; i < range.firstCommand + range.commandCount; ++i) {
+        const auto& command = commands[i];
+        // Rebind everything per mesh as if every mesh had its own buffers
+        cmdBuffer.bindPipeline(vk::PipelineBindPoint::eGraphics, pipeline);
+        vk::DeviceSize offset = (vk::DeviceSize)command.vertexOffset * vertexSize;
+        cmdBuffer.bindVertexBuffers(binding, vertices.buffer, offset);
+        cmdBuffer.bindIndexBuffer(indices.buffer, (vk::DeviceSize)command.firstIndex * sizeof(uint32_t), vk::IndexType::eUint32);
+        cmdBuffer.drawIndexed(command.indexCount, 1, 0, 0, command.firstInstance);
+        ++drawCalls;
+    }
+}
+
+void SceneBatcher::destroy() {
+    vertices.destroy();
+    indices.destroy();
+    drawData.destroy();
+    indirectCommands.destroy();
+}
+
+}
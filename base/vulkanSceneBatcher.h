@@ -0,0 +1,111 @@
+/*
+* Multi draw indirect batching of static meshes
+*
+* This code is licensed under the MIT license (MIT) (http://opensource.org/licenses/MIT)
+*/
+
+#pragma once
+
+#include <stdint.h>
+#include <vector>
+
+#include <vulkan/vk_cpp.hpp>
+
+#include "vulkanTools.h"
+
+namespace vkx {
+    class Context;
+
+    // Merges static meshes into one vertex and index buffer and draws them with one
+    // indirect draw per batch (typically one batch per pipeline).
+    //
+    // Every draw gets a block of per draw data (e.g. a model matrix) in a storage buffer.
+    // The draw's index into that buffer is passed as its first instance, so vertex shaders
+    // fetch it with
+    //
+    //     layout (std430, binding = N) readonly buffer Draws { DrawData draws[]; };
+    //     DrawData draw = draws[gl_InstanceIndex];
+    //
+    // Devices without drawIndirectFirstInstance fall back to one drawIndexed per draw with
+    // the same first instance, devices without multiDrawIndirect to one indirect draw per
+    // draw.  Both keep the shaders and bindings unchanged.
+    class SceneBatcher {
+    public:
+        // Range of the indirect commands of a batch, valid after build()
+        struct Batch {
+            uint32_t firstCommand{ 0 };
+            uint32_t commandCount{ 0 };
+        };
+
+        // Draw calls recorded by the last drawBatch() calls, see resetStats()
+        uint32_t drawCalls{ 0 };
+
+        SceneBatcher(const Context& context, uint32_t vertexSize, uint32_t drawDataSize) : context(context), vertexSize(vertexSize), drawDataSize(drawDataSize) {}
+        ~SceneBatcher() { destroy(); }
+
+        // Appends the mesh to the shared arena, indices are relative to the mesh's first vertex
+        uint32_t addMesh(const void* vertices, uint32_t vertexCount, const std::vector<uint32_t>& indices);
+        template <typename T>
+        uint32_t addMesh(const std::vector<T>& vertices, const std::vector<uint32_t>& indices) {
+            return addMesh(vertices.data(), (uint32_t)vertices.size(), indices);
+        }
+
+        // Draws a mesh in a batch, drawData points to drawDataSize bytes
+        void addDraw(uint32_t mesh, uint32_t batch, const void* drawData);
+        template <typename T>
+        void addDraw(uint32_t mesh, uint32_t batch, const T& drawData) {
+            addDraw(mesh, batch, &drawData);
+        }
+
+        // Uploads the arena, the draw data and the indirect commands grouped by batch
+        void build();
+
+        // Binds the shared vertex and index buffer
+        void bindBuffers(const vk::CommandBuffer& cmdBuffer, uint32_t binding) const;
+        // Draws all meshes of the batch, the pipeline has to be bound by the caller
+        void drawBatch(const vk::CommandBuffer& cmdBuffer, uint32_t batch);
+        // Draws the batch with one bind and drawIndexed per mesh, like unbatched code would,
+        // for comparison
+        void drawBatchUnbatched(const vk::CommandBuffer& cmdBuffer, uint32_t batch, uint32_t binding, const vk::Pipeline& pipeline);
+
+        void resetStats() { drawCalls = 0; }
+        void destroy();
+
+        // Storage buffer with the per draw data, in draw index order
+        const vk::DescriptorBufferInfo& drawDataDescriptor() const { return drawData.descriptor; }
+        uint32_t meshCount() const { return (uint32_t)meshes.size(); }
+        uint32_t drawCount() const { return (uint32_t)draws.size(); }
+        const std::vector<Batch>& getBatches() const { return batches; }
+
+    private:
+        struct Mesh {
+            uint32_t firstIndex;
+            uint32_t indexCount;
+            int32_t vertexOffset;
+        };
+
+        struct Draw {
+            uint32_t mesh;
+            uint32_t batch;
+            uint32_t dataOffset;
+        };
+
+        const Context& context;
+        const uint32_t vertexSize;
+        const uint32_t drawDataSize;
+
+        std::vector<uint8_t> vertexData;
+        std::vector<uint32_t> indexData;
+        std::vector<uint8_t> drawDataStorage;
+        std::vector<Mesh> meshes;
+        std::vector<Draw> draws;
+
+        std::vector<Batch> batches;
+        std::vector<vk::DrawIndexedIndirectCommand> commands;
+
+        CreateBufferResult vertices;
+        CreateBufferResult indices;
+        CreateBufferResult drawData;
+        CreateBufferResult indirectCommands;
+    };
+}
@@ -0,0 +1,223 @@
+/*
+* Instanced signed distance field text rendering
+*
+* This code is licensed under the MIT license (MIT) (http://opensource.org/licenses/MIT)
+*/
+
+#include "vulkanSdfText.h"
+
+#include <assert.h>
+#include <stddef.h>
+#include <string.h>
+#include <stdexcept>
+
+using namespace vkx;
+
+namespace {
+    // Binding of the instance records, the text pipeline has no per vertex input
+    const uint32_t INSTANCE_BUFFER_BIND_ID = 0;
+
+    // std140 layout of one glyph table entry in text.vert
+    struct GlyphTableEntry {
+        glm::vec4 uv;
+        glm::vec4 quad;
+    };
+
+    inline bool isSpace(char c) {
+        return c == ' ' || c == '\t' || c == '\r';
+    }
+
+    template <size_t N>
+    inline bool matches(const char* key, size_t length, const char(&name)[N]) {
+        return length == N - 1 && memcmp(key, name, N - 1) == 0;
+    }
+
+    // Parses the key=value pairs of one line and calls f(key, keyLength, value) for the
+    // integer ones.  Quoted strings are skipped, lists (padding=4,4,4,4) yield their first value.
+    template <typename F>
+    void parsePairs(const char* p, const char* end, F f) {
+        while (p < end) {
+            while (p < end && isSpace(*p)) {
+                ++p;
+            }
+            const char* key = p;
+            while (p < end && *p != '=' && !isSpace(*p)) {
+                ++p;
+            }
+            if (p == end || *p != '=') {
+                continue;
+            }
+            size_t keyLength = p - key;
+            ++p;
+            if (p < end && *p == '"') {
+                ++p;
+                while (p < end && *p != '"') {
+                    ++p;
+                }
+                if (p < end) {
+                    ++p;
+                }
+                continue;
+            }
+            bool negative = p < end && *p == '-';
+            if (negative) {
+                ++p;
+            }
+            int32_t value = 0;
+            while (p < end && *p >= '0' && *p <= '9') {
+                value = value * 10 + (*p++ - '0');
+            }
+            f(key, keyLength, negative ? -value : value);
+            while (p < end && !isSpace(*p)) {
+                ++p;
+            }
+        }
+    }
+}
+
+void SdfFont::load(const std::string& filename) {
+    std::string text = readTextFile(filename);
+    if (text.empty()) {
+        throw std::runtime_error("Failed to read font " + filename);
+    }
+    parse(text.data(), text.size());
+}
+
+void SdfFont::parse(const char* text, size_t size) {
+    glyphs.fill(SdfGlyph());
+    const char* end = text + size;
+    const char* line = text;
+    while (line < end) {
+        const char* lineEnd = (const char*)memchr(line, '\n', end - line);
+        if (!lineEnd) {
+            lineEnd = end;
+        }
+        size_t length = lineEnd - line;
+        if (length > 5 && memcmp(line, "char ", 5) == 0) {
+            SdfGlyph glyph;
+            int32_t id = -1;
+            parsePairs(line + 5, lineEnd, [&](const char* key, size_t keyLength, int32_t value) {
+                if (matches(key, keyLength, "id")) id = value;
+                else if (matches(key, keyLength, "x")) glyph.x = (uint16_t)value;
+                else if (matches(key, keyLength, "y")) glyph.y = (uint16_t)value;
+                else if (matches(key, keyLength, "width")) glyph.width = (uint16_t)value;
+                else if (matches(key, keyLength, "height")) glyph.height = (uint16_t)value;
+                else if (matches(key, keyLength, "xoffset")) glyph.xoffset = (int16_t)value;
+                else if (matches(key, keyLength, "yoffset")) glyph.yoffset = (int16_t)value;
+                else if (matches(key, keyLength, "xadvance")) glyph.xadvance = (int16_t)value;
+                else if (matches(key, keyLength, "page")) glyph.page = (uint16_t)value;
+            });
+            // The table only covers single byte characters
+            if (id >= 0 && id < (int32_t)glyphs.size()) {
+                glyphs[id] = glyph;
+            }
+        } else if (length > 7 && memcmp(line, "common ", 7) == 0) {
+            parsePairs(line + 7, lineEnd, [&](const char* key, size_t keyLength, int32_t value) {
+                if (matches(key, keyLength, "lineHeight")) lineHeight = value;
+                else if (matches(key, keyLength, "base")) base = value;
+                else if (matches(key, keyLength, "scaleW")) scaleW = std::max(value, 1);
+                else if (matches(key, keyLength, "scaleH")) scaleH = std::max(value, 1);
+            });
+        }
+        line = lineEnd + 1;
+    }
+}
+
+float SdfFont::width(const std::string& text) const {
+    float result = 0.0f;
+    for (char c : text) {
+        result += glyph(c).xadvance;
+    }
+    return result;
+}
+
+void SdfTextRenderer::create(const SdfFont& font, uint32_t capacity, uint32_t regions) {
+    destroy();
+    this->font = &font;
+    regionCapacity = capacity;
+    regionCount = regions;
+
+    std::vector<GlyphTableEntry> table(font.glyphs.size());
+    glm::vec2 texelSize = glm::vec2(1.0f / font.scaleW, 1.0f / font.scaleH);
+    for (size_t i = 0; i < table.size(); ++i) {
+        const SdfGlyph& glyph = font.glyphs[i];
+        glm::vec2 uvStart = glm::vec2(glyph.x, glyph.y) * texelSize;
+        glm::vec2 uvEnd = glm::vec2(glyph.x + glyph.width, glyph.y + glyph.height) * texelSize;
+        table[i].uv = glm::vec4(uvStart, uvEnd);
+        table[i].quad = glm::vec4(glyph.xoffset, glyph.yoffset, glyph.width, glyph.height);
+    }
+    glyphTable = context.createBuffer(vk::BufferUsageFlagBits::eUniformBuffer, vk::MemoryPropertyFlagBits::eHostVisible | vk::MemoryPropertyFlagBits::eHostCoherent, table);
+
+    // Coherent memory, the records are written in place and never flushed
+    ring = context.createBuffer(vk::BufferUsageFlagBits::eVertexBuffer | vk::BufferUsageFlagBits::eIndirectBuffer,
+        vk::MemoryPropertyFlagBits::eHostVisible | vk::MemoryPropertyFlagBits::eHostCoherent, regionOffset(regions));
+    ring.map();
+    for (uint32_t i = 0; i < regions; ++i) {
+        vk::DrawIndirectCommand drawCommand;
+        drawCommand.vertexCount = 4;
+        ring.copy(drawCommand, regionOffset(i));
+    }
+
+    bindingDescription = vertexInputBindingDescription(INSTANCE_BUFFER_BIND_ID, sizeof(SdfGlyphInstance), vk::VertexInputRate::eInstance);
+    // Location 0 : Pen position and scale
+    attributeDescriptions[0] = vertexInputAttributeDescription(INSTANCE_BUFFER_BIND_ID, 0, vk::Format::eR32G32B32Sfloat, offsetof(SdfGlyphInstance, x));
+    // Location 1 : Character code
+    attributeDescriptions[1] = vertexInputAttributeDescription(INSTANCE_BUFFER_BIND_ID, 1, vk::Format::eR32Uint, offsetof(SdfGlyphInstance, glyph));
+    vertexInputState = vk::PipelineVertexInputStateCreateInfo();
+    vertexInputState.vertexBindingDescriptionCount = 1;
+    vertexInputState.pVertexBindingDescriptions = &bindingDescription;
+    vertexInputState.vertexAttributeDescriptionCount = (uint32_t)attributeDescriptions.size();
+    vertexInputState.pVertexAttributeDescriptions = attributeDescriptions.data();
+}
+
+vk::DeviceSize SdfTextRenderer::regionOffset(uint32_t region) const {
+    // The indirect command is 16 bytes, so are the records following it
+    return region * (sizeof(vk::DrawIndirectCommand) + (vk::DeviceSize)regionCapacity * sizeof(SdfGlyphInstance));
+}
+
+void SdfTextRenderer::begin(uint32_t region) {
+    assert(region < regionCount);
+    this->region = region;
+    count = 0;
+    instances = (SdfGlyphInstance*)((uint8_t*)ring.mapped + regionOffset(region) + sizeof(vk::DrawIndirectCommand));
+}
+
+uint32_t SdfTextRenderer::add(const char* text, size_t length, float x, float y, float scale) {
+    uint32_t written = std::min((uint32_t)length, regionCapacity - count);
+    SdfGlyphInstance* instance = instances + count;
+    for (uint32_t i = 0; i < written; ++i) {
+        uint8_t c = (uint8_t)text[i];
+        *instance++ = { x, y, scale, c };
+        x += font->glyphs[c].xadvance * scale;
+    }
+    count += written;
+    return written;
+}
+
+SdfGlyphInstance* SdfTextRenderer::reserve(uint32_t count) {
+    if (count > regionCapacity - this->count) {
+        return nullptr;
+    }
+    SdfGlyphInstance* result = instances + this->count;
+    this->count += count;
+    return result;
+}
+
+void SdfTextRenderer::end() {
+    vk::DrawIndirectCommand* drawCommand = (vk::DrawIndirectCommand*)((uint8_t*)ring.mapped + regionOffset(region));
+    drawCommand->instanceCount = count;
+    instances = nullptr;
+}
+
+void SdfTextRenderer::draw(const vk::CommandBuffer& cmdBuffer, uint32_t region) const {
+    vk::DeviceSize offset = regionOffset(region);
+    cmdBuffer.bindVertexBuffers(INSTANCE_BUFFER_BIND_ID, ring.buffer, offset + sizeof(vk::DrawIndirectCommand));
+    cmdBuffer.drawIndirect(ring.buffer, offset, 1, sizeof(vk::DrawIndirectCommand));
+}
+
+void SdfTextRenderer::destroy() {
+    glyphTable.destroy();
+    ring.destroy();
+    instances = nullptr;
+    count = 0;
+}
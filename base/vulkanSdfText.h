@@ -0,0 +1,117 @@
+/*
+* Instanced signed distance field text rendering
+*
+* This code is licensed under the MIT license (MIT) (http://opensource.org/licenses/MIT)
+*/
+
+#pragma once
+
+#include <stdint.h>
+#include <array>
+#include <string>
+
+#include "vulkanContext.hpp"
+
+namespace vkx {
+
+    // Glyph metrics of an AngelCode .fnt file, in texels of the font texture
+    struct SdfGlyph {
+        uint16_t x{ 0 }, y{ 0 };
+        uint16_t width{ 0 }, height{ 0 };
+        int16_t xoffset{ 0 }, yoffset{ 0 };
+        int16_t xadvance{ 0 };
+        uint16_t page{ 0 };
+    };
+
+    // Glyph table of a bitmap font, see http://www.angelcode.com/products/bmfont/doc/file_format.html
+    // Only the text format is supported, kerning pairs are ignored.
+    class SdfFont {
+    public:
+        uint32_t lineHeight{ 0 };
+        uint32_t base{ 0 };
+        uint32_t scaleW{ 1 };
+        uint32_t scaleH{ 1 };
+        // Indexed by character code, glyphs missing from the file are empty
+        std::array<SdfGlyph, 256> glyphs;
+
+        // Reads the file from the mounted asset pack or from disk
+        void load(const std::string& filename);
+        // Parses the file in place, without copying lines or tokens
+        void parse(const char* text, size_t size);
+
+        const SdfGlyph& glyph(char c) const { return glyphs[(uint8_t)c]; }
+        // Sum of the advances, in texels
+        float width(const std::string& text) const;
+    };
+
+    // Per glyph instance record, the quad is expanded in the vertex shader from the glyph table
+    struct SdfGlyphInstance {
+        // Pen position of the glyph in text space, y points down like in the font file
+        float x, y;
+        // Size of one font texel in text space
+        float scale;
+        // Character code
+        uint32_t glyph;
+    };
+
+    // Draws any number of strings with a single instanced draw.
+    //
+    // The glyph instances are written to a persistently mapped ring with one region per
+    // recorded command buffer (usually one per swap chain image).  Each region starts with
+    // its indirect draw command, so prebuilt command buffers draw whatever text was written
+    // to their region before they are submitted: begin(region), add() strings, end().  A
+    // region may be rewritten once the command buffer drawing it has completed, which is
+    // also when the command buffer itself may be reused.
+    //
+    // The vertex shader (shaders/distancefieldfonts/text.vert) reads the instance record as
+    // vertex attributes of binding 0 and the glyph table from a uniform buffer, each glyph
+    // is a 4 vertex triangle strip without an index buffer.
+    class SdfTextRenderer {
+    public:
+        SdfTextRenderer(const Context& context) : context(context) {}
+        ~SdfTextRenderer() { destroy(); }
+
+        // Allocates regions of capacity glyphs each and uploads the glyph table of the font,
+        // the font has to outlive the renderer
+        void create(const SdfFont& font, uint32_t capacity, uint32_t regions);
+
+        // Glyph table for the vertex shader, a uniform buffer of 256 uv and quad rectangles
+        const vk::DescriptorBufferInfo& glyphTableDescriptor() const { return glyphTable.descriptor; }
+        const vk::PipelineVertexInputStateCreateInfo& inputState() const { return vertexInputState; }
+        uint32_t capacity() const { return regionCapacity; }
+
+        void begin(uint32_t region);
+        // Lays out the text starting at the pen position, returns the number of glyphs written.
+        // Strings that don't fit into the region anymore are cut off.
+        uint32_t add(const char* text, size_t length, float x, float y, float scale);
+        uint32_t add(const std::string& text, float x, float y, float scale) { return add(text.data(), text.size(), x, y, scale); }
+        // Reserves count instances for the caller to write directly, nullptr if they don't fit
+        SdfGlyphInstance* reserve(uint32_t count);
+        // Publishes the glyph count of the region to its indirect draw command
+        void end();
+        uint32_t glyphCount() const { return count; }
+
+        // Binds the instances of the region and draws them, the pipeline and descriptor
+        // sets have to be bound already
+        void draw(const vk::CommandBuffer& cmdBuffer, uint32_t region) const;
+
+        void destroy();
+
+    private:
+        vk::DeviceSize regionOffset(uint32_t region) const;
+
+        const Context& context;
+        const SdfFont* font{ nullptr };
+        CreateBufferResult glyphTable;
+        CreateBufferResult ring;
+        uint32_t regionCapacity{ 0 };
+        uint32_t regionCount{ 0 };
+        uint32_t region{ 0 };
+        uint32_t count{ 0 };
+        SdfGlyphInstance* instances{ nullptr };
+
+        vk::VertexInputBindingDescription bindingDescription;
+        std::array<vk::VertexInputAttributeDescription, 2> attributeDescriptions;
+        vk::PipelineVertexInputStateCreateInfo vertexInputState;
+    };
+}
@@ -130,7 +130,7 @@ void shader::finalizeGlsl() {
 //
 // Compile a given string containing GLSL into SPV for use by VK
 //
-std::vector<uint32_t> shader::glslToSpv(const vk::ShaderStageFlagBits shaderType, const std::string& shaderSource) {
+std::vector<uint32_t> shader::glslToSpv(const vk::ShaderStageFlagBits shaderType, const std::string& shaderSource, const std::string& preamble) {
     std::vector<uint32_t> result;
     TBuiltInResource Resources;
     init_resources(Resources);
@@ -142,6 +142,7 @@ std::vector<uint32_t> shader::glslToSpv(const vk::ShaderStageFlagBits shaderType
     {
         const char *shaderStrings[1] = { shaderSource.c_str() };
         shader->setStrings(shaderStrings, 1);
+        shader->setPreamble(preamble.c_str());
         if (!shader->parse(&Resources, 100, false, messages)) {
             auto log = shader->getInfoLog();
             throw new std::runtime_error(log);
@@ -157,8 +158,8 @@ std::vector<uint32_t> shader::glslToSpv(const vk::ShaderStageFlagBits shaderType
     return result;
 }
 
-vk::ShaderModule shader::glslToShaderModule(const vk::Device& device, const vk::ShaderStageFlagBits shaderType, const std::string& shaderSource) {
-    std::vector<uint32_t> spv = shader::glslToSpv(shaderType, shaderSource);
+vk::ShaderModule shader::glslToShaderModule(const vk::Device& device, const vk::ShaderStageFlagBits shaderType, const std::string& shaderSource, const std::string& preamble) {
+    std::vector<uint32_t> spv = shader::glslToSpv(shaderType, shaderSource, preamble);
     vk::ShaderModuleCreateInfo moduleCreateInfo;
     moduleCreateInfo
         .setCodeSize(spv.size() * sizeof(uint32_t))
@@ -19,7 +19,8 @@ namespace vkx {
         void finalizeGlsl();
         void initDebugReport(const vk::Instance& instance);
 
-        SpvBuffer glslToSpv(vk::ShaderStageFlagBits shaderType, const std::string& shaderSource);
-        vk::ShaderModule glslToShaderModule(const vk::Device& device, const vk::ShaderStageFlagBits shaderType, const std::string& shaderSource);
+        // The preamble is inserted after the #version directive, e.g. to #define shader variants
+        SpvBuffer glslToSpv(vk::ShaderStageFlagBits shaderType, const std::string& shaderSource, const std::string& preamble = "");
+        vk::ShaderModule glslToShaderModule(const vk::Device& device, const vk::ShaderStageFlagBits shaderType, const std::string& shaderSource, const std::string& preamble = "");
     }
 }
@@ -26,6 +26,7 @@
 
 #include <vulkan/vulkan.h>
 #include "vulkanTools.h"
+#include "vulkanDeletionQueue.h"
 
 #ifdef __ANDROID__
 #include "vulkanAndroid.h"
@@ -48,11 +49,28 @@ namespace vkx {
 
         uint32_t imageCount{ 0 };
         std::vector<vk::Image> images;
+        // Images can be copied from (frame capture), set by create() if the surface supports it
+        bool transferSource{ false };
         std::vector<SwapChainBuffer> buffers;
 
         // Index of the deteced graphics and presenting device queue
         uint32_t queueNodeIndex = UINT32_MAX;
 
+        // Renders into offscreen images instead of presenting, set by initHeadless()
+        bool headless{ false };
+        // Number of offscreen images of a headless swap chain
+        uint32_t headlessImageCount{ 2 };
+
+        // Replaces the surface with offscreen images, for rendering without a window.  The images
+        // are kept in the present layout between frames like swap chain images, so the frame loop
+        // and its barriers stay the same.
+        void initHeadless(vk::Format format) {
+            headless = true;
+            colorFormat = format;
+            colorSpace = vk::ColorSpaceKHR::eSrgbNonlinear;
+            queueNodeIndex = context.findQueue(vk::QueueFlagBits::eGraphics);
+        }
+
         // Creates an os specific surface
         // Tries to find a graphics and a present queue
         void initSurface(
@@ -112,8 +130,13 @@ namespace vkx {
             this->context = context;
         }
 
-        // Create the swap chain and get images with given width and height
-        void create(vk::CommandBuffer cmdBuffer, uint32_t *width, uint32_t *height) {
+        // Create the swap chain and get images with given width and height.  The old swap chain
+        // and its views are retired to deletionQueue if given, destroyed right away otherwise.
+        void create(vk::CommandBuffer cmdBuffer, uint32_t *width, uint32_t *height, DeletionQueue* deletionQueue = nullptr) {
+            if (headless) {
+                createHeadless(cmdBuffer, *width, *height, deletionQueue);
+                return;
+            }
             vk::SwapchainKHR oldSwapchain = swapChain;
 
             // Get physical device surface properties and formats
@@ -171,6 +194,10 @@ namespace vkx {
             swapchainCI.imageColorSpace = colorSpace;
             swapchainCI.imageExtent = vk::Extent2D{ swapchainExtent.width, swapchainExtent.height };
             swapchainCI.imageUsage = vk::ImageUsageFlagBits::eColorAttachment;
+            transferSource = (surfCaps.supportedUsageFlags & vk::ImageUsageFlagBits::eTransferSrc) == vk::ImageUsageFlagBits::eTransferSrc;
+            if (transferSource) {
+                swapchainCI.imageUsage |= vk::ImageUsageFlagBits::eTransferSrc;
+            }
             swapchainCI.preTransform = preTransform;
             swapchainCI.imageArrayLayers = 1;
             swapchainCI.imageSharingMode = vk::SharingMode::eExclusive;
@@ -186,7 +213,12 @@ namespace vkx {
 
             // If an existing sawp chain is re-created, destroy the old swap chain
             // This also cleans up all the presentable images
-            if (oldSwapchain) {
+            if (oldSwapchain && deletionQueue) {
+                for (uint32_t i = 0; i < imageCount; i++) {
+                    deletionQueue->retire(buffers[i].view);
+                }
+                deletionQueue->retire(oldSwapchain);
+            } else if (oldSwapchain) {
                 for (uint32_t i = 0; i < imageCount; i++) {
                     context.device.destroyImageView(buffers[i].view);
                 }
@@ -214,6 +246,16 @@ namespace vkx {
 
         // Acquires the next image in the swap chain
         uint32_t acquireNextImage(vk::Semaphore presentCompleteSemaphore) {
+            if (headless) {
+                // The image is free once the frames before it completed, the semaphore only has
+                // to be signaled for the submission waiting on it
+                vk::SubmitInfo submitInfo;
+                submitInfo.signalSemaphoreCount = 1;
+                submitInfo.pSignalSemaphores = &presentCompleteSemaphore;
+                context.queue.submit(submitInfo, vk::Fence());
+                headlessImage = (headlessImage + 1) % imageCount;
+                return headlessImage;
+            }
             auto resultValue = context.device.acquireNextImageKHR(swapChain, UINT64_MAX, presentCompleteSemaphore, vk::Fence());
             vk::Result result = resultValue.result;
             if (result != vk::Result::eSuccess) {
@@ -227,6 +269,18 @@ namespace vkx {
 
         // Present the current image to the queue
         vk::Result queuePresent(vk::Queue queue, uint32_t currentBuffer, vk::Semaphore waitSemaphore) {
+            if (headless) {
+                // Consume the semaphore so it can be signaled again by the next frame
+                if (waitSemaphore) {
+                    vk::PipelineStageFlags waitStage = vk::PipelineStageFlagBits::eBottomOfPipe;
+                    vk::SubmitInfo submitInfo;
+                    submitInfo.waitSemaphoreCount = 1;
+                    submitInfo.pWaitSemaphores = &waitSemaphore;
+                    submitInfo.pWaitDstStageMask = &waitStage;
+                    queue.submit(submitInfo, vk::Fence());
+                }
+                return vk::Result::eSuccess;
+            }
             vk::PresentInfoKHR presentInfo;
             presentInfo.swapchainCount = 1;
             presentInfo.pSwapchains = &swapChain;
@@ -241,6 +295,13 @@ namespace vkx {
 
         // Free all Vulkan resources used by the swap chain
         void cleanup() {
+            if (headless) {
+                for (auto& image : headlessImages) {
+                    image.destroy();
+                }
+                headlessImages.clear();
+                return;
+            }
             for (uint32_t i = 0; i < imageCount; i++) {
                 context.device.destroyImageView(buffers[i].view);
             }
@@ -248,6 +309,56 @@ namespace vkx {
             context.instance.destroySurfaceKHR(surface);
         }
 
+    private:
+        std::vector<CreateImageResult> headlessImages;
+        uint32_t headlessImage{ 0 };
+
+        void createHeadless(vk::CommandBuffer cmdBuffer, uint32_t width, uint32_t height, DeletionQueue* deletionQueue) {
+            for (auto& image : headlessImages) {
+                if (deletionQueue) {
+                    deletionQueue->retire(image);
+                } else {
+                    image.destroy();
+                }
+            }
+            headlessImages.resize(headlessImageCount);
+
+            vk::ImageCreateInfo imageCreateInfo;
+            imageCreateInfo.imageType = vk::ImageType::e2D;
+            imageCreateInfo.format = colorFormat;
+            imageCreateInfo.extent = vk::Extent3D{ width, height, 1 };
+            imageCreateInfo.mipLevels = 1;
+            imageCreateInfo.arrayLayers = 1;
+            imageCreateInfo.usage = vk::ImageUsageFlagBits::eColorAttachment | vk::ImageUsageFlagBits::eTransferSrc;
+            transferSource = true;
+
+            vk::ImageViewCreateInfo colorAttachmentView;
+            colorAttachmentView.format = colorFormat;
+            colorAttachmentView.subresourceRange = { vk::ImageAspectFlagBits::eColor, 0, 1, 0, 1 };
+            colorAttachmentView.viewType = vk::ImageViewType::e2D;
+
+            // The frame loop expects acquired images in the present layout
+            vk::ImageMemoryBarrier barrier;
+            barrier.oldLayout = vk::ImageLayout::eUndefined;
+            barrier.newLayout = vk::ImageLayout::ePresentSrcKHR;
+            barrier.subresourceRange = colorAttachmentView.subresourceRange;
+
+            imageCount = headlessImageCount;
+            images.resize(imageCount);
+            buffers.resize(imageCount);
+            for (uint32_t i = 0; i < imageCount; i++) {
+                CreateImageResult& image = headlessImages[i];
+                image = context.createImage(imageCreateInfo, vk::MemoryPropertyFlagBits::eDeviceLocal);
+                image.view = context.device.createImageView(colorAttachmentView.setImage(image.image));
+                barrier.image = image.image;
+                cmdBuffer.pipelineBarrier(vk::PipelineStageFlagBits::eTopOfPipe, vk::PipelineStageFlagBits::eBottomOfPipe, vk::DependencyFlags(), nullptr, nullptr, barrier);
+                images[i] = image.image;
+                buffers[i].image = image.image;
+                buffers[i].view = image.view;
+            }
+            headlessImage = imageCount - 1;
+        }
+
     };
 }
 
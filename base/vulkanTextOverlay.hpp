@@ -20,6 +20,7 @@
 #include <vulkan/vulkan.h>
 #include "vulkanTools.h"
 #include "vulkanDebug.h"
+#include "vulkanDeletionQueue.h"
 
 #include "../external/stb/stb_font_consolas_24_latin1.inl"
 
@@ -522,8 +523,13 @@ namespace vkx {
             queue.submit(submitInfo, VK_NULL_HANDLE);
         }
 
-        void reallocateCommandBuffers() {
-            context.device.freeCommandBuffers(context.getCommandPool(), cmdBuffers);
+        // The old command buffers are retired to deletionQueue if given, freed right away otherwise
+        void reallocateCommandBuffers(DeletionQueue* deletionQueue = nullptr) {
+            if (deletionQueue) {
+                deletionQueue->retire(context.getCommandPool(), cmdBuffers);
+            } else {
+                context.device.freeCommandBuffers(context.getCommandPool(), cmdBuffers);
+            }
             vk::CommandBufferAllocateInfo cmdBufAllocateInfo;
             cmdBufAllocateInfo.commandPool = context.getCommandPool();
             cmdBufAllocateInfo.commandBufferCount = frameBuffers.size();
@@ -12,6 +12,8 @@
 #pragma warning(disable: 4996 4244 4267)
 #include <gli/gli.hpp>
 #include "vulkanTools.h"
+#include "vulkanAssetPack.h"
+#include "vulkanMipmaps.h"
 
 #if defined(__ANDROID__)
 #include <android/asset_manager.h>
@@ -52,6 +54,7 @@ namespace vkx {
                 image = vk::Image();
             }
             if (memory) {
+                ResourceRegistry::get().remove(memory);
                 device.freeMemory(memory);
                 memory = vk::DeviceMemory();
             }
@@ -63,6 +66,155 @@ namespace vkx {
         Context context;
         vk::CommandBuffer cmdBuffer;
 
+        // Textures show up with their file name in the resource registry and debuggers
+        Texture named(const Texture& texture, const std::string& filename) const {
+            context.nameResource(texture.image, texture.memory, ResourceCategory::Texture, filename);
+            return texture;
+        }
+
+        const pack::Entry* findPacked(const std::string& filename) const {
+            AssetPack* pack = AssetPack::mounted();
+            return pack ? pack->find(filename) : nullptr;
+        }
+
+        // Loads a KTX file from the mounted asset pack.  The image data is copied once, straight
+        // from the mapping into the staging buffer, instead of being read into a gli texture first.
+        Texture loadPacked(const pack::Entry& entry, vk::Format format, vk::ImageViewType viewType, uint32_t maxLevels, vk::ImageUsageFlags imageUsageFlags) {
+            AssetPack* pack = AssetPack::mounted();
+            std::vector<uint8_t> decompressed;
+            const uint8_t* data = pack->map(entry);
+            if (!data) {
+                decompressed = pack->read(entry);
+                data = decompressed.data();
+            }
+            KtxView ktx(data, entry.size);
+
+            Texture texture;
+            texture.extent.width = ktx.width;
+            texture.extent.height = ktx.height;
+            texture.mipLevels = std::min(ktx.levels, maxLevels);
+            texture.layerCount = ktx.layers;
+            uint32_t arrayLayers = ktx.layers * ktx.faces;
+
+            uint32_t storedLevels = texture.mipLevels;
+            uint32_t fullLevels = mipLevelCount(texture.extent.width, texture.extent.height);
+            MipGenerator::Method mipMethod = MipGenerator::Method::None;
+            if (generateMipmaps && viewType == vk::ImageViewType::e2D && storedLevels < fullLevels) {
+                mipMethod = mipGenerator.method(format);
+                if (mipMethod != MipGenerator::Method::None) {
+                    texture.mipLevels = fullLevels;
+                }
+            }
+
+            // One copy region per level, layer and face, buffer offsets are kept aligned to the texel block size
+            std::vector<vk::BufferImageCopy> bufferCopyRegions;
+            vk::DeviceSize stagingSize = 0;
+            for (uint32_t level = 0; level < storedLevels; level++) {
+                for (uint32_t layer = 0; layer < arrayLayers; layer++) {
+                    vk::BufferImageCopy bufferCopyRegion;
+                    bufferCopyRegion.imageSubresource.aspectMask = vk::ImageAspectFlagBits::eColor;
+                    bufferCopyRegion.imageSubresource.mipLevel = level;
+                    bufferCopyRegion.imageSubresource.baseArrayLayer = layer;
+                    bufferCopyRegion.imageSubresource.layerCount = 1;
+                    bufferCopyRegion.imageExtent.width = std::max(ktx.width >> level, 1u);
+                    bufferCopyRegion.imageExtent.height = std::max(ktx.height >> level, 1u);
+                    bufferCopyRegion.imageExtent.depth = 1;
+                    bufferCopyRegion.bufferOffset = (stagingSize + 15) & ~(vk::DeviceSize)15;
+                    bufferCopyRegions.push_back(bufferCopyRegion);
+                    stagingSize = bufferCopyRegion.bufferOffset + ktx.imageSize(level);
+                }
+            }
+
+            auto staging = context.createBuffer(vk::BufferUsageFlagBits::eTransferSrc, vk::MemoryPropertyFlagBits::eHostVisible | vk::MemoryPropertyFlagBits::eHostCoherent, stagingSize);
+            uint8_t* stagingData = staging.map<uint8_t>();
+            for (const auto& region : bufferCopyRegions) {
+                uint32_t level = region.imageSubresource.mipLevel;
+                uint32_t layer = region.imageSubresource.baseArrayLayer;
+                memcpy(stagingData + region.bufferOffset, ktx.image(level, layer / ktx.faces, layer % ktx.faces), ktx.imageSize(level));
+            }
+            staging.unmap();
+
+            vk::ImageCreateInfo imageCreateInfo;
+            imageCreateInfo.imageType = vk::ImageType::e2D;
+            imageCreateInfo.format = format;
+            imageCreateInfo.mipLevels = texture.mipLevels;
+            imageCreateInfo.arrayLayers = arrayLayers;
+            imageCreateInfo.samples = vk::SampleCountFlagBits::e1;
+            imageCreateInfo.tiling = vk::ImageTiling::eOptimal;
+            imageCreateInfo.usage = vk::ImageUsageFlagBits::eTransferDst | imageUsageFlags | mipGenerator.imageUsage(mipMethod);
+            imageCreateInfo.sharingMode = vk::SharingMode::eExclusive;
+            imageCreateInfo.initialLayout = vk::ImageLayout::eUndefined;
+            imageCreateInfo.extent = texture.extent;
+            imageCreateInfo.flags = mipGenerator.imageFlags(mipMethod, format);
+            if (ktx.faces == 6) {
+                imageCreateInfo.flags |= vk::ImageCreateFlagBits::eCubeCompatible;
+            }
+            texture = context.createImage(imageCreateInfo, vk::MemoryPropertyFlagBits::eDeviceLocal);
+
+            vk::ImageSubresourceRange subresourceRange;
+            subresourceRange.aspectMask = vk::ImageAspectFlagBits::eColor;
+            subresourceRange.levelCount = texture.mipLevels;
+            subresourceRange.layerCount = arrayLayers;
+
+            vk::CommandBufferBeginInfo cmdBufInfo;
+            cmdBuffer.begin(cmdBufInfo);
+            setImageLayout(
+                cmdBuffer,
+                texture.image,
+                vk::ImageAspectFlagBits::eColor,
+                vk::ImageLayout::eUndefined,
+                vk::ImageLayout::eTransferDstOptimal,
+                subresourceRange);
+            cmdBuffer.copyBufferToImage(staging.buffer, texture.image, vk::ImageLayout::eTransferDstOptimal, bufferCopyRegions);
+            texture.imageLayout = vk::ImageLayout::eShaderReadOnlyOptimal;
+            if (storedLevels < texture.mipLevels) {
+                mipGenerator.generate(cmdBuffer, texture.image, format, { texture.extent.width, texture.extent.height }, storedLevels, texture.mipLevels);
+            } else {
+                setImageLayout(
+                    cmdBuffer,
+                    texture.image,
+                    vk::ImageAspectFlagBits::eColor,
+                    vk::ImageLayout::eTransferDstOptimal,
+                    texture.imageLayout,
+                    subresourceRange);
+            }
+            cmdBuffer.end();
+
+            vk::Fence copyFence = context.device.createFence(vk::FenceCreateInfo());
+            vk::SubmitInfo submitInfo;
+            submitInfo.commandBufferCount = 1;
+            submitInfo.pCommandBuffers = &cmdBuffer;
+            context.queue.submit(submitInfo, copyFence);
+            context.device.waitForFences(copyFence, VK_TRUE, DEFAULT_FENCE_TIMEOUT);
+            context.device.destroyFence(copyFence);
+            mipGenerator.releaseTransient();
+            staging.destroy();
+
+            // Same sampler settings as the non packed loaders
+            vk::SamplerCreateInfo sampler;
+            sampler.magFilter = vk::Filter::eLinear;
+            sampler.minFilter = vk::Filter::eLinear;
+            sampler.mipmapMode = vk::SamplerMipmapMode::eLinear;
+            if (viewType != vk::ImageViewType::e2D) {
+                sampler.addressModeU = vk::SamplerAddressMode::eClampToEdge;
+                sampler.addressModeV = sampler.addressModeU;
+                sampler.addressModeW = sampler.addressModeU;
+            }
+            sampler.maxLod = (float)texture.mipLevels;
+            sampler.maxAnisotropy = 8;
+            sampler.anisotropyEnable = viewType == vk::ImageViewType::e2D;
+            sampler.borderColor = vk::BorderColor::eFloatOpaqueWhite;
+            texture.sampler = context.device.createSampler(sampler);
+
+            vk::ImageViewCreateInfo view;
+            view.viewType = viewType;
+            view.format = format;
+            view.subresourceRange = { vk::ImageAspectFlagBits::eColor, 0, texture.mipLevels, 0, arrayLayers };
+            view.image = texture.image;
+            texture.view = context.device.createImageView(view);
+            return texture;
+        }
+
     public:
 
         TextureLoader(const Context& context) {
@@ -86,8 +238,17 @@ namespace vkx {
         AAssetManager* assetManager = nullptr;
 #endif
 
+        // Complete the mip chain of 2D textures stored with fewer levels, see MipGenerator
+        bool generateMipmaps{ true };
+        MipGenerator mipGenerator{ context };
+
         // Load a 2D texture
         Texture loadTexture(const std::string& filename, vk::Format format, bool forceLinear = false, vk::ImageUsageFlags imageUsageFlags = vk::ImageUsageFlagBits::eSampled) {
+            const pack::Entry* packed = forceLinear ? nullptr : findPacked(filename);
+            if (packed) {
+                return named(loadPacked(*packed, format, vk::ImageViewType::e2D, ~0U, imageUsageFlags), filename);
+            }
+
 #if defined(__ANDROID__)
             assert(assetManager != nullptr);
 
@@ -140,9 +301,27 @@ namespace vkx {
              imageCreateInfo.initialLayout = vk::ImageLayout::ePreinitialized;
 
             if (useStaging) {
+                // Levels missing from the file are generated on the GPU if the format allows it,
+                // 8 bit RGBA textures without any mip levels fall back to generating them on the CPU
+                uint32_t storedLevels = texture.mipLevels;
+                uint32_t fullLevels = mipLevelCount(texture.extent.width, texture.extent.height);
+                MipGenerator::Method mipMethod = MipGenerator::Method::None;
+                std::vector<uint8_t> generatedLevels;
+                if (generateMipmaps && storedLevels < fullLevels) {
+                    mipMethod = mipGenerator.method(format);
+                    if (mipMethod != MipGenerator::Method::None) {
+                        texture.mipLevels = fullLevels;
+                    } else if (storedLevels == 1 && (format == vk::Format::eR8G8B8A8Unorm || format == vk::Format::eR8G8B8A8Srgb)) {
+                        generatedLevels = mipmap::generateRGBA8((const uint8_t*)tex2D[0].data(), texture.extent.width, texture.extent.height, format == vk::Format::eR8G8B8A8Srgb);
+                        texture.mipLevels = storedLevels = fullLevels;
+                    }
+                }
+
                 // Create a host-visible staging buffer that contains the raw image data
                 // Copy texture data into staging buffer
-                auto staging = context.createBuffer(vk::BufferUsageFlagBits::eTransferSrc, tex2D);
+                auto staging = generatedLevels.empty() ?
+                    context.createBuffer(vk::BufferUsageFlagBits::eTransferSrc, tex2D) :
+                    context.createBuffer(vk::BufferUsageFlagBits::eTransferSrc, generatedLevels);
 
                 // Setup buffer copy regions for each mip level
                 std::vector<vk::BufferImageCopy> bufferCopyRegions;
@@ -153,17 +332,18 @@ namespace vkx {
                 bufferCopyRegion.imageSubresource.layerCount = 1;
                 bufferCopyRegion.imageExtent.depth = 1;
 
-                for (uint32_t i = 0; i < texture.mipLevels; i++) {
-                    bufferCopyRegion.imageExtent.width = tex2D[i].dimensions().x;
-                    bufferCopyRegion.imageExtent.height = tex2D[i].dimensions().y;
+                for (uint32_t i = 0; i < storedLevels; i++) {
+                    bufferCopyRegion.imageExtent.width = std::max(texture.extent.width >> i, 1u);
+                    bufferCopyRegion.imageExtent.height = std::max(texture.extent.height >> i, 1u);
                     bufferCopyRegion.imageSubresource.mipLevel = i;
                     bufferCopyRegion.bufferOffset = offset;
                     bufferCopyRegions.push_back(bufferCopyRegion);
-                    offset += tex2D[i].size();
+                    offset += generatedLevels.empty() ? (uint32_t)tex2D[i].size() : bufferCopyRegion.imageExtent.width * bufferCopyRegion.imageExtent.height * 4;
                 }
 
                 // Create optimal tiled target image
-                imageCreateInfo.usage = vk::ImageUsageFlagBits::eTransferDst | imageUsageFlags;
+                imageCreateInfo.usage = vk::ImageUsageFlagBits::eTransferDst | imageUsageFlags | mipGenerator.imageUsage(mipMethod);
+                imageCreateInfo.flags = mipGenerator.imageFlags(mipMethod, format);
                 imageCreateInfo.mipLevels = texture.mipLevels;
 
                 texture = context.createImage(imageCreateInfo, vk::MemoryPropertyFlagBits::eDeviceLocal);
@@ -185,14 +365,19 @@ namespace vkx {
 
                 // Copy mip levels from staging buffer
                 cmdBuffer.copyBufferToImage(staging.buffer, texture.image, vk::ImageLayout::eTransferDstOptimal, bufferCopyRegions);
-                // Change texture image layout to shader read after all mip levels have been copied
-                setImageLayout(
-                    cmdBuffer,
-                    texture.image,
-                    vk::ImageAspectFlagBits::eColor,
-                    vk::ImageLayout::eTransferDstOptimal,
-                    texture.imageLayout,
-                    subresourceRange);
+                if (storedLevels < texture.mipLevels) {
+                    // Also changes all levels to shader read
+                    mipGenerator.generate(cmdBuffer, texture.image, format, { texture.extent.width, texture.extent.height }, storedLevels, texture.mipLevels);
+                } else {
+                    // Change texture image layout to shader read after all mip levels have been copied
+                    setImageLayout(
+                        cmdBuffer,
+                        texture.image,
+                        vk::ImageAspectFlagBits::eColor,
+                        vk::ImageLayout::eTransferDstOptimal,
+                        texture.imageLayout,
+                        subresourceRange);
+                }
 
                 // Submit command buffer containing copy and image layout commands
                 cmdBuffer.end();
@@ -208,6 +393,7 @@ namespace vkx {
                 context.queue.submit(submitInfo, copyFence);
                 context.device.waitForFences(copyFence, VK_TRUE, DEFAULT_FENCE_TIMEOUT);
                 context.device.destroyFence(copyFence);
+                mipGenerator.releaseTransient();
                 staging.destroy();
 
             } else {
@@ -290,11 +476,15 @@ namespace vkx {
                 view.image = texture.image;
                 texture.view = context.device.createImageView(view);
             }
-            return texture;
+            return named(texture, filename);
         }
 
         // Load a cubemap texture (single file)
         Texture loadCubemap(const std::string& filename, vk::Format format) {
+            if (const pack::Entry* packed = findPacked(filename)) {
+                return named(loadPacked(*packed, format, vk::ImageViewType::eCube, 1, vk::ImageUsageFlagBits::eSampled), filename);
+            }
+
 #if defined(__ANDROID__)
             assert(assetManager != nullptr);
 
@@ -423,11 +613,15 @@ namespace vkx {
             texture.view = context.device.createImageView(view);
             // Clean up staging resources
             staging.destroy();
-            return texture;
+            return named(texture, filename);
         }
 
         // Load an array texture (single file)
         Texture loadTextureArray(const std::string& filename, vk::Format format) {
+            if (const pack::Entry* packed = findPacked(filename)) {
+                return named(loadPacked(*packed, format, vk::ImageViewType::e2DArray, 1, vk::ImageUsageFlagBits::eSampled), filename);
+            }
+
 #if defined(__ANDROID__)
             assert(assetManager != nullptr);
 
@@ -598,7 +792,7 @@ namespace vkx {
 
             // Clean up staging resources
             staging.destroy();
-            return texture;
+            return named(texture, filename);
         }
     };
 }
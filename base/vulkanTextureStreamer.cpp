@@ -0,0 +1,432 @@
+/*
+* Progressive texture streaming
+*
+* This code is licensed under the MIT license (MIT) (http://opensource.org/licenses/MIT)
+*/
+
+#include "vulkanTextureStreamer.h"
+
+#include <algorithm>
+#include <assert.h>
+#include <fstream>
+#include <stdexcept>
+#include <string.h>
+
+#include "vulkanAssetPack.h"
+
+namespace vkx {
+
+namespace {
+    // Maximum number of textures read by the loader thread at the same time
+    const uint32_t MAX_LOADS_IN_FLIGHT = 2;
+
+    // Reads single levels of a 2D KTX file without loading the whole file.  Packed files are
+    // read from the pack mapping, loose files are only seeked through.
+    class KtxLevelReader {
+    public:
+        uint32_t width{ 0 };
+        uint32_t height{ 0 };
+        uint32_t levels{ 0 };
+        std::vector<vk::DeviceSize> sizes;
+
+        KtxLevelReader(const std::string& filename) {
+            AssetPack* pack = AssetPack::mounted();
+            const pack::Entry* entry = pack ? pack->find(filename) : nullptr;
+            if (entry) {
+                data = pack->map(*entry);
+                if (!data) {
+                    decompressed = pack->read(*entry);
+                    data = decompressed.data();
+                }
+                size = entry->size;
+            } else {
+                file.open(filename, std::ios::binary);
+                if (!file.is_open()) {
+                    throw std::runtime_error("Could not open texture " + filename);
+                }
+            }
+
+            static const uint8_t identifier[12] = { 0xAB, 0x4B, 0x54, 0x58, 0x20, 0x31, 0x31, 0xBB, 0x0D, 0x0A, 0x1A, 0x0A };
+            uint8_t headerData[sizeof(identifier) + 13 * sizeof(uint32_t)];
+            read(0, sizeof(headerData), headerData);
+            if (memcmp(headerData, identifier, sizeof(identifier)) != 0) {
+                throw std::runtime_error("Not a KTX file: " + filename);
+            }
+            const uint32_t* header = (const uint32_t*)(headerData + sizeof(identifier));
+            if (header[0] != 0x04030201) {
+                throw std::runtime_error("Big endian KTX files are not supported");
+            }
+            if (header[8] > 1 || header[9] > 0 || header[10] != 1) {
+                throw std::runtime_error("Only 2D textures can be streamed: " + filename);
+            }
+            width = header[6];
+            height = std::max(header[7], 1u);
+            levels = std::max(header[11], 1u);
+
+            uint64_t offset = sizeof(headerData) + header[12];
+            for (uint32_t level = 0; level < levels; ++level) {
+                uint32_t imageSize;
+                read(offset, sizeof(imageSize), &imageSize);
+                offsets.push_back(offset + sizeof(imageSize));
+                sizes.push_back(imageSize);
+                offset += sizeof(imageSize) + ((imageSize + 3) & ~3u);
+            }
+        }
+
+        // Reads the levels [firstLevel, lastLevel) into result
+        void read(uint32_t firstLevel, uint32_t lastLevel, TextureStreamer::Levels& result) {
+            vk::DeviceSize total = 0;
+            result.offsets.clear();
+            for (uint32_t level = firstLevel; level < lastLevel; ++level) {
+                total = (total + 15) & ~(vk::DeviceSize)15;
+                result.offsets.push_back(total);
+                total += sizes[level];
+            }
+            result.data.resize((size_t)total);
+            for (uint32_t level = firstLevel; level < lastLevel; ++level) {
+                read(offsets[level], (size_t)sizes[level], result.data.data() + result.offsets[level - firstLevel]);
+            }
+            result.width = width;
+            result.height = height;
+            result.levels = levels;
+            result.firstLevel = firstLevel;
+            result.lastLevel = lastLevel;
+        }
+
+    private:
+        void read(uint64_t offset, size_t count, void* dst) {
+            if (data) {
+                if (offset + count > size) {
+                    throw std::runtime_error("Truncated KTX file");
+                }
+                memcpy(dst, data + offset, count);
+                return;
+            }
+            file.seekg((std::streamoff)offset);
+            file.read((char*)dst, count);
+            if (!file) {
+                throw std::runtime_error("Truncated KTX file");
+            }
+        }
+
+        const uint8_t* data{ nullptr };
+        uint64_t size{ 0 };
+        std::vector<uint8_t> decompressed;
+        std::ifstream file;
+        std::vector<uint64_t> offsets;
+    };
+}
+
+TextureStreamer::TextureStreamer(const Context& context) : context(context) {
+    vk::CommandBufferAllocateInfo cmdBufInfo;
+    cmdBufInfo.commandPool = context.getCommandPool();
+    cmdBufInfo.level = vk::CommandBufferLevel::ePrimary;
+    cmdBufInfo.commandBufferCount = 1;
+    cmdBuffer = context.device.allocateCommandBuffers(cmdBufInfo)[0];
+}
+
+TextureStreamer::~TextureStreamer() {
+    destroy();
+}
+
+TextureStreamer::Handle TextureStreamer::load(const std::string& filename, vk::Format format) {
+    KtxLevelReader reader(filename);
+
+    Entry entry;
+    entry.filename = filename;
+    entry.format = format;
+    entry.width = reader.width;
+    entry.height = reader.height;
+    entry.levels = reader.levels;
+    entry.levelSizes = reader.sizes;
+    // Nothing resident yet
+    entry.residentLevel = entry.levels;
+    entry.tailLevel = 0;
+    while (entry.tailLevel + 1 < entry.levels && std::max(entry.width >> entry.tailLevel, entry.height >> entry.tailLevel) > tailSize) {
+        ++entry.tailLevel;
+    }
+    entry.requestedLevel = entry.tailLevel;
+
+    Handle handle = (Handle)entries.size();
+    Levels levels;
+    reader.read(entry.tailLevel, entry.levels, levels);
+    levels.handle = handle;
+    setResidentLevel(entry, entry.tailLevel, &levels);
+    entries.push_back(std::move(entry));
+    return handle;
+}
+
+void TextureStreamer::requestSize(Handle handle, float pixels) {
+    Entry& entry = entries[handle];
+    // Highest level that still has at least as many texels as the texture covers pixels
+    uint32_t size = std::max(entry.width, entry.height);
+    uint32_t level = 0;
+    while (level < entry.tailLevel && (float)(size >> (level + 1)) >= pixels) {
+        ++level;
+    }
+    entry.requestedLevel = level;
+    entry.requestedPixels = pixels;
+    entry.lastRequested = frame;
+}
+
+bool TextureStreamer::update() {
+    ++frame;
+    bool changed = false;
+
+    // Upload what the loader has read so far
+    std::vector<Levels> arrived;
+    {
+        std::unique_lock<std::mutex> lock(loadedMutex);
+        arrived.swap(loaded);
+    }
+    for (const auto& levels : arrived) {
+        Entry& entry = entries[levels.handle];
+        entry.loading = false;
+        --loadsInFlight;
+        // Failed reads and levels no longer adjacent to the resident ones are dropped, they
+        // are requested again by the next frames
+        if (levels.data.empty() || levels.lastLevel < entry.residentLevel) {
+            continue;
+        }
+        // Levels no longer requested since the load started are skipped, as are the levels that
+        // don't fit into the budget
+        uint32_t firstLevel = std::max(levels.firstLevel, entry.requestedLevel);
+        vk::DeviceSize residentSize = imageSize(entry, entry.residentLevel);
+        while (firstLevel < entry.residentLevel && !makeRoom(imageSize(entry, firstLevel) - residentSize, levels.handle, changed)) {
+            ++firstLevel;
+        }
+        if (firstLevel < entry.residentLevel) {
+            setResidentLevel(entry, firstLevel, &levels);
+            ++uploads;
+            changed = true;
+        }
+    }
+
+    // Start new loads, textures covering the most pixels on screen first
+    std::vector<Handle> candidates;
+    for (Handle handle = 0; handle < entries.size(); ++handle) {
+        const Entry& entry = entries[handle];
+        if (!entry.loading && entry.requestedLevel < entry.residentLevel) {
+            candidates.push_back(handle);
+        }
+    }
+    std::sort(candidates.begin(), candidates.end(), [&](Handle a, Handle b) {
+        return entries[a].requestedPixels > entries[b].requestedPixels;
+    });
+    for (Handle handle : candidates) {
+        if (loadsInFlight >= MAX_LOADS_IN_FLIGHT) {
+            break;
+        }
+        Entry& entry = entries[handle];
+        entry.loading = true;
+        ++loadsInFlight;
+        std::string filename = entry.filename;
+        uint32_t firstLevel = entry.requestedLevel;
+        uint32_t lastLevel = entry.residentLevel;
+        loader.addJob([=] {
+            Levels levels;
+            try {
+                KtxLevelReader reader(filename);
+                reader.read(firstLevel, lastLevel, levels);
+            } catch (const std::exception&) {
+                levels.data.clear();
+            }
+            levels.handle = handle;
+            std::unique_lock<std::mutex> lock(loadedMutex);
+            loaded.push_back(std::move(levels));
+        });
+    }
+
+    return changed;
+}
+
+vk::DeviceSize TextureStreamer::residentMemory() const {
+    vk::DeviceSize result = 0;
+    for (const auto& entry : entries) {
+        result += entry.memorySize;
+    }
+    return result;
+}
+
+vk::DeviceSize TextureStreamer::imageSize(const Entry& entry, uint32_t residentLevel) const {
+    vk::DeviceSize result = 0;
+    for (uint32_t level = residentLevel; level < entry.levels; ++level) {
+        result += entry.levelSizes[level];
+    }
+    return result;
+}
+
+bool TextureStreamer::makeRoom(vk::DeviceSize size, Handle keep, bool& changed) {
+    while (residentMemory() + size > budget) {
+        // Textures with more levels resident than requested go first, then the least recently
+        // requested ones.  Mip tails and textures being loaded are never touched.
+        Entry* victim = nullptr;
+        for (Handle handle = 0; handle < entries.size(); ++handle) {
+            Entry& entry = entries[handle];
+            if (handle == keep || entry.loading || entry.residentLevel >= entry.tailLevel) {
+                continue;
+            }
+            if (!victim) {
+                victim = &entry;
+                continue;
+            }
+            bool excess = entry.requestedLevel > entry.residentLevel;
+            bool victimExcess = victim->requestedLevel > victim->residentLevel;
+            if (excess != victimExcess ? excess : entry.lastRequested < victim->lastRequested) {
+                victim = &entry;
+            }
+        }
+        if (!victim) {
+            return false;
+        }
+        setResidentLevel(*victim, victim->residentLevel + 1, nullptr);
+        ++evictions;
+        changed = true;
+    }
+    return true;
+}
+
+void TextureStreamer::setResidentLevel(Entry& entry, uint32_t residentLevel, const Levels* levels) {
+    const uint32_t oldResidentLevel = entry.residentLevel;
+    const uint32_t levelCount = entry.levels - residentLevel;
+
+    // Levels that aren't in the current image come from the staging buffer
+    std::vector<vk::BufferImageCopy> bufferCopyRegions;
+    CreateBufferResult staging;
+    if (residentLevel < oldResidentLevel) {
+        assert(levels && levels->firstLevel <= residentLevel && levels->lastLevel >= oldResidentLevel);
+        const uint8_t* first = levels->data.data() + levels->offsets[residentLevel - levels->firstLevel];
+        vk::DeviceSize stagingSize = 0;
+        for (uint32_t level = residentLevel; level < oldResidentLevel; ++level) {
+            vk::BufferImageCopy bufferCopyRegion;
+            bufferCopyRegion.imageSubresource.aspectMask = vk::ImageAspectFlagBits::eColor;
+            bufferCopyRegion.imageSubresource.mipLevel = level - residentLevel;
+            bufferCopyRegion.imageSubresource.layerCount = 1;
+            bufferCopyRegion.imageExtent.width = std::max(entry.width >> level, 1u);
+            bufferCopyRegion.imageExtent.height = std::max(entry.height >> level, 1u);
+            bufferCopyRegion.imageExtent.depth = 1;
+            // Same relative offsets as in the read levels, they are 16 byte aligned already
+            bufferCopyRegion.bufferOffset = levels->data.data() + levels->offsets[level - levels->firstLevel] - first;
+            bufferCopyRegions.push_back(bufferCopyRegion);
+            stagingSize = bufferCopyRegion.bufferOffset + entry.levelSizes[level];
+        }
+        staging = context.createBuffer(vk::BufferUsageFlagBits::eTransferSrc, vk::MemoryPropertyFlagBits::eHostVisible | vk::MemoryPropertyFlagBits::eHostCoherent, stagingSize, first);
+    }
+
+    vk::ImageCreateInfo imageCreateInfo;
+    imageCreateInfo.imageType = vk::ImageType::e2D;
+    imageCreateInfo.format = entry.format;
+    imageCreateInfo.mipLevels = levelCount;
+    imageCreateInfo.arrayLayers = 1;
+    imageCreateInfo.samples = vk::SampleCountFlagBits::e1;
+    imageCreateInfo.tiling = vk::ImageTiling::eOptimal;
+    // Transfer src to keep the levels when the image is reallocated
+    imageCreateInfo.usage = vk::ImageUsageFlagBits::eTransferDst | vk::ImageUsageFlagBits::eTransferSrc | vk::ImageUsageFlagBits::eSampled;
+    imageCreateInfo.sharingMode = vk::SharingMode::eExclusive;
+    imageCreateInfo.initialLayout = vk::ImageLayout::eUndefined;
+    imageCreateInfo.extent = { std::max(entry.width >> residentLevel, 1u), std::max(entry.height >> residentLevel, 1u), 1 };
+    auto created = context.createImage(imageCreateInfo, vk::MemoryPropertyFlagBits::eDeviceLocal);
+
+    Texture texture;
+    texture = created;
+    texture.extent = imageCreateInfo.extent;
+    texture.mipLevels = levelCount;
+
+    vk::ImageSubresourceRange subresourceRange;
+    subresourceRange.aspectMask = vk::ImageAspectFlagBits::eColor;
+    subresourceRange.levelCount = levelCount;
+    subresourceRange.layerCount = 1;
+
+    vk::CommandBufferBeginInfo cmdBufInfo;
+    cmdBuffer.begin(cmdBufInfo);
+    setImageLayout(
+        cmdBuffer,
+        texture.image,
+        vk::ImageAspectFlagBits::eColor,
+        vk::ImageLayout::eUndefined,
+        vk::ImageLayout::eTransferDstOptimal,
+        subresourceRange);
+
+    // Copy the levels both images have
+    if (entry.texture.image) {
+        vk::ImageSubresourceRange oldRange = subresourceRange;
+        oldRange.levelCount = entry.texture.mipLevels;
+        setImageLayout(
+            cmdBuffer,
+            entry.texture.image,
+            vk::ImageAspectFlagBits::eColor,
+            vk::ImageLayout::eShaderReadOnlyOptimal,
+            vk::ImageLayout::eTransferSrcOptimal,
+            oldRange);
+        std::vector<vk::ImageCopy> imageCopyRegions;
+        for (uint32_t level = std::max(residentLevel, oldResidentLevel); level < entry.levels; ++level) {
+            vk::ImageCopy imageCopyRegion;
+            imageCopyRegion.srcSubresource = { vk::ImageAspectFlagBits::eColor, level - oldResidentLevel, 0, 1 };
+            imageCopyRegion.dstSubresource = { vk::ImageAspectFlagBits::eColor, level - residentLevel, 0, 1 };
+            imageCopyRegion.extent = { std::max(entry.width >> level, 1u), std::max(entry.height >> level, 1u), 1 };
+            imageCopyRegions.push_back(imageCopyRegion);
+        }
+        cmdBuffer.copyImage(entry.texture.image, vk::ImageLayout::eTransferSrcOptimal, texture.image, vk::ImageLayout::eTransferDstOptimal, imageCopyRegions);
+    }
+    if (!bufferCopyRegions.empty()) {
+        cmdBuffer.copyBufferToImage(staging.buffer, texture.image, vk::ImageLayout::eTransferDstOptimal, bufferCopyRegions);
+    }
+
+    texture.imageLayout = vk::ImageLayout::eShaderReadOnlyOptimal;
+    setImageLayout(
+        cmdBuffer,
+        texture.image,
+        vk::ImageAspectFlagBits::eColor,
+        vk::ImageLayout::eTransferDstOptimal,
+        texture.imageLayout,
+        subresourceRange);
+    cmdBuffer.end();
+
+    vk::Fence copyFence = context.device.createFence(vk::FenceCreateInfo());
+    vk::SubmitInfo submitInfo;
+    submitInfo.commandBufferCount = 1;
+    submitInfo.pCommandBuffers = &cmdBuffer;
+    context.queue.submit(submitInfo, copyFence);
+    context.device.waitForFences(copyFence, VK_TRUE, DEFAULT_FENCE_TIMEOUT);
+    context.device.destroyFence(copyFence);
+    staging.destroy();
+    entry.texture.destroy();
+
+    // Same sampler settings as the texture loader
+    vk::SamplerCreateInfo sampler;
+    sampler.magFilter = vk::Filter::eLinear;
+    sampler.minFilter = vk::Filter::eLinear;
+    sampler.mipmapMode = vk::SamplerMipmapMode::eLinear;
+    sampler.maxLod = (float)texture.mipLevels;
+    sampler.maxAnisotropy = 8;
+    sampler.anisotropyEnable = VK_TRUE;
+    sampler.borderColor = vk::BorderColor::eFloatOpaqueWhite;
+    texture.sampler = context.device.createSampler(sampler);
+
+    vk::ImageViewCreateInfo view;
+    view.viewType = vk::ImageViewType::e2D;
+    view.format = entry.format;
+    view.subresourceRange = { vk::ImageAspectFlagBits::eColor, 0, texture.mipLevels, 0, 1 };
+    view.image = texture.image;
+    texture.view = context.device.createImageView(view);
+
+    entry.texture = texture;
+    entry.residentLevel = residentLevel;
+    entry.memorySize = created.allocSize;
+}
+
+void TextureStreamer::destroy() {
+    loader.wait();
+    for (auto& entry : entries) {
+        entry.texture.destroy();
+    }
+    entries.clear();
+    loaded.clear();
+    loadsInFlight = 0;
+    if (cmdBuffer) {
+        context.device.freeCommandBuffers(context.getCommandPool(), cmdBuffer);
+        cmdBuffer = vk::CommandBuffer();
+    }
+}
+
+}
@@ -0,0 +1,117 @@
+/*
+* Progressive texture streaming
+*
+* This code is licensed under the MIT license (MIT) (http://opensource.org/licenses/MIT)
+*/
+
+#pragma once
+
+#include <stdint.h>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include "vulkanContext.hpp"
+#include "vulkanTextureLoader.hpp"
+#include "threadPool.hpp"
+
+namespace vkx {
+
+    // Streams the mip levels of 2D KTX textures (stored with their mip chain) on demand.
+    //
+    // load() only uploads the mip tail, the levels up to tailSize texels, and returns a texture
+    // that can be used right away.  The application reports the on screen size of each texture
+    // every frame (requestSize), update() then reads the missing higher levels on a loader thread,
+    // largest on screen textures first, and uploads them once they arrived.  All resident levels
+    // are kept below the memory budget by dropping the highest levels of the least recently
+    // requested textures.  Files are read from the mounted asset pack if it has them, loose files
+    // are only supported on desktop platforms.
+    //
+    // Without sparse residency the image is reallocated with the resident levels whenever they
+    // change, so the sampled level 0 is always the highest resident level and no LOD clamp is
+    // needed.  The view of a texture changes in that case and descriptors have to be updated.
+    class TextureStreamer {
+    public:
+        using Handle = uint32_t;
+
+        // Levels read from a file, filled by the loader thread
+        struct Levels {
+            Handle handle{ 0 };
+            uint32_t width{ 0 };
+            uint32_t height{ 0 };
+            uint32_t levels{ 0 };
+            uint32_t firstLevel{ 0 };
+            uint32_t lastLevel{ 0 };
+            // Levels [firstLevel, lastLevel) at 16 byte aligned offsets, empty if the read failed
+            std::vector<uint8_t> data;
+            std::vector<vk::DeviceSize> offsets;
+        };
+
+        // Device memory for all streamed textures, mip tails are always resident
+        vk::DeviceSize budget{ 64 * 1024 * 1024 };
+        // Largest dimension of the levels uploaded by load()
+        uint32_t tailSize{ 128 };
+
+        TextureStreamer(const Context& context);
+        ~TextureStreamer();
+
+        // Uploads the mip tail, throws if the file isn't a 2D KTX texture
+        Handle load(const std::string& filename, vk::Format format);
+        const Texture& texture(Handle handle) const { return entries[handle].texture; }
+        // First resident level of the complete chain of the file
+        uint32_t residentLevel(Handle handle) const { return entries[handle].residentLevel; }
+        uint32_t levelCount(Handle handle) const { return entries[handle].levels; }
+
+        // Screen space feedback: number of pixels the texture covers along its larger dimension
+        void requestSize(Handle handle, float pixels);
+        // Starts loads for the requested levels and uploads the ones that have been read.  Returns
+        // true if the image of any texture changed.  The textures must not be in use by the device.
+        bool update();
+
+        vk::DeviceSize residentMemory() const;
+        uint32_t pendingLoads() const { return loadsInFlight; }
+        uint32_t uploadCount() const { return uploads; }
+        uint32_t evictionCount() const { return evictions; }
+
+        void destroy();
+
+    private:
+        struct Entry {
+            std::string filename;
+            vk::Format format;
+            uint32_t width{ 0 };
+            uint32_t height{ 0 };
+            uint32_t levels{ 0 };
+            uint32_t tailLevel{ 0 };
+            uint32_t residentLevel{ 0 };
+            uint32_t requestedLevel{ 0 };
+            float requestedPixels{ 0.0f };
+            uint64_t lastRequested{ 0 };
+            bool loading{ false };
+            // Sizes of all levels in the file, used to estimate the memory of a resident level
+            std::vector<vk::DeviceSize> levelSizes;
+            Texture texture;
+            vk::DeviceSize memorySize{ 0 };
+        };
+
+        // Reallocates the image with the levels [residentLevel, levels), keeping the levels both
+        // images have and uploading the others from levels
+        void setResidentLevel(Entry& entry, uint32_t residentLevel, const Levels* levels);
+        // Drops high levels of other textures until size more bytes fit into the budget
+        bool makeRoom(vk::DeviceSize size, Handle keep, bool& changed);
+        vk::DeviceSize imageSize(const Entry& entry, uint32_t residentLevel) const;
+
+        Context context;
+        vk::CommandBuffer cmdBuffer;
+        std::vector<Entry> entries;
+        uint64_t frame{ 0 };
+        uint32_t loadsInFlight{ 0 };
+        uint32_t uploads{ 0 };
+        uint32_t evictions{ 0 };
+
+        std::mutex loadedMutex;
+        std::vector<Levels> loaded;
+        // Declared last, joined before the members its jobs use are destroyed
+        Thread loader;
+    };
+}
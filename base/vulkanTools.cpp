@@ -7,6 +7,7 @@
 */
 
 #include "vulkanTools.h"
+#include "vulkanAssetPack.h"
 #include <iterator>
 #include <iostream>
 #include <fstream>
@@ -165,6 +166,12 @@ namespace vkx {
     }
 
     std::vector<uint8_t> readBinaryFile(const std::string& filename) {
+        if (AssetPack* pack = AssetPack::mounted()) {
+            if (const pack::Entry* entry = pack->find(filename)) {
+                return pack->read(*entry);
+            }
+        }
+
         // open the file:
         std::ifstream file(filename, std::ios::binary);
         // Stop eating new lines in binary mode!!!
@@ -190,6 +197,14 @@ namespace vkx {
     }
 
     std::string readTextFile(const std::string& fileName) {
+        if (AssetPack* pack = AssetPack::mounted()) {
+            if (const pack::Entry* entry = pack->find(fileName)) {
+                std::string fileContent(entry->size, '\0');
+                pack->read(*entry, (uint8_t*)&fileContent[0]);
+                return fileContent;
+            }
+        }
+
         std::string fileContent;
         std::ifstream fileStream(fileName, std::ios::in);
 
@@ -233,6 +248,18 @@ namespace vkx {
     }
 #else
     vk::ShaderModule loadShader(const std::string& filename, vk::Device device, vk::ShaderStageFlagBits stage) {
+        // Uncompressed SPIR-V is passed straight from the mapping, entries are aligned
+        if (AssetPack* pack = AssetPack::mounted()) {
+            const pack::Entry* entry = pack->find(filename);
+            const uint8_t* code = entry ? pack->map(*entry) : nullptr;
+            if (code) {
+                vk::ShaderModuleCreateInfo moduleCreateInfo;
+                moduleCreateInfo.codeSize = entry->size;
+                moduleCreateInfo.pCode = (const uint32_t*)code;
+                return device.createShaderModule(moduleCreateInfo);
+            }
+        }
+
         std::vector<uint8_t> binaryData = readBinaryFile(filename);
         vk::ShaderModuleCreateInfo moduleCreateInfo;
         moduleCreateInfo.codeSize = binaryData.size();
@@ -585,5 +612,62 @@ namespace vkx {
         memcpy(&result.float32, &v, sizeof(result.float32));
         return result;
     }
+
+    std::vector<vk::MappedMemoryRange> AllocatedResult::alignedRanges(const Range* ranges, uint32_t rangeCount) const {
+        // [begin, end) pairs in whole atoms, the end of the allocation doesn't need to be aligned
+        std::vector<std::pair<vk::DeviceSize, vk::DeviceSize>> spans;
+        spans.reserve(rangeCount);
+        vk::DeviceSize atom = std::max<vk::DeviceSize>(nonCoherentAtomSize, 1);
+        for (uint32_t i = 0; i < rangeCount; ++i) {
+            vk::DeviceSize begin = ranges[i].offset / atom * atom;
+            vk::DeviceSize end = ranges[i].size == VK_WHOLE_SIZE ? allocSize : ranges[i].offset + ranges[i].size;
+            end = std::min<vk::DeviceSize>((end + atom - 1) / atom * atom, allocSize);
+            if (begin < end) {
+                spans.push_back({ begin, end });
+            }
+        }
+        std::sort(spans.begin(), spans.end());
+
+        std::vector<vk::MappedMemoryRange> result;
+        for (const auto& span : spans) {
+            if (!result.empty() && span.first <= result.back().offset + result.back().size) {
+                vk::MappedMemoryRange& last = result.back();
+                last.size = std::max(last.offset + last.size, span.second) - last.offset;
+            } else {
+                vk::MappedMemoryRange range;
+                range.memory = memory;
+                range.offset = span.first;
+                range.size = span.second - span.first;
+                result.push_back(range);
+            }
+        }
+        // Ranges ending at an unaligned allocation size have to use VK_WHOLE_SIZE
+        for (auto& range : result) {
+            if (range.offset + range.size == allocSize) {
+                range.size = VK_WHOLE_SIZE;
+            }
+        }
+        return result;
+    }
+
+    void AllocatedResult::flush(const Range* ranges, uint32_t rangeCount) const {
+        if (!mapped || isCoherent()) {
+            return;
+        }
+        std::vector<vk::MappedMemoryRange> memoryRanges = alignedRanges(ranges, rangeCount);
+        if (!memoryRanges.empty()) {
+            device.flushMappedMemoryRanges(memoryRanges);
+        }
+    }
+
+    void AllocatedResult::invalidate(const Range* ranges, uint32_t rangeCount) const {
+        if (!mapped || isCoherent()) {
+            return;
+        }
+        std::vector<vk::MappedMemoryRange> memoryRanges = alignedRanges(ranges, rangeCount);
+        if (!memoryRanges.empty()) {
+            device.invalidateMappedMemoryRanges(memoryRanges);
+        }
+    }
 }
 
@@ -13,6 +13,8 @@
 #include <vulkan/vk_cpp.hpp>
 #include <glm/glm.hpp>
 
+#include "vulkanResourceRegistry.h"
+
 // Default fence timeout in nanoseconds
 #define DEFAULT_FENCE_TIMEOUT 100000000000
 
@@ -75,23 +77,70 @@ namespace vkx {
     vk::ImageMemoryBarrier postPresentBarrier(vk::Image presentImage);
 
 
+    // Memory of a buffer or image.
+    //
+    // Host visible buffers from Context::createBuffer are mapped once when they are allocated and
+    // stay mapped until destroy(), map() then only returns the mapping and unmap() doesn't call
+    // into the driver.  Writes to memory without eHostCoherent have to be made visible with
+    // flush() and device writes with invalidate() before they are read.  unmap() of a persistent
+    // mapping flushes the whole memory, so map(), copy(), unmap() sequences stay correct.
     struct AllocatedResult {
+        // Byte range of the memory, offsets are relative to the start of the allocation
+        struct Range {
+            vk::DeviceSize offset;
+            vk::DeviceSize size;
+        };
+
         vk::Device device;
         vk::DeviceMemory memory;
         size_t allocSize{ 0 };
         void* mapped{ nullptr };
+        // Property flags of the memory type the allocation was made from
+        vk::MemoryPropertyFlags memoryPropertyFlags;
+        // VkPhysicalDeviceLimits::nonCoherentAtomSize, flushed ranges are widened to it
+        vk::DeviceSize nonCoherentAtomSize{ 1 };
+        // Mapped at allocation until destroy()
+        bool persistent{ false };
 
         template <typename T = void>
         inline T* map(size_t offset = 0, size_t size = VK_WHOLE_SIZE) {
+            if (persistent) {
+                return (T*)((uint8_t*)mapped + offset);
+            }
             mapped = device.mapMemory(memory, offset, size, vk::MemoryMapFlags());
             return (T*)mapped;
         }
 
         inline void unmap() {
+            if (persistent) {
+                flush();
+                return;
+            }
             device.unmapMemory(memory);
             mapped = nullptr;
         }
 
+        bool isCoherent() const {
+            return (memoryPropertyFlags & vk::MemoryPropertyFlagBits::eHostCoherent) == vk::MemoryPropertyFlagBits::eHostCoherent;
+        }
+
+        // Makes host writes to the ranges visible to the device, all ranges are flushed with one
+        // call.  Nothing to do for coherent memory.
+        void flush(const Range* ranges, uint32_t rangeCount) const;
+        void flush(const std::vector<Range>& ranges) const { flush(ranges.data(), (uint32_t)ranges.size()); }
+        void flush(vk::DeviceSize offset = 0, vk::DeviceSize size = VK_WHOLE_SIZE) const {
+            Range range{ offset, size };
+            flush(&range, 1);
+        }
+
+        // Makes device writes to the ranges visible to the host, for readback from non coherent memory
+        void invalidate(const Range* ranges, uint32_t rangeCount) const;
+        void invalidate(const std::vector<Range>& ranges) const { invalidate(ranges.data(), (uint32_t)ranges.size()); }
+        void invalidate(vk::DeviceSize offset = 0, vk::DeviceSize size = VK_WHOLE_SIZE) const {
+            Range range{ offset, size };
+            invalidate(&range, 1);
+        }
+
         inline void copy(size_t size, const void* data, size_t offset = 0) const {
             memcpy((uint8_t*)mapped + offset, data, size);
         }
@@ -108,13 +157,20 @@ namespace vkx {
 
         virtual void destroy() {
             if (mapped) {
-                unmap();
+                device.unmapMemory(memory);
+                mapped = nullptr;
+                persistent = false;
             }
             if (memory) {
+                ResourceRegistry::get().remove(memory);
                 device.freeMemory(memory);
                 memory = vk::DeviceMemory();
             }
         }
+
+    private:
+        // Widens the ranges to whole atoms and merges the ones that touch
+        std::vector<vk::MappedMemoryRange> alignedRanges(const Range* ranges, uint32_t rangeCount) const;
     };
     struct CreateImageResult : public AllocatedResult{
         vk::Image image;
@@ -124,9 +180,6 @@ namespace vkx {
         size_t size{ 0 };
 
         void destroy() override {
-            if (mapped) {
-                unmap();
-            }
             if (view) {
                 device.destroyImageView(view);
                 view = vk::ImageView();
@@ -145,9 +198,6 @@ namespace vkx {
         vk::DescriptorBufferInfo descriptor;
 
         void destroy() override {
-            if (mapped) {
-                unmap();
-            }
             if (buffer) {
                 device.destroyBuffer(buffer);
                 buffer = vk::Buffer();
@@ -0,0 +1,43 @@
+#version 450
+
+#extension GL_ARB_separate_shader_objects : enable
+#extension GL_ARB_shading_language_420pack : enable
+
+// Number of accumulated levels in the bloom mip chain, set by bloom.cpp
+#ifndef BLOOM_LEVELS
+#define BLOOM_LEVELS 6
+#endif
+
+// Largest level of the upsampled bloom mip chain
+layout (binding = 1) uniform sampler2D samplerColor;
+
+layout (binding = 2) uniform UBO 
+{
+	int texWidth;
+	int texHeight;
+	float blurScale;
+	float blurStrength;
+	int horizontal;
+} ubo;
+
+layout (location = 0) in vec2 inUV;
+
+layout (location = 0) out vec4 outFragColor;
+
+void main() 
+{
+	// Last tent filter upsample, straight to the output resolution
+	vec2 texel = ubo.blurScale / vec2(textureSize(samplerColor, 0));
+	vec3 result = texture(samplerColor, inUV).rgb * 4.0;
+	result += texture(samplerColor, inUV + texel * vec2( 0.0, -1.0)).rgb * 2.0;
+	result += texture(samplerColor, inUV + texel * vec2(-1.0,  0.0)).rgb * 2.0;
+	result += texture(samplerColor, inUV + texel * vec2( 1.0,  0.0)).rgb * 2.0;
+	result += texture(samplerColor, inUV + texel * vec2( 0.0,  1.0)).rgb * 2.0;
+	result += texture(samplerColor, inUV + texel * vec2(-1.0, -1.0)).rgb;
+	result += texture(samplerColor, inUV + texel * vec2( 1.0, -1.0)).rgb;
+	result += texture(samplerColor, inUV + texel * vec2(-1.0,  1.0)).rgb;
+	result += texture(samplerColor, inUV + texel * vec2( 1.0,  1.0)).rgb;
+	result /= 16.0;
+
+	outFragColor = vec4(result * ubo.blurStrength / float(BLOOM_LEVELS), 1.0);
+}
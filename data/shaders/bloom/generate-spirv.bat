@@ -10,3 +10,8 @@ glslangvalidator -V gaussblur.frag -o gaussblur.frag.spv
 glslangvalidator -V skybox.vert -o skybox.vert.spv
 glslangvalidator -V skybox.frag -o skybox.frag.spv
 
+glslangvalidator -V downsample.comp -o downsample.comp.spv
+glslangvalidator -V blur.comp -o blur.comp.spv
+glslangvalidator -V upsample.comp -o upsample.comp.spv
+glslangvalidator -V composite.frag -o composite.frag.spv
+
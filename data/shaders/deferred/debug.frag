@@ -7,17 +7,29 @@ layout (binding = 1) uniform sampler2D samplerPosition;
 layout (binding = 2) uniform sampler2D samplerNormal;
 layout (binding = 3) uniform sampler2D samplerAlbedo;
 
+layout (binding = 4) uniform UBO 
+{
+	mat4 view;
+	mat4 projection;
+	vec4 viewPos;
+	vec2 clusterDepthRange;
+	uint lightCount;
+	uint clustered;
+	vec2 renderScale;
+} ubo;
+
 layout (location = 0) in vec3 inUV;
 
 layout (location = 0) out vec4 outFragColor;
 
 void main() 
 {
+	vec2 uv = min(inUV.st * ubo.renderScale, ubo.renderScale - 0.5 / vec2(textureSize(samplerPosition, 0)));
 	vec3 components[3];
-	components[0] = texture(samplerPosition, inUV.st).rgb;  
-	components[1] = texture(samplerNormal, inUV.st).rgb;  
-	components[2] = texture(samplerAlbedo, inUV.st).rgb;  
-	//components[2] = vec3(texture(samplerAlbedo, inUV.st).a);  
+	components[0] = texture(samplerPosition, uv).rgb;  
+	components[1] = texture(samplerNormal, uv).rgb;  
+	components[2] = texture(samplerAlbedo, uv).rgb;  
+	//components[2] = vec3(texture(samplerAlbedo, uv).a);  
 	
 	// Select component depending on z coordinate of quad
 	highp int index = int(inUV.z);
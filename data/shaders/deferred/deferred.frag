@@ -11,6 +11,12 @@ layout (location = 0) in vec2 inUV;
 
 layout (location = 0) out vec4 outFragcolor;
 
+// Must match cluster.comp and deferred.cpp
+#define CLUSTER_X 16
+#define CLUSTER_Y 16
+#define CLUSTER_Z 32
+#define MAX_LIGHTS_PER_CLUSTER 256
+
 struct Light {
     vec4 position;
     vec4 color;
@@ -22,47 +28,90 @@ struct Light {
 
 layout (binding = 4) uniform UBO 
 {
-	Light lights[6];
+	mat4 view;
+	mat4 projection;
 	vec4 viewPos;
+	vec2 clusterDepthRange;
+	uint lightCount;
+	uint clustered;
+	// Part of the G-Buffer rendered to, see dynamic resolution
+	vec2 renderScale;
 } ubo;
 
+layout (std430, binding = 5) readonly buffer Lights
+{
+	Light lights[];
+};
+
+layout (std430, binding = 6) readonly buffer ClusterCounts
+{
+	uint clusterCounts[];
+};
+
+layout (std430, binding = 7) readonly buffer ClusterIndices
+{
+	uint clusterIndices[];
+};
+
+#define ambient 0.05
+#define specularStrength 0.15
+
+vec3 shade(Light light, vec3 fragPos, vec3 normal, vec4 albedo, vec3 viewVec)
+{
+	// Distance from light to fragment position
+	float dist = length(light.position.xyz - fragPos);
+	if (dist >= light.radius)
+	{
+		return vec3(0.0);
+	}
+	// Get vector from current light source to fragment position
+	vec3 lightVec = normalize(light.position.xyz - fragPos);
+	// Diffuse part
+	vec3 diffuse = max(dot(normal, lightVec), 0.0) * albedo.rgb * light.color.rgb;
+	// Specular part (specular texture part stored in albedo alpha channel)
+	vec3 halfVec = normalize(lightVec + viewVec);  
+	vec3 specular = light.color.rgb * pow(max(dot(normal, halfVec), 0.0), 16.0) * albedo.a * specularStrength;
+	// Attenuation with linearFalloff and quadraticFalloff falloff
+	float attenuation = 1.0 / (1.0 + light.linearFalloff * dist + light.quadraticFalloff * dist * dist);
+	return (diffuse + specular) * attenuation;
+}
 
 void main() 
 {
-    // Get G-Buffer values
-    vec3 fragPos = texture(samplerposition, inUV).rgb;
-    vec3 normal = texture(samplerNormal, inUV).rgb;
-    vec4 albedo = texture(samplerAlbedo, inUV);
+    // Get G-Buffer values, upscaled from the rendered part without filtering in texels outside of it
+    vec2 uv = min(inUV * ubo.renderScale, ubo.renderScale - 0.5 / vec2(textureSize(samplerposition, 0)));
+    vec3 fragPos = texture(samplerposition, uv).rgb;
+    vec3 normal = texture(samplerNormal, uv).rgb;
+    vec4 albedo = texture(samplerAlbedo, uv);
     
-	#define lightCount 5
-	#define ambient 0.05
-	#define specularStrength 0.15
-	
 	// Ambient part
     vec3 fragcolor  = albedo.rgb * ambient;
 	
     vec3 viewVec = normalize(ubo.viewPos.xyz - fragPos);
-	
-    for(int i = 0; i < lightCount; ++i)
-    {
-        // Distance from light to fragment position
-        float dist = length(ubo.lights[i].position.xyz - fragPos);
-		
-        if(dist < ubo.lights[i].radius)
-        {
-			// Get vector from current light source to fragment position
-            vec3 lightVec = normalize(ubo.lights[i].position.xyz - fragPos);
-            // Diffuse part
-            vec3 diffuse = max(dot(normal, lightVec), 0.0) * albedo.rgb * ubo.lights[i].color.rgb;
-            // Specular part (specular texture part stored in albedo alpha channel)
-            vec3 halfVec = normalize(lightVec + viewVec);  
-            vec3 specular = ubo.lights[i].color.rgb * pow(max(dot(normal, halfVec), 0.0), 16.0) * albedo.a * specularStrength;
-            // Attenuation with linearFalloff and quadraticFalloff falloff
-            float attenuation = 1.0 / (1.0 + ubo.lights[i].linearFalloff * dist + ubo.lights[i].quadraticFalloff * dist * dist);
-            fragcolor += (diffuse + specular) * attenuation;
-        }
-		
-    }    	
+
+	if (ubo.clustered != 0)
+	{
+		// G-Buffer positions have y flipped (see mrt.vert)
+		float depth = -(ubo.view * vec4(fragPos.x, -fragPos.y, fragPos.z, 1.0)).z;
+		float slice = log(depth / ubo.clusterDepthRange.x) / log(ubo.clusterDepthRange.y / ubo.clusterDepthRange.x) * CLUSTER_Z;
+		uvec3 cluster = uvec3(
+			min(uvec2(inUV * vec2(CLUSTER_X, CLUSTER_Y)), uvec2(CLUSTER_X - 1, CLUSTER_Y - 1)),
+			uint(clamp(slice, 0.0, CLUSTER_Z - 1.0)));
+		uint clusterIndex = (cluster.z * CLUSTER_Y + cluster.y) * CLUSTER_X + cluster.x;
+		uint count = clusterCounts[clusterIndex];
+		for (uint i = 0; i < count; ++i)
+		{
+			fragcolor += shade(lights[clusterIndices[clusterIndex * MAX_LIGHTS_PER_CLUSTER + i]], fragPos, normal, albedo, viewVec);
+		}
+	}
+	else
+	{
+		// Brute force, every light for every pixel
+		for (uint i = 0; i < ubo.lightCount; ++i)
+		{
+			fragcolor += shade(lights[i], fragPos, normal, albedo, viewVec);
+		}
+	}
    
   outFragcolor = vec4(fragcolor, 1.0);	
 }
\ No newline at end of file
@@ -4,4 +4,5 @@ glslangvalidator -V deferred.vert -o deferred.vert.spv
 glslangvalidator -V deferred.frag -o deferred.frag.spv
 glslangvalidator -V mrt.vert -o mrt.vert.spv
 glslangvalidator -V mrt.frag -o mrt.frag.spv
+glslangvalidator -V cluster.comp -o cluster.comp.spv
 
@@ -0,0 +1,44 @@
+#version 450
+
+#extension GL_ARB_separate_shader_objects : enable
+#extension GL_ARB_shading_language_420pack : enable
+
+// Glyph instance, the quad corners are generated from the vertex index
+layout (location = 0) in vec3 inPenScale;
+layout (location = 1) in uint inGlyph;
+
+layout (binding = 0) uniform UBO 
+{
+	mat4 projection;
+	mat4 model;
+} ubo;
+
+struct Glyph
+{
+	// Texture coordinates of the top left and bottom right corner
+	vec4 uv;
+	// Offset from the pen position and size, in font texels
+	vec4 quad;
+};
+
+layout (binding = 3) uniform GlyphTable 
+{
+	Glyph glyphs[256];
+} glyphTable;
+
+layout (location = 0) out vec2 outUV;
+
+out gl_PerVertex 
+{
+	vec4 gl_Position;
+};
+
+void main() 
+{
+	// Triangle strip : 0 = top left, 1 = top right, 2 = bottom left, 3 = bottom right
+	vec2 corner = vec2(gl_VertexIndex & 1, gl_VertexIndex >> 1);
+	Glyph glyph = glyphTable.glyphs[inGlyph & 0xFFu];
+	vec2 pos = inPenScale.xy + (glyph.quad.xy + corner * glyph.quad.zw) * inPenScale.z;
+	outUV = mix(glyph.uv.xy, glyph.uv.zw, corner);
+	gl_Position = ubo.projection * ubo.model * vec4(pos, 0.0, 1.0);
+}
@@ -0,0 +1,59 @@
+#version 450
+
+#extension GL_ARB_separate_shader_objects : enable
+#extension GL_ARB_shading_language_420pack : enable
+
+// The application defines one of PUSH_CONSTANTS, DYNAMIC_UBO, STORAGE_BUFFER
+// or INSTANCE_ATTRIBUTES to select where the per object data comes from
+
+layout (location = 0) in vec2 inPos;
+
+struct Object
+{
+	// xy : offset in normalized device coordinates, z : scale
+	vec4 offsetScale;
+	vec4 color;
+};
+
+#if defined(PUSH_CONSTANTS)
+layout (push_constant) uniform PushConsts
+{
+	Object object;
+} pushConsts;
+#elif defined(DYNAMIC_UBO)
+layout (binding = 0) uniform UBO
+{
+	Object object;
+} ubo;
+#elif defined(STORAGE_BUFFER)
+layout (std430, binding = 1) readonly buffer Objects
+{
+	Object objects[];
+};
+#elif defined(INSTANCE_ATTRIBUTES)
+layout (location = 1) in vec4 inOffsetScale;
+layout (location = 2) in vec4 inColor;
+#endif
+
+layout (location = 0) out vec4 outColor;
+
+out gl_PerVertex
+{
+	vec4 gl_Position;
+};
+
+void main() 
+{
+#if defined(PUSH_CONSTANTS)
+	Object object = pushConsts.object;
+#elif defined(DYNAMIC_UBO)
+	Object object = ubo.object;
+#elif defined(STORAGE_BUFFER)
+	// Direct draws pass the object index as first instance, so do the indirect commands
+	Object object = objects[gl_InstanceIndex];
+#elif defined(INSTANCE_ATTRIBUTES)
+	Object object = Object(inOffsetScale, inColor);
+#endif
+	outColor = object.color;
+	gl_Position = vec4(inPos * object.offsetScale.z + object.offsetScale.xy, 0.0, 1.0);
+}
@@ -0,0 +1,50 @@
+#version 450
+
+#extension GL_ARB_separate_shader_objects : enable
+#extension GL_ARB_shading_language_420pack : enable
+
+layout (location = 0) in vec3 inPos;
+layout (location = 1) in vec3 inNormal;
+layout (location = 2) in uint inGear;
+
+layout (binding = 0) uniform UBO 
+{
+	mat4 projection;
+	mat4 view;
+	vec4 lightpos;
+} ubo;
+
+struct Instance
+{
+	mat4 model;
+	vec4 color;
+};
+
+layout (std430, binding = 1) readonly buffer Instances
+{
+	Instance instances[];
+};
+
+layout (location = 0) out vec3 outNormal;
+layout (location = 1) out vec3 outColor;
+layout (location = 2) out vec3 outEyePos;
+layout (location = 3) out vec3 outLightVec;
+
+out gl_PerVertex
+{
+	vec4 gl_Position;
+};
+
+void main() 
+{
+	Instance instance = instances[inGear];
+	mat4 modelView = ubo.view * instance.model;
+	vec4 pos = modelView * vec4(inPos, 1.0);
+	// Gears are only rotated and translated, so the model view matrix transforms the normals
+	outNormal = normalize(mat3(modelView) * inNormal);
+	outColor = instance.color.rgb;
+	outEyePos = pos.xyz;
+	vec4 lightPos = ubo.view * vec4(ubo.lightpos.xyz, 1.0);
+	outLightVec = normalize(lightPos.xyz - outEyePos);
+	gl_Position = ubo.projection * pos;
+}
@@ -7,11 +7,23 @@ layout (location = 0) in vec3 inPos;
 layout (location = 1) in vec3 inNormal;
 layout (location = 2) in vec3 inColor;
 
-layout (std140, push_constant) uniform PushConsts 
+layout (binding = 0) uniform UBO 
 {
-	mat4 mvp;
-	vec3 color;
-} pushConsts;
+	mat4 projection;
+	mat4 view;
+} ubo;
+
+struct Instance
+{
+	mat4 model;
+	vec4 color;
+};
+
+// Indexed by the first instance of the draw, so recorded draws stay valid when objects move
+layout (std430, binding = 1) readonly buffer Instances
+{
+	Instance instances[];
+};
 
 layout (location = 0) out vec3 outNormal;
 layout (location = 1) out vec3 outColor;
@@ -20,23 +32,23 @@ layout (location = 4) out vec3 outLightVec;
 
 void main() 
 {
-	outNormal = inNormal;
+	Instance instance = instances[gl_InstanceIndex];
 
 	if ( (inColor.r == 1.0) && (inColor.g == 0.0) && (inColor.b == 0.0))
 	{	
-		outColor = pushConsts.color;
+		outColor = instance.color.rgb;
 	}
 	else
 	{
 		outColor = inColor;
 	}
 	
-	gl_Position = pushConsts.mvp * vec4(inPos.xyz, 1.0);
+	mat4 modelView = ubo.view * instance.model;
+	vec4 pos = modelView * vec4(inPos, 1.0);
+	gl_Position = ubo.projection * pos;
 	
-    vec4 pos = pushConsts.mvp * vec4(inPos, 1.0);
-    outNormal = mat3(pushConsts.mvp) * inNormal;
-//	vec3 lPos = ubo.lightPos.xyz;
-vec3 lPos = vec3(0.0);
-    outLightVec = lPos - pos.xyz;
-    outViewVec = -pos.xyz;
+	outNormal = mat3(modelView) * inNormal;
+	vec3 lPos = vec3(0.0);
+	outLightVec = lPos - pos.xyz;
+	outViewVec = -pos.xyz;
 }
\ No newline at end of file
@@ -4,4 +4,6 @@ glslangvalidator -V scene.vert -o scene.vert.spv
 glslangvalidator -V scene.frag -o scene.frag.spv
 glslangvalidator -V cubemapdisplay.vert -o cubemapdisplay.vert.spv
 glslangvalidator -V cubemapdisplay.frag -o cubemapdisplay.frag.spv
+glslangvalidator -V offscreenlayered.vert -o offscreenlayered.vert.spv
+glslangvalidator -V offscreenlayered.geom -o offscreenlayered.geom.spv
 
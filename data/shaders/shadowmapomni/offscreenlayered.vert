@@ -0,0 +1,15 @@
+#version 450
+
+#extension GL_ARB_separate_shader_objects : enable
+#extension GL_ARB_shading_language_420pack : enable
+
+layout (location = 0) in vec3 inPos;
+
+layout (location = 0) out vec4 outPos;
+
+void main()
+{
+	// Projection to the cube faces is done in the geometry shader
+	outPos = vec4(inPos, 1.0);
+	gl_Position = outPos;
+}
\ No newline at end of file
@@ -17,6 +17,17 @@ layout (binding = 0) uniform UBO
 	vec3 lightpos;
 } ubo;
 
+struct DrawData
+{
+	mat4 model;
+};
+
+// Indexed by the first instance of the (indirect) draw
+layout (std430, binding = 2) readonly buffer Draws
+{
+	DrawData draws[];
+};
+
 layout (location = 0) out vec2 outUV;
 layout (location = 1) out vec3 outNormal;
 layout (location = 2) out vec3 outColor;
@@ -25,10 +36,11 @@ layout (location = 4) out vec3 outLightVec;
 
 void main() 
 {
-	mat4 modelView = ubo.view * ubo.model;
+	mat4 model = ubo.model * draws[gl_InstanceIndex].model;
+	mat4 modelView = ubo.view * model;
 	vec4 pos = modelView * inPos;
 	outUV = inTexCoord.st;
-	outNormal = normalize(mat3(ubo.normal) * inNormal);
+	outNormal = normalize(mat3(ubo.normal) * mat3(draws[gl_InstanceIndex].model) * inNormal);
 	outColor = inColor;
 	gl_Position = ubo.projection * pos;
 	outEyePos = vec3(modelView * pos);
@@ -7,15 +7,20 @@
 */
 
 #include "vulkanExampleBase.h"
-
-// Texture properties
-#define TEX_DIM 256
-#define TEX_FORMAT  vk::Format::eR8G8B8A8Unorm
-#define TEX_FILTER vk::Filter::eLinear;
+#include "vulkanRenderGraph.h"
 
 // Offscreen frame buffer properties
-#define FB_DIM TEX_DIM
+#define FB_DIM 256
 #define FB_COLOR_FORMAT  vk::Format::eR8G8B8A8Unorm
+#define FB_FILTER vk::Filter::eLinear
+
+// Compute bloom mip chain, the first level has half the window resolution
+#define BLOOM_LEVELS 6
+#define BLOOM_GROUP_SIZE 8
+// Must match TILE_SIZE in blur.comp
+#define BLOOM_BLUR_TILE_SIZE 64
+// Downsample, horizontal and vertical blur per level, upsample for all but the smallest one
+#define BLOOM_DESCRIPTOR_SETS (BLOOM_LEVELS * 4 - 1)
 
 // Vertex layout for this example
 vkx::MeshLayout vertexLayout =
@@ -29,6 +34,10 @@ vkx::MeshLayout vertexLayout =
 class VulkanExample : public vkx::ExampleBase {
 public:
     bool bloom = true;
+    // Compute mip chain instead of the fixed resolution fragment shader blur
+    bool computeBloom = false;
+    // FP16 instead of 8-bit storage for the compute mip chain
+    bool bloomFp16 = false;
 
     struct {
         vkx::Texture cubemap;
@@ -61,8 +70,8 @@ public:
     };
 
     struct UBOBlur {
-        int32_t texWidth = TEX_DIM;
-        int32_t texHeight = TEX_DIM;
+        int32_t texWidth = FB_DIM;
+        int32_t texHeight = FB_DIM;
         float blurScale = 1.0f;
         float blurStrength = 1.5f;
         uint32_t horizontal;
@@ -74,15 +83,27 @@ public:
     } ubos;
 
     struct {
+        vk::Pipeline glowPass;
         vk::Pipeline blurVert;
+        vk::Pipeline blurHorz;
         vk::Pipeline colorPass;
         vk::Pipeline phongPass;
         vk::Pipeline skyBox;
+        vk::Pipeline bloomComposite;
     } pipelines;
 
+    // Compute bloom pipelines for 8-bit and FP16 storage
+    struct BloomPipelines {
+        vk::Pipeline downsample;
+        vk::Pipeline blur;
+        vk::Pipeline upsample;
+    };
+    std::array<BloomPipelines, 2> bloomPipelines;
+
     struct {
         vk::PipelineLayout radialBlur;
         vk::PipelineLayout scene;
+        vk::PipelineLayout bloom;
     } pipelineLayouts;
 
     struct {
@@ -90,28 +111,68 @@ public:
         vk::DescriptorSet verticalBlur;
         vk::DescriptorSet horizontalBlur;
         vk::DescriptorSet skyBox;
+        vk::DescriptorSet bloomComposite;
     } descriptorSets;
 
+    // Sampled input and storage image output of every compute bloom dispatch
+    struct {
+        std::array<vk::DescriptorSet, BLOOM_LEVELS> downsample;
+        std::array<vk::DescriptorSet, BLOOM_LEVELS> blurHorizontal;
+        std::array<vk::DescriptorSet, BLOOM_LEVELS> blurVertical;
+        std::array<vk::DescriptorSet, BLOOM_LEVELS - 1> upsample;
+    } bloomDescriptorSets;
+
+    struct BloomPushConstants {
+        glm::ivec2 direction;
+        int32_t karisAverage;
+        float radius;
+    };
+
     // Descriptor set layout is shared amongst
     // all descriptor sets
     vk::DescriptorSetLayout descriptorSetLayout;
+    vk::DescriptorSetLayout bloomDescriptorSetLayout;
 
-    // vk::Framebuffer for offscreen rendering
-    struct FrameBufferAttachment {
-        vk::Image image;
-        vk::DeviceMemory mem;
-        vk::ImageView view;
-    };
-    struct FrameBuffer {
-        int32_t width, height;
-        vk::Framebuffer frameBuffer;
-        FrameBufferAttachment color, depth;
-        // Texture target for framebuffer blit
-        vkx::Texture textureTarget;
-    } offScreenFrameBuf, offScreenFrameBufB;
-
-    // Used to store commands for rendering and blitting
-    // the offscreen scene
+    // The glow pass and the vertical blur are render graph passes, each one
+    // sampling the color attachment of the previous one directly. The depth
+    // buffer of the glow pass is only used during that pass and shares its
+    // memory with the vertical blur target.
+    vkx::RenderGraph renderGraph{ *this };
+    struct {
+        vkx::RenderGraph::Resource glow;
+        vkx::RenderGraph::Resource depth;
+        vkx::RenderGraph::Resource blur;
+    } offscreen;
+    struct {
+        vkx::RenderGraph::Pass* glow{ nullptr };
+        vkx::RenderGraph::Pass* verticalBlur{ nullptr };
+    } graphPasses;
+
+    // The compute bloom renders the glow at the window resolution.  The pass is
+    // compatible with the one above, so both draw with the same pipeline.
+    vkx::RenderGraph computeGraph{ *this };
+    struct {
+        vkx::RenderGraph::Resource glow;
+        vkx::RenderGraph::Resource depth;
+    } fullResolution;
+
+    // The glow is downsampled into the levels, every level is blurred (through the
+    // temp chain) and the levels are then accumulated in place from the smallest one up.
+    // All mips stay in the general layout.
+    struct {
+        vkx::CreateImageResult levels;
+        vkx::CreateImageResult temp;
+        std::array<vk::ImageView, BLOOM_LEVELS> levelViews;
+        std::array<vk::ImageView, BLOOM_LEVELS> tempViews;
+        std::array<vk::Extent2D, BLOOM_LEVELS> extents;
+        vk::Sampler sampler;
+    } bloomChain;
+
+    // Start and end of the compute bloom dispatches
+    vk::QueryPool bloomQueryPool;
+    float bloomComputeTime = 0.0f;
+
+    // Used to store commands for rendering the offscreen passes
     vk::CommandBuffer offScreenCmdBuffer;
 
     VulkanExample() : vkx::ExampleBase(ENABLE_VALIDATION) {
@@ -126,39 +187,33 @@ public:
         // Clean up used Vulkan resources 
         // Note : Inherited destructor cleans up resources stored in base class
 
-        // Texture target
-        offScreenFrameBuf.textureTarget.destroy();
-        offScreenFrameBufB.textureTarget.destroy();
-
-        // Frame buffer
-        device.destroyImageView(offScreenFrameBuf.color.view);
-        device.destroyImage(offScreenFrameBuf.color.image);
-        device.freeMemory(offScreenFrameBuf.color.mem);
-
-        device.destroyImageView(offScreenFrameBuf.depth.view);
-        device.destroyImage(offScreenFrameBuf.depth.image);
-        device.freeMemory(offScreenFrameBuf.depth.mem);
-
-        device.destroyImageView(offScreenFrameBufB.color.view);
-        device.destroyImage(offScreenFrameBufB.color.image);
-        device.freeMemory(offScreenFrameBufB.color.mem);
-
-        device.destroyImageView(offScreenFrameBufB.depth.view);
-        device.destroyImage(offScreenFrameBufB.depth.image);
-        device.freeMemory(offScreenFrameBufB.depth.mem);
-
-        device.destroyFramebuffer(offScreenFrameBuf.frameBuffer);
-        device.destroyFramebuffer(offScreenFrameBufB.frameBuffer);
+        // Offscreen images, render passes and framebuffers
+        renderGraph.destroy();
+        computeGraph.destroy();
+        destroyBloomChain();
+        device.destroySampler(bloomChain.sampler);
+        device.destroyQueryPool(bloomQueryPool);
+
+        for (auto& variant : bloomPipelines) {
+            device.destroyPipeline(variant.downsample);
+            device.destroyPipeline(variant.blur);
+            device.destroyPipeline(variant.upsample);
+        }
+        device.destroyPipeline(pipelines.bloomComposite);
 
+        device.destroyPipeline(pipelines.glowPass);
         device.destroyPipeline(pipelines.blurVert);
+        device.destroyPipeline(pipelines.blurHorz);
         device.destroyPipeline(pipelines.phongPass);
         device.destroyPipeline(pipelines.colorPass);
         device.destroyPipeline(pipelines.skyBox);
 
         device.destroyPipelineLayout(pipelineLayouts.radialBlur);
         device.destroyPipelineLayout(pipelineLayouts.scene);
+        device.destroyPipelineLayout(pipelineLayouts.bloom);
 
         device.destroyDescriptorSetLayout(descriptorSetLayout);
+        device.destroyDescriptorSetLayout(bloomDescriptorSetLayout);
 
         // Meshes
         meshes.ufo.destroy();
@@ -178,323 +233,211 @@ public:
         textures.cubemap.destroy();
     }
 
-    // Preapre an empty texture as the blit target from 
-    // the offscreen framebuffer
-    void prepareTextureTarget(vkx::Texture &tex, uint32_t width, uint32_t height,  vk::Format format, vk::CommandBuffer cmdBuffer) {
-         vk::FormatProperties formatProperties;
+    void prepareRenderGraph() {
+        vk::Extent2D extent{ FB_DIM, FB_DIM };
+        offscreen.glow = renderGraph.createImage("Glow color", FB_COLOR_FORMAT, extent, FB_FILTER);
+        offscreen.depth = renderGraph.createImage("Glow depth", vkx::getSupportedDepthFormat(physicalDevice), extent);
+        offscreen.blur = renderGraph.createImage("Vertical blur color", FB_COLOR_FORMAT, extent, FB_FILTER);
+        // The horizontal blur is applied in the on screen pass
+        renderGraph.markOutput(offscreen.blur);
+
+        // Render the glowing parts of the scene
+        graphPasses.glow = &renderGraph.addPass("Glow")
+            .writeColor(offscreen.glow, glm::vec4(0.0f, 0.0f, 0.0f, 1.0f))
+            .writeDepth(offscreen.depth)
+            .setRecord([this](const vk::CommandBuffer& cmdBuffer) {
+                drawGlow(cmdBuffer);
+            });
+
+        // Render a textured quad sampling the glow pass, applying a vertical blur
+        graphPasses.verticalBlur = &renderGraph.addPass("Vertical blur")
+            .read(offscreen.glow)
+            .writeColor(offscreen.blur, glm::vec4(0.0f, 0.0f, 0.0f, 1.0f))
+            .setRecord([this](const vk::CommandBuffer& cmdBuffer) {
+                vk::DeviceSize offset = 0;
+                cmdBuffer.bindDescriptorSets(vk::PipelineBindPoint::eGraphics, pipelineLayouts.radialBlur, 0, descriptorSets.verticalBlur, nullptr);
+                cmdBuffer.bindPipeline(vk::PipelineBindPoint::eGraphics, pipelines.blurVert);
+                cmdBuffer.bindVertexBuffers(VERTEX_BUFFER_BIND_ID, meshes.quad.vertices.buffer, offset);
+                cmdBuffer.bindIndexBuffer(meshes.quad.indices.buffer, 0, vk::IndexType::eUint32);
+                cmdBuffer.drawIndexed(meshes.quad.indexCount, 1, 0, 0, 0);
+            });
+
+        renderGraph.compile();
+
+        // Glow at the window resolution, read by the compute bloom
+        vk::Extent2D windowExtent{ width, height };
+        fullResolution.glow = computeGraph.createImage("Full resolution glow color", FB_COLOR_FORMAT, windowExtent, FB_FILTER);
+        fullResolution.depth = computeGraph.createImage("Full resolution glow depth", vkx::getSupportedDepthFormat(physicalDevice), windowExtent);
+        computeGraph.markOutput(fullResolution.glow, vk::PipelineStageFlagBits::eComputeShader);
+        computeGraph.addPass("Full resolution glow")
+            .writeColor(fullResolution.glow, glm::vec4(0.0f, 0.0f, 0.0f, 1.0f))
+            .writeDepth(fullResolution.depth)
+            .setRecord([this](const vk::CommandBuffer& cmdBuffer) {
+                drawGlow(cmdBuffer);
+            });
+        computeGraph.compile();
+    }
 
-        // Get device properites for the requested texture format
-        formatProperties = physicalDevice.getFormatProperties(format);
-        // Check if blit destination is supported for the requested format
-        // Only try for optimal tiling, linear tiling usually won't support blit as destination anyway
-        assert(formatProperties.optimalTilingFeatures &  vk::FormatFeatureFlagBits::eBlitDst);
+    void drawGlow(const vk::CommandBuffer& cmdBuffer) {
+        vk::DeviceSize offset = 0;
+        cmdBuffer.bindDescriptorSets(vk::PipelineBindPoint::eGraphics, pipelineLayouts.scene, 0, descriptorSets.scene, nullptr);
+        cmdBuffer.bindPipeline(vk::PipelineBindPoint::eGraphics, pipelines.glowPass);
+        cmdBuffer.bindVertexBuffers(VERTEX_BUFFER_BIND_ID, meshes.ufoGlow.vertices.buffer, offset);
+        cmdBuffer.bindIndexBuffer(meshes.ufoGlow.indices.buffer, 0, vk::IndexType::eUint32);
+        cmdBuffer.drawIndexed(meshes.ufoGlow.indexCount, 1, 0, 0, 0);
+    }
 
-        // Prepare blit target texture
-        tex.extent.width = width;
-        tex.extent.height = height;
+    // Create the mip chains of the compute bloom for the current window size and storage format
+    void prepareBloomChain() {
+        vk::Extent2D extent{ std::max(width / 2, 1u), std::max(height / 2, 1u) };
+        for (uint32_t i = 0; i < BLOOM_LEVELS; ++i) {
+            bloomChain.extents[i] = vk::Extent2D{ std::max(extent.width >> i, 1u), std::max(extent.height >> i, 1u) };
+        }
 
         vk::ImageCreateInfo imageCreateInfo;
         imageCreateInfo.imageType = vk::ImageType::e2D;
-        imageCreateInfo.format = format;
-        imageCreateInfo.extent = vk::Extent3D{ width, height, 1 };
-        imageCreateInfo.mipLevels = 1;
+        imageCreateInfo.format = bloomFp16 ? vk::Format::eR16G16B16A16Sfloat : vk::Format::eR8G8B8A8Unorm;
+        imageCreateInfo.extent = vk::Extent3D{ extent.width, extent.height, 1 };
+        imageCreateInfo.mipLevels = BLOOM_LEVELS;
         imageCreateInfo.arrayLayers = 1;
-        // Texture will be sampled in a shader and is also the blit destination
-        imageCreateInfo.usage = vk::ImageUsageFlagBits::eSampled | vk::ImageUsageFlagBits::eTransferDst;
-        tex = createImage(imageCreateInfo, vk::MemoryPropertyFlagBits::eDeviceLocal);
-
-        vkx::setImageLayout(
-            cmdBuffer,
-            tex.image,
-            vk::ImageAspectFlagBits::eColor,
-            vk::ImageLayout::eUndefined,
-            tex.imageLayout);
-
-        // Create sampler
-        vk::SamplerCreateInfo sampler;
-        sampler.magFilter = TEX_FILTER;
-        sampler.minFilter = TEX_FILTER;
-        sampler.mipmapMode = vk::SamplerMipmapMode::eLinear;
-        tex.sampler = device.createSampler(sampler);
-
-        // Create image view
-        vk::ImageViewCreateInfo view;
-        view.viewType = vk::ImageViewType::e2D;
-        view.format = format;
-        view.subresourceRange = { vk::ImageAspectFlagBits::eColor, 0, 1, 0, 1 };
-        view.image = tex.image;
-        tex.view = device.createImageView(view);
-    }
+        imageCreateInfo.samples = vk::SampleCountFlagBits::e1;
+        imageCreateInfo.tiling = vk::ImageTiling::eOptimal;
+        imageCreateInfo.usage = vk::ImageUsageFlagBits::eStorage | vk::ImageUsageFlagBits::eSampled;
+        bloomChain.levels = createImage(imageCreateInfo, vk::MemoryPropertyFlagBits::eDeviceLocal);
+        bloomChain.temp = createImage(imageCreateInfo, vk::MemoryPropertyFlagBits::eDeviceLocal);
+
+        withPrimaryCommandBuffer([&](const vk::CommandBuffer& setupCmdBuffer) {
+            vk::ImageSubresourceRange subresourceRange{ vk::ImageAspectFlagBits::eColor, 0, BLOOM_LEVELS, 0, 1 };
+            vkx::setImageLayout(setupCmdBuffer, bloomChain.levels.image, vk::ImageAspectFlagBits::eColor, vk::ImageLayout::eUndefined, vk::ImageLayout::eGeneral, subresourceRange);
+            vkx::setImageLayout(setupCmdBuffer, bloomChain.temp.image, vk::ImageAspectFlagBits::eColor, vk::ImageLayout::eUndefined, vk::ImageLayout::eGeneral, subresourceRange);
+        });
+
+        // One view per mip, so every dispatch sees its level as a single level image
+        vk::ImageViewCreateInfo viewCreateInfo;
+        viewCreateInfo.viewType = vk::ImageViewType::e2D;
+        viewCreateInfo.format = imageCreateInfo.format;
+        viewCreateInfo.subresourceRange = { vk::ImageAspectFlagBits::eColor, 0, 1, 0, 1 };
+        for (uint32_t i = 0; i < BLOOM_LEVELS; ++i) {
+            viewCreateInfo.subresourceRange.baseMipLevel = i;
+            viewCreateInfo.image = bloomChain.levels.image;
+            bloomChain.levelViews[i] = device.createImageView(viewCreateInfo);
+            viewCreateInfo.image = bloomChain.temp.image;
+            bloomChain.tempViews[i] = device.createImageView(viewCreateInfo);
+        }
 
-    // Prepare a new framebuffer for offscreen rendering
-    // The contents of this framebuffer are then
-    // blitted to our render target
-    void prepareOffscreenFramebuffer(FrameBuffer &frameBuf, vk::CommandBuffer cmdBuffer) {
-        frameBuf.width = FB_DIM;
-        frameBuf.height = FB_DIM;
-
-         vk::Format fbColorFormat = FB_COLOR_FORMAT;
-
-        // Find a suitable depth format
-         vk::Format fbDepthFormat = vkx::getSupportedDepthFormat(physicalDevice);
-
-        // Color attachment
-        vk::ImageCreateInfo image;
-        image.imageType = vk::ImageType::e2D;
-        image.format = fbColorFormat;
-        image.extent.width = frameBuf.width;
-        image.extent.height = frameBuf.height;
-        image.extent.depth = 1;
-        image.mipLevels = 1;
-        image.arrayLayers = 1;
-        image.samples = vk::SampleCountFlagBits::e1;
-        image.tiling = vk::ImageTiling::eOptimal;
-        // vk::Image of the framebuffer is blit source
-        image.usage = vk::ImageUsageFlagBits::eColorAttachment | vk::ImageUsageFlagBits::eTransferSrc;
-
-        vk::MemoryAllocateInfo memAlloc;
-        vk::MemoryRequirements memReqs;
-
-        vk::ImageViewCreateInfo colorImageView;
-        colorImageView.viewType = vk::ImageViewType::e2D;
-        colorImageView.format = fbColorFormat;
-        colorImageView.subresourceRange.aspectMask = vk::ImageAspectFlagBits::eColor;
-        colorImageView.subresourceRange.levelCount = 1;
-        colorImageView.subresourceRange.layerCount = 1;
-
-        frameBuf.color.image = device.createImage(image);
-        memReqs = device.getImageMemoryRequirements(frameBuf.color.image);
-        memAlloc.allocationSize = memReqs.size;
-        memAlloc.memoryTypeIndex = getMemoryType(memReqs.memoryTypeBits, vk::MemoryPropertyFlagBits::eDeviceLocal);
-        frameBuf.color.mem = device.allocateMemory(memAlloc);
-        device.bindImageMemory(frameBuf.color.image, frameBuf.color.mem, 0);
-
-        vkx::setImageLayout(
-            cmdBuffer,
-            frameBuf.color.image,
-            vk::ImageAspectFlagBits::eColor,
-            vk::ImageLayout::eUndefined,
-            vk::ImageLayout::eColorAttachmentOptimal);
-
-        colorImageView.image = frameBuf.color.image;
-        frameBuf.color.view = device.createImageView(colorImageView);
-
-        // Depth stencil attachment
-        image.format = fbDepthFormat;
-        image.usage = vk::ImageUsageFlagBits::eDepthStencilAttachment;
-
-        vk::ImageViewCreateInfo depthStencilView;
-        depthStencilView.viewType = vk::ImageViewType::e2D;
-        depthStencilView.format = fbDepthFormat;
-        depthStencilView.subresourceRange.aspectMask = vk::ImageAspectFlagBits::eDepth | vk::ImageAspectFlagBits::eStencil;
-        depthStencilView.subresourceRange.levelCount = 1;
-        depthStencilView.subresourceRange.layerCount = 1;
-
-        frameBuf.depth.image = device.createImage(image);
-        memReqs = device.getImageMemoryRequirements(frameBuf.depth.image);
-        memAlloc.allocationSize = memReqs.size;
-        memAlloc.memoryTypeIndex = getMemoryType(memReqs.memoryTypeBits, vk::MemoryPropertyFlagBits::eDeviceLocal);
-        frameBuf.depth.mem = device.allocateMemory(memAlloc);
-        device.bindImageMemory(frameBuf.depth.image, frameBuf.depth.mem, 0);
-
-        vkx::setImageLayout(
-            cmdBuffer,
-            frameBuf.depth.image,
-            vk::ImageAspectFlagBits::eDepth | vk::ImageAspectFlagBits::eStencil,
-            vk::ImageLayout::eUndefined,
-            vk::ImageLayout::eDepthStencilAttachmentOptimal);
-
-        depthStencilView.image = frameBuf.depth.image;
-        frameBuf.depth.view = device.createImageView(depthStencilView);
-
-        vk::ImageView attachments[2];
-        attachments[0] = frameBuf.color.view;
-        attachments[1] = frameBuf.depth.view;
-
-        vk::FramebufferCreateInfo fbufCreateInfo;
-        fbufCreateInfo.renderPass = renderPass;
-        fbufCreateInfo.attachmentCount = 2;
-        fbufCreateInfo.pAttachments = attachments;
-        fbufCreateInfo.width = frameBuf.width;
-        fbufCreateInfo.height = frameBuf.height;
-        fbufCreateInfo.layers = 1;
-
-        frameBuf.frameBuffer = device.createFramebuffer(fbufCreateInfo);
+        if (!bloomChain.sampler) {
+            vk::SamplerCreateInfo samplerCreateInfo;
+            samplerCreateInfo.magFilter = vk::Filter::eLinear;
+            samplerCreateInfo.minFilter = vk::Filter::eLinear;
+            samplerCreateInfo.mipmapMode = vk::SamplerMipmapMode::eNearest;
+            samplerCreateInfo.addressModeU = vk::SamplerAddressMode::eClampToEdge;
+            samplerCreateInfo.addressModeV = samplerCreateInfo.addressModeU;
+            samplerCreateInfo.addressModeW = samplerCreateInfo.addressModeU;
+            samplerCreateInfo.maxLod = 1.0f;
+            bloomChain.sampler = device.createSampler(samplerCreateInfo);
+        }
     }
 
-    // Prepare the ping-pong texture targets for the vertical- and horizontal blur
-    void prepareTextureTargets() {
-        withPrimaryCommandBuffer([&](vk::CommandBuffer& cmdBuffer) {
-            prepareTextureTarget(offScreenFrameBuf.textureTarget, TEX_DIM, TEX_DIM, TEX_FORMAT, cmdBuffer);
-            prepareTextureTarget(offScreenFrameBufB.textureTarget, TEX_DIM, TEX_DIM, TEX_FORMAT, cmdBuffer);
-        });
+    void destroyBloomChain() {
+        for (uint32_t i = 0; i < BLOOM_LEVELS; ++i) {
+            if (bloomChain.levelViews[i]) {
+                device.destroyImageView(bloomChain.levelViews[i]);
+                bloomChain.levelViews[i] = vk::ImageView();
+            }
+            if (bloomChain.tempViews[i]) {
+                device.destroyImageView(bloomChain.tempViews[i]);
+                bloomChain.tempViews[i] = vk::ImageView();
+            }
+        }
+        bloomChain.levels.destroy();
+        bloomChain.temp.destroy();
     }
 
-    // Prepare the offscreen framebuffers used for the vertical- and horizontal blur 
-    void prepareOffscreenFramebuffers() {
-        withPrimaryCommandBuffer([&](vk::CommandBuffer& cmdBuffer) {
-            prepareOffscreenFramebuffer(offScreenFrameBuf, cmdBuffer);
-            prepareOffscreenFramebuffer(offScreenFrameBufB, cmdBuffer);
-        });
+    void prepareTimestampQueries() {
+        vk::QueryPoolCreateInfo queryPoolInfo;
+        queryPoolInfo.queryType = vk::QueryType::eTimestamp;
+        queryPoolInfo.queryCount = 2;
+        bloomQueryPool = device.createQueryPool(queryPoolInfo);
     }
 
     void createOffscreenCommandBuffer() {
         offScreenCmdBuffer = createCommandBuffer();
     }
 
-    // Render the 3D scene into a texture target
+    // Render the glow and the vertical blur into offscreen images, or the
+    // full resolution glow and the compute bloom mip chain
     void buildOffscreenCommandBuffer() {
         vk::CommandBufferBeginInfo cmdBufInfo;
+        offScreenCmdBuffer.begin(cmdBufInfo);
+        if (computeBloom) {
+            computeGraph.execute(offScreenCmdBuffer);
+            buildBloomComputeCommands(offScreenCmdBuffer);
+        } else {
+            renderGraph.execute(offScreenCmdBuffer);
+        }
+        offScreenCmdBuffer.end();
+    }
 
-        vk::Viewport viewport = vkx::viewport((float)offScreenFrameBuf.width, (float)offScreenFrameBuf.height, 0.0f, 1.0f);
-        vk::Rect2D scissor = vkx::rect2D(offScreenFrameBuf.width, offScreenFrameBuf.height, 0, 0);
-        vk::DeviceSize offset = 0;
-
-        // Horizontal blur
-        vk::ClearValue clearValues[2];
-        clearValues[0].color = vkx::clearColor({ 0.0f, 0.0f, 0.0f, 1.0f });
-        clearValues[1].depthStencil = { 1.0f, 0 };
-
-        vk::RenderPassBeginInfo renderPassBeginInfo;
-        renderPassBeginInfo.renderPass = renderPass;
-        renderPassBeginInfo.framebuffer = offScreenFrameBuf.frameBuffer;
-        renderPassBeginInfo.renderArea.extent.width = offScreenFrameBuf.width;
-        renderPassBeginInfo.renderArea.extent.height = offScreenFrameBuf.height;
-        renderPassBeginInfo.clearValueCount = 2;
-        renderPassBeginInfo.pClearValues = clearValues;
+    void bloomBarrier(const vk::CommandBuffer& cmdBuffer, vk::PipelineStageFlags dstStageMask) {
+        vk::MemoryBarrier memoryBarrier;
+        memoryBarrier.srcAccessMask = vk::AccessFlagBits::eShaderWrite;
+        memoryBarrier.dstAccessMask = vk::AccessFlagBits::eShaderRead | vk::AccessFlagBits::eShaderWrite;
+        cmdBuffer.pipelineBarrier(vk::PipelineStageFlagBits::eComputeShader, dstStageMask, vk::DependencyFlags(), memoryBarrier, nullptr, nullptr);
+    }
 
+    static uint32_t groupCount(uint32_t size, uint32_t groupSize) {
+        return (size + groupSize - 1) / groupSize;
+    }
 
-        offScreenCmdBuffer.begin(cmdBufInfo);
-        offScreenCmdBuffer.setViewport(0, viewport);
-        offScreenCmdBuffer.setScissor(0, scissor);
-
-        offScreenCmdBuffer.beginRenderPass(renderPassBeginInfo, vk::SubpassContents::eInline);
-        offScreenCmdBuffer.bindDescriptorSets(vk::PipelineBindPoint::eGraphics, pipelineLayouts.scene, 0, descriptorSets.scene, nullptr);
-        offScreenCmdBuffer.bindPipeline(vk::PipelineBindPoint::eGraphics, pipelines.phongPass);
-        offScreenCmdBuffer.bindVertexBuffers(VERTEX_BUFFER_BIND_ID, meshes.ufoGlow.vertices.buffer, offset);
-        offScreenCmdBuffer.bindIndexBuffer(meshes.ufoGlow.indices.buffer, 0, vk::IndexType::eUint32);
-        offScreenCmdBuffer.drawIndexed(meshes.ufoGlow.indexCount, 1, 0, 0, 0);
-        offScreenCmdBuffer.endRenderPass();
-
-        // Make sure color writes to the framebuffer are finished before using it as transfer source
-        vkx::setImageLayout(
-            offScreenCmdBuffer,
-            offScreenFrameBuf.color.image,
-            vk::ImageAspectFlagBits::eColor,
-            vk::ImageLayout::eColorAttachmentOptimal,
-            vk::ImageLayout::eTransferSrcOptimal);
-
-        // Transform texture target to transfer destination
-        vkx::setImageLayout(
-            offScreenCmdBuffer,
-            offScreenFrameBuf.textureTarget.image,
-            vk::ImageAspectFlagBits::eColor,
-            vk::ImageLayout::eShaderReadOnlyOptimal,
-            vk::ImageLayout::eTransferDstOptimal);
-
-        // Blit offscreen color buffer to our texture target
-        vk::ImageBlit imgBlit;
-        imgBlit.srcSubresource.aspectMask = vk::ImageAspectFlagBits::eColor;
-        imgBlit.srcSubresource.layerCount = 1;
-        imgBlit.srcOffsets[1].x = offScreenFrameBuf.width;
-        imgBlit.srcOffsets[1].y = offScreenFrameBuf.height;
-        imgBlit.srcOffsets[1].z = 1;
-
-        imgBlit.dstSubresource.aspectMask = vk::ImageAspectFlagBits::eColor;
-        imgBlit.dstSubresource.layerCount = 1;
-        imgBlit.dstOffsets[1].x = offScreenFrameBuf.textureTarget.extent.width;
-        imgBlit.dstOffsets[1].y = offScreenFrameBuf.textureTarget.extent.height;
-        imgBlit.dstOffsets[1].z = 1;
-
-        // Blit from framebuffer image to texture image
-        // vkCmdBlitImage does scaling and (if necessary and possible) also does format conversions
-        offScreenCmdBuffer.blitImage(
-            offScreenFrameBuf.color.image, vk::ImageLayout::eTransferSrcOptimal,
-            offScreenFrameBuf.textureTarget.image, vk::ImageLayout::eTransferDstOptimal,
-            imgBlit, vk::Filter::eLinear);
-
-        // Transform framebuffer color attachment back 
-        vkx::setImageLayout(
-            offScreenCmdBuffer,
-            offScreenFrameBuf.color.image,
-            vk::ImageAspectFlagBits::eColor,
-            vk::ImageLayout::eTransferSrcOptimal,
-            vk::ImageLayout::eColorAttachmentOptimal);
-
-        // Transform texture target back to shader read
-        // Makes sure that writes to the texture are finished before
-        // it's accessed in the shader
-        vkx::setImageLayout(
-            offScreenCmdBuffer,
-            offScreenFrameBuf.textureTarget.image,
-            vk::ImageAspectFlagBits::eColor,
-            vk::ImageLayout::eTransferDstOptimal,
-            vk::ImageLayout::eShaderReadOnlyOptimal);
+    void buildBloomComputeCommands(const vk::CommandBuffer& cmdBuffer) {
+        const BloomPipelines& variant = bloomPipelines[bloomFp16 ? 1 : 0];
+        BloomPushConstants pushConstants{};
+        pushConstants.radius = ubos.horzBlur.blurScale;
+
+        cmdBuffer.resetQueryPool(bloomQueryPool, 0, 2);
+        cmdBuffer.writeTimestamp(vk::PipelineStageFlagBits::eTopOfPipe, bloomQueryPool, 0);
+
+        // The composition of the previous frame has to be done reading the levels
+        cmdBuffer.pipelineBarrier(vk::PipelineStageFlagBits::eFragmentShader, vk::PipelineStageFlagBits::eComputeShader, vk::DependencyFlags(), nullptr, nullptr, nullptr);
+
+        // Progressive downsample, the first level averages the glow
+        cmdBuffer.bindPipeline(vk::PipelineBindPoint::eCompute, variant.downsample);
+        for (uint32_t i = 0; i < BLOOM_LEVELS; ++i) {
+            pushConstants.karisAverage = i == 0 ? 1 : 0;
+            cmdBuffer.pushConstants(pipelineLayouts.bloom, vk::ShaderStageFlagBits::eCompute, 0, sizeof(BloomPushConstants), &pushConstants);
+            cmdBuffer.bindDescriptorSets(vk::PipelineBindPoint::eCompute, pipelineLayouts.bloom, 0, bloomDescriptorSets.downsample[i], nullptr);
+            cmdBuffer.dispatch(groupCount(bloomChain.extents[i].width, BLOOM_GROUP_SIZE), groupCount(bloomChain.extents[i].height, BLOOM_GROUP_SIZE), 1);
+            bloomBarrier(cmdBuffer, vk::PipelineStageFlagBits::eComputeShader);
+        }
 
-        // Vertical blur
-        // Render the textured quad containing the scene into
-        // another offscreen buffer applying a vertical blur
-        renderPassBeginInfo.framebuffer = offScreenFrameBufB.frameBuffer;
-        renderPassBeginInfo.renderArea.extent.width = offScreenFrameBufB.width;
-        renderPassBeginInfo.renderArea.extent.height = offScreenFrameBufB.height;
-
-        viewport.width = offScreenFrameBuf.width;
-        viewport.height = offScreenFrameBuf.height;
-        offScreenCmdBuffer.setViewport(0, viewport);
-        offScreenCmdBuffer.setScissor(0, scissor);
-
-        // Draw horizontally blurred texture 
-        offScreenCmdBuffer.beginRenderPass(renderPassBeginInfo, vk::SubpassContents::eInline);
-        offScreenCmdBuffer.bindDescriptorSets(vk::PipelineBindPoint::eGraphics, pipelineLayouts.radialBlur, 0, descriptorSets.verticalBlur, nullptr);
-        offScreenCmdBuffer.bindPipeline(vk::PipelineBindPoint::eGraphics, pipelines.blurVert);
-        offScreenCmdBuffer.bindVertexBuffers(VERTEX_BUFFER_BIND_ID, meshes.quad.vertices.buffer, offset);
-        offScreenCmdBuffer.bindIndexBuffer(meshes.quad.indices.buffer, 0, vk::IndexType::eUint32);
-        offScreenCmdBuffer.drawIndexed(meshes.quad.indexCount, 1, 0, 0, 0);
-        offScreenCmdBuffer.endRenderPass();
-
-        // Make sure color writes to the framebuffer are finished before using it as transfer source
-        vkx::setImageLayout(
-            offScreenCmdBuffer,
-            offScreenFrameBufB.color.image,
-            vk::ImageAspectFlagBits::eColor,
-            vk::ImageLayout::eColorAttachmentOptimal,
-            vk::ImageLayout::eTransferSrcOptimal);
-
-        // Transform texture target to transfer destination
-        vkx::setImageLayout(
-            offScreenCmdBuffer,
-            offScreenFrameBufB.textureTarget.image,
-            vk::ImageAspectFlagBits::eColor,
-            vk::ImageLayout::eShaderReadOnlyOptimal,
-            vk::ImageLayout::eTransferDstOptimal);
-
-
-        // Blit from framebuffer image to texture image
-        // vkCmdBlitImage does scaling and (if necessary and possible) also does format conversions
-        offScreenCmdBuffer.blitImage(
-            offScreenFrameBufB.color.image, vk::ImageLayout::eTransferSrcOptimal,
-            offScreenFrameBufB.textureTarget.image, vk::ImageLayout::eTransferDstOptimal,
-            imgBlit, vk::Filter::eLinear);
-
-        // Transform framebuffer color attachment back 
-        vkx::setImageLayout(
-            offScreenCmdBuffer,
-            offScreenFrameBufB.color.image,
-            vk::ImageAspectFlagBits::eColor,
-            vk::ImageLayout::eTransferSrcOptimal,
-            vk::ImageLayout::eColorAttachmentOptimal);
-
-        // Transform texture target back to shader read
-        // Makes sure that writes to the texture are finished before
-        // it's accessed in the shader
-        vkx::setImageLayout(
-            offScreenCmdBuffer,
-            offScreenFrameBufB.textureTarget.image,
-            vk::ImageAspectFlagBits::eColor,
-            vk::ImageLayout::eTransferDstOptimal,
-            vk::ImageLayout::eShaderReadOnlyOptimal);
+        // Separable blur of all levels, one workgroup per line segment
+        cmdBuffer.bindPipeline(vk::PipelineBindPoint::eCompute, variant.blur);
+        pushConstants.karisAverage = 0;
+        pushConstants.direction = glm::ivec2(1, 0);
+        cmdBuffer.pushConstants(pipelineLayouts.bloom, vk::ShaderStageFlagBits::eCompute, 0, sizeof(BloomPushConstants), &pushConstants);
+        for (uint32_t i = 0; i < BLOOM_LEVELS; ++i) {
+            cmdBuffer.bindDescriptorSets(vk::PipelineBindPoint::eCompute, pipelineLayouts.bloom, 0, bloomDescriptorSets.blurHorizontal[i], nullptr);
+            cmdBuffer.dispatch(groupCount(bloomChain.extents[i].width, BLOOM_BLUR_TILE_SIZE), bloomChain.extents[i].height, 1);
+        }
+        bloomBarrier(cmdBuffer, vk::PipelineStageFlagBits::eComputeShader);
+        pushConstants.direction = glm::ivec2(0, 1);
+        cmdBuffer.pushConstants(pipelineLayouts.bloom, vk::ShaderStageFlagBits::eCompute, 0, sizeof(BloomPushConstants), &pushConstants);
+        for (uint32_t i = 0; i < BLOOM_LEVELS; ++i) {
+            cmdBuffer.bindDescriptorSets(vk::PipelineBindPoint::eCompute, pipelineLayouts.bloom, 0, bloomDescriptorSets.blurVertical[i], nullptr);
+            cmdBuffer.dispatch(groupCount(bloomChain.extents[i].height, BLOOM_BLUR_TILE_SIZE), bloomChain.extents[i].width, 1);
+        }
+        bloomBarrier(cmdBuffer, vk::PipelineStageFlagBits::eComputeShader);
+
+        // Tent filter upsample, adding every level to the next larger one.  The largest
+        // level is upsampled to the output resolution by the composition.
+        cmdBuffer.bindPipeline(vk::PipelineBindPoint::eCompute, variant.upsample);
+        for (int32_t i = BLOOM_LEVELS - 2; i >= 0; --i) {
+            cmdBuffer.bindDescriptorSets(vk::PipelineBindPoint::eCompute, pipelineLayouts.bloom, 0, bloomDescriptorSets.upsample[i], nullptr);
+            cmdBuffer.dispatch(groupCount(bloomChain.extents[i].width, BLOOM_GROUP_SIZE), groupCount(bloomChain.extents[i].height, BLOOM_GROUP_SIZE), 1);
+            bloomBarrier(cmdBuffer, i == 0 ? vk::PipelineStageFlagBits::eFragmentShader : vk::PipelineStageFlagBits::eComputeShader);
+        }
 
-        offScreenCmdBuffer.end();
+        cmdBuffer.writeTimestamp(vk::PipelineStageFlagBits::eBottomOfPipe, bloomQueryPool, 1);
     }
 
     void loadTextures() {
@@ -557,10 +500,16 @@ public:
             drawCmdBuffers[i].bindIndexBuffer(meshes.ufo.indices.buffer, 0, vk::IndexType::eUint32);
             drawCmdBuffers[i].drawIndexed(meshes.ufo.indexCount, 1, 0, 0, 0);
 
-            // Render vertical blurred scene applying a horizontal blur
+            // Render vertical blurred scene applying a horizontal blur, or
+            // the upsampled compute bloom
             if (bloom) {
-                drawCmdBuffers[i].bindDescriptorSets(vk::PipelineBindPoint::eGraphics, pipelineLayouts.radialBlur, 0, descriptorSets.horizontalBlur, nullptr);
-                drawCmdBuffers[i].bindPipeline(vk::PipelineBindPoint::eGraphics, pipelines.blurVert);
+                if (computeBloom) {
+                    drawCmdBuffers[i].bindDescriptorSets(vk::PipelineBindPoint::eGraphics, pipelineLayouts.radialBlur, 0, descriptorSets.bloomComposite, nullptr);
+                    drawCmdBuffers[i].bindPipeline(vk::PipelineBindPoint::eGraphics, pipelines.bloomComposite);
+                } else {
+                    drawCmdBuffers[i].bindDescriptorSets(vk::PipelineBindPoint::eGraphics, pipelineLayouts.radialBlur, 0, descriptorSets.horizontalBlur, nullptr);
+                    drawCmdBuffers[i].bindPipeline(vk::PipelineBindPoint::eGraphics, pipelines.blurHorz);
+                }
                 drawCmdBuffers[i].bindVertexBuffers(VERTEX_BUFFER_BIND_ID, meshes.quad.vertices.buffer, offset);
                 drawCmdBuffers[i].bindIndexBuffer(meshes.quad.indices.buffer, 0, vk::IndexType::eUint32);
                 drawCmdBuffers[i].drawIndexed(meshes.quad.indexCount, 1, 0, 0, 0);
@@ -640,12 +589,13 @@ public:
     void setupDescriptorPool() {
         std::vector<vk::DescriptorPoolSize> poolSizes =
         {
-            vkx::descriptorPoolSize(vk::DescriptorType::eUniformBuffer, 8),
-            vkx::descriptorPoolSize(vk::DescriptorType::eCombinedImageSampler, 6)
+            vkx::descriptorPoolSize(vk::DescriptorType::eUniformBuffer, 10),
+            vkx::descriptorPoolSize(vk::DescriptorType::eCombinedImageSampler, 7 + BLOOM_DESCRIPTOR_SETS),
+            vkx::descriptorPoolSize(vk::DescriptorType::eStorageImage, BLOOM_DESCRIPTOR_SETS)
         };
 
         vk::DescriptorPoolCreateInfo descriptorPoolInfo =
-            vkx::descriptorPoolCreateInfo(poolSizes.size(), poolSizes.data(), 5);
+            vkx::descriptorPoolCreateInfo(poolSizes.size(), poolSizes.data(), 6 + BLOOM_DESCRIPTOR_SETS);
 
         descriptorPool = device.createDescriptorPool(descriptorPoolInfo);
     }
@@ -684,6 +634,36 @@ public:
 
         // Offscreen pipeline layout
         pipelineLayouts.scene = device.createPipelineLayout(pPipelineLayoutCreateInfo);
+
+        // Compute bloom pipeline layout
+        setLayoutBindings =
+        {
+            // Binding 0 : Sampled input level
+            vkx::descriptorSetLayoutBinding(
+                vk::DescriptorType::eCombinedImageSampler,
+                vk::ShaderStageFlagBits::eCompute,
+                0),
+            // Binding 1 : Output level
+            vkx::descriptorSetLayoutBinding(
+                vk::DescriptorType::eStorageImage,
+                vk::ShaderStageFlagBits::eCompute,
+                1),
+        };
+
+        descriptorLayout =
+            vkx::descriptorSetLayoutCreateInfo(setLayoutBindings.data(), setLayoutBindings.size());
+
+        bloomDescriptorSetLayout = device.createDescriptorSetLayout(descriptorLayout);
+
+        pPipelineLayoutCreateInfo =
+            vkx::pipelineLayoutCreateInfo(&bloomDescriptorSetLayout, 1);
+
+        vk::PushConstantRange pushConstantRange =
+            vkx::pushConstantRange(vk::ShaderStageFlagBits::eCompute, sizeof(BloomPushConstants), 0);
+        pPipelineLayoutCreateInfo.pushConstantRangeCount = 1;
+        pPipelineLayoutCreateInfo.pPushConstantRanges = &pushConstantRange;
+
+        pipelineLayouts.bloom = device.createPipelineLayout(pPipelineLayoutCreateInfo);
     }
 
     void setupDescriptorSet() {
@@ -694,8 +674,7 @@ public:
         // Vertical blur
         descriptorSets.verticalBlur = device.allocateDescriptorSets(allocInfo)[0];
 
-        vk::DescriptorImageInfo texDescriptorVert =
-            vkx::descriptorImageInfo(offScreenFrameBuf.textureTarget.sampler, offScreenFrameBuf.textureTarget.view, vk::ImageLayout::eGeneral);
+        vk::DescriptorImageInfo texDescriptorVert = renderGraph.descriptor(offscreen.glow);
 
         std::vector<vk::WriteDescriptorSet> writeDescriptorSets =
         {
@@ -724,8 +703,7 @@ public:
         // Horizontal blur
         descriptorSets.horizontalBlur = device.allocateDescriptorSets(allocInfo)[0];
 
-        vk::DescriptorImageInfo texDescriptorHorz =
-            vkx::descriptorImageInfo(offScreenFrameBufB.textureTarget.sampler, offScreenFrameBufB.textureTarget.view, vk::ImageLayout::eGeneral);
+        vk::DescriptorImageInfo texDescriptorHorz = renderGraph.descriptor(offscreen.blur);
 
         writeDescriptorSets =
         {
@@ -790,6 +768,84 @@ public:
         };
 
         device.updateDescriptorSets(writeDescriptorSets, nullptr);
+
+        // Compute bloom
+        descriptorSets.bloomComposite = device.allocateDescriptorSets(allocInfo)[0];
+
+        allocInfo = vkx::descriptorSetAllocateInfo(descriptorPool, &bloomDescriptorSetLayout, 1);
+        for (uint32_t i = 0; i < BLOOM_LEVELS; ++i) {
+            bloomDescriptorSets.downsample[i] = device.allocateDescriptorSets(allocInfo)[0];
+            bloomDescriptorSets.blurHorizontal[i] = device.allocateDescriptorSets(allocInfo)[0];
+            bloomDescriptorSets.blurVertical[i] = device.allocateDescriptorSets(allocInfo)[0];
+            if (i < BLOOM_LEVELS - 1) {
+                bloomDescriptorSets.upsample[i] = device.allocateDescriptorSets(allocInfo)[0];
+            }
+        }
+
+        updateBloomDescriptorSets();
+    }
+
+    // Point the compute bloom descriptor sets to the current mip chains and glow
+    void updateBloomDescriptorSets() {
+        auto update = [&](vk::DescriptorSet descriptorSet, vk::DescriptorImageInfo input, vk::ImageView outputView) {
+            vk::DescriptorImageInfo output = vkx::descriptorImageInfo(vk::Sampler(), outputView, vk::ImageLayout::eGeneral);
+            std::vector<vk::WriteDescriptorSet> writeDescriptorSets =
+            {
+                // Binding 0 : Sampled input level
+                vkx::writeDescriptorSet(
+                    descriptorSet,
+                    vk::DescriptorType::eCombinedImageSampler,
+                    0,
+                    &input),
+                // Binding 1 : Output level
+                vkx::writeDescriptorSet(
+                    descriptorSet,
+                    vk::DescriptorType::eStorageImage,
+                    1,
+                    &output)
+            };
+            device.updateDescriptorSets(writeDescriptorSets, nullptr);
+        };
+        auto level = [&](uint32_t i) {
+            return vkx::descriptorImageInfo(bloomChain.sampler, bloomChain.levelViews[i], vk::ImageLayout::eGeneral);
+        };
+        auto temp = [&](uint32_t i) {
+            return vkx::descriptorImageInfo(bloomChain.sampler, bloomChain.tempViews[i], vk::ImageLayout::eGeneral);
+        };
+
+        for (uint32_t i = 0; i < BLOOM_LEVELS; ++i) {
+            update(bloomDescriptorSets.downsample[i], i == 0 ? computeGraph.descriptor(fullResolution.glow) : level(i - 1), bloomChain.levelViews[i]);
+            update(bloomDescriptorSets.blurHorizontal[i], level(i), bloomChain.tempViews[i]);
+            update(bloomDescriptorSets.blurVertical[i], temp(i), bloomChain.levelViews[i]);
+            if (i < BLOOM_LEVELS - 1) {
+                update(bloomDescriptorSets.upsample[i], level(i + 1), bloomChain.levelViews[i]);
+            }
+        }
+
+        vk::DescriptorImageInfo texDescriptorBloom = level(0);
+        std::vector<vk::WriteDescriptorSet> writeDescriptorSets =
+        {
+            // Binding 0 : Vertex shader uniform buffer
+            vkx::writeDescriptorSet(
+                descriptorSets.bloomComposite,
+                vk::DescriptorType::eUniformBuffer,
+                0,
+                &uniformData.vsScene.descriptor),
+            // Binding 1 : Largest level of the bloom chain
+            vkx::writeDescriptorSet(
+                descriptorSets.bloomComposite,
+                vk::DescriptorType::eCombinedImageSampler,
+                1,
+                &texDescriptorBloom),
+            // Binding 2 : Fragment shader uniform buffer
+            vkx::writeDescriptorSet(
+                descriptorSets.bloomComposite,
+                vk::DescriptorType::eUniformBuffer,
+                2,
+                &uniformData.fsHorzBlur.descriptor)
+        };
+
+        device.updateDescriptorSets(writeDescriptorSets, nullptr);
     }
 
     void preparePipelines() {
@@ -851,7 +907,16 @@ public:
         blendAttachmentState.srcAlphaBlendFactor = vk::BlendFactor::eSrcAlpha;
         blendAttachmentState.dstAlphaBlendFactor = vk::BlendFactor::eDstAlpha;
 
+        pipelines.blurHorz = device.createGraphicsPipelines(pipelineCache, pipelineCreateInfo, nullptr)[0];
+
+        // Same shaders for the vertical blur, rendered by the graph
+        pipelineCreateInfo.renderPass = graphPasses.verticalBlur->renderPass;
         pipelines.blurVert = device.createGraphicsPipelines(pipelineCache, pipelineCreateInfo, nullptr)[0];
+        pipelineCreateInfo.renderPass = renderPass;
+
+        // Composition of the compute bloom, also additive
+        shaderStages[1] = loadGlslShader(getAssetPath() + "shaders/bloom/composite.frag", vk::ShaderStageFlagBits::eFragment, "#define BLOOM_LEVELS " + std::to_string(BLOOM_LEVELS) + "\n");
+        pipelines.bloomComposite = device.createGraphicsPipelines(pipelineCache, pipelineCreateInfo, nullptr)[0];
 
         // Phong pass (3D model)
         shaderStages[0] = loadShader(getAssetPath() + "shaders/bloom/phongpass.vert.spv", vk::ShaderStageFlagBits::eVertex);
@@ -863,6 +928,11 @@ public:
 
         pipelines.phongPass = device.createGraphicsPipelines(pipelineCache, pipelineCreateInfo, nullptr)[0];
 
+        // Glow parts of the model use the same shaders, rendered by the graph
+        pipelineCreateInfo.renderPass = graphPasses.glow->renderPass;
+        pipelines.glowPass = device.createGraphicsPipelines(pipelineCache, pipelineCreateInfo, nullptr)[0];
+        pipelineCreateInfo.renderPass = renderPass;
+
         // Color only pass (offscreen blur base)
         shaderStages[0] = loadShader(getAssetPath() + "shaders/bloom/colorpass.vert.spv", vk::ShaderStageFlagBits::eVertex);
         shaderStages[1] = loadShader(getAssetPath() + "shaders/bloom/colorpass.frag.spv", vk::ShaderStageFlagBits::eFragment);
@@ -874,6 +944,19 @@ public:
         shaderStages[1] = loadShader(getAssetPath() + "shaders/bloom/skybox.frag.spv", vk::ShaderStageFlagBits::eFragment);
         depthStencilState.depthWriteEnable = VK_FALSE;
         pipelines.skyBox = device.createGraphicsPipelines(pipelineCache, pipelineCreateInfo, nullptr)[0];
+
+        // Compute bloom, the storage format of the mip chain is part of the shaders
+        vk::ComputePipelineCreateInfo computePipelineCreateInfo =
+            vkx::computePipelineCreateInfo(pipelineLayouts.bloom);
+        for (uint32_t i = 0; i < bloomPipelines.size(); ++i) {
+            std::string preamble = i == 1 ? "#define BLOOM_FP16\n" : "";
+            computePipelineCreateInfo.stage = loadGlslShader(getAssetPath() + "shaders/bloom/downsample.comp", vk::ShaderStageFlagBits::eCompute, preamble);
+            bloomPipelines[i].downsample = device.createComputePipelines(pipelineCache, computePipelineCreateInfo, nullptr)[0];
+            computePipelineCreateInfo.stage = loadGlslShader(getAssetPath() + "shaders/bloom/blur.comp", vk::ShaderStageFlagBits::eCompute, preamble);
+            bloomPipelines[i].blur = device.createComputePipelines(pipelineCache, computePipelineCreateInfo, nullptr)[0];
+            computePipelineCreateInfo.stage = loadGlslShader(getAssetPath() + "shaders/bloom/upsample.comp", vk::ShaderStageFlagBits::eCompute, preamble);
+            bloomPipelines[i].upsample = device.createComputePipelines(pipelineCache, computePipelineCreateInfo, nullptr)[0];
+        }
     }
 
     // Prepare and initialize uniform buffer containing shader uniforms
@@ -915,10 +998,7 @@ public:
         ubos.fullscreen.model = glm::rotate(ubos.fullscreen.model, glm::radians(timer * 360.0f), glm::vec3(0.0f, 1.0f, 0.0f));
         ubos.fullscreen.model = glm::rotate(ubos.fullscreen.model, glm::radians(rotation.z), glm::vec3(0.0f, 0.0f, 1.0f));
 
-        void *pData;
-        pData = device.mapMemory(uniformData.vsFullScreen.memory, 0, sizeof(ubos.fullscreen), vk::MemoryMapFlags());
-        memcpy(pData, &ubos.fullscreen, sizeof(ubos.fullscreen));
-        device.unmapMemory(uniformData.vsFullScreen.memory);
+        uniformData.vsFullScreen.copy(ubos.fullscreen);
 
         // Skybox
         ubos.skyBox.projection = glm::perspective(glm::radians(45.0f), (float)width / (float)height, 0.1f, 256.0f);
@@ -928,9 +1008,7 @@ public:
         ubos.skyBox.model = glm::rotate(ubos.skyBox.model, glm::radians(rotation.y), glm::vec3(0.0f, 1.0f, 0.0f));
         ubos.skyBox.model = glm::rotate(ubos.skyBox.model, glm::radians(rotation.z), glm::vec3(0.0f, 0.0f, 1.0f));
 
-        pData = device.mapMemory(uniformData.vsSkyBox.memory, 0, sizeof(ubos.skyBox), vk::MemoryMapFlags());
-        memcpy(pData, &ubos.skyBox, sizeof(ubos.skyBox));
-        device.unmapMemory(uniformData.vsSkyBox.memory);
+        uniformData.vsSkyBox.copy(ubos.skyBox);
     }
 
     // Update uniform buffers for the fullscreen quad
@@ -939,23 +1017,16 @@ public:
         ubos.scene.projection = glm::ortho(0.0f, 1.0f, 0.0f, 1.0f, -1.0f, 1.0f);
         ubos.scene.model = glm::mat4();
 
-        void*pData;
-        pData = device.mapMemory(uniformData.vsScene.memory, 0, sizeof(ubos.scene), vk::MemoryMapFlags());
-        memcpy(pData, &ubos.scene, sizeof(ubos.scene));
-        device.unmapMemory(uniformData.vsScene.memory);
+        uniformData.vsScene.copy(ubos.scene);
 
         // Fragment shader
         // Vertical
         ubos.vertBlur.horizontal = 0;
-        pData = device.mapMemory(uniformData.fsVertBlur.memory, 0, sizeof(ubos.vertBlur), vk::MemoryMapFlags());
-        memcpy(pData, &ubos.vertBlur, sizeof(ubos.vertBlur));
-        device.unmapMemory(uniformData.fsVertBlur.memory);
+        uniformData.fsVertBlur.copy(ubos.vertBlur);
 
         // Horizontal
         ubos.horzBlur.horizontal = 1;
-        pData = device.mapMemory(uniformData.fsHorzBlur.memory, 0, sizeof(ubos.horzBlur), vk::MemoryMapFlags());
-        memcpy(pData, &ubos.horzBlur, sizeof(ubos.horzBlur));
-        device.unmapMemory(uniformData.fsHorzBlur.memory);
+        uniformData.fsHorzBlur.copy(ubos.horzBlur);
     }
 
     void draw() override {
@@ -979,8 +1050,9 @@ public:
         loadMeshes();
         setupVertexDescriptions();
         prepareUniformBuffers();
-        prepareTextureTargets();
-        prepareOffscreenFramebuffers();
+        prepareRenderGraph();
+        prepareBloomChain();
+        prepareTimestampQueries();
         setupDescriptorSetLayout();
         preparePipelines();
         setupDescriptorPool();
@@ -994,6 +1066,14 @@ public:
         if (!prepared)
             return;
         draw();
+        if (bloom && computeBloom) {
+            computeGraph.updateTimings();
+            uint64_t timestamps[2];
+            device.getQueryPoolResults(bloomQueryPool, 0, 2, sizeof(timestamps), timestamps, sizeof(uint64_t), vk::QueryResultFlagBits::e64 | vk::QueryResultFlagBits::eWait);
+            bloomComputeTime = (float)(timestamps[1] - timestamps[0]) * deviceProperties.limits.timestampPeriod / 1000000.0f;
+        } else if (bloom) {
+            renderGraph.updateTimings();
+        }
         if (!paused) {
             updateUniformBuffersScene();
         }
@@ -1004,6 +1084,19 @@ public:
         updateUniformBuffersScreen();
     }
 
+    // The compute bloom follows the window resolution
+    virtual void windowResized() {
+        vk::Extent2D windowExtent{ width, height };
+        computeGraph.setExtent(fullResolution.glow, windowExtent);
+        computeGraph.setExtent(fullResolution.depth, windowExtent);
+        computeGraph.compile();
+        destroyBloomChain();
+        prepareBloomChain();
+        // Updating the descriptor sets invalidates the command buffers using them
+        updateBloomDescriptorSets();
+        buildCommandBuffers();
+    }
+
     virtual void keyPressed(uint32_t keyCode) {
         switch (keyCode) {
         case GLFW_KEY_KP_ADD:
@@ -1018,6 +1111,14 @@ public:
         case GAMEPAD_BUTTON_A:
             toggleBloom();
             break;
+        case GLFW_KEY_C:
+        case GAMEPAD_BUTTON_X:
+            toggleComputeBloom();
+            break;
+        case GLFW_KEY_F:
+        case GAMEPAD_BUTTON_Y:
+            toggleBloomFormat();
+            break;
         }
     }
 
@@ -1025,22 +1126,56 @@ public:
 #if defined(__ANDROID__)
         textOverlay->addText("Press \"L1/R1\" to change blur scale", 5.0f, 85.0f, vkx::TextOverlay::alignLeft);
         textOverlay->addText("Press \"Button A\" to toggle bloom", 5.0f, 105.0f, vkx::TextOverlay::alignLeft);
+        textOverlay->addText("Press \"Button X\" to toggle compute, \"Button Y\" to toggle FP16", 5.0f, 125.0f, vkx::TextOverlay::alignLeft);
 #else
         textOverlay->addText("Press \"NUMPAD +/-\" to change blur scale", 5.0f, 85.0f, vkx::TextOverlay::alignLeft);
         textOverlay->addText("Press \"B\" to toggle bloom", 5.0f, 105.0f, vkx::TextOverlay::alignLeft);
+        textOverlay->addText("Press \"C\" to toggle compute, \"F\" to toggle FP16", 5.0f, 125.0f, vkx::TextOverlay::alignLeft);
 #endif
+        std::stringstream ss;
+        ss << std::fixed << std::setprecision(3);
+        if (computeBloom) {
+            ss << "Compute bloom (" << (bloomFp16 ? "FP16" : "8-bit") << ", " << width << "x" << height << "): ";
+            ss << computeGraph.gpuTime << " ms glow + " << bloomComputeTime << " ms mip chain";
+        } else {
+            ss << "Fragment bloom (" << FB_DIM << "x" << FB_DIM << "): " << renderGraph.gpuTime << " ms";
+        }
+        textOverlay->addText(ss.str(), 5.0f, 145.0f, vkx::TextOverlay::alignLeft);
+        ss.str("");
+        ss << "Offscreen images: " << renderGraph.memoryStats.allocated / 1024 << " KB (" << renderGraph.memoryStats.required / 1024 << " KB without aliasing)";
+        textOverlay->addText(ss.str(), 5.0f, 165.0f, vkx::TextOverlay::alignLeft);
     }
 
     void changeBlurScale(float delta) {
         ubos.vertBlur.blurScale += delta;
         ubos.horzBlur.blurScale += delta;
         updateUniformBuffersScreen();
+        // The upsample radius is a push constant
+        if (bloom && computeBloom) {
+            buildOffscreenCommandBuffer();
+        }
     }
 
     void toggleBloom() {
         bloom = !bloom;
         reBuildCommandBuffers();
     }
+
+    void toggleComputeBloom() {
+        computeBloom = !computeBloom;
+        reBuildCommandBuffers();
+        updateTextOverlay();
+    }
+
+    void toggleBloomFormat() {
+        bloomFp16 = !bloomFp16;
+        device.waitIdle();
+        destroyBloomChain();
+        prepareBloomChain();
+        updateBloomDescriptorSets();
+        reBuildCommandBuffers();
+        updateTextOverlay();
+    }
 };
 
 RUN_EXAMPLE(VulkanExample)
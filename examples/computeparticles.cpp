@@ -85,8 +85,7 @@ public:
 
         device.destroyPipelineLayout(pipelineLayout);
         device.destroyDescriptorSetLayout(descriptorSetLayout);
-        device.destroyBuffer(computeStorageBuffer.buffer);
-        device.freeMemory(computeStorageBuffer.memory);
+        computeStorageBuffer.destroy();
 
         uniformData.computeShader.ubo.destroy();
 
@@ -45,8 +45,15 @@ public:
         uint32_t computeIndex{ 0 };
     } pipelines;
 
+    // Dedicated compute queue if the device has one, compute then overlaps with rendering
     vk::Queue computeQueue;
     vk::CommandBuffer computeCmdBuffer;
+    // Orders the compute and graphics submissions, the images are handed over between them
+    struct {
+        vk::Semaphore computeComplete;
+        vk::Semaphore graphicsComplete;
+        bool graphicsSubmitted{ false };
+    } computeSync;
     vk::PipelineLayout computePipelineLayout;
     vk::DescriptorSet computeDescriptorSet;
     vk::DescriptorSetLayout computeDescriptorSetLayout;
@@ -71,7 +78,9 @@ public:
         // Note : Inherited destructor cleans up resources stored in base class
         device.destroyPipelineLayout(computePipelineLayout);
         device.destroyDescriptorSetLayout(computeDescriptorSetLayout);
-        device.freeCommandBuffers(cmdPool, computeCmdBuffer);
+        device.freeCommandBuffers(getCommandPool(vkx::QueueType::Compute), computeCmdBuffer);
+        device.destroySemaphore(computeSync.computeComplete);
+        device.destroySemaphore(computeSync.graphicsComplete);
         //device.freeDescriptorSets(descriptorPool, computeDescriptorSet);
 
 
@@ -184,18 +193,9 @@ public:
 
             drawCmdBuffers[i].begin(cmdBufInfo);
 
-            // vk::Image memory barrier to make sure that compute
-            // shader writes are finished before sampling
-            // from the texture
-            vk::ImageMemoryBarrier imageMemoryBarrier;
-            imageMemoryBarrier.oldLayout = vk::ImageLayout::eGeneral;
-            imageMemoryBarrier.newLayout = vk::ImageLayout::eGeneral;
-            imageMemoryBarrier.image = textureComputeTarget.image;
-            imageMemoryBarrier.subresourceRange = { vk::ImageAspectFlagBits::eColor, 0, 1, 0, 1 };
-            imageMemoryBarrier.srcAccessMask = vk::AccessFlagBits::eShaderWrite;
-            imageMemoryBarrier.dstAccessMask = vk::AccessFlagBits::eInputAttachmentRead;
-            // todo : use different pipeline stage bits
-            drawCmdBuffers[i].pipelineBarrier(vk::PipelineStageFlagBits::eTopOfPipe, vk::PipelineStageFlagBits::eTopOfPipe, vk::DependencyFlags(), nullptr, nullptr, imageMemoryBarrier);
+            // Take the images over from the compute queue, the submission waits
+            // for the compute shader writes with a semaphore
+            handOverImages(drawCmdBuffers[i], false, vkx::QueueType::Compute, vkx::QueueType::Graphics, vk::AccessFlagBits::eShaderRead, vk::PipelineStageFlagBits::eFragmentShader);
 
             drawCmdBuffers[i].beginRenderPass(renderPassBeginInfo, vk::SubpassContents::eInline);
 
@@ -225,6 +225,9 @@ public:
 
             drawCmdBuffers[i].endRenderPass();
 
+            // Hand them back for the next dispatch
+            handOverImages(drawCmdBuffers[i], true, vkx::QueueType::Graphics, vkx::QueueType::Compute, vk::AccessFlagBits::eShaderRead, vk::PipelineStageFlagBits::eFragmentShader);
+
             drawCmdBuffers[i].end();
         }
 
@@ -232,16 +235,32 @@ public:
 
     void buildComputeCommandBuffer() {
         // FIXME find a better way to block on re-using the compute command, or build multiple command buffers
-        queue.waitIdle();
+        computeQueue.waitIdle();
         vk::CommandBufferBeginInfo cmdBufInfo;
 
         computeCmdBuffer.begin(cmdBufInfo);
+        handOverImages(computeCmdBuffer, false, vkx::QueueType::Graphics, vkx::QueueType::Compute, vk::AccessFlagBits::eShaderWrite, vk::PipelineStageFlagBits::eComputeShader);
         computeCmdBuffer.bindPipeline(vk::PipelineBindPoint::eCompute, pipelines.compute[pipelines.computeIndex]);
         computeCmdBuffer.bindDescriptorSets(vk::PipelineBindPoint::eCompute, computePipelineLayout, 0, computeDescriptorSet, nullptr);
         computeCmdBuffer.dispatch(textureComputeTarget.extent.width / 16, textureComputeTarget.extent.height / 16, 1);
+        handOverImages(computeCmdBuffer, true, vkx::QueueType::Compute, vkx::QueueType::Graphics, vk::AccessFlagBits::eShaderWrite, vk::PipelineStageFlagBits::eComputeShader);
         computeCmdBuffer.end();
     }
 
+    // Both images are used by both queues and are exclusive to one queue family at a time, so
+    // they are released and acquired around each submission (no-ops if both queues share a family)
+    void handOverImages(const vk::CommandBuffer& cmdBuffer, bool release, vkx::QueueType srcQueue, vkx::QueueType dstQueue, const vk::AccessFlags& targetAccess, const vk::PipelineStageFlags& stage) {
+        vk::ImageSubresourceRange colorMapRange = { vk::ImageAspectFlagBits::eColor, 0, textureColorMap.mipLevels, 0, 1 };
+        vk::ImageSubresourceRange targetRange = { vk::ImageAspectFlagBits::eColor, 0, 1, 0, 1 };
+        if (release) {
+            releaseImage(cmdBuffer, textureColorMap.image, colorMapRange, textureColorMap.imageLayout, textureColorMap.imageLayout, srcQueue, dstQueue, vk::AccessFlagBits::eShaderRead, stage);
+            releaseImage(cmdBuffer, textureComputeTarget.image, targetRange, vk::ImageLayout::eGeneral, vk::ImageLayout::eGeneral, srcQueue, dstQueue, targetAccess, stage);
+        } else {
+            acquireImage(cmdBuffer, textureColorMap.image, colorMapRange, textureColorMap.imageLayout, textureColorMap.imageLayout, srcQueue, dstQueue, vk::AccessFlagBits::eShaderRead, stage);
+            acquireImage(cmdBuffer, textureComputeTarget.image, targetRange, vk::ImageLayout::eGeneral, vk::ImageLayout::eGeneral, srcQueue, dstQueue, targetAccess, stage);
+        }
+    }
+
     // Setup vertices for a single uv-mapped quad
     void generateQuad() {
 #define dim 1.0f
@@ -387,9 +406,9 @@ public:
 
     // Create a separate command buffer for compute commands
     void createComputeCommandBuffer() {
-        vk::CommandBufferAllocateInfo cmdBufAllocateInfo =
-            vkx::commandBufferAllocateInfo(cmdPool, vk::CommandBufferLevel::ePrimary, 1);
-        computeCmdBuffer = device.allocateCommandBuffers(cmdBufAllocateInfo)[0];
+        computeCmdBuffer = createCommandBuffer(vk::CommandBufferLevel::ePrimary, false, vkx::QueueType::Compute);
+        computeSync.computeComplete = device.createSemaphore(vk::SemaphoreCreateInfo());
+        computeSync.graphicsComplete = device.createSemaphore(vk::SemaphoreCreateInfo());
     }
 
     void preparePipelines() {
@@ -545,38 +564,53 @@ public:
         uboVS.model = glm::rotate(uboVS.model, glm::radians(rotation.y), glm::vec3(0.0f, 1.0f, 0.0f));
         uboVS.model = glm::rotate(uboVS.model, glm::radians(rotation.z), glm::vec3(0.0f, 0.0f, 1.0f));
 
-        void *pData = device.mapMemory(uniformDataVS.memory, 0, sizeof(uboVS), vk::MemoryMapFlags());
-        memcpy(pData, &uboVS, sizeof(uboVS));
-        device.unmapMemory(uniformDataVS.memory);
+        uniformDataVS.copy(uboVS);
     }
 
-    // Find and create a compute capable device queue
+    // Get the compute queue created by the context
     void getComputeQueue() {
-        uint32_t queueIndex = 0;
-        std::vector<vk::QueueFamilyProperties> queueProps = physicalDevice.getQueueFamilyProperties();
-        uint32_t queueCount = queueProps.size();
-
-        for (queueIndex = 0; queueIndex < queueCount; queueIndex++) {
-            if (queueProps[queueIndex].queueFlags & vk::QueueFlagBits::eCompute)
-                break;
-        }
-        assert(queueIndex < queueCount);
-
-        vk::DeviceQueueCreateInfo queueCreateInfo;
-        queueCreateInfo.queueFamilyIndex = queueIndex;
-        queueCreateInfo.queueCount = 1;
-        computeQueue = device.getQueue(queueIndex, 0);
+        computeQueue = getQueue(vkx::QueueType::Compute);
     }
 
     void compute() {
-        // Submit compute
+        // Submit compute, waits for the previous frame to release the images
+        vk::PipelineStageFlags waitStage = vk::PipelineStageFlagBits::eComputeShader;
         vk::SubmitInfo computeSubmitInfo = vk::SubmitInfo();
+        if (computeSync.graphicsSubmitted) {
+            computeSubmitInfo.waitSemaphoreCount = 1;
+            computeSubmitInfo.pWaitSemaphores = &computeSync.graphicsComplete;
+            computeSubmitInfo.pWaitDstStageMask = &waitStage;
+        }
         computeSubmitInfo.commandBufferCount = 1;
         computeSubmitInfo.pCommandBuffers = &computeCmdBuffer;
+        computeSubmitInfo.signalSemaphoreCount = 1;
+        computeSubmitInfo.pSignalSemaphores = &computeSync.computeComplete;
 
         computeQueue.submit(computeSubmitInfo, VK_NULL_HANDLE);
     }
 
+    void draw() override {
+        prepareFrame();
+
+        // Wait for the swap chain image and the compute results, signal the frame as rendered
+        // and the target image as released to the compute queue
+        std::array<vk::Semaphore, 2> waitSemaphores = { semaphores.presentComplete, computeSync.computeComplete };
+        std::array<vk::PipelineStageFlags, 2> waitStages = { submitPipelineStages, vk::PipelineStageFlagBits::eFragmentShader };
+        std::array<vk::Semaphore, 2> signalSemaphores = { semaphores.renderComplete, computeSync.graphicsComplete };
+        vk::SubmitInfo graphicsSubmitInfo;
+        graphicsSubmitInfo.waitSemaphoreCount = (uint32_t)waitSemaphores.size();
+        graphicsSubmitInfo.pWaitSemaphores = waitSemaphores.data();
+        graphicsSubmitInfo.pWaitDstStageMask = waitStages.data();
+        graphicsSubmitInfo.commandBufferCount = 1;
+        graphicsSubmitInfo.pCommandBuffers = &drawCmdBuffers[currentBuffer];
+        graphicsSubmitInfo.signalSemaphoreCount = (uint32_t)signalSemaphores.size();
+        graphicsSubmitInfo.pSignalSemaphores = signalSemaphores.data();
+        queue.submit(graphicsSubmitInfo, VK_NULL_HANDLE);
+        computeSync.graphicsSubmitted = true;
+
+        submitFrame();
+    }
+
     void prepare() {
         ExampleBase::prepare();
         loadTextures();
@@ -586,6 +620,10 @@ public:
         setupVertexDescriptions();
         prepareUniformBuffers();
         prepareTextureTarget(textureComputeTarget, textureColorMap.extent.width, textureColorMap.extent.height, vk::Format::eR8G8B8A8Unorm);
+        // Both images were initialized on the graphics queue, release them to the first dispatch
+        withPrimaryCommandBuffer([&](const vk::CommandBuffer& releaseCmd) {
+            handOverImages(releaseCmd, true, vkx::QueueType::Graphics, vkx::QueueType::Compute, vk::AccessFlagBits::eShaderWrite, vk::PipelineStageFlagBits::eAllCommands);
+        });
         setupDescriptorSetLayout();
         preparePipelines();
         setupDescriptorPool();
@@ -599,8 +637,8 @@ public:
     virtual void render() {
         if (!prepared)
             return;
-        draw();
         compute();
+        draw();
     }
 
     virtual void viewChanged() {
@@ -7,12 +7,13 @@
 */
 
 #include "vulkanExampleBase.h"
+#include "vulkanRenderGraph.h"
 
 
 // Offscreen properties
 #define OFFSCREEN_DIM 256
 #define OFFSCREEN_FORMAT  vk::Format::eR8G8B8A8Unorm
-#define OFFSCREEN_FILTER vk::Filter::eLinear;
+#define OFFSCREEN_FILTER vk::Filter::eLinear
 
 // Extension spec can be found at https://github.com/KhronosGroup/Vulkan-Docs/blob/1.0-VK_EXT_debug_marker/doc/specs/vulkan/appendices/VK_EXT_debug_marker.txt
 // Note that the extension will only be present if run from an offline debugging application
@@ -170,15 +171,14 @@ public:
         vk::DescriptorSet fullscreen;
     } descriptorSets;
 
-    // vk::Framebuffer for offscreen rendering
-    using FrameBufferAttachment = CreateImageResult;
-
-    struct FrameBuffer {
-        int32_t width, height;
-        vk::Framebuffer frameBuffer;
-        FrameBufferAttachment color, depth;
-        vkx::Texture textureTarget;
-    } offScreenFrameBuf;
+    // Render graph for the color only glow pass, its color attachment
+    // is sampled directly by the post processing
+    vkx::RenderGraph renderGraph{ *this };
+    struct {
+        vkx::RenderGraph::Resource color;
+        vkx::RenderGraph::Resource depth;
+    } offscreen;
+    vkx::RenderGraph::Pass* glowPass{ nullptr };
 
     vk::CommandBuffer offScreenCmdBuffer;
 
@@ -216,268 +216,44 @@ public:
 
         uniformData.vsScene.destroy();
 
-        // Offscreen
-        // Texture target
-        offScreenFrameBuf.textureTarget.destroy();
-        // Frame buffer
-        device.destroyFramebuffer(offScreenFrameBuf.frameBuffer);
-        // Color attachment
-        offScreenFrameBuf.color.destroy();
-        // Depth attachment
-        offScreenFrameBuf.depth.destroy();
+        // Offscreen images, render pass and framebuffer
+        renderGraph.destroy();
     }
 
-    // Prepare a texture target and framebuffer for offscreen rendering
+    // Declare the offscreen glow pass, the render graph creates the
+    // images, render pass and framebuffer and names them for debugging
     void prepareOffscreen() {
-        vk::CommandBuffer cmdBuffer = ExampleBase::createCommandBuffer(vk::CommandBufferLevel::ePrimary, true);
-
-         vk::FormatProperties formatProperties;
-
-        // Get device properites for the requested texture format
-        formatProperties = physicalDevice.getFormatProperties(OFFSCREEN_FORMAT);
-        // Check if blit destination is supported for the requested format
-        // Only try for optimal tiling, linear tiling usually won't support blit as destination anyway
-        assert(formatProperties.optimalTilingFeatures &  vk::FormatFeatureFlagBits::eBlitDst);
-
-        // Texture target
-
-        auto& tex = offScreenFrameBuf.textureTarget;
-
-        // Prepare blit target texture
-        tex.extent.width = OFFSCREEN_DIM;
-        tex.extent.height = OFFSCREEN_DIM;
-
-        vk::ImageCreateInfo imageCreateInfo;
-        imageCreateInfo.imageType = vk::ImageType::e2D;
-        imageCreateInfo.format = OFFSCREEN_FORMAT;
-        imageCreateInfo.extent = vk::Extent3D{ OFFSCREEN_DIM, OFFSCREEN_DIM, 1 };
-        imageCreateInfo.mipLevels = 1;
-        imageCreateInfo.arrayLayers = 1;
-        imageCreateInfo.samples = vk::SampleCountFlagBits::e1;
-        imageCreateInfo.tiling = vk::ImageTiling::eOptimal;
-        imageCreateInfo.sharingMode = vk::SharingMode::eExclusive;
-        // Texture will be sampled in a shader and is also the blit destination
-        imageCreateInfo.usage = vk::ImageUsageFlagBits::eSampled | vk::ImageUsageFlagBits::eTransferDst;
-
-        offScreenFrameBuf.textureTarget = createImage(imageCreateInfo, vk::MemoryPropertyFlagBits::eDeviceLocal);
-
-        // Transform image layout to transfer destination
-        tex.imageLayout = vk::ImageLayout::eShaderReadOnlyOptimal;
-        vkx::setImageLayout(
-            cmdBuffer,
-            tex.image,
-            vk::ImageAspectFlagBits::eColor,
-            vk::ImageLayout::eUndefined,
-            tex.imageLayout);
-
-        // Create sampler
-        vk::SamplerCreateInfo sampler;
-        sampler.magFilter = OFFSCREEN_FILTER;
-        sampler.minFilter = OFFSCREEN_FILTER;
-        sampler.mipmapMode = vk::SamplerMipmapMode::eLinear;
-        sampler.addressModeU = vk::SamplerAddressMode::eClampToEdge;
-        sampler.addressModeV = sampler.addressModeU;
-        sampler.addressModeW = sampler.addressModeU;
-        sampler.mipLodBias = 0.0f;
-        sampler.maxAnisotropy = 0;
-        sampler.compareOp = vk::CompareOp::eNever;
-        sampler.minLod = 0.0f;
-        sampler.maxLod = 0.0f;
-        sampler.borderColor = vk::BorderColor::eFloatOpaqueWhite;
-        tex.sampler = device.createSampler(sampler);
-
-        // Create image view
-        vk::ImageViewCreateInfo view;
-        view.image;
-        view.viewType = vk::ImageViewType::e2D;
-        view.format = OFFSCREEN_FORMAT;
-        view.components = { vk::ComponentSwizzle::eR, vk::ComponentSwizzle::eG, vk::ComponentSwizzle::eB, vk::ComponentSwizzle::eA };
-        view.subresourceRange = { vk::ImageAspectFlagBits::eColor, 0, 1, 0, 1 };
-        view.image = tex.image;
-        tex.view = device.createImageView(view);
+        vk::Extent2D extent{ OFFSCREEN_DIM, OFFSCREEN_DIM };
+        offscreen.color = renderGraph.createImage("Off-screen color framebuffer", OFFSCREEN_FORMAT, extent, OFFSCREEN_FILTER);
+        offscreen.depth = renderGraph.createImage("Off-screen depth framebuffer", vkx::getSupportedDepthFormat(physicalDevice), extent);
+        renderGraph.markOutput(offscreen.color);
 
-        // Name for debugging
-        DebugMarker::setObjectName(device, (uint64_t)(VkImage)tex.image, VK_DEBUG_REPORT_OBJECT_TYPE_IMAGE_EXT, "Off-screen texture target image");
-        DebugMarker::setObjectName(device, (uint64_t)(VkSampler)tex.sampler, VK_DEBUG_REPORT_OBJECT_TYPE_SAMPLER_EXT, "Off-screen texture target sampler");
-
-        // Frame buffer
-        offScreenFrameBuf.width = OFFSCREEN_DIM;
-        offScreenFrameBuf.height = OFFSCREEN_DIM;
-
-        // Find a suitable depth format
-         vk::Format fbDepthFormat = vkx::getSupportedDepthFormat(physicalDevice);
-
-        // Color attachment
-        vk::ImageCreateInfo image;
-        image.imageType = vk::ImageType::e2D;
-        image.format = OFFSCREEN_FORMAT;
-        image.extent.width = offScreenFrameBuf.width;
-        image.extent.height = offScreenFrameBuf.height;
-        image.extent.depth = 1;
-        image.mipLevels = 1;
-        image.arrayLayers = 1;
-        image.samples = vk::SampleCountFlagBits::e1;
-        image.tiling = vk::ImageTiling::eOptimal;
-        // vk::Image of the framebuffer is blit source
-        image.usage = vk::ImageUsageFlagBits::eColorAttachment | vk::ImageUsageFlagBits::eTransferSrc;
-
-        vk::ImageViewCreateInfo colorImageView;
-        colorImageView.viewType = vk::ImageViewType::e2D;
-        colorImageView.format = OFFSCREEN_FORMAT;
-        colorImageView.subresourceRange.aspectMask = vk::ImageAspectFlagBits::eColor;
-        colorImageView.subresourceRange.levelCount = 1;
-        colorImageView.subresourceRange.layerCount = 1;
-
-        offScreenFrameBuf.color = createImage(image, vk::MemoryPropertyFlagBits::eDeviceLocal);
-
-
-        vkx::setImageLayout(
-            cmdBuffer,
-            offScreenFrameBuf.color.image,
-            vk::ImageAspectFlagBits::eColor,
-            vk::ImageLayout::eUndefined,
-            vk::ImageLayout::eColorAttachmentOptimal);
-
-        colorImageView.image = offScreenFrameBuf.color.image;
-        offScreenFrameBuf.color.view = device.createImageView(colorImageView);
-
-        // Depth stencil attachment
-        image.format = fbDepthFormat;
-        image.usage = vk::ImageUsageFlagBits::eDepthStencilAttachment;
-
-        vk::ImageViewCreateInfo depthStencilView;
-        depthStencilView.viewType = vk::ImageViewType::e2D;
-        depthStencilView.format = fbDepthFormat;
-        depthStencilView.subresourceRange.aspectMask = vk::ImageAspectFlagBits::eDepth | vk::ImageAspectFlagBits::eStencil;
-        depthStencilView.subresourceRange.levelCount = 1;
-        depthStencilView.subresourceRange.layerCount = 1;
-
-        offScreenFrameBuf.depth = createImage(image, vk::MemoryPropertyFlagBits::eDeviceLocal);
-
-        vkx::setImageLayout(
-            cmdBuffer,
-            offScreenFrameBuf.depth.image,
-            vk::ImageAspectFlagBits::eDepth | vk::ImageAspectFlagBits::eStencil,
-            vk::ImageLayout::eUndefined,
-            vk::ImageLayout::eDepthStencilAttachmentOptimal);
-
-        depthStencilView.image = offScreenFrameBuf.depth.image;
-        offScreenFrameBuf.depth.view = device.createImageView(depthStencilView);
-
-        vk::ImageView attachments[2];
-        attachments[0] = offScreenFrameBuf.color.view;
-        attachments[1] = offScreenFrameBuf.depth.view;
-
-        vk::FramebufferCreateInfo fbufCreateInfo;
-        fbufCreateInfo.renderPass = renderPass;
-        fbufCreateInfo.attachmentCount = 2;
-        fbufCreateInfo.pAttachments = attachments;
-        fbufCreateInfo.width = offScreenFrameBuf.width;
-        fbufCreateInfo.height = offScreenFrameBuf.height;
-        fbufCreateInfo.layers = 1;
-        offScreenFrameBuf.frameBuffer = device.createFramebuffer(fbufCreateInfo);
-
-        ExampleBase::flushCommandBuffer(cmdBuffer, true);
+        glowPass = &renderGraph.addPass("Off-screen glow")
+            .writeColor(offscreen.color, glm::vec4(0.0f))
+            .writeDepth(offscreen.depth)
+            .setRecord([this](const vk::CommandBuffer& cmdBuffer) {
+                cmdBuffer.bindDescriptorSets(vk::PipelineBindPoint::eGraphics, pipelineLayout, 0, descriptorSets.scene, nullptr);
+                cmdBuffer.bindPipeline(vk::PipelineBindPoint::eGraphics, pipelines.color);
+
+                // Draw glow scene
+                sceneGlow.draw(cmdBuffer);
+            });
+
+        renderGraph.compile();
 
         // Command buffer for offscreen rendering
         offScreenCmdBuffer = ExampleBase::createCommandBuffer(vk::CommandBufferLevel::ePrimary, false);
-
-        // Name for debugging
-        DebugMarker::setObjectName(device, (uint64_t)(VkImage)offScreenFrameBuf.color.image, VK_DEBUG_REPORT_OBJECT_TYPE_IMAGE_EXT, "Off-screen color framebuffer");
-        DebugMarker::setObjectName(device, (uint64_t)(VkImage)offScreenFrameBuf.depth.image, VK_DEBUG_REPORT_OBJECT_TYPE_IMAGE_EXT, "Off-screen depth framebuffer");
     }
 
     // Command buffer for rendering color only scene for glow
     void buildOffscreenCommandBuffer() {
         vk::CommandBufferBeginInfo cmdBufInfo;
-
-        vk::ClearValue clearValues[2];
-        clearValues[0].color = vkx::clearColor(glm::vec4(0));
-        clearValues[1].depthStencil = { 1.0f, 0 };
-
-        vk::RenderPassBeginInfo renderPassBeginInfo;
-        renderPassBeginInfo.renderPass = renderPass;
-        renderPassBeginInfo.framebuffer = offScreenFrameBuf.frameBuffer;
-        renderPassBeginInfo.renderArea.extent.width = offScreenFrameBuf.width;
-        renderPassBeginInfo.renderArea.extent.height = offScreenFrameBuf.height;
-        renderPassBeginInfo.clearValueCount = 2;
-        renderPassBeginInfo.pClearValues = clearValues;
-
         offScreenCmdBuffer.begin(cmdBufInfo);
 
         // Start a new debug marker region
         DebugMarker::beginRegion(offScreenCmdBuffer, "Off-screen scene rendering", glm::vec4(1.0f, 0.78f, 0.05f, 1.0f));
 
-        vk::Viewport viewport = vkx::viewport((float)offScreenFrameBuf.width, (float)offScreenFrameBuf.height, 0.0f, 1.0f);
-        offScreenCmdBuffer.setViewport(0, viewport);
-
-        vk::Rect2D scissor = vkx::rect2D(offScreenFrameBuf.width, offScreenFrameBuf.height, 0, 0);
-        offScreenCmdBuffer.setScissor(0, scissor);
-
-        offScreenCmdBuffer.beginRenderPass(renderPassBeginInfo, vk::SubpassContents::eInline);
-
-        offScreenCmdBuffer.bindDescriptorSets(vk::PipelineBindPoint::eGraphics, pipelineLayout, 0, descriptorSets.scene, nullptr);
-        offScreenCmdBuffer.bindPipeline(vk::PipelineBindPoint::eGraphics, pipelines.color);
-
-        // Draw glow scene
-        sceneGlow.draw(offScreenCmdBuffer);
-
-        offScreenCmdBuffer.endRenderPass();
-
-        // Make sure color writes to the framebuffer are finished before using it as transfer source
-        vkx::setImageLayout(
-            offScreenCmdBuffer,
-            offScreenFrameBuf.color.image,
-            vk::ImageAspectFlagBits::eColor,
-            vk::ImageLayout::eColorAttachmentOptimal,
-            vk::ImageLayout::eTransferSrcOptimal);
-
-        // Transform texture target to transfer destination
-        vkx::setImageLayout(
-            offScreenCmdBuffer,
-            offScreenFrameBuf.textureTarget.image,
-            vk::ImageAspectFlagBits::eColor,
-            vk::ImageLayout::eShaderReadOnlyOptimal,
-            vk::ImageLayout::eTransferDstOptimal);
-
-        // Blit offscreen color buffer to our texture target
-        vk::ImageBlit imgBlit;
-
-        imgBlit.srcSubresource.aspectMask = vk::ImageAspectFlagBits::eColor;
-        imgBlit.srcSubresource.layerCount = 1;
-
-        imgBlit.srcOffsets[1].x = offScreenFrameBuf.width;
-        imgBlit.srcOffsets[1].y = offScreenFrameBuf.height;
-        imgBlit.srcOffsets[1].z = 1;
-
-        imgBlit.dstSubresource.aspectMask = vk::ImageAspectFlagBits::eColor;
-        imgBlit.dstSubresource.layerCount = 1;
-
-        imgBlit.dstOffsets[1].x = offScreenFrameBuf.textureTarget.extent.width;
-        imgBlit.dstOffsets[1].y = offScreenFrameBuf.textureTarget.extent.height;
-        imgBlit.dstOffsets[1].z = 1;
-
-        // Blit from framebuffer image to texture image
-        // vkCmdBlitImage does scaling and (if necessary and possible) also does format conversions
-        offScreenCmdBuffer.blitImage(offScreenFrameBuf.color.image, vk::ImageLayout::eTransferSrcOptimal, offScreenFrameBuf.textureTarget.image, vk::ImageLayout::eTransferDstOptimal, imgBlit, vk::Filter::eLinear);
-
-        // Transform framebuffer color attachment back 
-        vkx::setImageLayout(
-            offScreenCmdBuffer,
-            offScreenFrameBuf.color.image,
-            vk::ImageAspectFlagBits::eColor,
-            vk::ImageLayout::eTransferSrcOptimal,
-            vk::ImageLayout::eColorAttachmentOptimal);
-
-        // Transform texture target back to shader read
-        // Makes sure that writes to the texture are finished before
-        // it's accessed in the shader
-        vkx::setImageLayout(
-            offScreenCmdBuffer,
-            offScreenFrameBuf.textureTarget.image,
-            vk::ImageAspectFlagBits::eColor,
-            vk::ImageLayout::eTransferDstOptimal,
-            vk::ImageLayout::eShaderReadOnlyOptimal);
+        renderGraph.execute(offScreenCmdBuffer);
 
         DebugMarker::endRegion(offScreenCmdBuffer);
 
@@ -739,8 +515,7 @@ public:
 
         descriptorSets.scene = device.allocateDescriptorSets(allocInfo)[0];
 
-        vk::DescriptorImageInfo texDescriptor =
-            vkx::descriptorImageInfo(offScreenFrameBuf.textureTarget.sampler, offScreenFrameBuf.textureTarget.view, vk::ImageLayout::eGeneral);
+        vk::DescriptorImageInfo texDescriptor = renderGraph.descriptor(offscreen.color);
 
         std::vector<vk::WriteDescriptorSet> writeDescriptorSets =
         {
@@ -817,7 +592,10 @@ public:
         shaderStages[0] = loadShader(getAssetPath() + "shaders/debugmarker/colorpass.vert.spv", vk::ShaderStageFlagBits::eVertex);
         shaderStages[1] = loadShader(getAssetPath() + "shaders/debugmarker/colorpass.frag.spv", vk::ShaderStageFlagBits::eFragment);
 
+        // Only used by the offscreen glow pass
+        pipelineCreateInfo.renderPass = glowPass->renderPass;
         pipelines.color = device.createGraphicsPipelines(pipelineCache, pipelineCreateInfo, nullptr)[0];
+        pipelineCreateInfo.renderPass = renderPass;
 
         // Wire frame rendering pipeline
         rasterizationState.polygonMode = vk::PolygonMode::eLine;
@@ -923,6 +701,9 @@ public:
         if (!prepared)
             return;
         draw();
+        if (glow) {
+            renderGraph.updateTimings();
+        }
     }
 
     virtual void viewChanged() {
@@ -950,6 +731,13 @@ public:
         } else {
             textOverlay->addText("VK_EXT_debug_marker not present", 5.0f, 85.0f, vkx::TextOverlay::alignLeft);
         }
+        std::stringstream ss;
+        ss << std::fixed << std::setprecision(3);
+        ss << "Offscreen passes: " << renderGraph.gpuTime << " ms";
+        textOverlay->addText(ss.str(), 5.0f, 105.0f, vkx::TextOverlay::alignLeft);
+        ss.str("");
+        ss << "Offscreen images: " << renderGraph.memoryStats.allocated / 1024 << " KB (" << renderGraph.memoryStats.required / 1024 << " KB without aliasing)";
+        textOverlay->addText(ss.str(), 5.0f, 125.0f, vkx::TextOverlay::alignLeft);
     }
 };
 
@@ -9,14 +9,21 @@
 
 
 #include "vulkanExampleBase.h"
+#include "vulkanRenderGraph.h"
 
 
-// Texture properties
-#define TEX_DIM 1024
-#define TEX_FILTER vk::Filter::eLinear
-
 // Offscreen frame buffer properties
-#define FB_DIM TEX_DIM
+#define FB_DIM 1024
+#define FB_FILTER vk::Filter::eLinear
+
+// Light clusters, must match cluster.comp and deferred.frag
+#define CLUSTER_X 16
+#define CLUSTER_Y 16
+#define CLUSTER_Z 32
+#define CLUSTER_COUNT (CLUSTER_X * CLUSTER_Y * CLUSTER_Z)
+#define MAX_LIGHTS_PER_CLUSTER 256
+#define MIN_LIGHT_COUNT 16
+#define MAX_LIGHT_COUNT 16384
 
 // Vertex layout for this example
 std::vector<vkx::VertexLayout> vertexLayout =
@@ -61,11 +68,27 @@ public:
         float _pad;
     };
 
+    std::vector<Light> lights;
+
     struct {
-        Light lights[5];
+        glm::mat4 view;
+        glm::mat4 projection;
         glm::vec4 viewPos;
+        // View space depth range covered by the exponential depth slices
+        glm::vec2 clusterDepthRange = glm::vec2(1.0f, 64.0f);
+        uint32_t lightCount = 1024;
+        // Read per cluster light lists instead of looping over all lights
+        uint32_t clustered = 1;
+        // Part of the G-Buffer rendered to at the current dynamic resolution scale
+        glm::vec2 renderScale = glm::vec2(1.0f);
     } uboFragmentLights;
 
+    struct {
+        vkx::CreateBufferResult lights;
+        vkx::CreateBufferResult clusterCounts;
+        vkx::CreateBufferResult clusterIndices;
+    } storageBuffers;
+
     struct {
         vkx::UniformData vsFullScreen;
         vkx::UniformData vsOffscreen;
@@ -76,6 +99,7 @@ public:
         vk::Pipeline deferred;
         vk::Pipeline offscreen;
         vk::Pipeline debug;
+        vk::Pipeline cluster;
     } pipelines;
 
     struct {
@@ -90,58 +114,50 @@ public:
     vk::DescriptorSet descriptorSet;
     vk::DescriptorSetLayout descriptorSetLayout;
 
-    // vk::Framebuffer for offscreen rendering
-    using FrameBufferAttachment = CreateImageResult;
-
-    struct FrameBuffer {
-        int32_t width, height;
-        vk::Framebuffer frameBuffer;
-        FrameBufferAttachment position, normal, albedo;
-        FrameBufferAttachment depth;
-        vk::RenderPass renderPass;
-    } offScreenFrameBuf;
-
-    // Texture targets
+    // Render graph for the G-Buffer pass, the composition samples
+    // the attachments directly
+    vkx::RenderGraph renderGraph{ *this };
     struct {
-        vkx::Texture position;
-        vkx::Texture normal;
-        vkx::Texture albedo;
-    } textureTargets;
+        vkx::RenderGraph::Resource position;
+        vkx::RenderGraph::Resource normal;
+        vkx::RenderGraph::Resource albedo;
+        vkx::RenderGraph::Resource depth;
+    } gBuffer;
+    vkx::RenderGraph::Pass* gBufferPass{ nullptr };
 
     vk::CommandBuffer offScreenCmdBuffer;
+
+    // Light culling start and end, the whole frame is timed by the dynamic resolution controller
+    vk::QueryPool timestampQueryPool;
+    float clusterTime = 0.0f;
     
     VulkanExample() : vkx::ExampleBase(ENABLE_VALIDATION) {
         
         zoom = -8.0f;
+
+        // Render the G-Buffer at a reduced resolution if the GPU can't hold 60 fps,
+        // the composition upscales to the window
+        enableDynamicResolution = true;
+        dynamicResolution.targetFrameTime = 16.6f;
+        dynamicResolution.minScale = 0.5f;
         rotation = { 0.0f, 0.0f, 0.0f };
         width = 1024;
         height = 1024;
         title = "Vulkan Example - Deferred shading";
+        enableTextOverlay = true;
     }
 
     ~VulkanExample() {
         // Clean up used Vulkan resources 
         // Note : Inherited destructor cleans up resources stored in base class
 
-        // Texture targets
-        textureTargets.position.destroy();
-        textureTargets.normal.destroy();
-        textureTargets.albedo.destroy();
-
-        // Color attachments
-        offScreenFrameBuf.position.destroy();
-        offScreenFrameBuf.normal.destroy();
-        offScreenFrameBuf.albedo.destroy();
-
-        // Depth attachment
-        offScreenFrameBuf.depth.destroy();
-
-        // Frame buffer
-        device.destroyFramebuffer(offScreenFrameBuf.frameBuffer);
+        // G-Buffer images, render pass and framebuffer
+        renderGraph.destroy();
 
         device.destroyPipeline(pipelines.deferred);
         device.destroyPipeline(pipelines.offscreen);
         device.destroyPipeline(pipelines.debug);
+        device.destroyPipeline(pipelines.cluster);
 
         device.destroyPipelineLayout(pipelineLayouts.deferred);
         device.destroyPipelineLayout(pipelineLayouts.offscreen);
@@ -156,321 +172,56 @@ public:
         uniformData.vsOffscreen.destroy();
         uniformData.vsFullScreen.destroy();
         uniformData.fsLights.destroy();
+
+        // Storage buffers
+        storageBuffers.lights.destroy();
+        storageBuffers.clusterCounts.destroy();
+        storageBuffers.clusterIndices.destroy();
+
+        device.destroyQueryPool(timestampQueryPool);
         
         device.freeCommandBuffers(cmdPool, offScreenCmdBuffer);
 
-        device.destroyRenderPass(offScreenFrameBuf.renderPass);
-
         textures.colorMap.destroy();
     }
 
-    // Preapre an empty texture as the blit target from 
-    // the offscreen framebuffer
-    void prepareTextureTarget(const vk::CommandBuffer& setupCmdBuffer, vkx::Texture &target,  vk::Format format) {
-         vk::FormatProperties formatProperties;
-
-        uint32_t width = TEX_DIM;
-        uint32_t height = TEX_DIM;
-
-        // Prepare blit target texture
-        target.extent.width = width;
-        target.extent.height = height;
-
-        vk::ImageCreateInfo imageCreateInfo;
-        imageCreateInfo.imageType = vk::ImageType::e2D;
-        imageCreateInfo.format = format;
-        imageCreateInfo.extent = vk::Extent3D{ width, height, 1 };
-        imageCreateInfo.mipLevels = 1;
-        imageCreateInfo.arrayLayers = 1;
-        imageCreateInfo.samples = vk::SampleCountFlagBits::e1;
-        imageCreateInfo.tiling = vk::ImageTiling::eOptimal;
-        // Texture will be sampled in a shader and is also the blit destination
-        imageCreateInfo.usage = vk::ImageUsageFlagBits::eSampled | vk::ImageUsageFlagBits::eTransferDst;
-
-        target = createImage(imageCreateInfo, vk::MemoryPropertyFlagBits::eDeviceLocal);
-
-        // vk::Image memory barrier
-        // Set initial layout for the offscreen texture to shader read
-        // Will be transformed while updating the texture
-        textureTargets.position.imageLayout = vk::ImageLayout::eShaderReadOnlyOptimal;
-        vkx::setImageLayout(
-            setupCmdBuffer,
-            target.image,
-            vk::ImageAspectFlagBits::eColor,
-            vk::ImageLayout::eUndefined,
-            textureTargets.position.imageLayout);
-
-        // Create sampler
-        vk::SamplerCreateInfo sampler;
-        sampler.magFilter = TEX_FILTER;
-        sampler.minFilter = TEX_FILTER;
-        sampler.mipmapMode = vk::SamplerMipmapMode::eLinear;
-        sampler.addressModeU = vk::SamplerAddressMode::eClampToBorder;
-        sampler.addressModeV = sampler.addressModeV;
-        sampler.addressModeW = sampler.addressModeV;
-        sampler.mipLodBias = 0.0f;
-        sampler.maxAnisotropy = 0;
-        sampler.compareOp = vk::CompareOp::eNever;
-        sampler.minLod = 0.0f;
-        sampler.maxLod = 0.0f;
-        sampler.borderColor = vk::BorderColor::eFloatOpaqueWhite;
-        target.sampler = device.createSampler(sampler);
-
-
-        // Create image view
-        vk::ImageViewCreateInfo view;
-        view.image;
-        view.viewType = vk::ImageViewType::e2D;
-        view.format = format;
-        view.components = { vk::ComponentSwizzle::eR, vk::ComponentSwizzle::eG, vk::ComponentSwizzle::eB, vk::ComponentSwizzle::eA };
-        view.subresourceRange = { vk::ImageAspectFlagBits::eColor, 0, 1, 0, 1 };
-        view.image = target.image;
-        target.view = device.createImageView(view);
-
-    }
-
-    void prepareTextureTargets(const vk::CommandBuffer& setupCmdBuffer) {
-        prepareTextureTarget(setupCmdBuffer, textureTargets.position,  vk::Format::eR16G16B16A16Sfloat);
-        prepareTextureTarget(setupCmdBuffer, textureTargets.normal,  vk::Format::eR16G16B16A16Sfloat);
-        prepareTextureTarget(setupCmdBuffer, textureTargets.albedo,  vk::Format::eR8G8B8A8Unorm);
-    }
-
-    // Create a frame buffer attachment
-    void createAttachment(
-        const vk::CommandBuffer& setupCmdBuffer,
-         vk::Format format,
-        vk::ImageUsageFlags usage,
-        FrameBufferAttachment &attachment) {
-        vk::ImageAspectFlags aspectMask;
-        vk::ImageLayout imageLayout;
-
-        attachment.format = format;
-
-        if (usage & vk::ImageUsageFlagBits::eColorAttachment) {
-            aspectMask = vk::ImageAspectFlagBits::eColor;
-            imageLayout = vk::ImageLayout::eColorAttachmentOptimal;
-        }
-        if (usage & vk::ImageUsageFlagBits::eDepthStencilAttachment) {
-            aspectMask = vk::ImageAspectFlagBits::eDepth | vk::ImageAspectFlagBits::eStencil;
-            imageLayout = vk::ImageLayout::eDepthStencilAttachmentOptimal;
-        }
-
-        assert(aspectMask != vk::ImageAspectFlags());
-
-        vk::ImageCreateInfo image;
-        image.imageType = vk::ImageType::e2D;
-        image.format = format;
-        image.extent.width = offScreenFrameBuf.width;
-        image.extent.height = offScreenFrameBuf.height;
-        image.extent.depth = 1;
-        image.mipLevels = 1;
-        image.arrayLayers = 1;
-        image.samples = vk::SampleCountFlagBits::e1;
-        image.tiling = vk::ImageTiling::eOptimal;
-        image.usage = usage | vk::ImageUsageFlagBits::eTransferSrc;
-
-        attachment = createImage(image, vk::MemoryPropertyFlagBits::eDeviceLocal);
-
-        vkx::setImageLayout(
-            setupCmdBuffer,
-            attachment.image,
-            aspectMask,
-            vk::ImageLayout::eUndefined,
-            imageLayout);
-
-        vk::ImageViewCreateInfo imageView;
-        imageView.viewType = vk::ImageViewType::e2D;
-        imageView.format = format;
-        imageView.subresourceRange.aspectMask = aspectMask;
-        imageView.subresourceRange.levelCount = 1;
-        imageView.subresourceRange.layerCount = 1;
-        imageView.image = attachment.image;
-
-        attachment.view = device.createImageView(imageView);
-    }
-
-    // Prepare a new framebuffer for offscreen rendering
-    // The contents of this framebuffer are then
-    // blitted to our render target
-    void prepareOffscreenFramebuffer(const vk::CommandBuffer& setupCmdBuffer) {
-        offScreenFrameBuf.width = FB_DIM;
-        offScreenFrameBuf.height = FB_DIM;
-
-        // Color attachments
-
+    // Declare the G-Buffer pass, the render graph creates the attachments,
+    // render pass and framebuffer
+    void prepareGBuffer() {
+        vk::Extent2D extent{ FB_DIM, FB_DIM };
         // (World space) Positions
-        createAttachment(
-            setupCmdBuffer,
-             vk::Format::eR16G16B16A16Sfloat,
-            vk::ImageUsageFlagBits::eColorAttachment,
-            offScreenFrameBuf.position);
-
+        gBuffer.position = renderGraph.createImage("G-Buffer position", vk::Format::eR16G16B16A16Sfloat, extent, FB_FILTER);
         // (World space) Normals
-        createAttachment(
-            setupCmdBuffer,
-             vk::Format::eR16G16B16A16Sfloat,
-            vk::ImageUsageFlagBits::eColorAttachment,
-            offScreenFrameBuf.normal);
-
+        gBuffer.normal = renderGraph.createImage("G-Buffer normal", vk::Format::eR16G16B16A16Sfloat, extent, FB_FILTER);
         // Albedo (color)
-        createAttachment(
-            setupCmdBuffer,
-             vk::Format::eR8G8B8A8Unorm,
-            vk::ImageUsageFlagBits::eColorAttachment,
-            offScreenFrameBuf.albedo);
-
-        // Depth attachment
-
-        // Find a suitable depth format
-         vk::Format attDepthFormat = vkx::getSupportedDepthFormat(physicalDevice);;
-
-        createAttachment(
-            setupCmdBuffer,
-            attDepthFormat,
-            vk::ImageUsageFlagBits::eDepthStencilAttachment,
-            offScreenFrameBuf.depth);
-
-        // Set up separate renderpass with references
-        // to the color and depth attachments
-
-        std::array<vk::AttachmentDescription, 4> attachmentDescs = {};
-
-        // Init attachment properties
-        for (uint32_t i = 0; i < 4; ++i) {
-            attachmentDescs[i].samples = vk::SampleCountFlagBits::e1;
-            attachmentDescs[i].loadOp = vk::AttachmentLoadOp::eClear;
-            attachmentDescs[i].storeOp = vk::AttachmentStoreOp::eStore;
-            attachmentDescs[i].stencilLoadOp = vk::AttachmentLoadOp::eDontCare;
-            attachmentDescs[i].stencilStoreOp = vk::AttachmentStoreOp::eDontCare;
-            if (i == 3) {
-                attachmentDescs[i].initialLayout = vk::ImageLayout::eDepthStencilAttachmentOptimal;
-                attachmentDescs[i].finalLayout = vk::ImageLayout::eDepthStencilAttachmentOptimal;
-            } else {
-                attachmentDescs[i].initialLayout = vk::ImageLayout::eColorAttachmentOptimal;
-                attachmentDescs[i].finalLayout = vk::ImageLayout::eColorAttachmentOptimal;
-            }
-        }
-
-        // Formats
-        attachmentDescs[0].format = offScreenFrameBuf.position.format;
-        attachmentDescs[1].format = offScreenFrameBuf.normal.format;
-        attachmentDescs[2].format = offScreenFrameBuf.albedo.format;
-        attachmentDescs[3].format = offScreenFrameBuf.depth.format;
-
-        std::vector<vk::AttachmentReference> colorReferences;
-        colorReferences.push_back({ 0, vk::ImageLayout::eColorAttachmentOptimal });
-        colorReferences.push_back({ 1, vk::ImageLayout::eColorAttachmentOptimal });
-        colorReferences.push_back({ 2, vk::ImageLayout::eColorAttachmentOptimal });
-
-        vk::AttachmentReference depthReference;
-        depthReference.attachment = 3;
-        depthReference.layout = vk::ImageLayout::eDepthStencilAttachmentOptimal;
-
-        vk::SubpassDescription subpass;
-        subpass.pipelineBindPoint = vk::PipelineBindPoint::eGraphics;
-        subpass.pColorAttachments = colorReferences.data();
-        subpass.colorAttachmentCount = colorReferences.size();
-        subpass.pDepthStencilAttachment = &depthReference;
-
-        vk::RenderPassCreateInfo renderPassInfo;
-        renderPassInfo.pAttachments = attachmentDescs.data();
-        renderPassInfo.attachmentCount = attachmentDescs.size();
-        renderPassInfo.subpassCount = 1;
-        renderPassInfo.pSubpasses = &subpass;
-
-        offScreenFrameBuf.renderPass = device.createRenderPass(renderPassInfo);
-
-
-        std::array<vk::ImageView, 4> attachments;
-        attachments[0] = offScreenFrameBuf.position.view;
-        attachments[1] = offScreenFrameBuf.normal.view;
-        attachments[2] = offScreenFrameBuf.albedo.view;
-        // depth
-        attachments[3] = offScreenFrameBuf.depth.view;
-
-        vk::FramebufferCreateInfo fbufCreateInfo;
-        fbufCreateInfo.renderPass = offScreenFrameBuf.renderPass;
-        fbufCreateInfo.pAttachments = attachments.data();
-        fbufCreateInfo.attachmentCount = attachments.size();
-        fbufCreateInfo.width = offScreenFrameBuf.width;
-        fbufCreateInfo.height = offScreenFrameBuf.height;
-        fbufCreateInfo.layers = 1;
-
-        offScreenFrameBuf.frameBuffer = device.createFramebuffer(fbufCreateInfo);
-    }
-
-    // Blit frame buffer attachment to texture target
-    void blit(vk::Image source, vk::Image dest) {
-        // vk::Image memory barrier
-        // Transform frame buffer color attachment to transfer source layout
-        // Makes sure that writes to the color attachment are finished before
-        // using it as source for the blit
-        vkx::setImageLayout(
-            offScreenCmdBuffer,
-            source,
-            vk::ImageAspectFlagBits::eColor,
-            vk::ImageLayout::eColorAttachmentOptimal,
-            vk::ImageLayout::eTransferSrcOptimal);
-
-        // vk::Image memory barrier
-        // Transform texture from shader read (initial layout) to transfer destination layout
-        // Makes sure that reads from texture are finished before
-        // using it as a transfer destination for the blit
-        vkx::setImageLayout(
-            offScreenCmdBuffer,
-            dest,
-            vk::ImageAspectFlagBits::eColor,
-            vk::ImageLayout::eShaderReadOnlyOptimal,
-            vk::ImageLayout::eTransferDstOptimal);
-
-        // Blit offscreen color buffer to our texture target
-        vk::ImageBlit imgBlit;
-
-        imgBlit.srcSubresource.aspectMask = vk::ImageAspectFlagBits::eColor;
-        imgBlit.srcSubresource.mipLevel = 0;
-        imgBlit.srcSubresource.baseArrayLayer = 0;
-        imgBlit.srcSubresource.layerCount = 1;
-
-        imgBlit.srcOffsets[1].x = offScreenFrameBuf.width;
-        imgBlit.srcOffsets[1].y = offScreenFrameBuf.height;
-        imgBlit.srcOffsets[1].z = 1;
-
-        imgBlit.dstSubresource.aspectMask = vk::ImageAspectFlagBits::eColor;
-        imgBlit.dstSubresource.mipLevel = 0;
-        imgBlit.dstSubresource.baseArrayLayer = 0;
-        imgBlit.dstSubresource.layerCount = 1;
-
-        imgBlit.dstOffsets[1].x = textureTargets.position.extent.width;
-        imgBlit.dstOffsets[1].y = textureTargets.position.extent.height;
-        imgBlit.dstOffsets[1].z = 1;
-
-        // Blit from framebuffer image to texture image
-        // vkCmdBlitImage does scaling and (if necessary and possible) also does format conversions
-        offScreenCmdBuffer.blitImage(source, vk::ImageLayout::eTransferSrcOptimal, dest, vk::ImageLayout::eTransferDstOptimal, imgBlit, vk::Filter::eLinear);
-
-        // vk::Image memory barrier
-        // Transform texture from transfer destination to shader read
-        // Makes sure that writes to the texture are finished before
-        // using it as the source for a sampler in the shader
-        vkx::setImageLayout(
-            offScreenCmdBuffer,
-            dest,
-            vk::ImageAspectFlagBits::eColor,
-            vk::ImageLayout::eTransferDstOptimal,
-            vk::ImageLayout::eShaderReadOnlyOptimal);
-
-        // vk::Image memory barrier
-        // Transform the framebuffer color attachment back
-        vkx::setImageLayout(
-            offScreenCmdBuffer,
-            source,
-            vk::ImageAspectFlagBits::eColor,
-            vk::ImageLayout::eTransferSrcOptimal,
-            vk::ImageLayout::eColorAttachmentOptimal);
+        gBuffer.albedo = renderGraph.createImage("G-Buffer albedo", vk::Format::eR8G8B8A8Unorm, extent, FB_FILTER);
+        gBuffer.depth = renderGraph.createImage("G-Buffer depth", vkx::getSupportedDepthFormat(physicalDevice), extent);
+        renderGraph.markOutput(gBuffer.position);
+        renderGraph.markOutput(gBuffer.normal);
+        renderGraph.markOutput(gBuffer.albedo);
+
+        gBufferPass = &renderGraph.addPass("G-Buffer")
+            .writeColor(gBuffer.position, glm::vec4(0.0f))
+            .writeColor(gBuffer.normal, glm::vec4(0.0f))
+            .writeColor(gBuffer.albedo, glm::vec4(0.0f))
+            .writeDepth(gBuffer.depth)
+            .setRecord([this](const vk::CommandBuffer& cmdBuffer) {
+                cmdBuffer.bindDescriptorSets(vk::PipelineBindPoint::eGraphics, pipelineLayouts.offscreen, 0, descriptorSets.offscreen, nullptr);
+                cmdBuffer.bindPipeline(vk::PipelineBindPoint::eGraphics, pipelines.offscreen);
+
+                vk::DeviceSize offsets = { 0 };
+                cmdBuffer.bindVertexBuffers(VERTEX_BUFFER_BIND_ID, meshes.example.vertices.buffer, offsets);
+                cmdBuffer.bindIndexBuffer(meshes.example.indices.buffer, 0, vk::IndexType::eUint32);
+                cmdBuffer.drawIndexed(meshes.example.indexCount, 1, 0, 0, 0);
+            });
+
+        // The frame is timed with the example's own queries, which also cover the light culling
+        renderGraph.enableTimestamps = false;
+        renderGraph.compile();
     }
 
-    // Build command buffer for rendering the scene to the offscreen frame buffer 
-    // and blitting it to the different texture targets
+    // Build command buffer for rendering the scene to the G-Buffer
+    // and binning the lights into clusters
     void buildDeferredCommandBuffer() {
         // Create separate command buffer for offscreen 
         // rendering
@@ -481,45 +232,31 @@ public:
 
         vk::CommandBufferBeginInfo cmdBufInfo;
 
-        // Clear values for all attachments written in the fragment sahder
-        std::array<vk::ClearValue, 4> clearValues;
-        clearValues[0].color = vkx::clearColor({ 0.0f, 0.0f, 0.0f, 0.0f });
-        clearValues[1].color = vkx::clearColor({ 0.0f, 0.0f, 0.0f, 0.0f });
-        clearValues[2].color = vkx::clearColor({ 0.0f, 0.0f, 0.0f, 0.0f });
-        clearValues[3].depthStencil = { 1.0f, 0 };
-
-        vk::RenderPassBeginInfo renderPassBeginInfo;
-        renderPassBeginInfo.renderPass = offScreenFrameBuf.renderPass;
-        renderPassBeginInfo.framebuffer = offScreenFrameBuf.frameBuffer;
-        renderPassBeginInfo.renderArea.extent.width = offScreenFrameBuf.width;
-        renderPassBeginInfo.renderArea.extent.height = offScreenFrameBuf.height;
-        renderPassBeginInfo.clearValueCount = clearValues.size();
-        renderPassBeginInfo.pClearValues = clearValues.data();
-
         offScreenCmdBuffer.begin(cmdBufInfo);
-
-
-        offScreenCmdBuffer.beginRenderPass(renderPassBeginInfo, vk::SubpassContents::eInline);
-
-        vk::Viewport viewport = vkx::viewport((float)offScreenFrameBuf.width, (float)offScreenFrameBuf.height, 0.0f, 1.0f);
-        offScreenCmdBuffer.setViewport(0, viewport);
-
-        vk::Rect2D scissor = vkx::rect2D(offScreenFrameBuf.width, offScreenFrameBuf.height, 0, 0);
-        offScreenCmdBuffer.setScissor(0, scissor);
-
-        offScreenCmdBuffer.bindDescriptorSets(vk::PipelineBindPoint::eGraphics, pipelineLayouts.offscreen, 0, descriptorSets.offscreen, nullptr);
-        offScreenCmdBuffer.bindPipeline(vk::PipelineBindPoint::eGraphics, pipelines.offscreen);
-
-        vk::DeviceSize offsets = { 0 };
-        offScreenCmdBuffer.bindVertexBuffers(VERTEX_BUFFER_BIND_ID, meshes.example.vertices.buffer, offsets);
-        offScreenCmdBuffer.bindIndexBuffer(meshes.example.indices.buffer, 0, vk::IndexType::eUint32);
-        offScreenCmdBuffer.drawIndexed(meshes.example.indexCount, 1, 0, 0, 0);
-
-        offScreenCmdBuffer.endRenderPass();
-
-        blit(offScreenFrameBuf.position.image, textureTargets.position.image);
-        blit(offScreenFrameBuf.normal.image, textureTargets.normal.image);
-        blit(offScreenFrameBuf.albedo.image, textureTargets.albedo.image);
+        dynamicResolution.beginFrame(offScreenCmdBuffer);
+        offScreenCmdBuffer.resetQueryPool(timestampQueryPool, 0, 2);
+
+        gBufferPass->renderScale = dynamicResolution.scale;
+        renderGraph.execute(offScreenCmdBuffer);
+
+        // Bin the lights into clusters, only depends on the view and the lights, not on the G-Buffer
+        offScreenCmdBuffer.writeTimestamp(vk::PipelineStageFlagBits::eBottomOfPipe, timestampQueryPool, 0);
+        if (uboFragmentLights.clustered) {
+            offScreenCmdBuffer.bindPipeline(vk::PipelineBindPoint::eCompute, pipelines.cluster);
+            offScreenCmdBuffer.bindDescriptorSets(vk::PipelineBindPoint::eCompute, pipelineLayouts.deferred, 0, descriptorSet, nullptr);
+            offScreenCmdBuffer.dispatch(CLUSTER_COUNT / 64, 1, 1);
+
+            // The composition pass in the draw command buffer reads the light lists
+            std::array<vk::BufferMemoryBarrier, 2> barriers;
+            barriers[0].srcAccessMask = vk::AccessFlagBits::eShaderWrite;
+            barriers[0].dstAccessMask = vk::AccessFlagBits::eShaderRead;
+            barriers[0].buffer = storageBuffers.clusterCounts.buffer;
+            barriers[0].size = VK_WHOLE_SIZE;
+            barriers[1] = barriers[0];
+            barriers[1].buffer = storageBuffers.clusterIndices.buffer;
+            offScreenCmdBuffer.pipelineBarrier(vk::PipelineStageFlagBits::eComputeShader, vk::PipelineStageFlagBits::eFragmentShader, vk::DependencyFlags(), nullptr, barriers, nullptr);
+        }
+        offScreenCmdBuffer.writeTimestamp(vk::PipelineStageFlagBits::eBottomOfPipe, timestampQueryPool, 1);
 
         offScreenCmdBuffer.end();
 
@@ -592,6 +329,8 @@ public:
 
             drawCmdBuffers[i].endRenderPass();
 
+            dynamicResolution.endFrame(drawCmdBuffers[i]);
+
             drawCmdBuffers[i].end();
 
         }
@@ -684,7 +423,9 @@ public:
         std::vector<vk::DescriptorPoolSize> poolSizes =
         {
             vkx::descriptorPoolSize(vk::DescriptorType::eUniformBuffer, 8),
-            vkx::descriptorPoolSize(vk::DescriptorType::eCombinedImageSampler, 8)
+            vkx::descriptorPoolSize(vk::DescriptorType::eCombinedImageSampler, 8),
+            // Lights and cluster light lists, both sets share the layout
+            vkx::descriptorPoolSize(vk::DescriptorType::eStorageBuffer, 6)
         };
 
         vk::DescriptorPoolCreateInfo descriptorPoolInfo =
@@ -717,11 +458,26 @@ public:
                 vk::DescriptorType::eCombinedImageSampler,
                 vk::ShaderStageFlagBits::eFragment,
                 3),
-            // Binding 4 : Fragment shader uniform buffer
+            // Binding 4 : Fragment and light culling shader uniform buffer
             vkx::descriptorSetLayoutBinding(
                 vk::DescriptorType::eUniformBuffer,
-                vk::ShaderStageFlagBits::eFragment,
+                vk::ShaderStageFlagBits::eFragment | vk::ShaderStageFlagBits::eCompute,
                 4),
+            // Binding 5 : Lights
+            vkx::descriptorSetLayoutBinding(
+                vk::DescriptorType::eStorageBuffer,
+                vk::ShaderStageFlagBits::eFragment | vk::ShaderStageFlagBits::eCompute,
+                5),
+            // Binding 6 : Light count per cluster
+            vkx::descriptorSetLayoutBinding(
+                vk::DescriptorType::eStorageBuffer,
+                vk::ShaderStageFlagBits::eFragment | vk::ShaderStageFlagBits::eCompute,
+                6),
+            // Binding 7 : Light indices per cluster
+            vkx::descriptorSetLayoutBinding(
+                vk::DescriptorType::eStorageBuffer,
+                vk::ShaderStageFlagBits::eFragment | vk::ShaderStageFlagBits::eCompute,
+                7),
         };
 
         vk::DescriptorSetLayoutCreateInfo descriptorLayout =
@@ -748,15 +504,10 @@ public:
 
         descriptorSet = device.allocateDescriptorSets(allocInfo)[0];
 
-        // vk::Image descriptor for the offscreen texture targets
-        vk::DescriptorImageInfo texDescriptorPosition =
-            vkx::descriptorImageInfo(textureTargets.position.sampler, textureTargets.position.view, vk::ImageLayout::eGeneral);
-
-        vk::DescriptorImageInfo texDescriptorNormal =
-            vkx::descriptorImageInfo(textureTargets.normal.sampler, textureTargets.normal.view, vk::ImageLayout::eGeneral);
-
-        vk::DescriptorImageInfo texDescriptorAlbedo =
-            vkx::descriptorImageInfo(textureTargets.albedo.sampler, textureTargets.albedo.view, vk::ImageLayout::eGeneral);
+        // vk::Image descriptors for the G-Buffer attachments
+        vk::DescriptorImageInfo texDescriptorPosition = renderGraph.descriptor(gBuffer.position);
+        vk::DescriptorImageInfo texDescriptorNormal = renderGraph.descriptor(gBuffer.normal);
+        vk::DescriptorImageInfo texDescriptorAlbedo = renderGraph.descriptor(gBuffer.albedo);
 
         std::vector<vk::WriteDescriptorSet> writeDescriptorSets =
         {
@@ -790,6 +541,24 @@ public:
                 vk::DescriptorType::eUniformBuffer,
                 4,
                 &uniformData.fsLights.descriptor),
+            // Binding 5 : Lights
+            vkx::writeDescriptorSet(
+                descriptorSet,
+                vk::DescriptorType::eStorageBuffer,
+                5,
+                &storageBuffers.lights.descriptor),
+            // Binding 6 : Light count per cluster
+            vkx::writeDescriptorSet(
+                descriptorSet,
+                vk::DescriptorType::eStorageBuffer,
+                6,
+                &storageBuffers.clusterCounts.descriptor),
+            // Binding 7 : Light indices per cluster
+            vkx::writeDescriptorSet(
+                descriptorSet,
+                vk::DescriptorType::eStorageBuffer,
+                7,
+                &storageBuffers.clusterIndices.descriptor),
         };
 
         device.updateDescriptorSets(writeDescriptorSets, nullptr);
@@ -851,7 +620,7 @@ public:
         std::array<vk::PipelineShaderStageCreateInfo, 2> shaderStages;
 
         shaderStages[0] = loadShader(getAssetPath() + "shaders/deferred/deferred.vert.spv", vk::ShaderStageFlagBits::eVertex);
-        shaderStages[1] = loadShader(getAssetPath() + "shaders/deferred/deferred.frag.spv", vk::ShaderStageFlagBits::eFragment);
+        shaderStages[1] = loadGlslShader(getAssetPath() + "shaders/deferred/deferred.frag", vk::ShaderStageFlagBits::eFragment);
 
         vk::GraphicsPipelineCreateInfo pipelineCreateInfo = vkx::pipelineCreateInfo(pipelineLayouts.deferred, renderPass);
         pipelineCreateInfo.pVertexInputState = &vertices.inputState;
@@ -870,7 +639,7 @@ public:
 
         // Debug display pipeline
         shaderStages[0] = loadShader(getAssetPath() + "shaders/deferred/debug.vert.spv", vk::ShaderStageFlagBits::eVertex);
-        shaderStages[1] = loadShader(getAssetPath() + "shaders/deferred/debug.frag.spv", vk::ShaderStageFlagBits::eFragment);
+        shaderStages[1] = loadGlslShader(getAssetPath() + "shaders/deferred/debug.frag", vk::ShaderStageFlagBits::eFragment);
         pipelines.debug = device.createGraphicsPipelines(pipelineCache, pipelineCreateInfo, nullptr)[0];
 
 
@@ -879,7 +648,7 @@ public:
         shaderStages[1] = loadShader(getAssetPath() + "shaders/deferred/mrt.frag.spv", vk::ShaderStageFlagBits::eFragment);
 
         // Separate render pass
-        pipelineCreateInfo.renderPass = offScreenFrameBuf.renderPass;
+        pipelineCreateInfo.renderPass = gBufferPass->renderPass;
 
         // Separate layout
         pipelineCreateInfo.layout = pipelineLayouts.offscreen;
@@ -897,6 +666,12 @@ public:
         colorBlendState.pAttachments = blendAttachmentStates.data();
 
         pipelines.offscreen = device.createGraphicsPipelines(pipelineCache, pipelineCreateInfo, nullptr)[0];
+
+        // Light culling pipeline, uses the composition descriptor set
+        vk::ComputePipelineCreateInfo computePipelineCreateInfo =
+            vkx::computePipelineCreateInfo(pipelineLayouts.deferred);
+        computePipelineCreateInfo.stage = loadGlslShader(getAssetPath() + "shaders/deferred/cluster.comp", vk::ShaderStageFlagBits::eCompute);
+        pipelines.cluster = device.createComputePipelines(pipelineCache, computePipelineCreateInfo, nullptr)[0];
     }
 
     // Prepare and initialize uniform buffer containing shader uniforms
@@ -924,9 +699,7 @@ public:
         }
         uboVS.model = glm::mat4();
 
-        void *pData = device.mapMemory(uniformData.vsFullScreen.memory, 0, sizeof(uboVS), vk::MemoryMapFlags());
-        memcpy(pData, &uboVS, sizeof(uboVS));
-        device.unmapMemory(uniformData.vsFullScreen.memory);
+        uniformData.vsFullScreen.copy(uboVS);
     }
 
     void updateUniformBufferDeferredMatrices() {
@@ -939,52 +712,87 @@ public:
         uboOffscreenVS.model = glm::mat4();
         uboOffscreenVS.model = glm::translate(glm::mat4(), glm::vec3(0.0f, 0.25f, 0.0f));
 
-        void *pData = device.mapMemory(uniformData.vsOffscreen.memory, 0, sizeof(uboOffscreenVS), vk::MemoryMapFlags());
-        memcpy(pData, &uboOffscreenVS, sizeof(uboOffscreenVS));
-        device.unmapMemory(uniformData.vsOffscreen.memory);
+        uniformData.vsOffscreen.copy(uboOffscreenVS);
     }
 
-    // Update fragment shader light position uniform block
+    // Update fragment shader light uniform block
     void updateUniformBufferDeferredLights() {
+        uboFragmentLights.view = uboOffscreenVS.view;
+        uboFragmentLights.projection = uboOffscreenVS.projection;
+        uboFragmentLights.lightCount = (uint32_t)lights.size();
+
+        // Current view position
+        uboFragmentLights.viewPos = glm::vec4(0.0f, 0.0f, -zoom, 0.0f);
+
+        uniformData.fsLights.copy(uboFragmentLights);
+    }
+
+    // The five hand placed lights, filled up with random point lights around the model.
+    // Radii shrink with the light count so the number of lights touching a point stays about the same.
+    void generateLights(uint32_t count) {
+        lights.resize(count);
         // White light from above
-        uboFragmentLights.lights[0].position = glm::vec4(0.0f, 3.0f, 1.0f, 0.0f);
-        uboFragmentLights.lights[0].color = glm::vec4(1.5f);
-        uboFragmentLights.lights[0].radius = 15.0f;
-        uboFragmentLights.lights[0].linearFalloff = 0.3f;
-        uboFragmentLights.lights[0].quadraticFalloff = 0.4f;
+        lights[0].position = glm::vec4(0.0f, 3.0f, 1.0f, 0.0f);
+        lights[0].color = glm::vec4(1.5f);
+        lights[0].radius = 15.0f;
+        lights[0].linearFalloff = 0.3f;
+        lights[0].quadraticFalloff = 0.4f;
         // Red light
-        uboFragmentLights.lights[1].position = glm::vec4(-2.0f, 0.0f, 0.0f, 0.0f);
-        uboFragmentLights.lights[1].color = glm::vec4(1.5f, 0.0f, 0.0f, 0.0f);
-        uboFragmentLights.lights[1].radius = 15.0f;
-        uboFragmentLights.lights[1].linearFalloff = 0.4f;
-        uboFragmentLights.lights[1].quadraticFalloff = 0.3f;
+        lights[1].position = glm::vec4(-2.0f, 0.0f, 0.0f, 0.0f);
+        lights[1].color = glm::vec4(1.5f, 0.0f, 0.0f, 0.0f);
+        lights[1].radius = 15.0f;
+        lights[1].linearFalloff = 0.4f;
+        lights[1].quadraticFalloff = 0.3f;
         // Blue light
-        uboFragmentLights.lights[2].position = glm::vec4(2.0f, 1.0f, 0.0f, 0.0f);
-        uboFragmentLights.lights[2].color = glm::vec4(0.0f, 0.0f, 2.5f, 0.0f);
-        uboFragmentLights.lights[2].radius = 10.0f;
-        uboFragmentLights.lights[2].linearFalloff = 0.45f;
-        uboFragmentLights.lights[2].quadraticFalloff = 0.35f;
+        lights[2].position = glm::vec4(2.0f, 1.0f, 0.0f, 0.0f);
+        lights[2].color = glm::vec4(0.0f, 0.0f, 2.5f, 0.0f);
+        lights[2].radius = 10.0f;
+        lights[2].linearFalloff = 0.45f;
+        lights[2].quadraticFalloff = 0.35f;
         // Belt glow
-        uboFragmentLights.lights[3].position = glm::vec4(0.0f, 0.7f, 0.5f, 0.0f);
-        uboFragmentLights.lights[3].color = glm::vec4(2.5f, 2.5f, 0.0f, 0.0f);
-        uboFragmentLights.lights[3].radius = 5.0f;
-        uboFragmentLights.lights[3].linearFalloff = 8.0f;
-        uboFragmentLights.lights[3].quadraticFalloff = 6.0f;
+        lights[3].position = glm::vec4(0.0f, 0.7f, 0.5f, 0.0f);
+        lights[3].color = glm::vec4(2.5f, 2.5f, 0.0f, 0.0f);
+        lights[3].radius = 5.0f;
+        lights[3].linearFalloff = 8.0f;
+        lights[3].quadraticFalloff = 6.0f;
         // Green light
-        uboFragmentLights.lights[4].position = glm::vec4(3.0f, 2.0f, 1.0f, 0.0f);
-        uboFragmentLights.lights[4].color = glm::vec4(0.0f, 1.5f, 0.0f, 0.0f);
-        uboFragmentLights.lights[4].radius = 10.0f;
-        uboFragmentLights.lights[4].linearFalloff = 0.8f;
-        uboFragmentLights.lights[4].quadraticFalloff = 0.6f;
-
-        // Current view position
-        uboFragmentLights.viewPos = glm::vec4(0.0f, 0.0f, -zoom, 0.0f);
+        lights[4].position = glm::vec4(3.0f, 2.0f, 1.0f, 0.0f);
+        lights[4].color = glm::vec4(0.0f, 1.5f, 0.0f, 0.0f);
+        lights[4].radius = 10.0f;
+        lights[4].linearFalloff = 0.8f;
+        lights[4].quadraticFalloff = 0.6f;
+
+        std::mt19937 rndGenerator(count);
+        std::uniform_real_distribution<float> rndDist(0.0f, 1.0f);
+        float radius = 2.0f * std::cbrt((float)MIN_LIGHT_COUNT / (float)count);
+        for (uint32_t i = 5; i < count; ++i) {
+            Light& light = lights[i];
+            light.position = glm::vec4(
+                rndDist(rndGenerator) * 6.0f - 3.0f,
+                rndDist(rndGenerator) * 5.0f - 2.0f,
+                rndDist(rndGenerator) * 4.0f - 2.0f,
+                0.0f);
+            light.color = glm::vec4(rndDist(rndGenerator), rndDist(rndGenerator), rndDist(rndGenerator), 0.0f) * 2.0f;
+            light.radius = radius * (0.75f + 0.5f * rndDist(rndGenerator));
+            // Attenuated to about 5% at the radius
+            light.linearFalloff = 0.0f;
+            light.quadraticFalloff = 20.0f / (light.radius * light.radius);
+        }
+    }
 
-        void *pData = device.mapMemory(uniformData.fsLights.memory, 0, sizeof(uboFragmentLights), vk::MemoryMapFlags());
-        memcpy(pData, &uboFragmentLights, sizeof(uboFragmentLights));
-        device.unmapMemory(uniformData.fsLights.memory);
+    void prepareStorageBuffers() {
+        generateLights(uboFragmentLights.lightCount);
+        storageBuffers.lights = stageToDeviceBuffer(vk::BufferUsageFlagBits::eStorageBuffer, lights);
+        storageBuffers.clusterCounts = createBuffer(vk::BufferUsageFlagBits::eStorageBuffer, vk::MemoryPropertyFlagBits::eDeviceLocal, CLUSTER_COUNT * sizeof(uint32_t));
+        storageBuffers.clusterIndices = createBuffer(vk::BufferUsageFlagBits::eStorageBuffer, vk::MemoryPropertyFlagBits::eDeviceLocal, CLUSTER_COUNT * MAX_LIGHTS_PER_CLUSTER * sizeof(uint32_t));
     }
 
+    void prepareTimestampQueries() {
+        vk::QueryPoolCreateInfo queryPoolInfo;
+        queryPoolInfo.queryType = vk::QueryType::eTimestamp;
+        queryPoolInfo.queryCount = 2;
+        timestampQueryPool = device.createQueryPool(queryPoolInfo);
+    }
 
     void prepare() {
         ExampleBase::prepare();
@@ -992,11 +800,10 @@ public:
         generateQuads();
         loadMeshes();
         setupVertexDescriptions();
+        prepareStorageBuffers();
+        prepareTimestampQueries();
         prepareUniformBuffers();
-        withPrimaryCommandBuffer([&](const vk::CommandBuffer& setupCmdBuffer) {
-            prepareOffscreenFramebuffer(setupCmdBuffer);
-            prepareTextureTargets(setupCmdBuffer);
-        });
+        prepareGBuffer();
         setupDescriptorSetLayout();
         preparePipelines();
         setupDescriptorPool();
@@ -1012,10 +819,47 @@ public:
         vkDeviceWaitIdle(device);
         draw();
         vkDeviceWaitIdle(device);
+
+        uint64_t timestamps[2];
+        device.getQueryPoolResults(timestampQueryPool, 0, 2, sizeof(timestamps), timestamps, sizeof(uint64_t), vk::QueryResultFlagBits::e64 | vk::QueryResultFlagBits::eWait);
+        float timestampPeriod = deviceProperties.limits.timestampPeriod / 1000000.0f;
+        clusterTime = (float)(timestamps[1] - timestamps[0]) * timestampPeriod;
+    }
+
+    // The G-Buffer keeps its size, only the render area of the pass shrinks
+    void renderScaleChanged() override {
+        uboFragmentLights.renderScale = glm::vec2(dynamicResolution.scale);
+        updateUniformBufferDeferredLights();
+        buildDeferredCommandBuffer();
+        updateTextOverlay();
     }
 
     virtual void viewChanged() {
         updateUniformBufferDeferredMatrices();
+        updateUniformBufferDeferredLights();
+    }
+
+    void changeLightCount(bool increase) {
+        uint32_t count = uboFragmentLights.lightCount;
+        count = increase ? std::min(count * 4, (uint32_t)MAX_LIGHT_COUNT) : std::max(count / 4, (uint32_t)MIN_LIGHT_COUNT);
+        if (count == uboFragmentLights.lightCount) {
+            return;
+        }
+        uboFragmentLights.lightCount = count;
+        generateLights(count);
+        storageBuffers.lights.destroy();
+        storageBuffers.lights = stageToDeviceBuffer(vk::BufferUsageFlagBits::eStorageBuffer, lights);
+        vk::WriteDescriptorSet writeDescriptorSet = vkx::writeDescriptorSet(descriptorSet, vk::DescriptorType::eStorageBuffer, 5, &storageBuffers.lights.descriptor);
+        device.updateDescriptorSets(writeDescriptorSet, nullptr);
+        updateUniformBufferDeferredLights();
+        updateTextOverlay();
+    }
+
+    void toggleClustered() {
+        uboFragmentLights.clustered = !uboFragmentLights.clustered;
+        updateUniformBufferDeferredLights();
+        buildDeferredCommandBuffer();
+        updateTextOverlay();
     }
 
     void toggleDebugDisplay() {
@@ -1030,8 +874,35 @@ public:
         case GLFW_KEY_D:
             toggleDebugDisplay();
             break;
+        case GLFW_KEY_C:
+            toggleClustered();
+            break;
+        case GLFW_KEY_KP_ADD:
+            changeLightCount(true);
+            break;
+        case GLFW_KEY_KP_SUBTRACT:
+            changeLightCount(false);
+            break;
         }
     }
+
+    void getOverlayText(vkx::TextOverlay *textOverlay) override {
+        std::stringstream ss;
+        ss << std::fixed << std::setprecision(2);
+        ss << uboFragmentLights.lightCount << " lights, " << (uboFragmentLights.clustered ? "clustered" : "brute force") << " shading";
+        textOverlay->addText(ss.str(), 5.0f, 85.0f, vkx::TextOverlay::alignLeft);
+        ss.str("");
+        ss << "GPU frame: " << dynamicResolution.gpuTime << " ms, light culling: " << clusterTime << " ms";
+        textOverlay->addText(ss.str(), 5.0f, 105.0f, vkx::TextOverlay::alignLeft);
+        ss.str("");
+        ss << "G-Buffer: " << renderGraph.memoryStats.allocated / (1024 * 1024) << " MB in " << renderGraph.memoryStats.allocationCount << " allocations";
+        textOverlay->addText(ss.str(), 5.0f, 125.0f, vkx::TextOverlay::alignLeft);
+        ss.str("");
+        vk::Extent2D extent = gBufferPass->renderExtent();
+        ss << "Render scale: " << dynamicResolution.scale << " (" << extent.width << "x" << extent.height << "), target " << dynamicResolution.targetFrameTime << " ms";
+        textOverlay->addText(ss.str(), 5.0f, 145.0f, vkx::TextOverlay::alignLeft);
+        textOverlay->addText("Press \"C\" to toggle clustering, \"Numpad +/-\" to change the light count", 5.0f, 165.0f, vkx::TextOverlay::alignLeft);
+    }
 };
 
 RUN_EXAMPLE(VulkanExample)
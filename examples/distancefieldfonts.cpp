@@ -9,69 +9,27 @@
 */
 
 #include "vulkanExampleBase.h"
+#include "vulkanSdfText.h"
 
-
-// Vertex layout for this example
-struct Vertex {
-    float pos[3];
-    float uv[2];
-};
-
-// AngelCode .fnt format structs and classes
-struct bmchar {
-    uint32_t x, y;
-    uint32_t width;
-    uint32_t height;
-    int32_t xoffset;
-    int32_t yoffset;
-    int32_t xadvance;
-    uint32_t page;
-};
-
-// Quick and dirty : complete ASCII table
-// Only chars present in the .fnt are filled with data!
-std::array<bmchar, 255> fontChars;
-
-int32_t nextValuePair(std::stringstream *stream) {
-    std::string pair;
-    *stream >> pair;
-    uint32_t spos = pair.find("=");
-    std::string value = pair.substr(spos + 1);
-    int32_t val = std::stoi(value);
-    return val;
-}
+// Glyph counts of the benchmark mode
+static const std::array<uint32_t, 5> BENCHMARK_GLYPHS = { 1000, 10000, 100000, 500000, 1000000 };
+static const char* BENCHMARK_TEXT = "The quick brown fox jumps over the lazy dog. 0123456789 ";
 
 class VulkanExample : public vkx::ExampleBase {
 public:
     bool splitScreen = true;
+    // Index into BENCHMARK_GLYPHS, -1 to only draw the title
+    int32_t benchmark = -1;
+    float glyphFillTime = 0.0f;
+
+    vkx::SdfFont font;
+    vkx::SdfTextRenderer textRenderer{ *this };
 
     struct {
         vkx::Texture fontSDF;
         vkx::Texture fontBitmap;
     } textures;
 
-    struct {
-        void operator=(const vkx::CreateBufferResult& result) {
-            buffer = result.buffer;
-            memory = result.memory;
-        }
-        vk::Buffer buffer;
-        vk::DeviceMemory memory;
-        vk::PipelineVertexInputStateCreateInfo inputState;
-        std::vector<vk::VertexInputBindingDescription> bindingDescriptions;
-        std::vector<vk::VertexInputAttributeDescription> attributeDescriptions;
-    } vertices;
-
-    struct {
-        void operator=(const vkx::CreateBufferResult& result) {
-            buffer = result.buffer;
-            memory = result.memory;
-        }
-        int count;
-        vk::Buffer buffer;
-        vk::DeviceMemory memory;
-    } indices;
-
     struct {
         vkx::UniformData vs;
         vkx::UniformData fs;
@@ -103,6 +61,7 @@ public:
 
     VulkanExample() : vkx::ExampleBase(ENABLE_VALIDATION) {
         zoom = -1.5f;
+        enableTextOverlay = true;
         rotation = { 0.0f, 0.0f, 0.0f };
         title = "Vulkan Example - Distance field fonts";
     }
@@ -116,74 +75,15 @@ public:
         textures.fontBitmap.destroy();
 
         device.destroyPipeline(pipelines.sdf);
+        device.destroyPipeline(pipelines.bitmap);
 
         device.destroyPipelineLayout(pipelineLayout);
         device.destroyDescriptorSetLayout(descriptorSetLayout);
 
-        device.destroyBuffer(vertices.buffer);
-        device.freeMemory(vertices.memory);
-
-        device.destroyBuffer(indices.buffer);
-        device.freeMemory(indices.memory);
-
-        device.destroyBuffer(uniformData.vs.buffer);
-        device.freeMemory(uniformData.vs.memory);
-    }
-
-    // Basic parser fpr AngelCode bitmap font format files
-    // See http://www.angelcode.com/products/bmfont/doc/file_format.html for details
-    void parsebmFont() {
-        std::string fileName = getAssetPath() + "font.fnt";
-
-#if defined(__ANDROID__)
-        // Font description file is stored inside the apk
-        // So we need to load it using the asset manager
-        AAsset* asset = AAssetManager_open(androidApp->activity->assetManager, fileName.c_str(), AASSET_MODE_STREAMING);
-        assert(asset);
-        size_t size = AAsset_getLength(asset);
-
-        assert(size > 0);
-
-        void *fileData = malloc(size);
-        AAsset_read(asset, fileData, size);
-        AAsset_close(asset);
-
-        std::stringbuf sbuf((const char*)fileData);
-        std::istream istream(&sbuf);
-#else
-        std::filebuf fileBuffer;
-        fileBuffer.open(fileName, std::ios::in);
-        std::istream istream(&fileBuffer);
-#endif
-
-        assert(istream.good());
-
-        while (!istream.eof()) {
-            std::string line;
-            std::stringstream lineStream;
-            std::getline(istream, line);
-            lineStream << line;
-
-            std::string info;
-            lineStream >> info;
-
-            if (info == "char") {
-                std::string pair;
-
-                // char id
-                uint32_t charid = nextValuePair(&lineStream);
-                // Char properties
-                fontChars[charid].x = nextValuePair(&lineStream);
-                fontChars[charid].y = nextValuePair(&lineStream);
-                fontChars[charid].width = nextValuePair(&lineStream);
-                fontChars[charid].height = nextValuePair(&lineStream);
-                fontChars[charid].xoffset = nextValuePair(&lineStream);
-                fontChars[charid].yoffset = nextValuePair(&lineStream);
-                fontChars[charid].xadvance = nextValuePair(&lineStream);
-                fontChars[charid].page = nextValuePair(&lineStream);
-            }
-        }
+        textRenderer.destroy();
 
+        uniformData.vs.destroy();
+        uniformData.fs.destroy();
     }
 
     void loadTextures() {
@@ -234,14 +134,11 @@ public:
             vk::Rect2D scissor = vkx::rect2D(width, height, 0, 0);
             drawCmdBuffers[i].setScissor(0, scissor);
 
-            vk::DeviceSize offsets = 0;
-
             // Signed distance field font
+            // The glyphs are written to the region of this command buffer every frame
             drawCmdBuffers[i].bindDescriptorSets(vk::PipelineBindPoint::eGraphics, pipelineLayout, 0, descriptorSets.sdf, nullptr);
             drawCmdBuffers[i].bindPipeline(vk::PipelineBindPoint::eGraphics, pipelines.sdf);
-            drawCmdBuffers[i].bindVertexBuffers(VERTEX_BUFFER_BIND_ID, vertices.buffer, offsets);
-            drawCmdBuffers[i].bindIndexBuffer(indices.buffer, 0, vk::IndexType::eUint32);
-            drawCmdBuffers[i].drawIndexed(indices.count, 1, 0, 0, 0);
+            textRenderer.draw(drawCmdBuffers[i], i);
 
             // Linear filtered bitmap font
             if (splitScreen) {
@@ -249,9 +146,7 @@ public:
                 drawCmdBuffers[i].setViewport(0, viewport);
                 drawCmdBuffers[i].bindDescriptorSets(vk::PipelineBindPoint::eGraphics, pipelineLayout, 0, descriptorSets.bitmap, nullptr);
                 drawCmdBuffers[i].bindPipeline(vk::PipelineBindPoint::eGraphics, pipelines.bitmap);
-                drawCmdBuffers[i].bindVertexBuffers(VERTEX_BUFFER_BIND_ID, vertices.buffer, offsets);
-                drawCmdBuffers[i].bindIndexBuffer(indices.buffer, 0, vk::IndexType::eUint32);
-                drawCmdBuffers[i].drawIndexed(indices.count, 1, 0, 0, 0);
+                textRenderer.draw(drawCmdBuffers[i], i);
             }
 
             drawCmdBuffers[i].endRenderPass();
@@ -261,91 +156,46 @@ public:
         }
     }
 
-    // todo : function fill buffer with quads from font
-
-    // Creates a vertex buffer containing quads for the passed text
-    void generateText(std::string text) {
-        std::vector<Vertex> vertexBuffer;
-        std::vector<uint32_t> indexBuffer;
-        uint32_t indexOffset = 0;
-
-        float w = textures.fontSDF.extent.width;
-
-        float posx = 0.0f;
-        float posy = 0.0f;
-
-        for (uint32_t i = 0; i < text.size(); i++) {
-            bmchar *charInfo = &fontChars[(int)text[i]];
-
-            if (charInfo->width == 0)
-                charInfo->width = 36;
-
-            float charw = ((float)(charInfo->width) / 36.0f);
-            float dimx = 1.0f * charw;
-            float charh = ((float)(charInfo->height) / 36.0f);
-            float dimy = 1.0f * charh;
-            posy = 1.0f - charh;
-
-            float us = charInfo->x / w;
-            float ue = (charInfo->x + charInfo->width) / w;
-            float ts = charInfo->y / w;
-            float te = (charInfo->y + charInfo->height) / w;
-
-            float xo = charInfo->xoffset / 36.0f;
-            float yo = charInfo->yoffset / 36.0f;
-
-            vertexBuffer.push_back({ { posx + dimx + xo,  posy + dimy, 0.0f }, { ue, te } });
-            vertexBuffer.push_back({ { posx + xo,         posy + dimy, 0.0f }, { us, te } });
-            vertexBuffer.push_back({ { posx + xo,         posy,        0.0f }, { us, ts } });
-            vertexBuffer.push_back({ { posx + dimx + xo,  posy,        0.0f }, { ue, ts } });
+    void prepareText() {
+        font.load(getAssetPath() + "font.fnt");
+        // One region per draw command buffer, large enough for the biggest benchmark
+        textRenderer.create(font, BENCHMARK_GLYPHS.back(), (uint32_t)drawCmdBuffers.size());
+    }
 
-            std::array<uint32_t, 6> indices = { 0,1,2, 2,3,0 };
-            for (auto& index : indices) {
-                indexBuffer.push_back(indexOffset + index);
+    // Writes the glyphs drawn by the command buffer of the current swap chain image
+    void updateText() {
+        auto tStart = std::chrono::high_resolution_clock::now();
+        textRenderer.begin(currentBuffer);
+        if (benchmark < 0) {
+            // The original text, centered, with the font size of 36 texels mapped to 1
+            const std::string text = "Vulkan";
+            float scale = 1.0f / 36.0f;
+            textRenderer.add(text, -font.width(text) * scale / 2.0f, -0.5f, scale);
+        } else {
+            // Lines of text filling a square of 2 x 2 units
+            uint32_t glyphs = BENCHMARK_GLYPHS[benchmark];
+            size_t lineLength = strlen(BENCHMARK_TEXT);
+            uint32_t lines = (glyphs + (uint32_t)lineLength - 1) / (uint32_t)lineLength;
+            uint32_t columns = std::max((uint32_t)sqrtf((float)lines * font.lineHeight / font.width(BENCHMARK_TEXT)), 1U);
+            uint32_t rows = (lines + columns - 1) / columns;
+            float scale = 2.0f / (rows * font.lineHeight);
+            float columnWidth = font.width(BENCHMARK_TEXT) * scale;
+            for (uint32_t line = 0; line < lines; ++line) {
+                size_t length = std::min<size_t>(lineLength, glyphs - line * lineLength);
+                float x = -1.0f + (line / rows) * columnWidth;
+                float y = -1.0f + (line % rows) * font.lineHeight * scale;
+                textRenderer.add(BENCHMARK_TEXT, length, x, y, scale);
             }
-            indexOffset += 4;
-
-            float advance = ((float)(charInfo->xadvance) / 36.0f);
-            posx += advance;
         }
-        indices.count = indexBuffer.size();
-
-        // Center
-        for (auto& v : vertexBuffer) {
-            v.pos[0] -= posx / 2.0f;
-            v.pos[1] -= 0.5f;
-        }
-        vertices = createBuffer(vk::BufferUsageFlagBits::eVertexBuffer, vertices);
-        indices = createBuffer(vk::BufferUsageFlagBits::eIndexBuffer, indexBuffer);
-    }
-
-    void setupVertexDescriptions() {
-        // Binding description
-        vertices.bindingDescriptions.resize(1);
-        vertices.bindingDescriptions[0] =
-            vkx::vertexInputBindingDescription(VERTEX_BUFFER_BIND_ID, sizeof(Vertex), vk::VertexInputRate::eVertex);
-
-        // Attribute descriptions
-        // Describes memory layout and shader positions
-        vertices.attributeDescriptions.resize(2);
-        // Location 0 : Position
-        vertices.attributeDescriptions[0] =
-            vkx::vertexInputAttributeDescription(VERTEX_BUFFER_BIND_ID, 0,  vk::Format::eR32G32B32Sfloat, 0);
-        // Location 1 : Texture coordinates
-        vertices.attributeDescriptions[1] =
-            vkx::vertexInputAttributeDescription(VERTEX_BUFFER_BIND_ID, 1,  vk::Format::eR32G32Sfloat, sizeof(float) * 3);
-
-        vertices.inputState = vk::PipelineVertexInputStateCreateInfo();
-        vertices.inputState.vertexBindingDescriptionCount = vertices.bindingDescriptions.size();
-        vertices.inputState.pVertexBindingDescriptions = vertices.bindingDescriptions.data();
-        vertices.inputState.vertexAttributeDescriptionCount = vertices.attributeDescriptions.size();
-        vertices.inputState.pVertexAttributeDescriptions = vertices.attributeDescriptions.data();
+        textRenderer.end();
+        auto tEnd = std::chrono::high_resolution_clock::now();
+        glyphFillTime = std::chrono::duration<float, std::milli>(tEnd - tStart).count();
     }
 
     void setupDescriptorPool() {
         std::vector<vk::DescriptorPoolSize> poolSizes =
         {
-            vkx::descriptorPoolSize(vk::DescriptorType::eUniformBuffer, 4),
+            vkx::descriptorPoolSize(vk::DescriptorType::eUniformBuffer, 6),
             vkx::descriptorPoolSize(vk::DescriptorType::eCombinedImageSampler, 2)
         };
 
@@ -372,7 +222,12 @@ public:
             vkx::descriptorSetLayoutBinding(
                 vk::DescriptorType::eUniformBuffer,
                 vk::ShaderStageFlagBits::eFragment,
-                2)
+                2),
+            // Binding 3 : Vertex shader glyph table
+            vkx::descriptorSetLayoutBinding(
+                vk::DescriptorType::eUniformBuffer,
+                vk::ShaderStageFlagBits::eVertex,
+                3)
         };
 
         vk::DescriptorSetLayoutCreateInfo descriptorLayout =
@@ -389,6 +244,8 @@ public:
     }
 
     void setupDescriptorSet() {
+        vk::DescriptorBufferInfo glyphTableDescriptor = textRenderer.glyphTableDescriptor();
+
         vk::DescriptorSetAllocateInfo allocInfo =
             vkx::descriptorSetAllocateInfo(descriptorPool, &descriptorSetLayout, 1);
 
@@ -418,7 +275,13 @@ public:
                 descriptorSets.sdf,
                 vk::DescriptorType::eUniformBuffer,
                 2,
-                &uniformData.fs.descriptor)
+                &uniformData.fs.descriptor),
+            // Binding 3 : Vertex shader glyph table
+            vkx::writeDescriptorSet(
+                descriptorSets.sdf,
+                vk::DescriptorType::eUniformBuffer,
+                3,
+                &glyphTableDescriptor)
         };
 
         device.updateDescriptorSets(writeDescriptorSets.size(), writeDescriptorSets.data(), 0, NULL);
@@ -443,7 +306,13 @@ public:
                 descriptorSets.bitmap,
                 vk::DescriptorType::eCombinedImageSampler,
                 1,
-                &texDescriptor)
+                &texDescriptor),
+            // Binding 3 : Vertex shader glyph table
+            vkx::writeDescriptorSet(
+                descriptorSets.bitmap,
+                vk::DescriptorType::eUniformBuffer,
+                3,
+                &glyphTableDescriptor)
         };
 
         device.updateDescriptorSets(writeDescriptorSets.size(), writeDescriptorSets.data(), 0, NULL);
@@ -451,7 +320,7 @@ public:
 
     void preparePipelines() {
         vk::PipelineInputAssemblyStateCreateInfo inputAssemblyState =
-            vkx::pipelineInputAssemblyStateCreateInfo(vk::PrimitiveTopology::eTriangleList, vk::PipelineInputAssemblyStateCreateFlags(), VK_FALSE);
+            vkx::pipelineInputAssemblyStateCreateInfo(vk::PrimitiveTopology::eTriangleStrip, vk::PipelineInputAssemblyStateCreateFlags(), VK_FALSE);
 
         vk::PipelineRasterizationStateCreateInfo rasterizationState =
             vkx::pipelineRasterizationStateCreateInfo(vk::PolygonMode::eFill, vk::CullModeFlagBits::eNone, vk::FrontFace::eCounterClockwise);
@@ -488,13 +357,14 @@ public:
         // Load shaders
         std::array<vk::PipelineShaderStageCreateInfo, 2> shaderStages;
 
-        shaderStages[0] = loadShader(getAssetPath() + "shaders/distancefieldfonts/sdf.vert.spv", vk::ShaderStageFlagBits::eVertex);
+        // Both pipelines expand the glyph instances with the same vertex shader
+        shaderStages[0] = loadGlslShader(getAssetPath() + "shaders/distancefieldfonts/text.vert", vk::ShaderStageFlagBits::eVertex);
         shaderStages[1] = loadShader(getAssetPath() + "shaders/distancefieldfonts/sdf.frag.spv", vk::ShaderStageFlagBits::eFragment);
 
         vk::GraphicsPipelineCreateInfo pipelineCreateInfo =
             vkx::pipelineCreateInfo(pipelineLayout, renderPass);
 
-        pipelineCreateInfo.pVertexInputState = &vertices.inputState;
+        pipelineCreateInfo.pVertexInputState = &textRenderer.inputState();
         pipelineCreateInfo.pInputAssemblyState = &inputAssemblyState;
         pipelineCreateInfo.pRasterizationState = &rasterizationState;
         pipelineCreateInfo.pColorBlendState = &colorBlendState;
@@ -509,7 +379,6 @@ public:
 
 
         // Default bitmap font rendering pipeline
-        shaderStages[0] = loadShader(getAssetPath() + "shaders/distancefieldfonts/bitmap.vert.spv", vk::ShaderStageFlagBits::eVertex);
         shaderStages[1] = loadShader(getAssetPath() + "shaders/distancefieldfonts/bitmap.frag.spv", vk::ShaderStageFlagBits::eFragment);
         pipelines.bitmap = device.createGraphicsPipelines(pipelineCache, pipelineCreateInfo, nullptr)[0];
 
@@ -540,24 +409,18 @@ public:
         uboVS.model = glm::rotate(uboVS.model, glm::radians(rotation.y), glm::vec3(0.0f, 1.0f, 0.0f));
         uboVS.model = glm::rotate(uboVS.model, glm::radians(rotation.z), glm::vec3(0.0f, 0.0f, 1.0f));
 
-        void *pData = device.mapMemory(uniformData.vs.memory, 0, sizeof(uboVS), vk::MemoryMapFlags());
-        memcpy(pData, &uboVS, sizeof(uboVS));
-        device.unmapMemory(uniformData.vs.memory);
+        uniformData.vs.copy(uboVS);
     }
 
     void updateFontSettings() {
         // Fragment shader
-        void *pData = device.mapMemory(uniformData.fs.memory, 0, sizeof(uboFS), vk::MemoryMapFlags());
-        memcpy(pData, &uboFS, sizeof(uboFS));
-        device.unmapMemory(uniformData.fs.memory);
+        uniformData.fs.copy(uboFS);
     }
 
     void prepare() {
         ExampleBase::prepare();
-        parsebmFont();
         loadTextures();
-        generateText("Vulkan");
-        setupVertexDescriptions();
+        prepareText();
         prepareUniformBuffers();
         setupDescriptorSetLayout();
         preparePipelines();
@@ -575,6 +438,14 @@ public:
         vkDeviceWaitIdle(device);
     }
 
+    void draw() override {
+        prepareFrame();
+        // The region of this swap chain image is no longer read once its previous frame completed
+        updateText();
+        drawCommandBuffers({ drawCmdBuffers[currentBuffer] });
+        submitFrame();
+    }
+
     virtual void viewChanged() {
         updateUniformBuffers();
     }
@@ -585,6 +456,11 @@ public:
         updateUniformBuffers();
     }
 
+    void toggleBenchmark() {
+        benchmark = benchmark + 1 < (int32_t)BENCHMARK_GLYPHS.size() ? benchmark + 1 : -1;
+        updateTextOverlay();
+    }
+
     void toggleFontOutline() {
         uboFS.outline = !uboFS.outline;
         updateFontSettings();
@@ -599,8 +475,21 @@ public:
         case GLFW_KEY_O:
             toggleFontOutline();
             break;
+        case GLFW_KEY_B:
+            toggleBenchmark();
+            break;
         }
     }
+
+    virtual void getOverlayText(vkx::TextOverlay *textOverlay) {
+        std::stringstream ss;
+        ss << std::fixed << std::setprecision(2);
+        ss << "Glyphs: " << textRenderer.glyphCount() << " in 1 draw, filled in " << glyphFillTime << " ms";
+        textOverlay->addText(ss.str(), 5.0f, 85.0f, vkx::TextOverlay::alignLeft);
+        ss.str("");
+        ss << "Press \"b\" to cycle the benchmark (" << BENCHMARK_GLYPHS.back() << " glyphs max)";
+        textOverlay->addText(ss.str(), 5.0f, 105.0f, vkx::TextOverlay::alignLeft);
+    }
 };
 
 RUN_EXAMPLE(VulkanExample)
@@ -0,0 +1,634 @@
+/*
+* Vulkan Example - Per draw data benchmark
+*
+* Draws N identical quads, each with its own offset and color, and compares the ways of
+* getting per object data to the vertex shader:
+*
+*   push constants      : one vkCmdPushConstants and one draw per object
+*   dynamic UBO         : one descriptor set bind with a dynamic offset and one draw per object
+*   storage buffer      : one draw per object, the object index is passed as first instance
+*   instance attributes : one instanced draw, the object data is a per instance vertex binding
+*   indirect            : the storage buffer path with the draws read from an indirect buffer
+*
+* On start every strategy is swept over the object counts, measuring the CPU time to record the
+* command buffer, the CPU time of the queue submission and the GPU time of the render pass.  The
+* results are printed to the console once the sweep is done.  Afterwards "s" and "n" select the
+* strategy and object count to draw, "b" restarts the sweep.
+*
+* This code is licensed under the MIT license (MIT) (http://opensource.org/licenses/MIT)
+*/
+
+#include "vulkanExampleBase.h"
+
+// Object counts of the sweep
+static const std::array<uint32_t, 7> OBJECT_COUNTS = { 1, 10, 100, 1000, 10000, 100000, 1000000 };
+// Frames measured per configuration, the first one only warms up
+static const uint32_t SWEEP_FRAMES = 6;
+// A strategy isn't run with higher object counts once a frame took longer than this (ms)
+static const float FRAME_BUDGET = 2000.0f;
+// Largest dynamic uniform buffer, one aligned slot per object
+static const vk::DeviceSize MAX_DYNAMIC_UBO_SIZE = 128 * 1024 * 1024;
+
+enum Strategy {
+    PushConstants,
+    DynamicUbo,
+    StorageBuffer,
+    InstanceAttributes,
+    Indirect,
+    StrategyCount
+};
+
+static const char* STRATEGY_NAMES[StrategyCount] = { "push constants", "dynamic UBO", "storage buffer", "instancing", "indirect" };
+// Shader variant of each strategy, the indirect draws read the storage buffer
+static const char* STRATEGY_DEFINES[StrategyCount] = { "PUSH_CONSTANTS", "DYNAMIC_UBO", "STORAGE_BUFFER", "INSTANCE_ATTRIBUTES", "STORAGE_BUFFER" };
+
+class VulkanExample : public vkx::ExampleBase {
+public:
+    // std140 and std430 layout of the per object data in object.vert
+    struct ObjectData {
+        // xy : offset in normalized device coordinates, z : scale
+        glm::vec4 offsetScale;
+        glm::vec4 color;
+    };
+
+    // Best frame of a configuration, in ms
+    struct Result {
+        bool measured{ false };
+        // Why the configuration wasn't run
+        const char* skipped{ nullptr };
+        float record{ 0.0f };
+        float submit{ 0.0f };
+        float gpu{ 0.0f };
+    };
+
+    struct {
+        vk::PipelineVertexInputStateCreateInfo inputState;
+        std::vector<vk::VertexInputBindingDescription> bindingDescriptions;
+        std::vector<vk::VertexInputAttributeDescription> attributeDescriptions;
+    } vertices;
+
+    std::array<vk::Pipeline, StrategyCount> pipelines;
+    vk::PipelineLayout pipelineLayout;
+    vk::DescriptorSetLayout descriptorSetLayout;
+    vk::DescriptorSet descriptorSet;
+
+    // Unit quad, shared by all objects
+    vkx::CreateBufferResult quadVertices;
+    vkx::CreateBufferResult quadIndices;
+    // Tightly packed object data, read as storage buffer and as instance vertex buffer
+    vkx::CreateBufferResult objectBuffer;
+    // Object data at minUniformBufferOffsetAlignment strides
+    vkx::CreateBufferResult dynamicUniformBuffer;
+    // One indexed draw per object, first instance is the object index
+    vkx::CreateBufferResult indirectBuffer;
+    // Upload of the per object data whenever the object count changes
+    vkx::CreateBufferResult stagingBuffer;
+    // Host copy of the object data, the push constants are recorded from it
+    std::vector<ObjectData> objects;
+    vk::DeviceSize dynamicAlignment{ 0 };
+    uint32_t maxDynamicUboObjects{ 0 };
+
+    vk::QueryPool timestampQueryPool;
+
+    Strategy strategy = PushConstants;
+    uint32_t countIndex = 0;
+    // Object count the buffers currently hold
+    uint32_t uploadedCount = 0;
+
+    // Last frame
+    float recordTime = 0.0f;
+    float submitTime = 0.0f;
+    float gpuTime = 0.0f;
+
+    bool sweeping = true;
+    uint32_t sweepFrame = 0;
+    std::array<std::array<Result, OBJECT_COUNTS.size()>, StrategyCount> results;
+
+    VulkanExample() : vkx::ExampleBase(ENABLE_VALIDATION) {
+        enableTextOverlay = true;
+        title = "Vulkan Example - Per draw data benchmark";
+    }
+
+    ~VulkanExample() {
+        // Clean up used Vulkan resources
+        // Note : Inherited destructor cleans up resources stored in base class
+        for (auto& pipeline : pipelines) {
+            device.destroyPipeline(pipeline);
+        }
+        device.destroyPipelineLayout(pipelineLayout);
+        device.destroyDescriptorSetLayout(descriptorSetLayout);
+        device.destroyQueryPool(timestampQueryPool);
+
+        quadVertices.destroy();
+        quadIndices.destroy();
+        objectBuffer.destroy();
+        dynamicUniformBuffer.destroy();
+        indirectBuffer.destroy();
+        stagingBuffer.destroy();
+    }
+
+    uint32_t objectCount() const {
+        return OBJECT_COUNTS[countIndex];
+    }
+
+    // Reason the strategy can't draw count objects on this device, nullptr if it can
+    const char* unsupported(Strategy strategy, uint32_t count) const {
+        if (strategy == DynamicUbo && count > maxDynamicUboObjects) {
+            return "buffer size";
+        }
+        // Without the feature the first instance of indirect draws must be 0
+        if (strategy == Indirect && !deviceFeatures.drawIndirectFirstInstance) {
+            return "no drawIndirectFirstInstance";
+        }
+        return nullptr;
+    }
+
+    void recordCommandBuffer(const vk::CommandBuffer& cmdBuffer, const vk::Framebuffer& frameBuffer) {
+        vk::CommandBufferBeginInfo cmdBufInfo;
+        cmdBufInfo.flags = vk::CommandBufferUsageFlagBits::eOneTimeSubmit;
+
+        vk::ClearValue clearValues[2];
+        clearValues[0].color = defaultClearColor;
+        clearValues[1].depthStencil = { 1.0f, 0 };
+
+        vk::RenderPassBeginInfo renderPassBeginInfo;
+        renderPassBeginInfo.renderPass = renderPass;
+        renderPassBeginInfo.renderArea.extent.width = width;
+        renderPassBeginInfo.renderArea.extent.height = height;
+        renderPassBeginInfo.clearValueCount = 2;
+        renderPassBeginInfo.pClearValues = clearValues;
+        renderPassBeginInfo.framebuffer = frameBuffer;
+
+        cmdBuffer.begin(cmdBufInfo);
+        cmdBuffer.resetQueryPool(timestampQueryPool, 0, 2);
+        cmdBuffer.writeTimestamp(vk::PipelineStageFlagBits::eTopOfPipe, timestampQueryPool, 0);
+        cmdBuffer.beginRenderPass(renderPassBeginInfo, vk::SubpassContents::eInline);
+
+        vk::Viewport viewport = vkx::viewport((float)width, (float)height, 0.0f, 1.0f);
+        cmdBuffer.setViewport(0, viewport);
+
+        vk::Rect2D scissor = vkx::rect2D(width, height, 0, 0);
+        cmdBuffer.setScissor(0, scissor);
+
+        vk::DeviceSize offset = 0;
+        uint32_t noDynamicOffset = 0;
+
+        uint32_t count = objectCount();
+        if (!unsupported(strategy, count)) {
+            cmdBuffer.bindPipeline(vk::PipelineBindPoint::eGraphics, pipelines[strategy]);
+            cmdBuffer.bindVertexBuffers(VERTEX_BUFFER_BIND_ID, quadVertices.buffer, offset);
+            cmdBuffer.bindIndexBuffer(quadIndices.buffer, 0, vk::IndexType::eUint32);
+
+            switch (strategy) {
+            case PushConstants:
+                for (uint32_t i = 0; i < count; ++i) {
+                    cmdBuffer.pushConstants(pipelineLayout, vk::ShaderStageFlagBits::eVertex, 0, sizeof(ObjectData), &objects[i]);
+                    cmdBuffer.drawIndexed(6, 1, 0, 0, 0);
+                }
+                break;
+
+            case DynamicUbo:
+                for (uint32_t i = 0; i < count; ++i) {
+                    uint32_t dynamicOffset = (uint32_t)(i * dynamicAlignment);
+                    cmdBuffer.bindDescriptorSets(vk::PipelineBindPoint::eGraphics, pipelineLayout, 0, descriptorSet, dynamicOffset);
+                    cmdBuffer.drawIndexed(6, 1, 0, 0, 0);
+                }
+                break;
+
+            case StorageBuffer:
+                cmdBuffer.bindDescriptorSets(vk::PipelineBindPoint::eGraphics, pipelineLayout, 0, descriptorSet, noDynamicOffset);
+                for (uint32_t i = 0; i < count; ++i) {
+                    cmdBuffer.drawIndexed(6, 1, 0, 0, i);
+                }
+                break;
+
+            case InstanceAttributes:
+                cmdBuffer.bindVertexBuffers(INSTANCE_BUFFER_BIND_ID, objectBuffer.buffer, offset);
+                cmdBuffer.drawIndexed(6, count, 0, 0, 0);
+                break;
+
+            case Indirect: {
+                cmdBuffer.bindDescriptorSets(vk::PipelineBindPoint::eGraphics, pipelineLayout, 0, descriptorSet, noDynamicOffset);
+                // Without multi draw indirect every command is a draw of its own
+                uint32_t maxDrawCount = deviceFeatures.multiDrawIndirect ? deviceProperties.limits.maxDrawIndirectCount : 1;
+                uint32_t stride = sizeof(vk::DrawIndexedIndirectCommand);
+                for (uint32_t first = 0; first < count; first += maxDrawCount) {
+                    cmdBuffer.drawIndexedIndirect(indirectBuffer.buffer, first * stride, std::min(maxDrawCount, count - first), stride);
+                }
+                break;
+            }
+
+            default:
+                break;
+            }
+        }
+
+        cmdBuffer.endRenderPass();
+        cmdBuffer.writeTimestamp(vk::PipelineStageFlagBits::eBottomOfPipe, timestampQueryPool, 1);
+        cmdBuffer.end();
+    }
+
+    void buildCommandBuffers() override {
+        for (size_t i = 0; i < drawCmdBuffers.size(); ++i) {
+            recordCommandBuffer(drawCmdBuffers[i], frameBuffers[i]);
+        }
+    }
+
+    void prepareVertices() {
+        std::vector<glm::vec2> quad = { { -1.0f, -1.0f }, { 1.0f, -1.0f }, { 1.0f, 1.0f }, { -1.0f, 1.0f } };
+        std::vector<uint32_t> indices = { 0, 1, 2, 2, 3, 0 };
+        quadVertices = stageToDeviceBuffer(vk::BufferUsageFlagBits::eVertexBuffer, quad);
+        quadIndices = stageToDeviceBuffer(vk::BufferUsageFlagBits::eIndexBuffer, indices);
+
+        vertices.bindingDescriptions.resize(2);
+        vertices.bindingDescriptions[0] =
+            vkx::vertexInputBindingDescription(VERTEX_BUFFER_BIND_ID, sizeof(glm::vec2), vk::VertexInputRate::eVertex);
+        // Only read by the instance attribute variant
+        vertices.bindingDescriptions[1] =
+            vkx::vertexInputBindingDescription(INSTANCE_BUFFER_BIND_ID, sizeof(ObjectData), vk::VertexInputRate::eInstance);
+
+        vertices.attributeDescriptions.resize(3);
+        // Location 0 : Position
+        vertices.attributeDescriptions[0] =
+            vkx::vertexInputAttributeDescription(VERTEX_BUFFER_BIND_ID, 0, vk::Format::eR32G32Sfloat, 0);
+        // Location 1 : Instance offset and scale
+        vertices.attributeDescriptions[1] =
+            vkx::vertexInputAttributeDescription(INSTANCE_BUFFER_BIND_ID, 1, vk::Format::eR32G32B32A32Sfloat, offsetof(ObjectData, offsetScale));
+        // Location 2 : Instance color
+        vertices.attributeDescriptions[2] =
+            vkx::vertexInputAttributeDescription(INSTANCE_BUFFER_BIND_ID, 2, vk::Format::eR32G32B32A32Sfloat, offsetof(ObjectData, color));
+
+        vertices.inputState = vk::PipelineVertexInputStateCreateInfo();
+        vertices.inputState.vertexBindingDescriptionCount = vertices.bindingDescriptions.size();
+        vertices.inputState.pVertexBindingDescriptions = vertices.bindingDescriptions.data();
+        vertices.inputState.vertexAttributeDescriptionCount = vertices.attributeDescriptions.size();
+        vertices.inputState.pVertexAttributeDescriptions = vertices.attributeDescriptions.data();
+    }
+
+    // Buffers for the largest object count, filled by uploadObjects
+    void prepareObjectBuffers() {
+        uint32_t maxCount = OBJECT_COUNTS.back();
+        vk::DeviceSize objectSize = maxCount * sizeof(ObjectData);
+
+        vk::DeviceSize minAlignment = deviceProperties.limits.minUniformBufferOffsetAlignment;
+        dynamicAlignment = minAlignment > 0 ? (sizeof(ObjectData) + minAlignment - 1) & ~(minAlignment - 1) : sizeof(ObjectData);
+        maxDynamicUboObjects = (uint32_t)std::min<vk::DeviceSize>(maxCount, MAX_DYNAMIC_UBO_SIZE / dynamicAlignment);
+        vk::DeviceSize dynamicSize = maxDynamicUboObjects * dynamicAlignment;
+
+        objectBuffer = createBuffer(vk::BufferUsageFlagBits::eStorageBuffer | vk::BufferUsageFlagBits::eVertexBuffer | vk::BufferUsageFlagBits::eTransferDst,
+            vk::MemoryPropertyFlagBits::eDeviceLocal, objectSize);
+        dynamicUniformBuffer = createBuffer(vk::BufferUsageFlagBits::eUniformBuffer | vk::BufferUsageFlagBits::eTransferDst,
+            vk::MemoryPropertyFlagBits::eDeviceLocal, dynamicSize);
+        stagingBuffer = createBuffer(vk::BufferUsageFlagBits::eTransferSrc,
+            vk::MemoryPropertyFlagBits::eHostVisible | vk::MemoryPropertyFlagBits::eHostCoherent, std::max(objectSize, dynamicSize));
+        stagingBuffer.map();
+
+        // The draws never change, only how many of them are used
+        std::vector<vk::DrawIndexedIndirectCommand> commands(maxCount);
+        for (uint32_t i = 0; i < maxCount; ++i) {
+            commands[i].indexCount = 6;
+            commands[i].instanceCount = 1;
+            commands[i].firstInstance = i;
+        }
+        indirectBuffer = stageToDeviceBuffer(vk::BufferUsageFlagBits::eIndirectBuffer, commands);
+
+        vk::QueryPoolCreateInfo queryPoolInfo;
+        queryPoolInfo.queryType = vk::QueryType::eTimestamp;
+        queryPoolInfo.queryCount = 2;
+        timestampQueryPool = device.createQueryPool(queryPoolInfo);
+    }
+
+    // Lays out count objects on a square grid filling the window and uploads them
+    void uploadObjects(uint32_t count) {
+        if (count == uploadedCount) {
+            return;
+        }
+        device.waitIdle();
+
+        uint32_t columns = (uint32_t)ceil(sqrt((float)count));
+        float cell = 2.0f / columns;
+        objects.resize(count);
+        for (uint32_t i = 0; i < count; ++i) {
+            ObjectData& object = objects[i];
+            glm::vec2 offset = glm::vec2((float)(i % columns) + 0.5f, (float)(i / columns) + 0.5f) * cell - 1.0f;
+            object.offsetScale = glm::vec4(offset, cell * 0.4f, 0.0f);
+            uint32_t hash = i * 2654435761u;
+            object.color = glm::vec4((hash & 0xff) / 255.0f, ((hash >> 8) & 0xff) / 255.0f, ((hash >> 16) & 0xff) / 255.0f, 1.0f);
+        }
+
+        // Packed copy first, then the aligned copy through the same staging memory
+        vk::DeviceSize objectSize = count * sizeof(ObjectData);
+        memcpy(stagingBuffer.mapped, objects.data(), objectSize);
+        withPrimaryCommandBuffer([&](const vk::CommandBuffer& copyCmd) {
+            copyCmd.copyBuffer(stagingBuffer.buffer, objectBuffer.buffer, vk::BufferCopy(0, 0, objectSize));
+        });
+        uint32_t dynamicCount = std::min(count, maxDynamicUboObjects);
+        if (dynamicCount > 0) {
+            for (uint32_t i = 0; i < dynamicCount; ++i) {
+                memcpy((uint8_t*)stagingBuffer.mapped + i * dynamicAlignment, &objects[i], sizeof(ObjectData));
+            }
+            withPrimaryCommandBuffer([&](const vk::CommandBuffer& copyCmd) {
+                copyCmd.copyBuffer(stagingBuffer.buffer, dynamicUniformBuffer.buffer, vk::BufferCopy(0, 0, dynamicCount * dynamicAlignment));
+            });
+        }
+        uploadedCount = count;
+    }
+
+    void setupDescriptorPool() {
+        std::vector<vk::DescriptorPoolSize> poolSizes =
+        {
+            vkx::descriptorPoolSize(vk::DescriptorType::eUniformBufferDynamic, 1),
+            vkx::descriptorPoolSize(vk::DescriptorType::eStorageBuffer, 1),
+        };
+
+        vk::DescriptorPoolCreateInfo descriptorPoolInfo =
+            vkx::descriptorPoolCreateInfo(poolSizes.size(), poolSizes.data(), 1);
+
+        descriptorPool = device.createDescriptorPool(descriptorPoolInfo);
+    }
+
+    // One layout for all variants, each shader only declares the bindings it reads
+    void setupDescriptorSetLayout() {
+        std::vector<vk::DescriptorSetLayoutBinding> setLayoutBindings =
+        {
+            // Binding 0 : Per object uniform buffer at a dynamic offset
+            vkx::descriptorSetLayoutBinding(
+                vk::DescriptorType::eUniformBufferDynamic,
+                vk::ShaderStageFlagBits::eVertex,
+                0),
+            // Binding 1 : Object storage buffer
+            vkx::descriptorSetLayoutBinding(
+                vk::DescriptorType::eStorageBuffer,
+                vk::ShaderStageFlagBits::eVertex,
+                1)
+        };
+
+        vk::DescriptorSetLayoutCreateInfo descriptorLayout =
+            vkx::descriptorSetLayoutCreateInfo(setLayoutBindings.data(), setLayoutBindings.size());
+
+        descriptorSetLayout = device.createDescriptorSetLayout(descriptorLayout);
+
+        vk::PushConstantRange pushConstantRange =
+            vkx::pushConstantRange(vk::ShaderStageFlagBits::eVertex, sizeof(ObjectData), 0);
+
+        vk::PipelineLayoutCreateInfo pipelineLayoutCreateInfo =
+            vkx::pipelineLayoutCreateInfo(&descriptorSetLayout, 1);
+        pipelineLayoutCreateInfo.pushConstantRangeCount = 1;
+        pipelineLayoutCreateInfo.pPushConstantRanges = &pushConstantRange;
+
+        pipelineLayout = device.createPipelineLayout(pipelineLayoutCreateInfo);
+    }
+
+    void setupDescriptorSet() {
+        vk::DescriptorSetAllocateInfo allocInfo =
+            vkx::descriptorSetAllocateInfo(descriptorPool, &descriptorSetLayout, 1);
+
+        descriptorSet = device.allocateDescriptorSets(allocInfo)[0];
+
+        // The dynamic offset selects the object, the range covers one
+        vk::DescriptorBufferInfo uniformDescriptor = dynamicUniformBuffer.descriptor;
+        uniformDescriptor.range = sizeof(ObjectData);
+
+        std::vector<vk::WriteDescriptorSet> writeDescriptorSets =
+        {
+            // Binding 0 : Per object uniform buffer
+            vkx::writeDescriptorSet(
+                descriptorSet,
+                vk::DescriptorType::eUniformBufferDynamic,
+                0,
+                &uniformDescriptor),
+            // Binding 1 : Object storage buffer
+            vkx::writeDescriptorSet(
+                descriptorSet,
+                vk::DescriptorType::eStorageBuffer,
+                1,
+                &objectBuffer.descriptor)
+        };
+
+        device.updateDescriptorSets(writeDescriptorSets.size(), writeDescriptorSets.data(), 0, NULL);
+    }
+
+    void preparePipelines() {
+        vk::PipelineInputAssemblyStateCreateInfo inputAssemblyState =
+            vkx::pipelineInputAssemblyStateCreateInfo(vk::PrimitiveTopology::eTriangleList, vk::PipelineInputAssemblyStateCreateFlags(), VK_FALSE);
+
+        vk::PipelineRasterizationStateCreateInfo rasterizationState =
+            vkx::pipelineRasterizationStateCreateInfo(vk::PolygonMode::eFill, vk::CullModeFlagBits::eNone, vk::FrontFace::eClockwise);
+
+        vk::PipelineColorBlendAttachmentState blendAttachmentState =
+            vkx::pipelineColorBlendAttachmentState();
+
+        vk::PipelineColorBlendStateCreateInfo colorBlendState =
+            vkx::pipelineColorBlendStateCreateInfo(1, &blendAttachmentState);
+
+        // The quads don't overlap
+        vk::PipelineDepthStencilStateCreateInfo depthStencilState =
+            vkx::pipelineDepthStencilStateCreateInfo(VK_FALSE, VK_FALSE, vk::CompareOp::eLessOrEqual);
+
+        vk::PipelineViewportStateCreateInfo viewportState =
+            vkx::pipelineViewportStateCreateInfo(1, 1);
+
+        vk::PipelineMultisampleStateCreateInfo multisampleState =
+            vkx::pipelineMultisampleStateCreateInfo(vk::SampleCountFlagBits::e1);
+
+        std::vector<vk::DynamicState> dynamicStateEnables = {
+            vk::DynamicState::eViewport,
+            vk::DynamicState::eScissor
+        };
+        vk::PipelineDynamicStateCreateInfo dynamicState =
+            vkx::pipelineDynamicStateCreateInfo(dynamicStateEnables.data(), dynamicStateEnables.size());
+
+        std::array<vk::PipelineShaderStageCreateInfo, 2> shaderStages;
+        shaderStages[1] = loadGlslShader(getAssetPath() + "shaders/drawdatabench/object.frag", vk::ShaderStageFlagBits::eFragment);
+
+        vk::GraphicsPipelineCreateInfo pipelineCreateInfo =
+            vkx::pipelineCreateInfo(pipelineLayout, renderPass);
+
+        pipelineCreateInfo.pVertexInputState = &vertices.inputState;
+        pipelineCreateInfo.pInputAssemblyState = &inputAssemblyState;
+        pipelineCreateInfo.pRasterizationState = &rasterizationState;
+        pipelineCreateInfo.pColorBlendState = &colorBlendState;
+        pipelineCreateInfo.pMultisampleState = &multisampleState;
+        pipelineCreateInfo.pViewportState = &viewportState;
+        pipelineCreateInfo.pDepthStencilState = &depthStencilState;
+        pipelineCreateInfo.pDynamicState = &dynamicState;
+        pipelineCreateInfo.stageCount = shaderStages.size();
+        pipelineCreateInfo.pStages = shaderStages.data();
+
+        // One vertex shader variant per strategy
+        for (uint32_t i = 0; i < StrategyCount; ++i) {
+            std::string preamble = std::string("#define ") + STRATEGY_DEFINES[i] + "\n";
+            shaderStages[0] = loadGlslShader(getAssetPath() + "shaders/drawdatabench/object.vert", vk::ShaderStageFlagBits::eVertex, preamble);
+            pipelines[i] = device.createGraphicsPipelines(pipelineCache, pipelineCreateInfo, nullptr)[0];
+        }
+    }
+
+    void prepare() {
+        ExampleBase::prepare();
+        prepareVertices();
+        prepareObjectBuffers();
+        uploadObjects(objectCount());
+        setupDescriptorSetLayout();
+        preparePipelines();
+        setupDescriptorPool();
+        setupDescriptorSet();
+        startSweep();
+        buildCommandBuffers();
+        prepared = true;
+    }
+
+    void startSweep() {
+        for (auto& strategyResults : results) {
+            strategyResults.fill(Result());
+        }
+        sweeping = true;
+        sweepFrame = 0;
+        strategy = PushConstants;
+        countIndex = 0;
+        uploadObjects(objectCount());
+        skipUnsupported();
+    }
+
+    // Marks the configurations that can't run, returns true if the current one is one of them
+    bool skipUnsupported() {
+        Result& result = results[strategy][countIndex];
+        if (!result.skipped) {
+            result.skipped = unsupported(strategy, objectCount());
+        }
+        return result.skipped != nullptr;
+    }
+
+    // The sweep runs all strategies for one object count before moving to the next count, so
+    // the object data is only uploaded once per count
+    void nextConfiguration() {
+        do {
+            strategy = (Strategy)(strategy + 1);
+            if (strategy == StrategyCount) {
+                strategy = PushConstants;
+                if (++countIndex == OBJECT_COUNTS.size()) {
+                    countIndex = (uint32_t)OBJECT_COUNTS.size() - 1;
+                    strategy = InstanceAttributes;
+                    sweeping = false;
+                    printResults();
+                    break;
+                }
+            }
+        } while (skipUnsupported());
+        sweepFrame = 0;
+        uploadObjects(objectCount());
+        updateTextOverlay();
+    }
+
+    void recordSweepFrame() {
+        if (sweepFrame++ == 0) {
+            return;
+        }
+        Result& result = results[strategy][countIndex];
+        if (!result.measured || recordTime + submitTime + gpuTime < result.record + result.submit + result.gpu) {
+            result.measured = true;
+            result.record = recordTime;
+            result.submit = submitTime;
+            result.gpu = gpuTime;
+        }
+        if (recordTime + gpuTime > FRAME_BUDGET) {
+            for (uint32_t i = countIndex + 1; i < OBJECT_COUNTS.size(); ++i) {
+                results[strategy][i].skipped = "over budget";
+            }
+        }
+        if (sweepFrame == SWEEP_FRAMES) {
+            nextConfiguration();
+        }
+    }
+
+    void printResults() {
+        std::cout << "Per draw data benchmark, best of " << SWEEP_FRAMES - 1 << " frames, record / submit / GPU ms" << std::endl;
+        std::cout << std::setw(10) << "objects";
+        for (uint32_t s = 0; s < StrategyCount; ++s) {
+            std::cout << std::setw(26) << STRATEGY_NAMES[s];
+        }
+        std::cout << std::endl;
+        for (uint32_t c = 0; c < OBJECT_COUNTS.size(); ++c) {
+            std::cout << std::setw(10) << OBJECT_COUNTS[c];
+            for (uint32_t s = 0; s < StrategyCount; ++s) {
+                const Result& result = results[s][c];
+                std::stringstream ss;
+                if (result.measured) {
+                    ss << std::fixed << std::setprecision(3) << result.record << " / " << result.submit << " / " << result.gpu;
+                } else {
+                    ss << "- (" << (result.skipped ? result.skipped : "not run") << ")";
+                }
+                std::cout << std::setw(26) << ss.str();
+            }
+            std::cout << std::endl;
+        }
+    }
+
+    virtual void render() {
+        if (!prepared)
+            return;
+        vkDeviceWaitIdle(device);
+        prepareFrame();
+
+        // The command buffer is recorded every frame, that's part of what is measured
+        auto tStart = std::chrono::high_resolution_clock::now();
+        recordCommandBuffer(drawCmdBuffers[currentBuffer], frameBuffers[currentBuffer]);
+        auto tRecorded = std::chrono::high_resolution_clock::now();
+        drawCommandBuffers({ drawCmdBuffers[currentBuffer] });
+        auto tSubmitted = std::chrono::high_resolution_clock::now();
+        submitFrame();
+        vkDeviceWaitIdle(device);
+
+        recordTime = std::chrono::duration<float, std::milli>(tRecorded - tStart).count();
+        submitTime = std::chrono::duration<float, std::milli>(tSubmitted - tRecorded).count();
+        uint64_t timestamps[2];
+        device.getQueryPoolResults(timestampQueryPool, 0, 2, sizeof(timestamps), timestamps, sizeof(uint64_t), vk::QueryResultFlagBits::e64 | vk::QueryResultFlagBits::eWait);
+        gpuTime = (float)(timestamps[1] - timestamps[0]) * deviceProperties.limits.timestampPeriod / 1000000.0f;
+
+        if (sweeping) {
+            recordSweepFrame();
+        }
+    }
+
+    void keyPressed(uint32_t key) override {
+        switch (key) {
+        case GLFW_KEY_S:
+            sweeping = false;
+            strategy = (Strategy)((strategy + 1) % StrategyCount);
+            updateTextOverlay();
+            break;
+        case GLFW_KEY_N:
+            sweeping = false;
+            countIndex = (countIndex + 1) % OBJECT_COUNTS.size();
+            uploadObjects(objectCount());
+            updateTextOverlay();
+            break;
+        case GLFW_KEY_B:
+            startSweep();
+            updateTextOverlay();
+            break;
+        }
+    }
+
+    virtual void getOverlayText(vkx::TextOverlay *textOverlay) {
+        std::stringstream ss;
+        ss << std::fixed << std::setprecision(3);
+        ss << objectCount() << " objects, " << STRATEGY_NAMES[strategy];
+        const char* reason = unsupported(strategy, objectCount());
+        if (reason) {
+            ss << " (not drawn: " << reason << ")";
+        }
+        textOverlay->addText(ss.str(), 5.0f, 85.0f, vkx::TextOverlay::alignLeft);
+        ss.str("");
+        ss << "Record: " << recordTime << " ms, submit: " << submitTime << " ms, GPU: " << gpuTime << " ms";
+        textOverlay->addText(ss.str(), 5.0f, 105.0f, vkx::TextOverlay::alignLeft);
+        ss.str("");
+        if (sweeping) {
+            ss << "Sweeping, frame " << sweepFrame << " of " << SWEEP_FRAMES;
+        } else {
+            ss << "Results on the console (\"s\" strategy, \"n\" objects, \"b\" sweep again)";
+        }
+        textOverlay->addText(ss.str(), 5.0f, 125.0f, vkx::TextOverlay::alignLeft);
+    }
+};
+
+RUN_EXAMPLE(VulkanExample)
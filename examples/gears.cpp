@@ -1,5 +1,5 @@
 /*
-* Vulkan Example - Animated gears using multiple uniform buffers
+* Vulkan Example - Animated gears drawn as one batch
 *
 * Copyright (C) 2016 by Sascha Willems - www.saschawillems.de
 *
@@ -11,6 +11,11 @@
 #include "vulkanGear.h"
 #include "vulkanExampleBase.h"
 
+// Number of copies of the three gear scene, cycled with "g"
+static const std::array<uint32_t, 5> GEAR_GROUPS = { 1, 10, 100, 1000, 2000 };
+// Distance between the copies
+static const float GROUP_SPACING = 14.0f;
+
 
 class VulkanExample : public vkx::ExampleBase {
 public:
@@ -24,16 +29,27 @@ public:
         vk::Pipeline solid;
     } pipelines;
 
-    std::vector<VulkanGear*> gears;
+    // All gears share one vertex, index and instance buffer and are drawn with a single draw
+    VulkanGearBatch gears{ *this };
+    uint32_t gearGroups = 0;
+    vkx::ThreadPool threadPool;
 
     vk::PipelineLayout pipelineLayout;
     vk::DescriptorSetLayout descriptorSetLayout;
 
+    // GPU time of the render pass, one pair of timestamps per draw command buffer
+    vk::QueryPool timestampQueryPool;
+    float generateTime = 0.0f;
+    float cpuTime = 0.0f;
+    float gpuTime = 0.0f;
+
     VulkanExample() : vkx::ExampleBase(ENABLE_VALIDATION) {
         zoom = -16.0f;
         rotation = glm::vec3(-23.75, 41.25, 21.0);
         timerSpeed *= 0.25f;
+        enableTextOverlay = true;
         title = "Vulkan Example - Gears";
+        threadPool.setThreadCount(std::max(1u, std::thread::hardware_concurrency()));
     }
 
     ~VulkanExample() {
@@ -44,9 +60,17 @@ public:
         device.destroyPipelineLayout(pipelineLayout);
         device.destroyDescriptorSetLayout(descriptorSetLayout);
 
-        for (auto& gear : gears) {
-            delete(gear);
+        device.destroyQueryPool(timestampQueryPool);
+
+        gears.destroy();
+    }
+
+    void reBuildCommandBuffers() {
+        if (!checkCommandBuffers()) {
+            destroyCommandBuffers();
+            createCommandBuffers();
         }
+        buildCommandBuffers();
     }
 
     void buildCommandBuffers() {
@@ -71,6 +95,8 @@ public:
 
             drawCmdBuffers[i].begin(cmdBufInfo);
 
+            drawCmdBuffers[i].resetQueryPool(timestampQueryPool, i * 2, 2);
+            drawCmdBuffers[i].writeTimestamp(vk::PipelineStageFlagBits::eTopOfPipe, timestampQueryPool, i * 2);
 
             drawCmdBuffers[i].beginRenderPass(renderPassBeginInfo, vk::SubpassContents::eInline);
 
@@ -82,18 +108,19 @@ public:
 
             drawCmdBuffers[i].bindPipeline(vk::PipelineBindPoint::eGraphics, pipelines.solid);
 
-            for (auto& gear : gears) {
-                gear->draw(drawCmdBuffers[i], pipelineLayout);
-            }
+            gears.draw(drawCmdBuffers[i], pipelineLayout);
 
             drawCmdBuffers[i].endRenderPass();
 
+            drawCmdBuffers[i].writeTimestamp(vk::PipelineStageFlagBits::eBottomOfPipe, timestampQueryPool, i * 2 + 1);
+
             drawCmdBuffers[i].end();
 
         }
     }
 
-    void prepareVertices() {
+    // Generates the gears of gearGroups copies of the three gear scene
+    void generateGears() {
         // Gear definitions
         std::vector<float> innerRadiuses = { 1.0f, 0.5f, 1.3f };
         std::vector<float> outerRadiuses = { 4.0f, 2.0f, 2.0f };
@@ -113,38 +140,59 @@ public:
         std::vector<float> rotationSpeeds = { 1.0f, -2.0f, -2.0f };
         std::vector<float> rotationStarts = { 0.0f, -9.0f, -30.0f };
 
-        gears.resize(positions.size());
-        for (int32_t i = 0; i < gears.size(); ++i) {
-            gears[i] = new VulkanGear(*this);
-            gears[i]->generate(
-                innerRadiuses[i],
-                outerRadiuses[i],
-                widths[i],
-                toothCount[i],
-                toothDepth[i],
-                colors[i],
-                positions[i],
-                rotationSpeeds[i],
-                rotationStarts[i]);
+        // The copies are laid out on a square grid centered on the original scene
+        uint32_t groups = GEAR_GROUPS[gearGroups];
+        uint32_t columns = (uint32_t)ceil(sqrt((float)groups));
+        uint32_t rows = (groups + columns - 1) / columns;
+        glm::vec3 center = glm::vec3((float)(columns - 1), -(float)(rows - 1), 0.0f) * (GROUP_SPACING / 2.0f);
+        std::vector<GearInfo> gearInfos;
+        gearInfos.reserve(groups * positions.size());
+        for (uint32_t group = 0; group < groups; ++group) {
+            glm::vec3 offset = glm::vec3((float)(group % columns), -(float)(group / columns), 0.0f) * GROUP_SPACING - center;
+            for (size_t i = 0; i < positions.size(); ++i) {
+                GearInfo info;
+                info.innerRadius = innerRadiuses[i];
+                info.outerRadius = outerRadiuses[i];
+                info.width = widths[i];
+                info.teeth = toothCount[i];
+                info.toothDepth = toothDepth[i];
+                info.color = colors[i];
+                info.pos = positions[i] + offset;
+                info.rotSpeed = rotationSpeeds[i];
+                info.rotOffset = rotationStarts[i];
+                gearInfos.push_back(info);
+            }
+        }
+
+        auto tStart = std::chrono::high_resolution_clock::now();
+        gears.generate(gearInfos, &threadPool);
+        auto tEnd = std::chrono::high_resolution_clock::now();
+        generateTime = std::chrono::duration<float, std::milli>(tEnd - tStart).count();
+        if (verbose) {
+            std::cout << "Generated " << gears.gearCount() << " gears (" << gears.vertexCount() << " vertices) in " << generateTime << " ms" << std::endl;
         }
+    }
+
+    void prepareVertices() {
+        generateGears();
 
         // Binding and attribute descriptions are shared across all gears
         vertices.bindingDescriptions.resize(1);
         vertices.bindingDescriptions[0] =
-            vkx::vertexInputBindingDescription(VERTEX_BUFFER_BIND_ID, sizeof(Vertex), vk::VertexInputRate::eVertex);
+            vkx::vertexInputBindingDescription(VERTEX_BUFFER_BIND_ID, sizeof(GearVertex), vk::VertexInputRate::eVertex);
 
         // Attribute descriptions
         // Describes memory layout and shader positions
         vertices.attributeDescriptions.resize(3);
         // Location 0 : Position
         vertices.attributeDescriptions[0] =
-            vkx::vertexInputAttributeDescription(VERTEX_BUFFER_BIND_ID, 0,  vk::Format::eR32G32B32Sfloat, 0);
+            vkx::vertexInputAttributeDescription(VERTEX_BUFFER_BIND_ID, 0,  vk::Format::eR32G32B32Sfloat, offsetof(GearVertex, pos));
         // Location 1 : Normal
         vertices.attributeDescriptions[1] =
-            vkx::vertexInputAttributeDescription(VERTEX_BUFFER_BIND_ID, 1,  vk::Format::eR32G32B32Sfloat, sizeof(float) * 3);
-        // Location 2 : Color
+            vkx::vertexInputAttributeDescription(VERTEX_BUFFER_BIND_ID, 1,  vk::Format::eR32G32B32Sfloat, offsetof(GearVertex, normal));
+        // Location 2 : Gear index into the instance buffer
         vertices.attributeDescriptions[2] =
-            vkx::vertexInputAttributeDescription(VERTEX_BUFFER_BIND_ID, 2,  vk::Format::eR32G32B32Sfloat, sizeof(float) * 6);
+            vkx::vertexInputAttributeDescription(VERTEX_BUFFER_BIND_ID, 2,  vk::Format::eR32Uint, offsetof(GearVertex, gear));
 
         vertices.inputState = vk::PipelineVertexInputStateCreateInfo();
         vertices.inputState.vertexBindingDescriptionCount = vertices.bindingDescriptions.size();
@@ -154,15 +202,15 @@ public:
     }
 
     void setupDescriptorPool() {
-        // One UBO for each gears
+        // One descriptor set for all gears
         std::vector<vk::DescriptorPoolSize> poolSizes =
         {
-            vkx::descriptorPoolSize(vk::DescriptorType::eUniformBuffer, 3),
+            vkx::descriptorPoolSize(vk::DescriptorType::eUniformBuffer, 1),
+            vkx::descriptorPoolSize(vk::DescriptorType::eStorageBuffer, 1),
         };
 
         vk::DescriptorPoolCreateInfo descriptorPoolInfo =
-            vkx::descriptorPoolCreateInfo(poolSizes.size(), poolSizes.data(), // Three descriptor sets (for each gear)
-                3);
+            vkx::descriptorPoolCreateInfo(poolSizes.size(), poolSizes.data(), 1);
 
         descriptorPool = device.createDescriptorPool(descriptorPoolInfo);
     }
@@ -174,7 +222,12 @@ public:
             vkx::descriptorSetLayoutBinding(
                 vk::DescriptorType::eUniformBuffer,
                 vk::ShaderStageFlagBits::eVertex,
-                0)
+                0),
+            // Binding 1 : Vertex shader instance buffer
+            vkx::descriptorSetLayoutBinding(
+                vk::DescriptorType::eStorageBuffer,
+                vk::ShaderStageFlagBits::eVertex,
+                1)
         };
 
         vk::DescriptorSetLayoutCreateInfo descriptorLayout =
@@ -191,9 +244,7 @@ public:
     }
 
     void setupDescriptorSets() {
-        for (auto& gear : gears) {
-            gear->setupDescriptorSet(descriptorPool, descriptorSetLayout);
-        }
+        gears.setupDescriptorSet(descriptorPool, descriptorSetLayout);
     }
 
     void preparePipelines() {
@@ -229,7 +280,7 @@ public:
         // Load shaders
         std::array<vk::PipelineShaderStageCreateInfo, 2> shaderStages;
 
-        shaderStages[0] = loadShader(getAssetPath() + "shaders/gears.vert.spv", vk::ShaderStageFlagBits::eVertex);
+        shaderStages[0] = loadGlslShader(getAssetPath() + "shaders/gearsbatch.vert", vk::ShaderStageFlagBits::eVertex);
         shaderStages[1] = loadShader(getAssetPath() + "shaders/gears.frag.spv", vk::ShaderStageFlagBits::eFragment);
 
         vk::GraphicsPipelineCreateInfo pipelineCreateInfo =
@@ -249,16 +300,25 @@ public:
         pipelines.solid = device.createGraphicsPipelines(pipelineCache, pipelineCreateInfo, nullptr)[0];
     }
 
+    void prepareTimestampQueries() {
+        vk::QueryPoolCreateInfo queryPoolInfo;
+        queryPoolInfo.queryType = vk::QueryType::eTimestamp;
+        queryPoolInfo.queryCount = (uint32_t)drawCmdBuffers.size() * 2;
+        timestampQueryPool = device.createQueryPool(queryPoolInfo);
+    }
+
     void updateUniformBuffers() {
-        glm::mat4 perspective = glm::perspective(glm::radians(60.0f), (float)width / (float)height, 0.001f, 256.0f);
-        for (auto& gear : gears) {
-            gear->updateUniformBuffer(perspective, rotation, zoom, timer * 360.0f);
-        }
+        auto tStart = std::chrono::high_resolution_clock::now();
+        glm::mat4 perspective = glm::perspective(glm::radians(60.0f), (float)width / (float)height, 0.1f, 4096.0f);
+        gears.updateUniformBuffer(perspective, rotation, zoom, timer * 360.0f);
+        auto tEnd = std::chrono::high_resolution_clock::now();
+        cpuTime = std::chrono::duration<float, std::milli>(tEnd - tStart).count();
     }
 
     void prepare() {
         ExampleBase::prepare();
         prepareVertices();
+        prepareTimestampQueries();
         setupDescriptorSetLayout();
         preparePipelines();
         setupDescriptorPool();
@@ -274,6 +334,9 @@ public:
         vkDeviceWaitIdle(device);
         draw();
         vkDeviceWaitIdle(device);
+        uint64_t timestamps[2];
+        device.getQueryPoolResults(timestampQueryPool, currentBuffer * 2, 2, sizeof(timestamps), timestamps, sizeof(uint64_t), vk::QueryResultFlagBits::e64 | vk::QueryResultFlagBits::eWait);
+        gpuTime = (float)(timestamps[1] - timestamps[0]) * deviceProperties.limits.timestampPeriod / 1000000.0f;
         if (!paused) {
             updateUniformBuffers();
         }
@@ -282,6 +345,39 @@ public:
     virtual void viewChanged() {
         updateUniformBuffers();
     }
+
+    void cycleGearCount() {
+        gearGroups = (gearGroups + 1) % GEAR_GROUPS.size();
+        device.waitIdle();
+        generateGears();
+        gears.setupDescriptorSet(descriptorPool, descriptorSetLayout);
+        // Keep the whole grid in view
+        zoom = -16.0f * (float)ceil(sqrt((float)GEAR_GROUPS[gearGroups]));
+        updateUniformBuffers();
+        reBuildCommandBuffers();
+        updateTextOverlay();
+    }
+
+    void keyPressed(uint32_t key) override {
+        switch (key) {
+        case GLFW_KEY_G:
+            cycleGearCount();
+            break;
+        }
+    }
+
+    virtual void getOverlayText(vkx::TextOverlay *textOverlay) {
+        std::stringstream ss;
+        ss << std::fixed << std::setprecision(2);
+        ss << gears.gearCount() << " gears, " << gears.vertexCount() << " vertices in 1 draw (\"g\" to change)";
+        textOverlay->addText(ss.str(), 5.0f, 85.0f, vkx::TextOverlay::alignLeft);
+        ss.str("");
+        ss << "CPU update: " << cpuTime << " ms, GPU: " << gpuTime << " ms";
+        textOverlay->addText(ss.str(), 5.0f, 105.0f, vkx::TextOverlay::alignLeft);
+        ss.str("");
+        ss << "Generated in " << generateTime << " ms on " << threadPool.threads.size() << " threads";
+        textOverlay->addText(ss.str(), 5.0f, 125.0f, vkx::TextOverlay::alignLeft);
+    }
 };
 
 RUN_EXAMPLE(VulkanExample)
@@ -322,16 +322,12 @@ public:
         uboVS.model = glm::rotate(uboVS.model, glm::radians(rotation.y), glm::vec3(0.0f, 1.0f, 0.0f));
         uboVS.model = glm::rotate(uboVS.model, glm::radians(rotation.z), glm::vec3(0.0f, 0.0f, 1.0f));
 
-        void *pData = device.mapMemory(uniformData.VS.memory, 0, sizeof(uboVS), vk::MemoryMapFlags());
-        memcpy(pData, &uboVS, sizeof(uboVS));
-        device.unmapMemory(uniformData.VS.memory);
+        uniformData.VS.copy(uboVS);
 
         // Geometry shader
         uboGS.model = uboVS.model;
         uboGS.projection = uboVS.projection;
-        pData = device.mapMemory(uniformData.GS.memory, 0, sizeof(uboGS), vk::MemoryMapFlags());
-        memcpy(pData, &uboGS, sizeof(uboGS));
-        device.unmapMemory(uniformData.GS.memory);
+        uniformData.GS.copy(uboGS);
     }
 
     void prepare() {
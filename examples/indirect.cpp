@@ -401,9 +401,9 @@ public:
         if (!prepared) {
             return;
         }
+        // draw() returns once the frame's fence signaled, the uniform buffer isn't in use anymore
         draw();
         if (!paused) {
-            device.waitIdle();
             accumulator += frameTimer;
             if (accumulator < duration) {
                 zoom = easings::inOutQuint(accumulator, duration, zoomStart, zoomDelta);
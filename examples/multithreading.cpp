@@ -21,6 +21,9 @@ std::vector<vkx::VertexLayout> vertexLayout =
     vkx::VertexLayout::VERTEX_LAYOUT_COLOR,
 };
 
+// Object counts to compare the CPU cost of command buffer recording
+static const std::array<uint32_t, 3> OBJECT_COUNTS = { 256, 4096, 65536 };
+
 class VulkanExample : public vkx::ExampleBase {
 public:
     struct {
@@ -34,7 +37,8 @@ public:
         vkx::MeshBuffer skysphere;
     } meshes;
 
-    // Shared matrices used for thread push constant blocks
+    // Shared matrices, read from a uniform buffer so the recorded
+    // object draws don't depend on the camera
     struct {
         glm::mat4 projection;
         glm::mat4 view;
@@ -46,27 +50,36 @@ public:
     } pipelines;
 
     vk::PipelineLayout pipelineLayout;
+    vk::DescriptorSetLayout descriptorSetLayout;
+    vk::DescriptorSet descriptorSet;
 
     vk::CommandBuffer primaryCommandBuffer;
     vk::CommandBuffer secondaryCommandBuffer;
+    // Star sphere command buffer has to be recorded again
+    bool starsphereDirty = true;
 
     // Number of animated objects to be renderer
     // by using threads and secondary command buffers
+    uint32_t objectCountIndex = 0;
     uint32_t numObjectsPerThread;
 
     // Multi threaded stuff
     // Max. number of concurrent threads
     uint32_t numThreads;
 
-    // Use push constants to update shader
-    // parameters on a per-thread base
-    struct ThreadPushConstantBlock {
-        glm::mat4 mvp;
-        glm::vec3 color;
+    // Per object data read by the vertex shader, indexed by the
+    // first instance of the object's draw
+    struct InstanceData {
+        glm::mat4 model;
+        glm::vec4 color;
     };
 
+    struct {
+        vkx::UniformData matrices;
+        vkx::CreateBufferResult instances;
+    } buffers;
+
     struct ObjectData {
-        glm::mat4 model;
         glm::vec3 pos;
         glm::vec3 rotation;
         float rotationDir;
@@ -74,18 +87,22 @@ public:
         float scale;
         float deltaT;
         float stateT = 0;
-        bool visible = true;
+        bool visible = false;
     };
 
     struct ThreadData {
-        vkx::MeshBuffer mesh;
         vk::CommandPool commandPool;
-        // One command buffer per render object
-        std::vector<vk::CommandBuffer> commandBuffer;
-        // One push constant block per render object
-        std::vector<ThreadPushConstantBlock> pushConstBlock;
+        // Draws all visible objects of the thread, reused
+        // until the set of visible objects changes
+        vk::CommandBuffer commandBuffer;
+        bool dirty = true;
+        uint32_t visibleCount = 0;
+        // Index of the first object of this thread in the instance buffer
+        uint32_t firstObject = 0;
         // Per object information (position, rotation, etc.)
         std::vector<ObjectData> objectData;
+        // CPU time spent recording in the last frame in ms
+        float recordTime = 0.0f;
     };
     std::vector<ThreadData> threadData;
 
@@ -102,6 +119,20 @@ public:
     // View frustum for culling invisible objects
     vkx::Frustum frustum;
 
+    // Reuse recorded secondary command buffers, re-record every frame if disabled
+    bool cacheCommandBuffers = true;
+
+    // CPU timings of updateCommandBuffers, averaged over the last second
+    struct {
+        // Object update, culling and recording
+        float total = 0.0f;
+        // Recording of secondary command buffers only
+        float record = 0.0f;
+        uint32_t recordedBuffers = 0;
+        uint32_t frames = 0;
+    } cpuTimes, cpuTimesSum;
+    float statsTimer = 0.0f;
+
     VulkanExample() : vkx::ExampleBase(ENABLE_VALIDATION) {
         zoom = -32.5f;
         zoomSpeed = 2.5f;
@@ -120,8 +151,6 @@ public:
         srand(time(NULL));
 
         threadPool.setThreadCount(numThreads);
-
-        numObjectsPerThread = 256 / numThreads;
     }
 
     ~VulkanExample() {
@@ -131,6 +160,7 @@ public:
         device.destroyPipeline(pipelines.starsphere);
 
         device.destroyPipelineLayout(pipelineLayout);
+        device.destroyDescriptorSetLayout(descriptorSetLayout);
 
         device.freeCommandBuffers(cmdPool, primaryCommandBuffer);
         device.freeCommandBuffers(cmdPool, secondaryCommandBuffer);
@@ -138,8 +168,11 @@ public:
         meshes.ufo.destroy();
         meshes.skysphere.destroy();
 
+        buffers.matrices.destroy();
+        buffers.instances.destroy();
+
         for (auto& thread : threadData) {
-            device.freeCommandBuffers(thread.commandPool, thread.commandBuffer.size(), thread.commandBuffer.data());
+            device.freeCommandBuffers(thread.commandPool, thread.commandBuffer);
             device.destroyCommandPool(thread.commandPool);
         }
 
@@ -150,7 +183,7 @@ public:
         return range * (rand() / double(RAND_MAX));
     }
 
-    // Create all threads and initialize shader push constants
+    // Create the per thread command pools and buffers
     void prepareMultiThreadedRenderer() {
         // Since this demo updates the command buffers on each frame
         // we don't use the per-framebuffer command buffers from the
@@ -165,13 +198,6 @@ public:
 
         threadData.resize(numThreads);
 
-        withPrimaryCommandBuffer([&](const vk::CommandBuffer& setupCmdBuffer) {
-        });
-
-        float maxX = std::floor(std::sqrt(numThreads * numObjectsPerThread));
-        uint32_t posX = 0;
-        uint32_t posZ = 0;
-
         for (uint32_t i = 0; i < numThreads; i++) {
             ThreadData *thread = &threadData[i];
 
@@ -181,23 +207,40 @@ public:
             cmdPoolInfo.flags = vk::CommandPoolCreateFlagBits::eResetCommandBuffer;
             thread->commandPool = device.createCommandPool(cmdPoolInfo);
 
-            // One secondary command buffer per object that is updated by this thread
-            thread->commandBuffer.resize(numObjectsPerThread);
-            // Generate secondary command buffers for each thread
+            // One secondary command buffer for all objects updated by this thread
             vk::CommandBufferAllocateInfo secondaryCmdBufAllocateInfo =
                 vkx::commandBufferAllocateInfo(
                     thread->commandPool,
                     vk::CommandBufferLevel::eSecondary,
-                    thread->commandBuffer.size());
-            thread->commandBuffer = device.allocateCommandBuffers(secondaryCmdBufAllocateInfo);
-            thread->mesh = meshes.ufo;
-            thread->pushConstBlock.resize(numObjectsPerThread);
+                    1);
+            thread->commandBuffer = device.allocateCommandBuffers(secondaryCmdBufAllocateInfo)[0];
+        }
+
+        prepareObjects();
+    }
+
+    // Distribute the objects over the threads and fill the instance buffer
+    void prepareObjects() {
+        uint32_t objectCount = OBJECT_COUNTS[objectCountIndex];
+        numObjectsPerThread = objectCount / numThreads;
+        objectCount = numObjectsPerThread * numThreads;
+
+        buffers.instances.destroy();
+        buffers.instances = createBuffer(vk::BufferUsageFlagBits::eStorageBuffer, vk::MemoryPropertyFlagBits::eHostVisible | vk::MemoryPropertyFlagBits::eHostCoherent, objectCount * sizeof(InstanceData));
+        InstanceData* instances = buffers.instances.map<InstanceData>();
+
+        float maxX = std::floor(std::sqrt(objectCount));
+        uint32_t posX = 0;
+        uint32_t posZ = 0;
+
+        for (uint32_t i = 0; i < numThreads; i++) {
+            ThreadData *thread = &threadData[i];
+            thread->firstObject = i * numObjectsPerThread;
+            thread->objectData.clear();
             thread->objectData.resize(numObjectsPerThread);
+            thread->dirty = true;
 
-            float step = 360.0f / (float)(numThreads * numObjectsPerThread);
             for (uint32_t j = 0; j < numObjectsPerThread; j++) {
-                float radius = 8.0f + rnd(8.0f) - rnd(4.0f);
-
                 thread->objectData[j].pos.x = (posX - maxX / 2.0f) * 3.0f + rnd(1.5f) - rnd(1.5f);
                 thread->objectData[j].pos.z = (posZ - maxX / 2.0f) * 3.0f + rnd(1.5f) - rnd(1.5f);
 
@@ -213,30 +256,79 @@ public:
                 thread->objectData[j].rotationSpeed = (2.0f + rnd(4.0f)) * thread->objectData[j].rotationDir;
                 thread->objectData[j].scale = 0.75f + rnd(0.5f);
 
-                thread->pushConstBlock[j].color = glm::vec3(rnd(1.0f), rnd(1.0f), rnd(1.0f));
+                instances[thread->firstObject + j].color = glm::vec4(rnd(1.0f), rnd(1.0f), rnd(1.0f), 1.0f);
             }
         }
+
+        if (descriptorSet) {
+            vk::WriteDescriptorSet writeDescriptorSet = vkx::writeDescriptorSet(descriptorSet, vk::DescriptorType::eStorageBuffer, 1, &buffers.instances.descriptor);
+            device.updateDescriptorSets(writeDescriptorSet, nullptr);
+        }
+    }
+
+    void changeObjectCount() {
+        device.waitIdle();
+        objectCountIndex = (objectCountIndex + 1) % OBJECT_COUNTS.size();
+        prepareObjects();
+        updateTextOverlay();
     }
 
-    // Builds the secondary command buffer for each thread
-    void threadRenderCode(uint32_t threadIndex, uint32_t cmdBufferIndex, vk::CommandBufferInheritanceInfo inheritanceInfo) {
+    // Animates and culls the objects of a thread and records its secondary
+    // command buffer if the set of visible objects has changed
+    void threadRenderCode(uint32_t threadIndex, vk::CommandBufferInheritanceInfo inheritanceInfo) {
         ThreadData *thread = &threadData[threadIndex];
-        ObjectData *objectData = &thread->objectData[cmdBufferIndex];
+        InstanceData* instances = (InstanceData*)buffers.instances.mapped + thread->firstObject;
 
-        // Check visibility against view frustum
-        objectData->visible = frustum.checkSphere(objectData->pos, objectSphereDim * 0.5f);
+        uint32_t visibleCount = 0;
+        for (uint32_t i = 0; i < numObjectsPerThread; i++) {
+            ObjectData *objectData = &thread->objectData[i];
 
-        if (!objectData->visible) {
+            // Update
+            objectData->rotation.y += 2.5f * objectData->rotationSpeed * frameTimer;
+            if (objectData->rotation.y > 360.0f) {
+                objectData->rotation.y -= 360.0f;
+            }
+            objectData->deltaT += 0.15f * frameTimer;
+            if (objectData->deltaT > 1.0f)
+                objectData->deltaT -= 1.0f;
+            objectData->pos.y = sin(glm::radians(objectData->deltaT * 360.0f)) * 2.5f;
+
+            // Check visibility against view frustum
+            bool visible = frustum.checkSphere(objectData->pos, objectSphereDim * 0.5f);
+            if (visible != objectData->visible) {
+                objectData->visible = visible;
+                thread->dirty = true;
+            }
+            if (!visible) {
+                continue;
+            }
+            ++visibleCount;
+
+            // Only the instance data changes, the recorded draw stays valid
+            glm::mat4 model = glm::translate(glm::mat4(), objectData->pos);
+            model = glm::rotate(model, -sinf(glm::radians(objectData->deltaT * 360.0f)) * 0.25f, glm::vec3(objectData->rotationDir, 0.0f, 0.0f));
+            model = glm::rotate(model, glm::radians(objectData->rotation.y), glm::vec3(0.0f, objectData->rotationDir, 0.0f));
+            model = glm::rotate(model, glm::radians(objectData->deltaT * 360.0f), glm::vec3(0.0f, objectData->rotationDir, 0.0f));
+            instances[i].model = glm::scale(model, glm::vec3(objectData->scale));
+        }
+        thread->visibleCount = visibleCount;
+
+        thread->recordTime = 0.0f;
+        if (!thread->dirty && cacheCommandBuffers) {
             return;
         }
+        thread->dirty = false;
+
+        auto tStart = std::chrono::high_resolution_clock::now();
 
         vk::CommandBufferBeginInfo commandBufferBeginInfo;
         commandBufferBeginInfo.flags = vk::CommandBufferUsageFlagBits::eRenderPassContinue;
         commandBufferBeginInfo.pInheritanceInfo = &inheritanceInfo;
 
-        vk::CommandBuffer cmdBuffer = thread->commandBuffer[cmdBufferIndex];
+        vk::CommandBuffer cmdBuffer = thread->commandBuffer;
         cmdBuffer.begin(commandBufferBeginInfo);
 
+        // State is bound once for all objects of the thread
         vk::Viewport viewport = vkx::viewport((float)width, (float)height, 0.0f, 1.0f);
         cmdBuffer.setViewport(0, viewport);
 
@@ -244,35 +336,23 @@ public:
         cmdBuffer.setScissor(0, scissor);
 
         cmdBuffer.bindPipeline(vk::PipelineBindPoint::eGraphics, pipelines.phong);
-
-        // Update
-        objectData->rotation.y += 2.5f * objectData->rotationSpeed * frameTimer;
-        if (objectData->rotation.y > 360.0f) {
-            objectData->rotation.y -= 360.0f;
-        }
-        objectData->deltaT += 0.15f * frameTimer;
-        if (objectData->deltaT > 1.0f)
-            objectData->deltaT -= 1.0f;
-        objectData->pos.y = sin(glm::radians(objectData->deltaT * 360.0f)) * 2.5f;
-
-        objectData->model = glm::translate(glm::mat4(), objectData->pos);
-        objectData->model = glm::rotate(objectData->model, -sinf(glm::radians(objectData->deltaT * 360.0f)) * 0.25f, glm::vec3(objectData->rotationDir, 0.0f, 0.0f));
-        objectData->model = glm::rotate(objectData->model, glm::radians(objectData->rotation.y), glm::vec3(0.0f, objectData->rotationDir, 0.0f));
-        objectData->model = glm::rotate(objectData->model, glm::radians(objectData->deltaT * 360.0f), glm::vec3(0.0f, objectData->rotationDir, 0.0f));
-        objectData->model = glm::scale(objectData->model, glm::vec3(objectData->scale));
-
-        thread->pushConstBlock[cmdBufferIndex].mvp = matrices.projection * matrices.view * objectData->model;
-
-        // Update shader push constant block
-        // Contains model view matrix
-        cmdBuffer.pushConstants(pipelineLayout, vk::ShaderStageFlagBits::eVertex, 0, sizeof(ThreadPushConstantBlock), &thread->pushConstBlock[cmdBufferIndex]);
+        cmdBuffer.bindDescriptorSets(vk::PipelineBindPoint::eGraphics, pipelineLayout, 0, descriptorSet, nullptr);
 
         vk::DeviceSize offsets = 0;
-        cmdBuffer.bindVertexBuffers(0, thread->mesh.vertices.buffer, offsets);
-        cmdBuffer.bindIndexBuffer(thread->mesh.indices.buffer, 0, vk::IndexType::eUint32);
-        cmdBuffer.drawIndexed(thread->mesh.indexCount, 1, 0, 0, 0);
+        cmdBuffer.bindVertexBuffers(0, meshes.ufo.vertices.buffer, offsets);
+        cmdBuffer.bindIndexBuffer(meshes.ufo.indices.buffer, 0, vk::IndexType::eUint32);
+
+        for (uint32_t i = 0; i < numObjectsPerThread; i++) {
+            if (thread->objectData[i].visible) {
+                // The first instance selects the object's instance data
+                cmdBuffer.drawIndexed(meshes.ufo.indexCount, 1, 0, 0, thread->firstObject + i);
+            }
+        }
 
         cmdBuffer.end();
+
+        auto tEnd = std::chrono::high_resolution_clock::now();
+        thread->recordTime = (float)std::chrono::duration<double, std::milli>(tEnd - tStart).count();
     }
 
     void updateSecondaryCommandBuffer(vk::CommandBufferInheritanceInfo inheritanceInfo) {
@@ -313,6 +393,8 @@ public:
     // and puts them into the primary command buffer that's 
     // lat submitted to the queue for rendering
     void updateCommandBuffers(vk::Framebuffer frameBuffer) {
+        auto tStart = std::chrono::high_resolution_clock::now();
+
         vk::CommandBufferBeginInfo cmdBufInfo;
 
         vk::ClearValue clearValues[2];
@@ -335,33 +417,36 @@ public:
         primaryCommandBuffer.beginRenderPass(renderPassBeginInfo, vk::SubpassContents::eSecondaryCommandBuffers);
 
         // Inheritance info for the secondary command buffers
+        // The framebuffer is left out, so the recorded command buffers
+        // can be executed with all swap chain images
         vk::CommandBufferInheritanceInfo inheritanceInfo;
         inheritanceInfo.renderPass = renderPass;
-        // Secondary command buffer also use the currently active framebuffer
-        inheritanceInfo.framebuffer = frameBuffer;
 
         // Contains the list of secondary command buffers to be executed
         std::vector<vk::CommandBuffer> commandBuffers;
 
         // Secondary command buffer with star background sphere
-        updateSecondaryCommandBuffer(inheritanceInfo);
+        if (starsphereDirty || !cacheCommandBuffers) {
+            updateSecondaryCommandBuffer(inheritanceInfo);
+            starsphereDirty = false;
+        }
         commandBuffers.push_back(secondaryCommandBuffer);
 
-        // Add a job to the thread's queue for each object to be rendered
+        // Add a job to the thread's queue for its objects
         for (uint32_t t = 0; t < numThreads; t++) {
-            for (uint32_t i = 0; i < numObjectsPerThread; i++) {
-                threadPool.threads[t]->addJob([=] { threadRenderCode(t, i, inheritanceInfo); });
-            }
+            threadPool.threads[t]->addJob([=] { threadRenderCode(t, inheritanceInfo); });
         }
 
         threadPool.wait();
 
-        // Only submit if object is within the current view frustum
+        // Only submit threads with objects within the current view frustum
         for (uint32_t t = 0; t < numThreads; t++) {
-            for (uint32_t i = 0; i < numObjectsPerThread; i++) {
-                if (threadData[t].objectData[i].visible) {
-                    commandBuffers.push_back(threadData[t].commandBuffer[i]);
-                }
+            if (threadData[t].visibleCount > 0) {
+                commandBuffers.push_back(threadData[t].commandBuffer);
+            }
+            if (threadData[t].recordTime > 0.0f) {
+                cpuTimesSum.record += threadData[t].recordTime;
+                cpuTimesSum.recordedBuffers++;
             }
         }
 
@@ -371,6 +456,10 @@ public:
         primaryCommandBuffer.endRenderPass();
 
         primaryCommandBuffer.end();
+
+        auto tEnd = std::chrono::high_resolution_clock::now();
+        cpuTimesSum.total += (float)std::chrono::duration<double, std::milli>(tEnd - tStart).count();
+        cpuTimesSum.frames++;
     }
 
     void draw() override {
@@ -424,11 +513,33 @@ public:
         vertices.inputState.pVertexAttributeDescriptions = vertices.attributeDescriptions.data();
     }
 
+    void setupDescriptorSetLayout() {
+        std::vector<vk::DescriptorSetLayoutBinding> setLayoutBindings =
+        {
+            // Binding 0 : Vertex shader uniform buffer
+            vkx::descriptorSetLayoutBinding(
+                vk::DescriptorType::eUniformBuffer,
+                vk::ShaderStageFlagBits::eVertex,
+                0),
+            // Binding 1 : Instance data
+            vkx::descriptorSetLayoutBinding(
+                vk::DescriptorType::eStorageBuffer,
+                vk::ShaderStageFlagBits::eVertex,
+                1),
+        };
+
+        vk::DescriptorSetLayoutCreateInfo descriptorLayout =
+            vkx::descriptorSetLayoutCreateInfo(setLayoutBindings.data(), setLayoutBindings.size());
+
+        descriptorSetLayout = device.createDescriptorSetLayout(descriptorLayout);
+    }
+
     void setupPipelineLayout() {
-        vk::PipelineLayoutCreateInfo pPipelineLayoutCreateInfo;
-        // Push constants for model matrices
+        vk::PipelineLayoutCreateInfo pPipelineLayoutCreateInfo =
+            vkx::pipelineLayoutCreateInfo(&descriptorSetLayout, 1);
+        // Push constants for the star sphere matrix
         vk::PushConstantRange pushConstantRange =
-            vkx::pushConstantRange(vk::ShaderStageFlagBits::eVertex, sizeof(ThreadPushConstantBlock), 0);
+            vkx::pushConstantRange(vk::ShaderStageFlagBits::eVertex, sizeof(glm::mat4), 0);
 
         // Push constant ranges are part of the pipeline layout
         pPipelineLayoutCreateInfo.pushConstantRangeCount = 1;
@@ -437,6 +548,44 @@ public:
         pipelineLayout = device.createPipelineLayout(pPipelineLayoutCreateInfo);
     }
 
+    void setupDescriptorPool() {
+        std::vector<vk::DescriptorPoolSize> poolSizes =
+        {
+            vkx::descriptorPoolSize(vk::DescriptorType::eUniformBuffer, 1),
+            vkx::descriptorPoolSize(vk::DescriptorType::eStorageBuffer, 1),
+        };
+
+        vk::DescriptorPoolCreateInfo descriptorPoolInfo =
+            vkx::descriptorPoolCreateInfo(poolSizes.size(), poolSizes.data(), 1);
+
+        descriptorPool = device.createDescriptorPool(descriptorPoolInfo);
+    }
+
+    void setupDescriptorSet() {
+        vk::DescriptorSetAllocateInfo allocInfo =
+            vkx::descriptorSetAllocateInfo(descriptorPool, &descriptorSetLayout, 1);
+
+        descriptorSet = device.allocateDescriptorSets(allocInfo)[0];
+
+        std::vector<vk::WriteDescriptorSet> writeDescriptorSets =
+        {
+            // Binding 0 : Vertex shader uniform buffer
+            vkx::writeDescriptorSet(
+                descriptorSet,
+                vk::DescriptorType::eUniformBuffer,
+                0,
+                &buffers.matrices.descriptor),
+            // Binding 1 : Instance data
+            vkx::writeDescriptorSet(
+                descriptorSet,
+                vk::DescriptorType::eStorageBuffer,
+                1,
+                &buffers.instances.descriptor),
+        };
+
+        device.updateDescriptorSets(writeDescriptorSets, nullptr);
+    }
+
     void preparePipelines() {
         vk::PipelineInputAssemblyStateCreateInfo inputAssemblyState =
             vkx::pipelineInputAssemblyStateCreateInfo(vk::PrimitiveTopology::eTriangleList, vk::PipelineInputAssemblyStateCreateFlags(), VK_FALSE);
@@ -470,7 +619,7 @@ public:
         // Load shaders
         std::array<vk::PipelineShaderStageCreateInfo, 2> shaderStages;
 
-        shaderStages[0] = loadShader(getAssetPath() + "shaders/multithreading/phong.vert.spv", vk::ShaderStageFlagBits::eVertex);
+        shaderStages[0] = loadGlslShader(getAssetPath() + "shaders/multithreading/phong.vert", vk::ShaderStageFlagBits::eVertex);
         shaderStages[1] = loadShader(getAssetPath() + "shaders/multithreading/phong.frag.spv", vk::ShaderStageFlagBits::eFragment);
 
         vk::GraphicsPipelineCreateInfo pipelineCreateInfo =
@@ -505,6 +654,9 @@ public:
         matrices.view = glm::rotate(matrices.view, glm::radians(rotation.z), glm::vec3(0.0f, 0.0f, 1.0f));
 
         frustum.update(matrices.projection * matrices.view);
+
+        buffers.matrices.copy(matrices);
+        starsphereDirty = true;
     }
 
     void prepare() {
@@ -513,9 +665,14 @@ public:
         renderFence = device.createFence(vk::FenceCreateInfo());
         loadMeshes();
         setupVertexDescriptions();
+        buffers.matrices = createUniformBuffer(matrices);
+        buffers.matrices.map();
+        setupDescriptorSetLayout();
         setupPipelineLayout();
         preparePipelines();
         prepareMultiThreadedRenderer();
+        setupDescriptorPool();
+        setupDescriptorSet();
         updateMatrices();
         prepared = true;
     }
@@ -524,14 +681,65 @@ public:
         if (!prepared)
             return;
         draw();
+
+        statsTimer += frameTimer;
+        if (statsTimer > 1.0f && cpuTimesSum.frames > 0) {
+            float frames = (float)cpuTimesSum.frames;
+            cpuTimes.total = cpuTimesSum.total / frames;
+            cpuTimes.record = cpuTimesSum.record / frames;
+            cpuTimes.recordedBuffers = cpuTimesSum.recordedBuffers;
+            cpuTimes.frames = cpuTimesSum.frames;
+            cpuTimesSum = {};
+            statsTimer = 0.0f;
+            // The text overlay shows the same, see getOverlayText()
+            if (verbose) {
+                std::cout << std::fixed << std::setprecision(3) << numObjectsPerThread * numThreads << " objects, "
+                    << (cacheCommandBuffers ? "cached" : "re-recorded") << ": update " << cpuTimes.total << " ms, recording "
+                    << cpuTimes.record << " ms per frame, " << cpuTimes.recordedBuffers << " secondary command buffers recorded in "
+                    << cpuTimes.frames << " frames" << std::endl;
+            }
+        }
     }
 
     virtual void viewChanged() {
         updateMatrices();
     }
 
+    void windowResized() override {
+        // Viewport and scissor are recorded into the secondary command buffers
+        for (auto& thread : threadData) {
+            thread.dirty = true;
+        }
+        starsphereDirty = true;
+    }
+
+    void toggleCaching() {
+        cacheCommandBuffers = !cacheCommandBuffers;
+        updateTextOverlay();
+    }
+
+    void keyPressed(uint32_t key) override {
+        switch (key) {
+        case GLFW_KEY_C:
+        case GAMEPAD_BUTTON_A:
+            toggleCaching();
+            break;
+        case GLFW_KEY_O:
+        case GAMEPAD_BUTTON_X:
+            changeObjectCount();
+            break;
+        }
+    }
+
     virtual void getOverlayText(vkx::TextOverlay *textOverlay) {
-        textOverlay->addText("Using " + std::to_string(numThreads) + " threads", 5.0f, 85.0f, vkx::TextOverlay::alignLeft);
+        std::stringstream ss;
+        ss << std::fixed << std::setprecision(3);
+        ss << numObjectsPerThread * numThreads << " objects using " << numThreads << " threads, " << (cacheCommandBuffers ? "cached" : "re-recorded") << " command buffers";
+        textOverlay->addText(ss.str(), 5.0f, 85.0f, vkx::TextOverlay::alignLeft);
+        ss.str("");
+        ss << "CPU: " << cpuTimes.total << " ms, recording " << cpuTimes.record << " ms (" << cpuTimes.recordedBuffers << " buffers / " << cpuTimes.frames << " frames)";
+        textOverlay->addText(ss.str(), 5.0f, 105.0f, vkx::TextOverlay::alignLeft);
+        textOverlay->addText("Press \"C\" to toggle caching, \"O\" to change the object count", 5.0f, 125.0f, vkx::TextOverlay::alignLeft);
     }
 };
 
@@ -7,16 +7,13 @@
 */
 
 #include "vulkanExampleBase.h"
+#include "vulkanRenderGraph.h"
 
 
-// Texture properties
-#define TEX_DIM 512
-#define TEX_FORMAT  vk::Format::eR8G8B8A8Unorm
-#define TEX_FILTER vk::Filter::eLinear
-
 // Offscreen frame buffer properties
-#define FB_DIM TEX_DIM
+#define FB_DIM 512
 #define FB_COLOR_FORMAT  vk::Format::eR8G8B8A8Unorm
+#define FB_FILTER vk::Filter::eLinear
 
 // Vertex layout for this example
 std::vector<vkx::VertexLayout> vertexLayout =
@@ -67,6 +64,7 @@ public:
     struct {
         vk::Pipeline debug;
         vk::Pipeline shaded;
+        vk::Pipeline shadedOffscreen;
         vk::Pipeline mirror;
     } pipelines;
 
@@ -84,19 +82,14 @@ public:
 
     vk::DescriptorSetLayout descriptorSetLayout;
 
-    // vk::Framebuffer for offscreen rendering
-    struct FrameBufferAttachment {
-        vk::Image image;
-        vk::DeviceMemory mem;
-        vk::ImageView view;
-    };
-    struct FrameBuffer {
-        int32_t width, height;
-        vk::Framebuffer frameBuffer;
-        FrameBufferAttachment color, depth;
-        // Texture target for framebugger blut
-        vkx::Texture textureTarget;
-    } offScreenFrameBuf;
+    // The mirrored scene is rendered by a render graph pass and its color
+    // attachment is sampled directly by the mirror plane
+    vkx::RenderGraph renderGraph{ *this };
+    struct {
+        vkx::RenderGraph::Resource color;
+        vkx::RenderGraph::Resource depth;
+    } offscreen;
+    vkx::RenderGraph::Pass* mirrorPass{ nullptr };
 
     vk::CommandBuffer offScreenCmdBuffer;
 
@@ -106,6 +99,7 @@ public:
         zoom = -6.5f;
         rotation = { -11.25f, 45.0f, 0.0f };
         timerSpeed *= 0.25f;
+        enableTextOverlay = true;
         title = "Vulkan Example - Offscreen rendering";
     }
 
@@ -114,25 +108,14 @@ public:
         // Note : Inherited destructor cleans up resources stored in base class
 
         // Textures
-        offScreenFrameBuf.textureTarget.destroy();
         textures.colorMap.destroy();
 
-        // Frame buffer
-
-        // Color attachment
-        device.destroyImageView(offScreenFrameBuf.color.view);
-        device.destroyImage(offScreenFrameBuf.color.image);
-        device.freeMemory(offScreenFrameBuf.color.mem);
-
-        // Depth attachment
-        device.destroyImageView(offScreenFrameBuf.depth.view);
-        device.destroyImage(offScreenFrameBuf.depth.image);
-        device.freeMemory(offScreenFrameBuf.depth.mem);
-
-        device.destroyFramebuffer(offScreenFrameBuf.frameBuffer);
+        // Offscreen images, render pass and framebuffer
+        renderGraph.destroy();
 
         device.destroyPipeline(pipelines.debug);
         device.destroyPipeline(pipelines.shaded);
+        device.destroyPipeline(pipelines.shadedOffscreen);
         device.destroyPipeline(pipelines.mirror);
 
         device.destroyPipelineLayout(pipelineLayouts.quad);
@@ -154,173 +137,28 @@ public:
         device.freeCommandBuffers(cmdPool, offScreenCmdBuffer);
     }
 
-    // Preapre an empty texture as the blit target from 
-    // the offscreen framebuffer
-    void prepareTextureTarget(const vk::CommandBuffer& setupCmdBuffer, uint32_t width, uint32_t height,  vk::Format format) {
-        // Get device properites for the requested texture format
-         vk::FormatProperties formatProperties = physicalDevice.getFormatProperties(format);
-        // Check if blit destination is supported for the requested format
-        // Only try for optimal tiling, linear tiling usually won't support blit as destination anyway
-        assert(formatProperties.optimalTilingFeatures &  vk::FormatFeatureFlagBits::eBlitDst);
-
-        // Prepare blit target texture
-        offScreenFrameBuf.textureTarget.extent.width = width;
-        offScreenFrameBuf.textureTarget.extent.height = height;
-
-        vk::ImageCreateInfo imageCreateInfo;
-        imageCreateInfo.imageType = vk::ImageType::e2D;
-        imageCreateInfo.format = format;
-        imageCreateInfo.extent = vk::Extent3D{ width, height, 1 };
-        imageCreateInfo.mipLevels = 1;
-        imageCreateInfo.arrayLayers = 1;
-        imageCreateInfo.samples = vk::SampleCountFlagBits::e1;
-        imageCreateInfo.tiling = vk::ImageTiling::eOptimal;
-        // Texture will be sampled in a shader and is also the blit destination
-        imageCreateInfo.usage = vk::ImageUsageFlagBits::eSampled | vk::ImageUsageFlagBits::eTransferDst;
-
-        offScreenFrameBuf.textureTarget = createImage(imageCreateInfo, vk::MemoryPropertyFlagBits::eDeviceLocal);
-
-        // vk::Image memory barrier
-        // Set initial layout for the offscreen texture transfer destination
-        // Will be transformed while updating the texture
-        vkx::setImageLayout(
-            setupCmdBuffer,
-            offScreenFrameBuf.textureTarget.image,
-            vk::ImageAspectFlagBits::eColor,
-            vk::ImageLayout::eUndefined,
-            offScreenFrameBuf.textureTarget.imageLayout);
-
-        // Create sampler
-        vk::SamplerCreateInfo sampler;
-        sampler.magFilter = TEX_FILTER;
-        sampler.minFilter = TEX_FILTER;
-        sampler.mipmapMode = vk::SamplerMipmapMode::eLinear;
-        sampler.addressModeU = vk::SamplerAddressMode::eClampToEdge;
-        sampler.addressModeV = sampler.addressModeU;
-        sampler.addressModeW = sampler.addressModeU;
-        sampler.mipLodBias = 0.0f;
-        sampler.maxAnisotropy = 0;
-        sampler.compareOp = vk::CompareOp::eNever;
-        sampler.minLod = 0.0f;
-        sampler.maxLod = 0.0f;
-        sampler.borderColor = vk::BorderColor::eFloatOpaqueWhite;
-        offScreenFrameBuf.textureTarget.sampler = device.createSampler(sampler);
-
-
-        // Create image view
-        vk::ImageViewCreateInfo view;
-        view.viewType = vk::ImageViewType::e2D;
-        view.format = format;
-        view.components = { vk::ComponentSwizzle::eR, vk::ComponentSwizzle::eG, vk::ComponentSwizzle::eB, vk::ComponentSwizzle::eA };
-        view.subresourceRange = { vk::ImageAspectFlagBits::eColor, 0, 1, 0, 1 };
-        view.image = offScreenFrameBuf.textureTarget.image;
-        offScreenFrameBuf.textureTarget.view = device.createImageView(view);
-    }
-
-    // Prepare a new framebuffer for offscreen rendering
-    // The contents of this framebuffer are then
-    // blitted to our render target
-    void prepareOffscreenFramebuffer(const vk::CommandBuffer& setupCmdBuffer) {
-        offScreenFrameBuf.width = FB_DIM;
-        offScreenFrameBuf.height = FB_DIM;
-
-         vk::Format fbColorFormat = FB_COLOR_FORMAT;
-
-        // Find a suitable depth format
-         vk::Format fbDepthFormat = vkx::getSupportedDepthFormat(physicalDevice);
-
-        // Color attachment
-        vk::ImageCreateInfo image;
-        image.imageType = vk::ImageType::e2D;
-        image.format = fbColorFormat;
-        image.extent.width = offScreenFrameBuf.width;
-        image.extent.height = offScreenFrameBuf.height;
-        image.extent.depth = 1;
-        image.mipLevels = 1;
-        image.arrayLayers = 1;
-        image.samples = vk::SampleCountFlagBits::e1;
-        image.tiling = vk::ImageTiling::eOptimal;
-        // vk::Image of the framebuffer is blit source
-        image.usage = vk::ImageUsageFlagBits::eColorAttachment | vk::ImageUsageFlagBits::eTransferSrc;
-
-        vk::MemoryAllocateInfo memAlloc;
-        vk::MemoryRequirements memReqs;
-
-        vk::ImageViewCreateInfo colorImageView;
-        colorImageView.viewType = vk::ImageViewType::e2D;
-        colorImageView.format = fbColorFormat;
-        colorImageView.subresourceRange.aspectMask = vk::ImageAspectFlagBits::eColor;
-        colorImageView.subresourceRange.levelCount = 1;
-        colorImageView.subresourceRange.layerCount = 1;
-
-        offScreenFrameBuf.color.image = device.createImage(image);
-
-        memReqs = device.getImageMemoryRequirements(offScreenFrameBuf.color.image);
-        memAlloc.allocationSize = memReqs.size;
-        getMemoryType(memReqs.memoryTypeBits, vk::MemoryPropertyFlagBits::eDeviceLocal, &memAlloc.memoryTypeIndex);
-        offScreenFrameBuf.color.mem = device.allocateMemory(memAlloc);
-
-
-        device.bindImageMemory(offScreenFrameBuf.color.image, offScreenFrameBuf.color.mem, 0);
-
-
-        vkx::setImageLayout(
-            setupCmdBuffer,
-            offScreenFrameBuf.color.image,
-            vk::ImageAspectFlagBits::eColor,
-            vk::ImageLayout::eUndefined,
-            vk::ImageLayout::eColorAttachmentOptimal);
-
-        colorImageView.image = offScreenFrameBuf.color.image;
-        offScreenFrameBuf.color.view = device.createImageView(colorImageView);
-
-
-        // Depth stencil attachment
-        image.format = fbDepthFormat;
-        image.usage = vk::ImageUsageFlagBits::eDepthStencilAttachment;
-
-        vk::ImageViewCreateInfo depthStencilView;
-        depthStencilView.viewType = vk::ImageViewType::e2D;
-        depthStencilView.format = fbDepthFormat;
-        depthStencilView.subresourceRange.aspectMask = vk::ImageAspectFlagBits::eDepth | vk::ImageAspectFlagBits::eStencil;
-        depthStencilView.subresourceRange.levelCount = 1;
-        depthStencilView.subresourceRange.layerCount = 1;
-
-        offScreenFrameBuf.depth.image = device.createImage(image);
-
-        memReqs = device.getImageMemoryRequirements(offScreenFrameBuf.depth.image);
-        memAlloc.allocationSize = memReqs.size;
-        getMemoryType(memReqs.memoryTypeBits, vk::MemoryPropertyFlagBits::eDeviceLocal, &memAlloc.memoryTypeIndex);
-        offScreenFrameBuf.depth.mem = device.allocateMemory(memAlloc);
-
-
-        device.bindImageMemory(offScreenFrameBuf.depth.image, offScreenFrameBuf.depth.mem, 0);
-
-
-        vkx::setImageLayout(
-            setupCmdBuffer,
-            offScreenFrameBuf.depth.image,
-            vk::ImageAspectFlagBits::eDepth | vk::ImageAspectFlagBits::eStencil,
-            vk::ImageLayout::eUndefined,
-            vk::ImageLayout::eDepthStencilAttachmentOptimal);
-
-        depthStencilView.image = offScreenFrameBuf.depth.image;
-        offScreenFrameBuf.depth.view = device.createImageView(depthStencilView);
-
-        vk::ImageView attachments[2];
-        attachments[0] = offScreenFrameBuf.color.view;
-        attachments[1] = offScreenFrameBuf.depth.view;
-
-        vk::FramebufferCreateInfo fbufCreateInfo;
-        fbufCreateInfo.renderPass = renderPass;
-        fbufCreateInfo.attachmentCount = 2;
-        fbufCreateInfo.pAttachments = attachments;
-        fbufCreateInfo.width = offScreenFrameBuf.width;
-        fbufCreateInfo.height = offScreenFrameBuf.height;
-        fbufCreateInfo.layers = 1;
-
-        offScreenFrameBuf.frameBuffer = device.createFramebuffer(fbufCreateInfo);
-
+    // The mirrored scene only needs a single pass, writing the color image
+    // that is sampled by the mirror plane and a depth buffer that is discarded
+    // at the end of the pass
+    void prepareRenderGraph() {
+        vk::Extent2D extent{ FB_DIM, FB_DIM };
+        offscreen.color = renderGraph.createImage("Mirror color", FB_COLOR_FORMAT, extent, FB_FILTER);
+        offscreen.depth = renderGraph.createImage("Mirror depth", vkx::getSupportedDepthFormat(physicalDevice), extent);
+        renderGraph.markOutput(offscreen.color);
+
+        mirrorPass = &renderGraph.addPass("Mirrored scene")
+            .writeColor(offscreen.color, glm::vec4(0.0f))
+            .writeDepth(offscreen.depth)
+            .setRecord([this](const vk::CommandBuffer& cmdBuffer) {
+                vk::DeviceSize offsets = 0;
+                cmdBuffer.bindDescriptorSets(vk::PipelineBindPoint::eGraphics, pipelineLayouts.offscreen, 0, descriptorSets.offscreen, nullptr);
+                cmdBuffer.bindPipeline(vk::PipelineBindPoint::eGraphics, pipelines.shadedOffscreen);
+                cmdBuffer.bindVertexBuffers(VERTEX_BUFFER_BIND_ID, meshes.example.vertices.buffer, offsets);
+                cmdBuffer.bindIndexBuffer(meshes.example.indices.buffer, 0, vk::IndexType::eUint32);
+                cmdBuffer.drawIndexed(meshes.example.indexCount, 1, 0, 0, 0);
+            });
+
+        renderGraph.compile();
     }
 
     void createOffscreenCommandBuffer() {
@@ -328,112 +166,13 @@ public:
         offScreenCmdBuffer = device.allocateCommandBuffers(cmd)[0];
     }
 
-    // The command buffer to copy for rendering 
-    // the offscreen scene and blitting it into
-    // the texture target is only build once
-    // and gets resubmitted 
+    // The command buffer for rendering the offscreen scene is only
+    // built once and gets resubmitted
     void buildOffscreenCommandBuffer() {
         vk::CommandBufferBeginInfo cmdBufInfo;
-
-        vk::ClearValue clearValues[2];
-        clearValues[0].color = vkx::clearColor({ 0.0f, 0.0f, 0.0f, 0.0f });
-        clearValues[1].depthStencil = { 1.0f, 0 };
-
-        vk::RenderPassBeginInfo renderPassBeginInfo;
-        renderPassBeginInfo.renderPass = renderPass;
-        renderPassBeginInfo.framebuffer = offScreenFrameBuf.frameBuffer;
-        renderPassBeginInfo.renderArea.extent.width = offScreenFrameBuf.width;
-        renderPassBeginInfo.renderArea.extent.height = offScreenFrameBuf.height;
-        renderPassBeginInfo.clearValueCount = 2;
-        renderPassBeginInfo.pClearValues = clearValues;
-
         offScreenCmdBuffer.begin(cmdBufInfo);
-
-
-        offScreenCmdBuffer.beginRenderPass(renderPassBeginInfo, vk::SubpassContents::eInline);
-
-        vk::Viewport viewport = vkx::viewport((float)offScreenFrameBuf.width, (float)offScreenFrameBuf.height, 0.0f, 1.0f);
-        offScreenCmdBuffer.setViewport(0, viewport);
-
-        vk::Rect2D scissor = vkx::rect2D(offScreenFrameBuf.width, offScreenFrameBuf.height, 0, 0);
-        offScreenCmdBuffer.setScissor(0, scissor);
-
-        vk::DeviceSize offsets = 0;
-
-        // Model
-        offScreenCmdBuffer.bindDescriptorSets(vk::PipelineBindPoint::eGraphics, pipelineLayouts.offscreen, 0, descriptorSets.offscreen, nullptr);
-        offScreenCmdBuffer.bindPipeline(vk::PipelineBindPoint::eGraphics, pipelines.shaded);
-        offScreenCmdBuffer.bindVertexBuffers(VERTEX_BUFFER_BIND_ID, meshes.example.vertices.buffer, offsets);
-        offScreenCmdBuffer.bindIndexBuffer(meshes.example.indices.buffer, 0, vk::IndexType::eUint32);
-        offScreenCmdBuffer.drawIndexed(meshes.example.indexCount, 1, 0, 0, 0);
-
-        offScreenCmdBuffer.endRenderPass();
-
-        // Make sure color writes to the framebuffer are finished before using it as transfer source
-        vkx::setImageLayout(
-            offScreenCmdBuffer,
-            offScreenFrameBuf.color.image,
-            vk::ImageAspectFlagBits::eColor,
-            vk::ImageLayout::eColorAttachmentOptimal,
-            vk::ImageLayout::eTransferSrcOptimal);
-
-        // Transform texture target to transfer source
-        vkx::setImageLayout(
-            offScreenCmdBuffer,
-            offScreenFrameBuf.textureTarget.image,
-            vk::ImageAspectFlagBits::eColor,
-            vk::ImageLayout::eShaderReadOnlyOptimal,
-            vk::ImageLayout::eTransferDstOptimal);
-
-        // Blit offscreen color buffer to our texture target
-        vk::ImageBlit imgBlit;
-
-        imgBlit.srcSubresource.aspectMask = vk::ImageAspectFlagBits::eColor;
-        imgBlit.srcSubresource.layerCount = 1;
-
-        imgBlit.srcOffsets[1].x = offScreenFrameBuf.width;
-        imgBlit.srcOffsets[1].y = offScreenFrameBuf.height;
-        imgBlit.srcOffsets[1].z = 1;
-
-        imgBlit.dstSubresource.aspectMask = vk::ImageAspectFlagBits::eColor;
-        imgBlit.dstSubresource.mipLevel = 0;
-        imgBlit.dstSubresource.baseArrayLayer = 0;
-        imgBlit.dstSubresource.layerCount = 1;
-
-        imgBlit.dstOffsets[1].x = offScreenFrameBuf.textureTarget.extent.width;
-        imgBlit.dstOffsets[1].y = offScreenFrameBuf.textureTarget.extent.height;
-        imgBlit.dstOffsets[1].z = 1;
-
-        // Blit from framebuffer image to texture image
-        // vkCmdBlitImage does scaling and (if necessary and possible) also does format conversions
-        offScreenCmdBuffer.blitImage(
-            offScreenFrameBuf.color.image,
-            vk::ImageLayout::eTransferSrcOptimal,
-            offScreenFrameBuf.textureTarget.image,
-            vk::ImageLayout::eTransferDstOptimal,
-            imgBlit,
-            vk::Filter::eLinear);
-
-        // Transform framebuffer color attachment back 
-        vkx::setImageLayout(
-            offScreenCmdBuffer,
-            offScreenFrameBuf.color.image,
-            vk::ImageAspectFlagBits::eColor,
-            vk::ImageLayout::eTransferSrcOptimal,
-            vk::ImageLayout::eColorAttachmentOptimal);
-
-        // Transform texture target back to shader read
-        // Makes sure that writes to the textuer are finished before
-        // it's accessed in the shader
-        vkx::setImageLayout(
-            offScreenCmdBuffer,
-            offScreenFrameBuf.textureTarget.image,
-            vk::ImageAspectFlagBits::eColor,
-            vk::ImageLayout::eTransferDstOptimal,
-            vk::ImageLayout::eShaderReadOnlyOptimal);
-
+        renderGraph.execute(offScreenCmdBuffer);
         offScreenCmdBuffer.end();
-
     }
 
     void buildCommandBuffers() {
@@ -638,8 +377,7 @@ public:
         descriptorSets.mirror = device.allocateDescriptorSets(allocInfo)[0];
 
         // vk::Image descriptor for the offscreen mirror texture
-        vk::DescriptorImageInfo texDescriptorMirror =
-            vkx::descriptorImageInfo(offScreenFrameBuf.textureTarget.sampler, offScreenFrameBuf.textureTarget.view, vk::ImageLayout::eGeneral);
+        vk::DescriptorImageInfo texDescriptorMirror = renderGraph.descriptor(offscreen.color);
 
         // vk::Image descriptor for the color map
         vk::DescriptorImageInfo texDescriptorColorMap =
@@ -787,6 +525,10 @@ public:
 
         pipelines.shaded = device.createGraphicsPipelines(pipelineCache, pipelineCreateInfo, nullptr)[0];
 
+        // Same shading for the mirrored scene, created against the render pass of the graph
+        pipelineCreateInfo.renderPass = mirrorPass->renderPass;
+        pipelines.shadedOffscreen = device.createGraphicsPipelines(pipelineCache, pipelineCreateInfo, nullptr)[0];
+
     }
 
     // Prepare and initialize uniform buffer containing shader uniforms
@@ -858,17 +600,12 @@ public:
         loadMeshes();
         setupVertexDescriptions();
         prepareUniformBuffers();
-        withPrimaryCommandBuffer([&](const vk::CommandBuffer& setupCmdBuffer) {
-            prepareTextureTarget(setupCmdBuffer, TEX_DIM, TEX_DIM, TEX_FORMAT);
-        });
+        prepareRenderGraph();
         setupDescriptorSetLayout();
         preparePipelines();
         setupDescriptorPool();
         setupDescriptorSet();
         createOffscreenCommandBuffer();
-        withPrimaryCommandBuffer([&](const vk::CommandBuffer& setupCmdBuffer) {
-            prepareOffscreenFramebuffer(setupCmdBuffer);
-        });
         buildCommandBuffers();
         buildOffscreenCommandBuffer();
         prepared = true;
@@ -880,6 +617,7 @@ public:
         vkDeviceWaitIdle(device);
         draw();
         vkDeviceWaitIdle(device);
+        renderGraph.updateTimings();
         if (!paused) {
             updateUniformBuffers();
             updateUniformBufferOffscreen();
@@ -890,6 +628,16 @@ public:
         updateUniformBuffers();
         updateUniformBufferOffscreen();
     }
+
+    void getOverlayText(vkx::TextOverlay *textOverlay) override {
+        std::stringstream ss;
+        ss << std::fixed << std::setprecision(3);
+        ss << "Offscreen passes: " << renderGraph.gpuTime << " ms";
+        textOverlay->addText(ss.str(), 5.0f, 85.0f, vkx::TextOverlay::alignLeft);
+        ss.str("");
+        ss << "Offscreen images: " << renderGraph.memoryStats.allocated / 1024 << " KB (" << renderGraph.memoryStats.required / 1024 << " KB without aliasing)";
+        textOverlay->addText(ss.str(), 5.0f, 105.0f, vkx::TextOverlay::alignLeft);
+    }
 };
 
 RUN_EXAMPLE(VulkanExample)
@@ -7,6 +7,7 @@
 */
 
 #include "vulkanExampleBase.h"
+#include "vulkanTextureStreamer.h"
 
 
 #define PARTICLE_COUNT 512
@@ -50,12 +51,15 @@ public:
             // inside the shader for alpha blended textures
             vk::Sampler sampler;
         } particles;
+        // Streamed, only the mip tails are loaded up front
         struct {
-            vkx::Texture colorMap;
-            vkx::Texture normalMap;
+            vkx::TextureStreamer::Handle colorMap;
+            vkx::TextureStreamer::Handle normalMap;
         } floor;
     } textures;
 
+    vkx::TextureStreamer* textureStreamer{ nullptr };
+
     struct {
         vkx::Mesh environment;
     } meshes;
@@ -108,6 +112,7 @@ public:
         title = "Vulkan Example - Particle system";
         zoomSpeed *= 1.5f;
         timerSpeed *= 8.0f;
+        enableTextOverlay = true;
         srand(time(NULL));
     }
 
@@ -117,8 +122,7 @@ public:
 
         textures.particles.smoke.destroy();
         textures.particles.fire.destroy();
-        textures.floor.colorMap.destroy();
-        textures.floor.normalMap.destroy();
+        delete textureStreamer;
 
         device.destroyPipeline(pipelines.particles);
         device.destroyPipeline(pipelines.environment);
@@ -278,10 +282,11 @@ public:
              vk::Format::eBc3UnormBlock);
 
         // Floor
-        textures.floor.colorMap = textureLoader->loadTexture(
+        textureStreamer = new vkx::TextureStreamer(*this);
+        textures.floor.colorMap = textureStreamer->load(
             getAssetPath() + "textures/fireplace_colormap_bc3.ktx",
              vk::Format::eBc3UnormBlock);
-        textures.floor.normalMap = textureLoader->loadTexture(
+        textures.floor.normalMap = textureStreamer->load(
             getAssetPath() + "textures/fireplace_normalmap_bc3.ktx",
              vk::Format::eBc3UnormBlock);
 
@@ -457,16 +462,24 @@ public:
         // Environment
         meshes.environment.descriptorSet = device.allocateDescriptorSets(allocInfo)[0];
 
+        // Binding 0 : Vertex shader uniform buffer
+        vk::WriteDescriptorSet writeDescriptorSet =
+            vkx::writeDescriptorSet(meshes.environment.descriptorSet, vk::DescriptorType::eUniformBuffer, 0, &uniformData.environment.descriptor);
+        device.updateDescriptorSets(1, &writeDescriptorSet, 0, NULL);
+
+        updateEnvironmentTextures();
+    }
+
+    // The streamed textures are reallocated when their resident levels change
+    void updateEnvironmentTextures() {
+        const vkx::Texture& colorMap = textureStreamer->texture(textures.floor.colorMap);
+        const vkx::Texture& normalMap = textureStreamer->texture(textures.floor.normalMap);
         vk::DescriptorImageInfo texDescriptorColorMap =
-            vkx::descriptorImageInfo(textures.floor.colorMap.sampler, textures.floor.colorMap.view, vk::ImageLayout::eGeneral);
+            vkx::descriptorImageInfo(colorMap.sampler, colorMap.view, vk::ImageLayout::eGeneral);
         vk::DescriptorImageInfo texDescriptorNormalMap =
-            vkx::descriptorImageInfo(textures.floor.normalMap.sampler, textures.floor.normalMap.view, vk::ImageLayout::eGeneral);
-
-        writeDescriptorSets.clear();
+            vkx::descriptorImageInfo(normalMap.sampler, normalMap.view, vk::ImageLayout::eGeneral);
 
-        // Binding 0 : Vertex shader uniform buffer
-        writeDescriptorSets.push_back(
-            vkx::writeDescriptorSet(meshes.environment.descriptorSet, vk::DescriptorType::eUniformBuffer, 0, &uniformData.environment.descriptor));
+        std::vector<vk::WriteDescriptorSet> writeDescriptorSets;
         // Binding 1 : Color map
         writeDescriptorSets.push_back(
             vkx::writeDescriptorSet(meshes.environment.descriptorSet, vk::DescriptorType::eCombinedImageSampler, 1, &texDescriptorColorMap));
@@ -611,10 +624,25 @@ public:
         prepared = true;
     }
 
+    // Requests the floor texture levels matching the on screen size of the fireplace
+    void streamTextures() {
+        const glm::vec3& dim = meshes.environment.buffers.dim;
+        float extent = std::max(dim.x, std::max(dim.y, dim.z));
+        float pixels = extent / -zoom * uboVS.projection[1][1] * (float)height * 0.5f;
+        textureStreamer->requestSize(textures.floor.colorMap, pixels);
+        textureStreamer->requestSize(textures.floor.normalMap, pixels);
+        // Called with the device idle, the descriptors and command buffers can be updated right away
+        if (textureStreamer->update()) {
+            updateEnvironmentTextures();
+            buildCommandBuffers();
+        }
+    }
+
     virtual void render() {
         if (!prepared)
             return;
         vkDeviceWaitIdle(device);
+        streamTextures();
         draw();
         vkDeviceWaitIdle(device);
         if (!paused) {
@@ -626,6 +654,20 @@ public:
     virtual void viewChanged() {
         updateUniformBuffers();
     }
+
+    virtual void getOverlayText(vkx::TextOverlay *textOverlay) {
+        std::stringstream ss;
+        ss << std::fixed << std::setprecision(1);
+        ss << "Streamed textures: " << textureStreamer->residentMemory() / (1024.0f * 1024.0f) << " MB resident, budget " << textureStreamer->budget / (1024 * 1024) << " MB";
+        textOverlay->addText(ss.str(), 5.0f, 85.0f, vkx::TextOverlay::alignLeft);
+        ss.str("");
+        ss << "Color map level " << textureStreamer->residentLevel(textures.floor.colorMap) << " / " << textureStreamer->levelCount(textures.floor.colorMap)
+            << ", " << textureStreamer->pendingLoads() << " loads pending, " << textureStreamer->uploadCount() << " uploads, " << textureStreamer->evictionCount() << " evictions";
+        textOverlay->addText(ss.str(), 5.0f, 105.0f, vkx::TextOverlay::alignLeft);
+        ss.str("");
+        ss << "Time to first frame: " << timeToFirstFrame << " ms";
+        textOverlay->addText(ss.str(), 5.0f, 125.0f, vkx::TextOverlay::alignLeft);
+    }
 };
 
 
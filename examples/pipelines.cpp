@@ -76,8 +76,7 @@ public:
 
         meshes.cube.destroy();
 
-        device.destroyBuffer(uniformDataVS.buffer);
-        device.freeMemory(uniformDataVS.memory);
+        uniformDataVS.destroy();
     }
 
     void buildCommandBuffers() {
@@ -7,16 +7,13 @@
 */
 
 #include "vulkanExampleBase.h"
+#include "vulkanRenderGraph.h"
 
 
-// Texture properties
-#define TEX_DIM 128
-#define TEX_FORMAT  vk::Format::eR8G8B8A8Unorm
-#define TEX_FILTER vk::Filter::eLinear;
-
 // Offscreen frame buffer properties
-#define FB_DIM TEX_DIM
+#define FB_DIM 128
 #define FB_COLOR_FORMAT  vk::Format::eR8G8B8A8Unorm
+#define FB_FILTER vk::Filter::eLinear
 
 // Vertex layout for this example
 std::vector<vkx::VertexLayout> vertexLayout =
@@ -60,8 +57,8 @@ public:
     } uboQuadVS;
 
     struct UboQuadFS {
-        int32_t texWidth = TEX_DIM;
-        int32_t texHeight = TEX_DIM;
+        int32_t texWidth = FB_DIM;
+        int32_t texHeight = FB_DIM;
         float radialBlurScale = 0.25f;
         float radialBlurStrength = 0.75f;
         glm::vec2 radialOrigin = glm::vec2(0.5f, 0.5f);
@@ -88,19 +85,14 @@ public:
     // all descriptor sets
     vk::DescriptorSetLayout descriptorSetLayout;
 
-    // vk::Framebuffer for offscreen rendering
-    struct FrameBufferAttachment {
-        vk::Image image;
-        vk::DeviceMemory mem;
-        vk::ImageView view;
-    };
-    struct FrameBuffer {
-        int32_t width, height;
-        vk::Framebuffer frameBuffer;
-        FrameBufferAttachment color, depth;
-        // Texture target for framebuffer blit
-        vkx::Texture textureTarget;
-    } offScreenFrameBuf;
+    // The glow parts of the scene are rendered by a render graph pass, its
+    // color attachment is sampled directly by the radial blur
+    vkx::RenderGraph renderGraph{ *this };
+    struct {
+        vkx::RenderGraph::Resource color;
+        vkx::RenderGraph::Resource depth;
+    } offscreen;
+    vkx::RenderGraph::Pass* glowPass{ nullptr };
 
     vk::CommandBuffer offScreenCmdBuffer;
 
@@ -116,22 +108,8 @@ public:
         // Clean up used Vulkan resources 
         // Note : Inherited destructor cleans up resources stored in base class
 
-        // Texture target
-        offScreenFrameBuf.textureTarget.destroy();
-
-        // Frame buffer
-
-        // Color attachment
-        device.destroyImageView(offScreenFrameBuf.color.view);
-        device.destroyImage(offScreenFrameBuf.color.image);
-        device.freeMemory(offScreenFrameBuf.color.mem);
-
-        // Depth attachment
-        device.destroyImageView(offScreenFrameBuf.depth.view);
-        device.destroyImage(offScreenFrameBuf.depth.image);
-        device.freeMemory(offScreenFrameBuf.depth.mem);
-
-        device.destroyFramebuffer(offScreenFrameBuf.frameBuffer);
+        // Offscreen images, render pass and framebuffer
+        renderGraph.destroy();
 
         device.destroyPipeline(pipelines.radialBlur);
         device.destroyPipeline(pipelines.phongPass);
@@ -155,172 +133,26 @@ public:
         device.freeCommandBuffers(cmdPool, offScreenCmdBuffer);
     }
 
-    // Preapre an empty texture as the blit target from 
-    // the offscreen framebuffer
-    void prepareTextureTarget(vkx::Texture *tex, uint32_t width, uint32_t height,  vk::Format format) {
-        withPrimaryCommandBuffer([&](const vk::CommandBuffer& cmdBuffer) {
-
-             vk::FormatProperties formatProperties;
-
-            // Get device properites for the requested texture format
-            formatProperties = physicalDevice.getFormatProperties(format);
-            // Check if blit destination is supported for the requested format
-            // Only try for optimal tiling, linear tiling usually won't support blit as destination anyway
-            assert(formatProperties.optimalTilingFeatures &  vk::FormatFeatureFlagBits::eBlitDst);
-
-            // Prepare blit target texture
-            tex->extent.width = width;
-            tex->extent.height = height;
-
-            vk::ImageCreateInfo imageCreateInfo;
-            imageCreateInfo.imageType = vk::ImageType::e2D;
-            imageCreateInfo.format = format;
-            imageCreateInfo.extent = vk::Extent3D{ width, height, 1 };
-            imageCreateInfo.mipLevels = 1;
-            imageCreateInfo.arrayLayers = 1;
-            imageCreateInfo.samples = vk::SampleCountFlagBits::e1;
-            imageCreateInfo.tiling = vk::ImageTiling::eOptimal;
-            imageCreateInfo.sharingMode = vk::SharingMode::eExclusive;
-            imageCreateInfo.initialLayout = vk::ImageLayout::ePreinitialized;
-            // Texture will be sampled in a shader and is also the blit destination
-            imageCreateInfo.usage = vk::ImageUsageFlagBits::eSampled | vk::ImageUsageFlagBits::eTransferDst;
-
-            *tex = createImage(imageCreateInfo, vk::MemoryPropertyFlagBits::eDeviceLocal);
-
-
-            // Transform image layout to transfer destination
-            tex->imageLayout = vk::ImageLayout::eShaderReadOnlyOptimal;
-            vkx::setImageLayout(
-                cmdBuffer,
-                tex->image,
-                vk::ImageAspectFlagBits::eColor,
-                vk::ImageLayout::ePreinitialized,
-                tex->imageLayout);
-
-            // Create sampler
-            vk::SamplerCreateInfo sampler;
-            sampler.magFilter = TEX_FILTER;
-            sampler.minFilter = TEX_FILTER;
-            sampler.mipmapMode = vk::SamplerMipmapMode::eLinear;
-            sampler.addressModeU = vk::SamplerAddressMode::eClampToEdge;
-            sampler.addressModeV = sampler.addressModeU;
-            sampler.addressModeW = sampler.addressModeU;
-            sampler.mipLodBias = 0.0f;
-            sampler.maxAnisotropy = 0;
-            sampler.compareOp = vk::CompareOp::eNever;
-            sampler.minLod = 0.0f;
-            sampler.maxLod = 0.0f;
-            sampler.borderColor = vk::BorderColor::eFloatOpaqueWhite;
-            tex->sampler = device.createSampler(sampler);
-
-            // Create image view
-            vk::ImageViewCreateInfo view;
-            view.image;
-            view.viewType = vk::ImageViewType::e2D;
-            view.format = format;
-            view.components = { vk::ComponentSwizzle::eR, vk::ComponentSwizzle::eG, vk::ComponentSwizzle::eB, vk::ComponentSwizzle::eA };
-            view.subresourceRange = { vk::ImageAspectFlagBits::eColor, 0, 1, 0, 1 };
-            view.image = tex->image;
-            tex->view = device.createImageView(view);
-        });
-    }
-
-    // Prepare a new framebuffer for offscreen rendering
-    // The contents of this framebuffer are then
-    // blitted to our render target
-    void prepareOffscreenFramebuffer() {
-        withPrimaryCommandBuffer([&](const vk::CommandBuffer& cmdBuffer) {
-            offScreenFrameBuf.width = FB_DIM;
-            offScreenFrameBuf.height = FB_DIM;
-
-             vk::Format fbColorFormat = FB_COLOR_FORMAT;
-
-            // Find a suitable depth format
-             vk::Format fbDepthFormat = vkx::getSupportedDepthFormat(physicalDevice);
-
-            // Color attachment
-            vk::ImageCreateInfo image;
-            image.imageType = vk::ImageType::e2D;
-            image.format = fbColorFormat;
-            image.extent.width = offScreenFrameBuf.width;
-            image.extent.height = offScreenFrameBuf.height;
-            image.extent.depth = 1;
-            image.mipLevels = 1;
-            image.arrayLayers = 1;
-            image.samples = vk::SampleCountFlagBits::e1;
-            image.tiling = vk::ImageTiling::eOptimal;
-            // vk::Image of the framebuffer is blit source
-            image.usage = vk::ImageUsageFlagBits::eColorAttachment | vk::ImageUsageFlagBits::eTransferSrc;
-
-            vk::MemoryAllocateInfo memAlloc;
-            vk::MemoryRequirements memReqs;
-
-            vk::ImageViewCreateInfo colorImageView;
-            colorImageView.viewType = vk::ImageViewType::e2D;
-            colorImageView.format = fbColorFormat;
-            colorImageView.subresourceRange.aspectMask = vk::ImageAspectFlagBits::eColor;
-            colorImageView.subresourceRange.levelCount = 1;
-            colorImageView.subresourceRange.layerCount = 1;
-
-            offScreenFrameBuf.color.image = device.createImage(image);
-            memReqs = device.getImageMemoryRequirements(offScreenFrameBuf.color.image);
-            memAlloc.allocationSize = memReqs.size;
-            memAlloc.memoryTypeIndex = getMemoryType(memReqs.memoryTypeBits, vk::MemoryPropertyFlagBits::eDeviceLocal);
-            offScreenFrameBuf.color.mem = device.allocateMemory(memAlloc);
-            device.bindImageMemory(offScreenFrameBuf.color.image, offScreenFrameBuf.color.mem, 0);
-
-            vkx::setImageLayout(
-                cmdBuffer,
-                offScreenFrameBuf.color.image,
-                vk::ImageAspectFlagBits::eColor,
-                vk::ImageLayout::eUndefined,
-                vk::ImageLayout::eColorAttachmentOptimal);
-
-            colorImageView.image = offScreenFrameBuf.color.image;
-            offScreenFrameBuf.color.view = device.createImageView(colorImageView);
-
-            // Depth stencil attachment
-            image.format = fbDepthFormat;
-            image.usage = vk::ImageUsageFlagBits::eDepthStencilAttachment;
-
-            vk::ImageViewCreateInfo depthStencilView;
-            depthStencilView.viewType = vk::ImageViewType::e2D;
-            depthStencilView.format = fbDepthFormat;
-            depthStencilView.subresourceRange.aspectMask = vk::ImageAspectFlagBits::eDepth | vk::ImageAspectFlagBits::eStencil;
-            depthStencilView.subresourceRange.levelCount = 1;
-            depthStencilView.subresourceRange.layerCount = 1;
-
-            offScreenFrameBuf.depth.image = device.createImage(image);
-            memReqs = device.getImageMemoryRequirements(offScreenFrameBuf.depth.image);
-            memAlloc.allocationSize = memReqs.size;
-            memAlloc.memoryTypeIndex = getMemoryType(memReqs.memoryTypeBits, vk::MemoryPropertyFlagBits::eDeviceLocal);
-            offScreenFrameBuf.depth.mem = device.allocateMemory(memAlloc);
-            device.bindImageMemory(offScreenFrameBuf.depth.image, offScreenFrameBuf.depth.mem, 0);
-
-            vkx::setImageLayout(
-                cmdBuffer,
-                offScreenFrameBuf.depth.image,
-                vk::ImageAspectFlagBits::eDepth | vk::ImageAspectFlagBits::eStencil,
-                vk::ImageLayout::eUndefined,
-                vk::ImageLayout::eDepthStencilAttachmentOptimal);
-
-            depthStencilView.image = offScreenFrameBuf.depth.image;
-            offScreenFrameBuf.depth.view = device.createImageView(depthStencilView);
-
-            vk::ImageView attachments[2];
-            attachments[0] = offScreenFrameBuf.color.view;
-            attachments[1] = offScreenFrameBuf.depth.view;
-
-            vk::FramebufferCreateInfo fbufCreateInfo;
-            fbufCreateInfo.renderPass = renderPass;
-            fbufCreateInfo.attachmentCount = 2;
-            fbufCreateInfo.pAttachments = attachments;
-            fbufCreateInfo.width = offScreenFrameBuf.width;
-            fbufCreateInfo.height = offScreenFrameBuf.height;
-            fbufCreateInfo.layers = 1;
-            offScreenFrameBuf.frameBuffer = device.createFramebuffer(fbufCreateInfo);
-        });
-
+    void prepareRenderGraph() {
+        vk::Extent2D extent{ FB_DIM, FB_DIM };
+        offscreen.color = renderGraph.createImage("Glow color", FB_COLOR_FORMAT, extent, FB_FILTER);
+        offscreen.depth = renderGraph.createImage("Glow depth", vkx::getSupportedDepthFormat(physicalDevice), extent);
+        renderGraph.markOutput(offscreen.color);
+
+        glowPass = &renderGraph.addPass("Glow")
+            .writeColor(offscreen.color, glm::vec4(0.0f))
+            .writeDepth(offscreen.depth)
+            .setRecord([this](const vk::CommandBuffer& cmdBuffer) {
+                cmdBuffer.bindDescriptorSets(vk::PipelineBindPoint::eGraphics, pipelineLayouts.scene, 0, descriptorSets.scene, nullptr);
+                cmdBuffer.bindPipeline(vk::PipelineBindPoint::eGraphics, pipelines.colorPass);
+
+                vk::DeviceSize offsets = 0;
+                cmdBuffer.bindVertexBuffers(VERTEX_BUFFER_BIND_ID, meshes.example.vertices.buffer, offsets);
+                cmdBuffer.bindIndexBuffer(meshes.example.indices.buffer, 0, vk::IndexType::eUint32);
+                cmdBuffer.drawIndexed(meshes.example.indexCount, 1, 0, 0, 0);
+            });
+
+        renderGraph.compile();
     }
 
     void createOffscreenCommandBuffer() {
@@ -328,109 +160,12 @@ public:
         offScreenCmdBuffer = device.allocateCommandBuffers(cmd)[0];
     }
 
-    // The command buffer to copy for rendering 
-    // the offscreen scene and blitting it into
-    // the texture target is only build once
-    // and gets resubmitted 
+    // The command buffer for rendering the offscreen glow is only
+    // built once and gets resubmitted
     void buildOffscreenCommandBuffer() {
         vk::CommandBufferBeginInfo cmdBufInfo;
-
-        vk::ClearValue clearValues[2];
-        clearValues[0].color = vkx::clearColor({ 0, 0, 0, 0 });
-        clearValues[1].depthStencil = { 1.0f, 0 };
-
-        vk::RenderPassBeginInfo renderPassBeginInfo;
-        renderPassBeginInfo.renderPass = renderPass;
-        renderPassBeginInfo.framebuffer = offScreenFrameBuf.frameBuffer;
-        renderPassBeginInfo.renderArea.extent.width = offScreenFrameBuf.width;
-        renderPassBeginInfo.renderArea.extent.height = offScreenFrameBuf.height;
-        renderPassBeginInfo.clearValueCount = 2;
-        renderPassBeginInfo.pClearValues = clearValues;
-
         offScreenCmdBuffer.begin(cmdBufInfo);
-
-        vk::Viewport viewport = vkx::viewport((float)offScreenFrameBuf.width, (float)offScreenFrameBuf.height, 0.0f, 1.0f);
-        offScreenCmdBuffer.setViewport(0, viewport);
-
-        vk::Rect2D scissor = vkx::rect2D(offScreenFrameBuf.width, offScreenFrameBuf.height, 0, 0);
-        offScreenCmdBuffer.setScissor(0, scissor);
-
-        offScreenCmdBuffer.beginRenderPass(renderPassBeginInfo, vk::SubpassContents::eInline);
-
-        offScreenCmdBuffer.bindDescriptorSets(vk::PipelineBindPoint::eGraphics, pipelineLayouts.scene, 0, descriptorSets.scene, nullptr);
-        offScreenCmdBuffer.bindPipeline(vk::PipelineBindPoint::eGraphics, pipelines.colorPass);
-
-        vk::DeviceSize offsets = 0;
-        offScreenCmdBuffer.bindVertexBuffers(VERTEX_BUFFER_BIND_ID, meshes.example.vertices.buffer, offsets);
-        offScreenCmdBuffer.bindIndexBuffer(meshes.example.indices.buffer, 0, vk::IndexType::eUint32);
-        offScreenCmdBuffer.drawIndexed(meshes.example.indexCount, 1, 0, 0, 0);
-        offScreenCmdBuffer.endRenderPass();
-
-        // Make sure color writes to the framebuffer are finished before using it as transfer source
-        vkx::setImageLayout(
-            offScreenCmdBuffer,
-            offScreenFrameBuf.color.image,
-            vk::ImageAspectFlagBits::eColor,
-            vk::ImageLayout::eColorAttachmentOptimal,
-            vk::ImageLayout::eTransferSrcOptimal);
-
-        // Transform texture target to transfer destination
-        vkx::setImageLayout(
-            offScreenCmdBuffer,
-            offScreenFrameBuf.textureTarget.image,
-            vk::ImageAspectFlagBits::eColor,
-            vk::ImageLayout::eShaderReadOnlyOptimal,
-            vk::ImageLayout::eTransferDstOptimal);
-
-        // Blit offscreen color buffer to our texture target
-        vk::ImageBlit imgBlit;
-
-        imgBlit.srcSubresource.aspectMask = vk::ImageAspectFlagBits::eColor;
-        imgBlit.srcSubresource.mipLevel = 0;
-        imgBlit.srcSubresource.baseArrayLayer = 0;
-        imgBlit.srcSubresource.layerCount = 1;
-
-        imgBlit.srcOffsets[1].x = offScreenFrameBuf.width;
-        imgBlit.srcOffsets[1].y = offScreenFrameBuf.height;
-        imgBlit.srcOffsets[1].z = 1;
-
-        imgBlit.dstSubresource.aspectMask = vk::ImageAspectFlagBits::eColor;
-        imgBlit.dstSubresource.mipLevel = 0;
-        imgBlit.dstSubresource.baseArrayLayer = 0;
-        imgBlit.dstSubresource.layerCount = 1;
-
-        imgBlit.dstOffsets[1].x = offScreenFrameBuf.textureTarget.extent.width;
-        imgBlit.dstOffsets[1].y = offScreenFrameBuf.textureTarget.extent.height;
-        imgBlit.dstOffsets[1].z = 1;
-
-        // Blit from framebuffer image to texture image
-        // vkCmdBlitImage does scaling and (if necessary and possible) also does format conversions
-        offScreenCmdBuffer.blitImage(
-            offScreenFrameBuf.color.image,
-            vk::ImageLayout::eTransferSrcOptimal,
-            offScreenFrameBuf.textureTarget.image,
-            vk::ImageLayout::eTransferDstOptimal,
-            imgBlit,
-            vk::Filter::eLinear);
-
-        // Transform framebuffer color attachment back 
-        vkx::setImageLayout(
-            offScreenCmdBuffer,
-            offScreenFrameBuf.color.image,
-            vk::ImageAspectFlagBits::eColor,
-            vk::ImageLayout::eTransferSrcOptimal,
-            vk::ImageLayout::eColorAttachmentOptimal);
-
-        // Transform texture target back to shader read
-        // Makes sure that writes to the texture are finished before
-        // it's accessed in the shader
-        vkx::setImageLayout(
-            offScreenCmdBuffer,
-            offScreenFrameBuf.textureTarget.image,
-            vk::ImageAspectFlagBits::eColor,
-            vk::ImageLayout::eTransferDstOptimal,
-            vk::ImageLayout::eShaderReadOnlyOptimal);
-
+        renderGraph.execute(offScreenCmdBuffer);
         offScreenCmdBuffer.end();
     }
 
@@ -612,8 +347,7 @@ public:
         descriptorSets.quad = device.allocateDescriptorSets(allocInfo)[0];
 
         // vk::Image descriptor for the color map texture
-        vk::DescriptorImageInfo texDescriptor =
-            vkx::descriptorImageInfo(offScreenFrameBuf.textureTarget.sampler, offScreenFrameBuf.textureTarget.view, vk::ImageLayout::eGeneral);
+        vk::DescriptorImageInfo texDescriptor = renderGraph.descriptor(offscreen.color);
 
         std::vector<vk::WriteDescriptorSet> writeDescriptorSets =
         {
@@ -734,6 +468,7 @@ public:
         shaderStages[0] = loadShader(getAssetPath() + "shaders/radialblur/colorpass.vert.spv", vk::ShaderStageFlagBits::eVertex);
         shaderStages[1] = loadShader(getAssetPath() + "shaders/radialblur/colorpass.frag.spv", vk::ShaderStageFlagBits::eFragment);
 
+        pipelineCreateInfo.renderPass = glowPass->renderPass;
         pipelines.colorPass = device.createGraphicsPipelines(pipelineCache, pipelineCreateInfo, nullptr)[0];
     }
 
@@ -801,13 +536,12 @@ public:
         loadMeshes();
         setupVertexDescriptions();
         prepareUniformBuffers();
-        prepareTextureTarget(&offScreenFrameBuf.textureTarget, TEX_DIM, TEX_DIM, TEX_FORMAT);
+        prepareRenderGraph();
         setupDescriptorSetLayout();
         preparePipelines();
         setupDescriptorPool();
         setupDescriptorSet();
         createOffscreenCommandBuffer();
-        prepareOffscreenFramebuffer();
         buildCommandBuffers();
         buildOffscreenCommandBuffer();
         prepared = true;
@@ -817,6 +551,9 @@ public:
         if (!prepared)
             return;
         draw();
+        if (blur) {
+            renderGraph.updateTimings();
+        }
         if (!paused) {
             updateUniformBuffersScene();
         }
@@ -848,6 +585,13 @@ public:
         textOverlay->addText("Press \"B\" to toggle blur", 5.0f, 85.0f, vkx::TextOverlay::alignLeft);
         textOverlay->addText("Press \"T\" to display offscreen texture", 5.0f, 105.0f, vkx::TextOverlay::alignLeft);
 #endif
+        std::stringstream ss;
+        ss << std::fixed << std::setprecision(3);
+        ss << "Offscreen passes: " << renderGraph.gpuTime << " ms";
+        textOverlay->addText(ss.str(), 5.0f, 125.0f, vkx::TextOverlay::alignLeft);
+        ss.str("");
+        ss << "Offscreen images: " << renderGraph.memoryStats.allocated / 1024 << " KB (" << renderGraph.memoryStats.required / 1024 << " KB without aliasing)";
+        textOverlay->addText(ss.str(), 5.0f, 145.0f, vkx::TextOverlay::alignLeft);
     }
 
     void toggleBlur() {
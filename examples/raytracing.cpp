@@ -7,9 +7,12 @@
 */
 
 #include "vulkanExampleBase.h"
-
+#include "bvh.h"
+#include "threadPool.hpp"
 
 #define TEX_DIM 2048
+// Progressive mode traces the target in tiles of this size
+#define TILE_DIM 256
 
 // Vertex layout for this example
 struct Vertex {
@@ -20,6 +23,7 @@ struct Vertex {
 class VulkanExample : public vkx::ExampleBase {
 private:
     vkx::Texture textureComputeTarget;
+    vkx::Texture textureAccumulation;
 public:
     struct {
         vk::PipelineVertexInputStateCreateInfo inputState;
@@ -63,12 +67,49 @@ public:
     vk::DescriptorSet descriptorSetPostCompute;
     vk::DescriptorSetLayout descriptorSetLayout;
 
+    // Triangle mesh traced through a bounding volume hierarchy
+    std::vector<std::string> meshFiles = {
+        "models/suzanne.obj",
+        "models/torusknot.obj",
+        "models/teapot.3ds",
+        "models/angryteapot.3ds",
+    };
+    uint32_t meshIndex = 0;
+    vkx::ThreadPool threadPool;
+    vkx::Bvh bvh;
+    struct {
+        vkx::CreateBufferResult nodes;
+        vkx::CreateBufferResult triangles;
+    } bvhBuffers;
+    float bvhBuildTime = 0.0f;
+
+    // Timestamps around the compute dispatch
+    vk::QueryPool timestampQueryPool;
+    float computeTime = 0.0f;
+
+    // Progressive accumulation
+    struct PushConstants {
+        glm::ivec2 tileOffset;
+        uint32_t sampleIndex;
+        uint32_t progressive;
+    };
+    bool progressive = true;
+    // GPU time spent on tiles per frame once the first full sample has been traced
+    float frameBudget = 8.0f;
+    uint32_t tilesPerFrame = 1;
+    uint32_t tilesTraced = 0;
+    // Next tile to trace and the sample index it will receive
+    uint32_t nextTile = 0;
+    uint32_t sampleIndex = 0;
+    float samplesPerSecond = 0.0f;
+
     VulkanExample() : vkx::ExampleBase(ENABLE_VALIDATION) {
         zoom = -2.0f;
         title = "Vulkan Example - Compute shader ray tracing";
         uboCompute.aspectRatio = (float)width / (float)height;
         paused = true;
         timerSpeed *= 0.5f;
+        enableTextOverlay = true;
     }
 
     ~VulkanExample() {
@@ -83,10 +124,14 @@ public:
 
         meshes.quad.destroy();
         uniformDataCompute.destroy();
+        bvhBuffers.nodes.destroy();
+        bvhBuffers.triangles.destroy();
+        device.destroyQueryPool(timestampQueryPool);
 
         device.freeCommandBuffers(cmdPool, computeCmdBuffer);
 
         textureComputeTarget.destroy();
+        textureAccumulation.destroy();
     }
 
     // Prepare a texture target that is used to store compute shader calculations
@@ -219,22 +264,147 @@ public:
 
     }
 
+    // Records the tiles for this frame.  The first sample after a reset covers the whole
+    // target so the image is never stale, later samples are limited by the frame budget.
     void buildComputeCommandBuffer() {
+        const uint32_t tilesX = textureComputeTarget.extent.width / TILE_DIM;
+        const uint32_t tileCount = tilesX * (textureComputeTarget.extent.height / TILE_DIM);
+        uint32_t tiles = tileCount;
+        if (progressive && sampleIndex > 0) {
+            tiles = tilesPerFrame;
+        }
+
         vk::CommandBufferBeginInfo cmdBufInfo;
+        cmdBufInfo.flags = vk::CommandBufferUsageFlagBits::eOneTimeSubmit;
         computeCmdBuffer.begin(cmdBufInfo);
+        computeCmdBuffer.resetQueryPool(timestampQueryPool, 0, 2);
+        computeCmdBuffer.writeTimestamp(vk::PipelineStageFlagBits::eTopOfPipe, timestampQueryPool, 0);
         computeCmdBuffer.bindPipeline(vk::PipelineBindPoint::eCompute, pipelines.compute);
         computeCmdBuffer.bindDescriptorSets(vk::PipelineBindPoint::eCompute, computePipelineLayout, 0, computeDescriptorSet, nullptr);
-        computeCmdBuffer.dispatch(textureComputeTarget.extent.width / 16, textureComputeTarget.extent.height / 16, 1);
+        for (uint32_t i = 0; i < tiles; ++i) {
+            PushConstants pushConstants;
+            pushConstants.tileOffset = glm::ivec2(nextTile % tilesX, nextTile / tilesX) * TILE_DIM;
+            pushConstants.sampleIndex = progressive ? sampleIndex : 0;
+            pushConstants.progressive = progressive ? 1 : 0;
+            computeCmdBuffer.pushConstants(computePipelineLayout, vk::ShaderStageFlagBits::eCompute, 0, sizeof(PushConstants), &pushConstants);
+            computeCmdBuffer.dispatch(TILE_DIM / 16, TILE_DIM / 16, 1);
+            if (++nextTile == tileCount) {
+                nextTile = 0;
+                ++sampleIndex;
+            }
+        }
+        computeCmdBuffer.writeTimestamp(vk::PipelineStageFlagBits::eBottomOfPipe, timestampQueryPool, 1);
         computeCmdBuffer.end();
+        tilesTraced = tiles;
+    }
+
+    void resetAccumulation() {
+        nextTile = 0;
+        sampleIndex = 0;
     }
 
     void compute() {
+        buildComputeCommandBuffer();
+
         // Compute
         vk::SubmitInfo computeSubmitInfo;
         computeSubmitInfo.commandBufferCount = 1;
         computeSubmitInfo.pCommandBuffers = &computeCmdBuffer;
         computeQueue.submit(computeSubmitInfo, VK_NULL_HANDLE);
         computeQueue.waitIdle();
+
+        uint64_t timestamps[2];
+        device.getQueryPoolResults(timestampQueryPool, 0, 2, sizeof(timestamps), timestamps, sizeof(uint64_t), vk::QueryResultFlagBits::e64 | vk::QueryResultFlagBits::eWait);
+        computeTime = (float)(timestamps[1] - timestamps[0]) * deviceProperties.limits.timestampPeriod / 1000000.0f;
+        if (computeTime <= 0.0f) {
+            return;
+        }
+
+        samplesPerSecond = (float)(tilesTraced * TILE_DIM * TILE_DIM) / (computeTime / 1000.0f);
+        // Fit as many tiles into the budget as the last frame's cost per tile allows
+        const uint32_t tileCount = (textureComputeTarget.extent.width / TILE_DIM) * (textureComputeTarget.extent.height / TILE_DIM);
+        float tileTime = computeTime / (float)tilesTraced;
+        tilesPerFrame = std::max(1u, std::min(tileCount, (uint32_t)(frameBudget / tileTime)));
+    }
+
+    void prepareTimestampQueries() {
+        vk::QueryPoolCreateInfo queryPoolInfo;
+        queryPoolInfo.queryType = vk::QueryType::eTimestamp;
+        queryPoolInfo.queryCount = 2;
+        timestampQueryPool = device.createQueryPool(queryPoolInfo);
+    }
+
+    // Load a mesh, fit it between the spheres and build the hierarchy the compute shader traverses
+    void loadMeshBvh() {
+        vkx::MeshLoader loader;
+#if defined(__ANDROID__)
+        loader.assetManager = androidApp->activity->assetManager;
+#endif
+        loader.load(getAssetPath() + meshFiles[meshIndex]);
+        assert(loader.m_Entries.size() > 0);
+
+        std::vector<glm::vec3> positions;
+        std::vector<uint32_t> indices;
+        glm::vec3 boundsMin(FLT_MAX), boundsMax(-FLT_MAX);
+        for (const auto& entry : loader.m_Entries) {
+            uint32_t indexBase = (uint32_t)positions.size();
+            for (const auto& vertex : entry.Vertices) {
+                // The mesh loader flips y for the rasterization examples, the ray tracer is y up
+                glm::vec3 pos(vertex.m_pos.x, -vertex.m_pos.y, vertex.m_pos.z);
+                boundsMin = glm::min(boundsMin, pos);
+                boundsMax = glm::max(boundsMax, pos);
+                positions.push_back(pos);
+            }
+            for (auto index : entry.Indices) {
+                indices.push_back(indexBase + index);
+            }
+        }
+
+        // Stand on the plane below the center sphere
+        glm::vec3 size = boundsMax - boundsMin;
+        float scale = std::min(1.4f / size.y, 1.2f / std::max(size.x, size.z));
+        glm::vec3 center = (boundsMin + boundsMax) * 0.5f;
+        for (auto& pos : positions) {
+            pos = glm::vec3(pos.x - center.x, pos.y - boundsMin.y, pos.z - center.z) * scale;
+        }
+
+        auto tStart = std::chrono::high_resolution_clock::now();
+        bvh.build(positions, indices, &threadPool);
+        auto tEnd = std::chrono::high_resolution_clock::now();
+        bvhBuildTime = std::chrono::duration<float, std::milli>(tEnd - tStart).count();
+
+        bvhBuffers.nodes.destroy();
+        bvhBuffers.triangles.destroy();
+        bvhBuffers.nodes = stageToDeviceBuffer(vk::BufferUsageFlagBits::eStorageBuffer, bvh.nodes);
+        bvhBuffers.triangles = stageToDeviceBuffer(vk::BufferUsageFlagBits::eStorageBuffer, bvh.triangles);
+    }
+
+    void changeMesh(int32_t delta) {
+        meshIndex = (meshIndex + (uint32_t)meshFiles.size() + delta) % (uint32_t)meshFiles.size();
+        computeQueue.waitIdle();
+        loadMeshBvh();
+        updateMeshDescriptors();
+        resetAccumulation();
+        updateTextOverlay();
+    }
+
+    void updateMeshDescriptors() {
+        std::vector<vk::WriteDescriptorSet> writeDescriptorSets =
+        {
+            // Binding 2 : BVH nodes
+            vkx::writeDescriptorSet(
+                computeDescriptorSet,
+                vk::DescriptorType::eStorageBuffer,
+                2,
+                &bvhBuffers.nodes.descriptor),
+            // Binding 3 : Triangles in leaf order
+            vkx::writeDescriptorSet(
+                computeDescriptorSet,
+                vk::DescriptorType::eStorageBuffer,
+                3,
+                &bvhBuffers.triangles.descriptor)
+        };
+        device.updateDescriptorSets(writeDescriptorSets.size(), writeDescriptorSets.data(), 0, NULL);
     }
 
     // Setup vertices for a single uv-mapped quad
@@ -286,7 +456,9 @@ public:
             // Graphics pipeline uses image samplers for display
             vkx::descriptorPoolSize(vk::DescriptorType::eCombinedImageSampler, 4),
             // Compute pipeline uses storage images image loads and stores
-            vkx::descriptorPoolSize(vk::DescriptorType::eStorageImage, 1),
+            vkx::descriptorPoolSize(vk::DescriptorType::eStorageImage, 2),
+            // BVH nodes and triangles
+            vkx::descriptorPoolSize(vk::DescriptorType::eStorageBuffer, 2),
         };
 
         vk::DescriptorPoolCreateInfo descriptorPoolInfo =
@@ -414,7 +586,22 @@ public:
             vkx::descriptorSetLayoutBinding(
                 vk::DescriptorType::eUniformBuffer,
                 vk::ShaderStageFlagBits::eCompute,
-                1)
+                1),
+            // Binding 2 : BVH nodes
+            vkx::descriptorSetLayoutBinding(
+                vk::DescriptorType::eStorageBuffer,
+                vk::ShaderStageFlagBits::eCompute,
+                2),
+            // Binding 3 : Triangles
+            vkx::descriptorSetLayoutBinding(
+                vk::DescriptorType::eStorageBuffer,
+                vk::ShaderStageFlagBits::eCompute,
+                3),
+            // Binding 4 : Accumulation image (read and write)
+            vkx::descriptorSetLayoutBinding(
+                vk::DescriptorType::eStorageImage,
+                vk::ShaderStageFlagBits::eCompute,
+                4)
         };
 
         vk::DescriptorSetLayoutCreateInfo descriptorLayout =
@@ -426,6 +613,12 @@ public:
         vk::PipelineLayoutCreateInfo pPipelineLayoutCreateInfo =
             vkx::pipelineLayoutCreateInfo(&computeDescriptorSetLayout, 1);
 
+        // Tile offset and sample index
+        vk::PushConstantRange pushConstantRange =
+            vkx::pushConstantRange(vk::ShaderStageFlagBits::eCompute, sizeof(PushConstants), 0);
+        pPipelineLayoutCreateInfo.pushConstantRangeCount = 1;
+        pPipelineLayoutCreateInfo.pPushConstantRanges = &pushConstantRange;
+
         computePipelineLayout = device.createPipelineLayout(pPipelineLayoutCreateInfo);
 
 
@@ -440,6 +633,10 @@ public:
             vkx::descriptorImageInfo(
                 VK_NULL_HANDLE,
                 textureComputeTarget.view,
+                vk::ImageLayout::eGeneral),
+            vkx::descriptorImageInfo(
+                VK_NULL_HANDLE,
+                textureAccumulation.view,
                 vk::ImageLayout::eGeneral)
         };
 
@@ -456,17 +653,24 @@ public:
                 computeDescriptorSet,
                 vk::DescriptorType::eUniformBuffer,
                 1,
-                &uniformDataCompute.descriptor)
+                &uniformDataCompute.descriptor),
+            // Binding 4 : Accumulation storage image
+            vkx::writeDescriptorSet(
+                computeDescriptorSet,
+                vk::DescriptorType::eStorageImage,
+                4,
+                &computeTexDescriptors[1])
         };
 
         device.updateDescriptorSets(computeWriteDescriptorSets.size(), computeWriteDescriptorSets.data(), 0, NULL);
+        updateMeshDescriptors();
 
 
         // Create compute shader pipelines
         vk::ComputePipelineCreateInfo computePipelineCreateInfo =
             vkx::computePipelineCreateInfo(computePipelineLayout);
 
-        computePipelineCreateInfo.stage = loadShader(getAssetPath() + "shaders/raytracing/raytracing.comp.spv", vk::ShaderStageFlagBits::eCompute);
+        computePipelineCreateInfo.stage = loadGlslShader(getAssetPath() + "shaders/raytracing/raytracing.comp", vk::ShaderStageFlagBits::eCompute);
         pipelines.compute = device.createComputePipelines(pipelineCache, computePipelineCreateInfo, nullptr)[0];
     }
 
@@ -510,6 +714,9 @@ public:
         generateQuad();
         getComputeQueue();
         createComputeCommandBuffer();
+        prepareTimestampQueries();
+        threadPool.setThreadCount(std::max(1u, std::thread::hardware_concurrency()));
+        loadMeshBvh();
         setupVertexDescriptions();
         prepareUniformBuffers();
         prepareTextureTarget(
@@ -517,13 +724,17 @@ public:
             TEX_DIM,
             TEX_DIM,
              vk::Format::eR8G8B8A8Unorm);
+        prepareTextureTarget(
+            textureAccumulation,
+            TEX_DIM,
+            TEX_DIM,
+            vk::Format::eR32G32B32A32Sfloat);
         setupDescriptorSetLayout();
         preparePipelines();
         setupDescriptorPool();
         setupDescriptorSet();
         prepareCompute();
         buildCommandBuffers();
-        buildComputeCommandBuffer();
         prepared = true;
     }
 
@@ -534,11 +745,57 @@ public:
         compute();
         if (!paused) {
             updateUniformBuffers();
+            resetAccumulation();
         }
     }
 
     virtual void viewChanged() {
         updateUniformBuffers();
+        resetAccumulation();
+    }
+
+    void toggleProgressive() {
+        progressive = !progressive;
+        resetAccumulation();
+        updateTextOverlay();
+    }
+
+    virtual void keyPressed(uint32_t keyCode) {
+        switch (keyCode) {
+        case GLFW_KEY_KP_ADD:
+        case GAMEPAD_BUTTON_R1:
+            changeMesh(1);
+            break;
+        case GLFW_KEY_KP_SUBTRACT:
+        case GAMEPAD_BUTTON_L1:
+            changeMesh(-1);
+            break;
+        case GLFW_KEY_P:
+        case GAMEPAD_BUTTON_A:
+            toggleProgressive();
+            break;
+        }
+    }
+
+    virtual void getOverlayText(vkx::TextOverlay *textOverlay) {
+        std::stringstream ss;
+        ss << std::fixed << std::setprecision(2);
+        ss << meshFiles[meshIndex] << ": " << bvh.triangles.size() << " triangles, " << bvh.nodes.size() << " nodes";
+        textOverlay->addText(ss.str(), 5.0f, 85.0f, vkx::TextOverlay::alignLeft);
+        ss.str("");
+        ss << "BVH build: " << bvhBuildTime << " ms (" << threadPool.threads.size() << " threads)";
+        textOverlay->addText(ss.str(), 5.0f, 105.0f, vkx::TextOverlay::alignLeft);
+        ss.str("");
+        ss << "Trace: " << computeTime << " ms, " << tilesTraced << " tiles, " << samplesPerSecond / 1000000.0f << " Msamples/s";
+        textOverlay->addText(ss.str(), 5.0f, 125.0f, vkx::TextOverlay::alignLeft);
+        ss.str("");
+        if (progressive) {
+            ss << "Progressive: " << sampleIndex << " samples per pixel";
+        } else {
+            ss << "Progressive: off";
+        }
+        textOverlay->addText(ss.str(), 5.0f, 145.0f, vkx::TextOverlay::alignLeft);
+        textOverlay->addText("Press \"Numpad +/-\" to change mesh, \"P\" to toggle progressive mode", 5.0f, 165.0f, vkx::TextOverlay::alignLeft);
     }
 };
 
@@ -31,6 +31,8 @@ std::vector<vkx::VertexLayout> vertexLayout =
 class VulkanExample : public vkx::ExampleBase {
 public:
     bool displayCubeMap = false;
+    // Render all cube map faces in a single layered pass (requires geometry shader support)
+    bool layeredShadows = false;
 
     float zNear = 0.1f;
     float zFar = 1024.0f;
@@ -70,11 +72,14 @@ public:
         glm::mat4 view;
         glm::mat4 model;
         glm::vec4 lightPos;
+        // Used by the layered path only
+        glm::mat4 faceViewProjection[6];
     } uboOffscreenVS;
 
     struct {
         vk::Pipeline scene;
         vk::Pipeline offscreen;
+        vk::Pipeline offscreenLayered;
         vk::Pipeline cubeMap;
     } pipelines;
 
@@ -100,14 +105,27 @@ public:
         FrameBufferAttachment color, depth;
     } offScreenFrameBuf;
 
+    // Renders directly into all layers of the cube map
+    struct {
+        vk::RenderPass renderPass;
+        vk::Framebuffer frameBuffer;
+        vk::ImageView colorView;
+        FrameBufferAttachment depth;
+    } layeredFrameBuf;
+
     vk::CommandBuffer offScreenCmdBuffer;
 
+    // GPU time of the offscreen command buffer
+    vk::QueryPool timestampQueryPool;
+    float shadowPassTime = 0.0f;
+
     VulkanExample() : vkx::ExampleBase(ENABLE_VALIDATION) {
         zoom = -175.0f;
         zoomSpeed = 10.0f;
         timerSpeed *= 0.25f;
         rotation = { -20.5f, -673.0f, 0.0f };
         title = "Vulkan Example - Point light shadows";
+        enableTextOverlay = true;
     }
 
     ~VulkanExample() {
@@ -126,9 +144,22 @@ public:
         // Frame buffer
         device.destroyFramebuffer(offScreenFrameBuf.frameBuffer);
 
+        // Layered frame buffer
+        if (layeredFrameBuf.renderPass) {
+            device.destroyFramebuffer(layeredFrameBuf.frameBuffer);
+            device.destroyImageView(layeredFrameBuf.colorView);
+            layeredFrameBuf.depth.destroy();
+            device.destroyRenderPass(layeredFrameBuf.renderPass);
+        }
+
+        device.destroyQueryPool(timestampQueryPool);
+
         // Pipelibes
         device.destroyPipeline(pipelines.scene);
         device.destroyPipeline(pipelines.offscreen);
+        if (pipelines.offscreenLayered) {
+            device.destroyPipeline(pipelines.offscreenLayered);
+        }
         device.destroyPipeline(pipelines.cubeMap);
 
         device.destroyPipelineLayout(pipelineLayouts.scene);
@@ -163,7 +194,8 @@ public:
         imageCreateInfo.arrayLayers = 6;
         imageCreateInfo.samples = vk::SampleCountFlagBits::e1;
         imageCreateInfo.tiling = vk::ImageTiling::eOptimal;
-        imageCreateInfo.usage = vk::ImageUsageFlagBits::eTransferDst | vk::ImageUsageFlagBits::eSampled;
+        // Copy destination for the per face path, color attachment for the layered path
+        imageCreateInfo.usage = vk::ImageUsageFlagBits::eTransferDst | vk::ImageUsageFlagBits::eSampled | vk::ImageUsageFlagBits::eColorAttachment;
         imageCreateInfo.sharingMode = vk::SharingMode::eExclusive;
         imageCreateInfo.initialLayout = vk::ImageLayout::ePreinitialized;
         imageCreateInfo.flags = vk::ImageCreateFlagBits::eCubeCompatible;
@@ -306,27 +338,122 @@ public:
 
     }
 
-    // Updates a single cube map face
-    // Renders the scene with face's view and does 
-    // a copy from framebuffer to cube face
-    // Uses push constants for quick update of
-    // view matrix for the current cube map face
-    void updateCubeFace(uint32_t faceIndex) {
-        vk::ClearValue clearValues[2];
-        clearValues[0].color = vkx::clearColor({ 0.0f, 0.0f, 0.0f, 1.0f });
-        clearValues[1].depthStencil = { 1.0f, 0 };
+    // Prepare a layered framebuffer that renders to all six cube map faces at once.
+    // The geometry shader selects the target face via gl_Layer.
+    void prepareLayeredFramebuffer() {
+        vk::Format fbDepthFormat = vkx::getSupportedDepthFormat(physicalDevice);
 
-        vk::RenderPassBeginInfo renderPassBeginInfo;
-        // Reuse render pass from example pass
-        renderPassBeginInfo.renderPass = renderPass;
-        renderPassBeginInfo.framebuffer = offScreenFrameBuf.frameBuffer;
-        renderPassBeginInfo.renderArea.extent.width = offScreenFrameBuf.width;
-        renderPassBeginInfo.renderArea.extent.height = offScreenFrameBuf.height;
-        renderPassBeginInfo.clearValueCount = 2;
-        renderPassBeginInfo.pClearValues = clearValues;
+        vk::AttachmentDescription attDesc[2];
+        attDesc[0].format = FB_COLOR_FORMAT;
+        attDesc[0].samples = vk::SampleCountFlagBits::e1;
+        attDesc[0].loadOp = vk::AttachmentLoadOp::eClear;
+        attDesc[0].storeOp = vk::AttachmentStoreOp::eStore;
+        attDesc[0].stencilLoadOp = vk::AttachmentLoadOp::eDontCare;
+        attDesc[0].stencilStoreOp = vk::AttachmentStoreOp::eDontCare;
+        // Previous contents are cleared, the render pass leaves the cube map ready for sampling
+        attDesc[0].initialLayout = vk::ImageLayout::eUndefined;
+        attDesc[0].finalLayout = vk::ImageLayout::eShaderReadOnlyOptimal;
+
+        attDesc[1].format = fbDepthFormat;
+        attDesc[1].samples = vk::SampleCountFlagBits::e1;
+        attDesc[1].loadOp = vk::AttachmentLoadOp::eClear;
+        attDesc[1].storeOp = vk::AttachmentStoreOp::eDontCare;
+        attDesc[1].stencilLoadOp = vk::AttachmentLoadOp::eDontCare;
+        attDesc[1].stencilStoreOp = vk::AttachmentStoreOp::eDontCare;
+        attDesc[1].initialLayout = vk::ImageLayout::eUndefined;
+        attDesc[1].finalLayout = vk::ImageLayout::eDepthStencilAttachmentOptimal;
+
+        vk::AttachmentReference colorReference;
+        colorReference.attachment = 0;
+        colorReference.layout = vk::ImageLayout::eColorAttachmentOptimal;
+
+        vk::AttachmentReference depthReference;
+        depthReference.attachment = 1;
+        depthReference.layout = vk::ImageLayout::eDepthStencilAttachmentOptimal;
+
+        vk::SubpassDescription subpass;
+        subpass.pipelineBindPoint = vk::PipelineBindPoint::eGraphics;
+        subpass.colorAttachmentCount = 1;
+        subpass.pColorAttachments = &colorReference;
+        subpass.pDepthStencilAttachment = &depthReference;
+
+        // Wait for the previous frame's scene pass to finish sampling before overwriting the faces,
+        // and make the writes visible to the scene pass of this frame
+        std::array<vk::SubpassDependency, 2> dependencies;
+        dependencies[0].srcSubpass = VK_SUBPASS_EXTERNAL;
+        dependencies[0].dstSubpass = 0;
+        dependencies[0].srcStageMask = vk::PipelineStageFlagBits::eFragmentShader;
+        dependencies[0].dstStageMask = vk::PipelineStageFlagBits::eColorAttachmentOutput;
+        dependencies[0].srcAccessMask = vk::AccessFlagBits::eShaderRead;
+        dependencies[0].dstAccessMask = vk::AccessFlagBits::eColorAttachmentWrite;
+        dependencies[1].srcSubpass = 0;
+        dependencies[1].dstSubpass = VK_SUBPASS_EXTERNAL;
+        dependencies[1].srcStageMask = vk::PipelineStageFlagBits::eColorAttachmentOutput;
+        dependencies[1].dstStageMask = vk::PipelineStageFlagBits::eFragmentShader;
+        dependencies[1].srcAccessMask = vk::AccessFlagBits::eColorAttachmentWrite;
+        dependencies[1].dstAccessMask = vk::AccessFlagBits::eShaderRead;
+
+        vk::RenderPassCreateInfo renderPassCreateInfo;
+        renderPassCreateInfo.attachmentCount = 2;
+        renderPassCreateInfo.pAttachments = attDesc;
+        renderPassCreateInfo.subpassCount = 1;
+        renderPassCreateInfo.pSubpasses = &subpass;
+        renderPassCreateInfo.dependencyCount = (uint32_t)dependencies.size();
+        renderPassCreateInfo.pDependencies = dependencies.data();
+        layeredFrameBuf.renderPass = device.createRenderPass(renderPassCreateInfo);
+
+        // One depth layer per cube face
+        vk::ImageCreateInfo image;
+        image.imageType = vk::ImageType::e2D;
+        image.format = fbDepthFormat;
+        image.extent.width = FB_DIM;
+        image.extent.height = FB_DIM;
+        image.extent.depth = 1;
+        image.mipLevels = 1;
+        image.arrayLayers = 6;
+        image.samples = vk::SampleCountFlagBits::e1;
+        image.tiling = vk::ImageTiling::eOptimal;
+        image.usage = vk::ImageUsageFlagBits::eDepthStencilAttachment;
+        image.initialLayout = vk::ImageLayout::eUndefined;
+        layeredFrameBuf.depth = createImage(image, vk::MemoryPropertyFlagBits::eDeviceLocal);
+
+        vk::ImageViewCreateInfo depthStencilView;
+        depthStencilView.viewType = vk::ImageViewType::e2DArray;
+        depthStencilView.format = fbDepthFormat;
+        depthStencilView.subresourceRange = { vk::ImageAspectFlagBits::eDepth, 0, 1, 0, 6 };
+        depthStencilView.image = layeredFrameBuf.depth.image;
+        layeredFrameBuf.depth.view = device.createImageView(depthStencilView);
+
+        // The cube view can't be used as an attachment, render through an array view of the same image
+        vk::ImageViewCreateInfo colorView;
+        colorView.viewType = vk::ImageViewType::e2DArray;
+        colorView.format = FB_COLOR_FORMAT;
+        colorView.subresourceRange = { vk::ImageAspectFlagBits::eColor, 0, 1, 0, 6 };
+        colorView.image = shadowCubeMap.image;
+        layeredFrameBuf.colorView = device.createImageView(colorView);
+
+        vk::ImageView attachments[2];
+        attachments[0] = layeredFrameBuf.colorView;
+        attachments[1] = layeredFrameBuf.depth.view;
+
+        vk::FramebufferCreateInfo fbufCreateInfo;
+        fbufCreateInfo.renderPass = layeredFrameBuf.renderPass;
+        fbufCreateInfo.attachmentCount = 2;
+        fbufCreateInfo.pAttachments = attachments;
+        fbufCreateInfo.width = FB_DIM;
+        fbufCreateInfo.height = FB_DIM;
+        fbufCreateInfo.layers = 6;
+        layeredFrameBuf.frameBuffer = device.createFramebuffer(fbufCreateInfo);
+    }
 
-        // Update view matrix via push constant
+    void prepareTimestampQueries() {
+        vk::QueryPoolCreateInfo queryPoolInfo;
+        queryPoolInfo.queryType = vk::QueryType::eTimestamp;
+        queryPoolInfo.queryCount = 2;
+        timestampQueryPool = device.createQueryPool(queryPoolInfo);
+    }
 
+    static glm::mat4 cubeFaceView(uint32_t faceIndex) {
         glm::mat4 viewMatrix = glm::mat4();
         switch (faceIndex) {
         case 0: // POSITIVE_X
@@ -350,6 +477,31 @@ public:
             viewMatrix = glm::rotate(viewMatrix, glm::radians(180.0f), glm::vec3(0.0f, 0.0f, 1.0f));
             break;
         }
+        return viewMatrix;
+    }
+
+    // Updates a single cube map face
+    // Renders the scene with face's view and does 
+    // a copy from framebuffer to cube face
+    // Uses push constants for quick update of
+    // view matrix for the current cube map face
+    void updateCubeFace(uint32_t faceIndex) {
+        vk::ClearValue clearValues[2];
+        clearValues[0].color = vkx::clearColor({ 0.0f, 0.0f, 0.0f, 1.0f });
+        clearValues[1].depthStencil = { 1.0f, 0 };
+
+        vk::RenderPassBeginInfo renderPassBeginInfo;
+        // Reuse render pass from example pass
+        renderPassBeginInfo.renderPass = renderPass;
+        renderPassBeginInfo.framebuffer = offScreenFrameBuf.frameBuffer;
+        renderPassBeginInfo.renderArea.extent.width = offScreenFrameBuf.width;
+        renderPassBeginInfo.renderArea.extent.height = offScreenFrameBuf.height;
+        renderPassBeginInfo.clearValueCount = 2;
+        renderPassBeginInfo.pClearValues = clearValues;
+
+        // Update view matrix via push constant
+
+        glm::mat4 viewMatrix = cubeFaceView(faceIndex);
 
         // Render scene from cube face's point of view
         offScreenCmdBuffer.beginRenderPass(renderPassBeginInfo, vk::SubpassContents::eInline);
@@ -412,7 +564,8 @@ public:
         vk::CommandBufferBeginInfo cmdBufInfo;
 
         offScreenCmdBuffer.begin(cmdBufInfo);
-
+        offScreenCmdBuffer.resetQueryPool(timestampQueryPool, 0, 2);
+        offScreenCmdBuffer.writeTimestamp(vk::PipelineStageFlagBits::eTopOfPipe, timestampQueryPool, 0);
 
         vk::Viewport viewport = vkx::viewport((float)offScreenFrameBuf.width, (float)offScreenFrameBuf.height, 0.0f, 1.0f);
         offScreenCmdBuffer.setViewport(0, viewport);
@@ -420,6 +573,34 @@ public:
         vk::Rect2D scissor = vkx::rect2D(offScreenFrameBuf.width, offScreenFrameBuf.height, 0, 0);
         offScreenCmdBuffer.setScissor(0, scissor);
 
+        if (layeredShadows) {
+            // All faces in one pass, the render pass takes care of the layout transitions
+            vk::ClearValue clearValues[2];
+            clearValues[0].color = vkx::clearColor({ 0.0f, 0.0f, 0.0f, 1.0f });
+            clearValues[1].depthStencil = { 1.0f, 0 };
+
+            vk::RenderPassBeginInfo renderPassBeginInfo;
+            renderPassBeginInfo.renderPass = layeredFrameBuf.renderPass;
+            renderPassBeginInfo.framebuffer = layeredFrameBuf.frameBuffer;
+            renderPassBeginInfo.renderArea.extent.width = FB_DIM;
+            renderPassBeginInfo.renderArea.extent.height = FB_DIM;
+            renderPassBeginInfo.clearValueCount = 2;
+            renderPassBeginInfo.pClearValues = clearValues;
+
+            offScreenCmdBuffer.beginRenderPass(renderPassBeginInfo, vk::SubpassContents::eInline);
+            offScreenCmdBuffer.bindPipeline(vk::PipelineBindPoint::eGraphics, pipelines.offscreenLayered);
+            offScreenCmdBuffer.bindDescriptorSets(vk::PipelineBindPoint::eGraphics, pipelineLayouts.scene, 0, descriptorSets.offscreen, nullptr);
+            vk::DeviceSize offsets = 0;
+            offScreenCmdBuffer.bindVertexBuffers(VERTEX_BUFFER_BIND_ID, meshes.scene.vertices.buffer, offsets);
+            offScreenCmdBuffer.bindIndexBuffer(meshes.scene.indices.buffer, 0, vk::IndexType::eUint32);
+            offScreenCmdBuffer.drawIndexed(meshes.scene.indexCount, 1, 0, 0, 0);
+            offScreenCmdBuffer.endRenderPass();
+
+            offScreenCmdBuffer.writeTimestamp(vk::PipelineStageFlagBits::eBottomOfPipe, timestampQueryPool, 1);
+            offScreenCmdBuffer.end();
+            return;
+        }
+
         vk::ImageSubresourceRange subresourceRange;
         subresourceRange.aspectMask = vk::ImageAspectFlagBits::eColor;
         subresourceRange.baseMipLevel = 0;
@@ -448,6 +629,7 @@ public:
             vk::ImageLayout::eShaderReadOnlyOptimal,
             subresourceRange);
 
+        offScreenCmdBuffer.writeTimestamp(vk::PipelineStageFlagBits::eBottomOfPipe, timestampQueryPool, 1);
         offScreenCmdBuffer.end();
 
     }
@@ -572,13 +754,19 @@ public:
     }
 
     void setupDescriptorSetLayout() {
+        // The layered offscreen pass reads the uniform buffer in the geometry shader
+        vk::ShaderStageFlags uboStages = vk::ShaderStageFlagBits::eVertex;
+        if (deviceFeatures.geometryShader) {
+            uboStages |= vk::ShaderStageFlagBits::eGeometry;
+        }
+
         // Shared pipeline layout
         std::vector<vk::DescriptorSetLayoutBinding> setLayoutBindings =
         {
-            // Binding 0 : Vertex shader uniform buffer
+            // Binding 0 : Vertex (and geometry) shader uniform buffer
             vkx::descriptorSetLayoutBinding(
                 vk::DescriptorType::eUniformBuffer,
-                vk::ShaderStageFlagBits::eVertex,
+                uboStages,
                 0),
             // Binding 1 : Fragment shader image sampler (cube map)
             vkx::descriptorSetLayoutBinding(
@@ -723,6 +911,20 @@ public:
         pipelineCreateInfo.layout = pipelineLayouts.offscreen;
         pipelines.offscreen = device.createGraphicsPipelines(pipelineCache, pipelineCreateInfo, nullptr)[0];
 
+        // Layered offscreen pipeline
+        // The geometry shader reads the face matrices from the uniform buffer, so no push constants are needed
+        if (deviceFeatures.geometryShader) {
+            std::array<vk::PipelineShaderStageCreateInfo, 3> layeredShaderStages;
+            layeredShaderStages[0] = loadGlslShader(getAssetPath() + "shaders/shadowmapomni/offscreenlayered.vert", vk::ShaderStageFlagBits::eVertex);
+            layeredShaderStages[1] = loadGlslShader(getAssetPath() + "shaders/shadowmapomni/offscreenlayered.geom", vk::ShaderStageFlagBits::eGeometry);
+            layeredShaderStages[2] = shaderStages[1];
+            pipelineCreateInfo.stageCount = layeredShaderStages.size();
+            pipelineCreateInfo.pStages = layeredShaderStages.data();
+            pipelineCreateInfo.layout = pipelineLayouts.scene;
+            pipelineCreateInfo.renderPass = layeredFrameBuf.renderPass;
+            pipelines.offscreenLayered = device.createGraphicsPipelines(pipelineCache, pipelineCreateInfo, nullptr)[0];
+        }
+
     }
 
     // Prepare and initialize uniform buffer containing shader uniforms
@@ -747,10 +949,7 @@ public:
 
         uboVSscene.lightPos = lightPos;
 
-        void *pData = device.mapMemory(uniformData.scene.memory, 0, sizeof(uboVSscene), vk::MemoryMapFlags());
-
-        memcpy(pData, &uboVSscene, sizeof(uboVSscene));
-        device.unmapMemory(uniformData.scene.memory);
+        uniformData.scene.copy(uboVSscene);
     }
 
     void updateUniformBufferOffscreen() {
@@ -763,10 +962,11 @@ public:
         uboOffscreenVS.model = glm::translate(glm::mat4(), glm::vec3(-lightPos.x, -lightPos.y, -lightPos.z));
 
         uboOffscreenVS.lightPos = lightPos;
+        for (uint32_t face = 0; face < 6; ++face) {
+            uboOffscreenVS.faceViewProjection[face] = uboOffscreenVS.projection * cubeFaceView(face) * uboOffscreenVS.model;
+        }
 
-        void *pData = device.mapMemory(uniformData.offscreen.memory, 0, sizeof(uboOffscreenVS), vk::MemoryMapFlags());
-        memcpy(pData, &uboOffscreenVS, sizeof(uboOffscreenVS));
-        device.unmapMemory(uniformData.offscreen.memory);
+        uniformData.offscreen.copy(uboOffscreenVS);
     }
 
     void prepare() {
@@ -775,6 +975,11 @@ public:
         setupVertexDescriptions();
         prepareUniformBuffers();
         prepareCubeMap();
+        layeredShadows = deviceFeatures.geometryShader == VK_TRUE;
+        if (layeredShadows) {
+            prepareLayeredFramebuffer();
+        }
+        prepareTimestampQueries();
         setupDescriptorSetLayout();
         preparePipelines();
         setupDescriptorPool();
@@ -791,6 +996,9 @@ public:
         vkDeviceWaitIdle(device);
         draw();
         vkDeviceWaitIdle(device);
+        uint64_t timestamps[2];
+        device.getQueryPoolResults(timestampQueryPool, 0, 2, sizeof(timestamps), timestamps, sizeof(uint64_t), vk::QueryResultFlagBits::e64 | vk::QueryResultFlagBits::eWait);
+        shadowPassTime = (float)(timestamps[1] - timestamps[0]) * deviceProperties.limits.timestampPeriod / 1000000.0f;
         if (!paused) {
             updateUniformBufferOffscreen();
             updateUniformBuffers();
@@ -807,11 +1015,34 @@ public:
         reBuildCommandBuffers();
     }
 
+    void toggleLayeredShadows() {
+        if (!pipelines.offscreenLayered) {
+            return;
+        }
+        layeredShadows = !layeredShadows;
+        buildOffscreenCommandBuffer();
+        updateTextOverlay();
+    }
+
     void keyPressed(uint32_t key) override {
         switch (key) {
         case GLFW_KEY_D:
             toggleCubeMapDisplay();
             break;
+        case GLFW_KEY_L:
+            toggleLayeredShadows();
+            break;
+        }
+    }
+
+    void getOverlayText(vkx::TextOverlay *textOverlay) override {
+        std::stringstream ss;
+        ss << std::fixed << std::setprecision(3) << "Shadow pass: " << shadowPassTime << " ms (" << (layeredShadows ? "layered, single pass" : "6 passes + copies") << ")";
+        textOverlay->addText(ss.str(), 5.0f, 85.0f, vkx::TextOverlay::alignLeft);
+        if (pipelines.offscreenLayered) {
+            textOverlay->addText("Press \"L\" to toggle layered rendering", 5.0f, 105.0f, vkx::TextOverlay::alignLeft);
+        } else {
+            textOverlay->addText("Layered rendering requires geometry shaders", 5.0f, 105.0f, vkx::TextOverlay::alignLeft);
         }
     }
 };
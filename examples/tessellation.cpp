@@ -88,11 +88,9 @@ public:
 
         meshes.object.destroy();
 
-        device.destroyBuffer(uniformDataTC.buffer);
-        device.freeMemory(uniformDataTC.memory);
+        uniformDataTC.destroy();
 
-        device.destroyBuffer(uniformDataTE.buffer);
-        device.freeMemory(uniformDataTE.memory);
+        uniformDataTE.destroy();
 
         textures.colorMap.destroy();
     }
@@ -381,14 +379,10 @@ public:
         uboTE.model = glm::rotate(uboTE.model, glm::radians(rotation.y), glm::vec3(0.0f, 1.0f, 0.0f));
         uboTE.model = glm::rotate(uboTE.model, glm::radians(rotation.z), glm::vec3(0.0f, 0.0f, 1.0f));
 
-        void *pData = device.mapMemory(uniformDataTE.memory, 0, sizeof(uboTE), vk::MemoryMapFlags());
-        memcpy(pData, &uboTE, sizeof(uboTE));
-        device.unmapMemory(uniformDataTE.memory);
+        uniformDataTE.copy(uboTE);
 
         // Tessellation control uniform block
-        pData = device.mapMemory(uniformDataTC.memory, 0, sizeof(uboTC), vk::MemoryMapFlags());
-        memcpy(pData, &uboTC, sizeof(uboTC));
-        device.unmapMemory(uniformDataTC.memory);
+        uniformDataTC.copy(uboTC);
     }
 
     void prepare() {
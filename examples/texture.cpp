@@ -85,14 +85,16 @@ public:
         device.destroyPipelineLayout(pipelineLayout);
         device.destroyDescriptorSetLayout(descriptorSetLayout);
 
+        // Allocated with createBuffer, which registered their memory
+        vkx::ResourceRegistry::get().remove(vertices.memory);
         device.destroyBuffer(vertices.buffer);
         device.freeMemory(vertices.memory);
 
+        vkx::ResourceRegistry::get().remove(indices.memory);
         device.destroyBuffer(indices.buffer);
         device.freeMemory(indices.memory);
 
-        device.destroyBuffer(uniformDataVS.buffer);
-        device.freeMemory(uniformDataVS.memory);
+        uniformDataVS.destroy();
     }
 
     // Create an image memory barrier for changing the layout of
@@ -663,9 +665,7 @@ public:
 
         uboVS.viewPos = glm::vec4(0.0f, 0.0f, -zoom, 0.0f);
 
-        void *pData = device.mapMemory(uniformDataVS.memory, 0, sizeof(uboVS), vk::MemoryMapFlags());
-        memcpy(pData, &uboVS, sizeof(uboVS));
-        device.unmapMemory(uniformDataVS.memory);
+        uniformDataVS.copy(uboVS);
     }
 
     void prepare() {
@@ -11,23 +11,52 @@
 */
 
 #include "vulkanExampleBase.h"
+#include "vulkanSceneBatcher.h"
+#include "shapes.h"
 
 static std::vector<std::string> names{ "logos", "background", "models", "skybox" };
 
+// Number of meshes in the synthetic scene used for benchmarking the batching
+#define SYNTHETIC_MESH_COUNT 10000
+
+// One batch (i.e. one indirect draw) per pipeline
+enum Batch {
+    BATCH_SKYBOX = 0,
+    BATCH_LOGOS = 1,
+    BATCH_MODELS = 2,
+};
+
 class VulkanExample : public vkx::ExampleBase {
 public:
 
+    struct Vertex {
+        float pos[3];
+        float normal[3];
+        float uv[2];
+        float color[3];
+    };
+
+    // Per draw data, fetched by the vertex shaders with the first instance as index
+    struct DrawData {
+        glm::mat4 model;
+    };
+
     struct DemoMeshes {
         vk::PipelineVertexInputStateCreateInfo inputState;
         std::vector<vk::VertexInputBindingDescription> bindingDescriptions;
         std::vector<vk::VertexInputAttributeDescription> attributeDescriptions;
-        vk::Pipeline pipeline;
-        vkx::MeshLoader* logos;
-        vkx::MeshLoader* background;
-        vkx::MeshLoader* models;
-        vkx::MeshLoader* skybox;
     } demoMeshes;
-    std::vector<vkx::MeshLoader*> meshes;
+
+    // All static meshes of the scene in one arena, drawn with one indirect draw per pipeline
+    vkx::SceneBatcher sceneBatcher{ *this, sizeof(Vertex), sizeof(DrawData) };
+    // Many small meshes for comparing batched and unbatched command buffers, built on demand
+    vkx::SceneBatcher syntheticBatcher{ *this, sizeof(Vertex), sizeof(DrawData) };
+    bool syntheticScene = false;
+    bool batched = true;
+
+    // Draw calls and CPU time of the last command buffer build
+    uint32_t drawCalls = 0;
+    float recordTime = 0.0f;
 
     struct {
         vkx::UniformData meshVS;
@@ -52,7 +81,10 @@ public:
     } pipelines;
 
     vk::PipelineLayout pipelineLayout;
-    vk::DescriptorSet descriptorSet;
+    struct {
+        vk::DescriptorSet scene;
+        vk::DescriptorSet synthetic;
+    } descriptorSets;
     vk::DescriptorSetLayout descriptorSetLayout;
 
     glm::vec4 lightPos = glm::vec4(1.0f, 2.0f, 0.0f, 0.0f);
@@ -64,6 +96,7 @@ public:
         rotationSpeed = 0.5f;
         rotation = glm::vec3(15.0f, 0.f, 0.0f);
         title = "Vulkan Demo Scene - � 2016 by Sascha Willems";
+        enableTextOverlay = true;
     }
 
     ~VulkanExample() {
@@ -78,27 +111,46 @@ public:
 
         uniformData.meshVS.destroy();
 
-        for (auto& mesh : meshes) {
-            device.destroyBuffer(mesh->vertexBuffer.buf);
-            device.freeMemory(mesh->vertexBuffer.mem);
-
-            device.destroyBuffer(mesh->indexBuffer.buf);
-            device.freeMemory(mesh->indexBuffer.mem);
-        }
+        sceneBatcher.destroy();
+        syntheticBatcher.destroy();
 
         textures.skybox.destroy();
-
-        delete(demoMeshes.logos);
-        delete(demoMeshes.background);
-        delete(demoMeshes.models);
-        delete(demoMeshes.skybox);
     }
 
     void loadTextures() {
         textures.skybox = textureLoader->loadCubemap(getAssetPath() + "textures/cubemap_vulkan.ktx", vk::Format::eR8G8B8A8Unorm);
     }
 
+    vk::Pipeline batchPipeline(uint32_t batch) {
+        switch (batch) {
+        case BATCH_SKYBOX:
+            return pipelines.skybox;
+        case BATCH_LOGOS:
+            return pipelines.logos;
+        default:
+            return pipelines.models;
+        }
+    }
+
+    void drawBatches(const vk::CommandBuffer& cmdBuffer, vkx::SceneBatcher& batcher, std::initializer_list<uint32_t> batches) {
+        if (!batched) {
+            for (auto batch : batches) {
+                batcher.drawBatchUnbatched(cmdBuffer, batch, VERTEX_BUFFER_BIND_ID, batchPipeline(batch));
+            }
+            return;
+        }
+        batcher.bindBuffers(cmdBuffer, VERTEX_BUFFER_BIND_ID);
+        for (auto batch : batches) {
+            cmdBuffer.bindPipeline(vk::PipelineBindPoint::eGraphics, batchPipeline(batch));
+            batcher.drawBatch(cmdBuffer, batch);
+        }
+    }
+
     void buildCommandBuffers() {
+        auto tStart = std::chrono::high_resolution_clock::now();
+        sceneBatcher.resetStats();
+        syntheticBatcher.resetStats();
+
         vk::CommandBufferBeginInfo cmdBufInfo;
 
         vk::ClearValue clearValues[2];
@@ -126,14 +178,15 @@ public:
             vk::Rect2D scissor = vkx::rect2D(width, height, 0, 0);
             drawCmdBuffers[i].setScissor(0, scissor);
 
-            drawCmdBuffers[i].bindDescriptorSets(vk::PipelineBindPoint::eGraphics, pipelineLayout, 0, descriptorSet, nullptr);
+            // Skybox first because of depth writes
+            drawCmdBuffers[i].bindDescriptorSets(vk::PipelineBindPoint::eGraphics, pipelineLayout, 0, descriptorSets.scene, nullptr);
+            drawBatches(drawCmdBuffers[i], sceneBatcher, { BATCH_SKYBOX });
 
-            vk::DeviceSize offsets = 0;
-            for (auto& mesh : meshes) {
-                drawCmdBuffers[i].bindPipeline(vk::PipelineBindPoint::eGraphics, mesh->pipeline);
-                drawCmdBuffers[i].bindVertexBuffers(VERTEX_BUFFER_BIND_ID, mesh->vertexBuffer.buf, offsets);
-                drawCmdBuffers[i].bindIndexBuffer(mesh->indexBuffer.buf, 0, vk::IndexType::eUint32);
-                drawCmdBuffers[i].drawIndexed(mesh->indexBuffer.count, 1, 0, 0, 0);
+            if (syntheticScene) {
+                drawCmdBuffers[i].bindDescriptorSets(vk::PipelineBindPoint::eGraphics, pipelineLayout, 0, descriptorSets.synthetic, nullptr);
+                drawBatches(drawCmdBuffers[i], syntheticBatcher, { BATCH_MODELS });
+            } else {
+                drawBatches(drawCmdBuffers[i], sceneBatcher, { BATCH_LOGOS, BATCH_MODELS });
             }
 
             drawCmdBuffers[i].endRenderPass();
@@ -141,84 +194,72 @@ public:
             drawCmdBuffers[i].end();
 
         }
+
+        auto tEnd = std::chrono::high_resolution_clock::now();
+        recordTime = (float)std::chrono::duration<double, std::milli>(tEnd - tStart).count() / drawCmdBuffers.size();
+        drawCalls = (sceneBatcher.drawCalls + syntheticBatcher.drawCalls) / (uint32_t)drawCmdBuffers.size();
+        if (verbose) {
+            std::cout << std::fixed << std::setprecision(3) << (syntheticScene ? syntheticBatcher.meshCount() : sceneBatcher.meshCount()) << " meshes, "
+                << (batched ? "batched" : "unbatched") << ": " << drawCalls << " draw calls, " << recordTime << " ms per command buffer" << std::endl;
+        }
     }
 
-    void prepareVertices() {
-        struct Vertex {
-            float pos[3];
-            float normal[3];
-            float uv[2];
-            float color[3];
-        };
+    void appendVertices(const vkx::MeshLoader& mesh, std::vector<Vertex>& vertexBuffer, std::vector<uint32_t>& indexBuffer) {
+        for (int m = 0; m < mesh.m_Entries.size(); m++) {
+            uint32_t vertexBase = (uint32_t)vertexBuffer.size();
+            for (int i = 0; i < mesh.m_Entries[m].Vertices.size(); i++) {
+                glm::vec3 pos = mesh.m_Entries[m].Vertices[i].m_pos;
+                glm::vec3 normal = mesh.m_Entries[m].Vertices[i].m_normal;
+                glm::vec2 uv = mesh.m_Entries[m].Vertices[i].m_tex;
+                glm::vec3 col = mesh.m_Entries[m].Vertices[i].m_color;
+                Vertex vert = {
+                    { pos.x, pos.y, pos.z },
+                    { normal.x, -normal.y, normal.z },
+                    { uv.s, uv.t },
+                    { col.r, col.g, col.b }
+                };
+                vertexBuffer.push_back(vert);
+            }
+            for (int i = 0; i < mesh.m_Entries[m].Indices.size(); i++) {
+                indexBuffer.push_back(mesh.m_Entries[m].Indices[i] + vertexBase);
+            }
+        }
+    }
 
+    void prepareVertices() {
         // Load meshes for demos scene
-        demoMeshes.logos = new vkx::MeshLoader();
-        demoMeshes.background = new vkx::MeshLoader();
-        demoMeshes.models = new vkx::MeshLoader();
-        demoMeshes.skybox = new vkx::MeshLoader();
+        struct SceneMesh {
+            std::string filename;
+            uint32_t batch;
+        };
+        std::vector<SceneMesh> sceneMeshes = {
+            { "models/cube.obj", BATCH_SKYBOX },
+            { "models/vulkanscenelogos.dae", BATCH_LOGOS },
+            { "models/vulkanscenebackground.dae", BATCH_MODELS },
+            { "models/vulkanscenemodels.dae", BATCH_MODELS },
+        };
 
+        for (const auto& sceneMesh : sceneMeshes) {
+            vkx::MeshLoader mesh;
 #if defined(__ANDROID__)
-        demoMeshes.logos->assetManager = androidApp->activity->assetManager;
-        demoMeshes.background->assetManager = androidApp->activity->assetManager;
-        demoMeshes.models->assetManager = androidApp->activity->assetManager;
-        demoMeshes.skybox->assetManager = androidApp->activity->assetManager;
+            mesh.assetManager = androidApp->activity->assetManager;
 #endif
+            mesh.load(getAssetPath() + sceneMesh.filename);
 
-        demoMeshes.logos->load(getAssetPath() + "models/vulkanscenelogos.dae");
-        demoMeshes.background->load(getAssetPath() + "models/vulkanscenebackground.dae");
-        demoMeshes.models->load(getAssetPath() + "models/vulkanscenemodels.dae");
-        demoMeshes.skybox->load(getAssetPath() + "models/cube.obj");
-
-        std::vector<vkx::MeshLoader*> meshList;
-        meshList.push_back(demoMeshes.skybox); // skybox first because of depth writes
-        meshList.push_back(demoMeshes.logos);
-        meshList.push_back(demoMeshes.background);
-        meshList.push_back(demoMeshes.models);
-
-        // todo : Use mesh function for loading
-        float scale = 1.0f;
-        for (auto& mesh : meshList) {
             // Generate vertex buffer (pos, normal, uv, color)
             std::vector<Vertex> vertexBuffer;
-            for (int m = 0; m < mesh->m_Entries.size(); m++) {
-                for (int i = 0; i < mesh->m_Entries[m].Vertices.size(); i++) {
-                    glm::vec3 pos = mesh->m_Entries[m].Vertices[i].m_pos * scale;
-                    glm::vec3 normal = mesh->m_Entries[m].Vertices[i].m_normal;
-                    glm::vec2 uv = mesh->m_Entries[m].Vertices[i].m_tex;
-                    glm::vec3 col = mesh->m_Entries[m].Vertices[i].m_color;
-                    Vertex vert = {
-                        { pos.x, pos.y, pos.z },
-                        { normal.x, -normal.y, normal.z },
-                        { uv.s, uv.t },
-                        { col.r, col.g, col.b }
-                    };
-
-                    // Offset Vulkan meshes
-                    // todo : center before export
-                    if (mesh != demoMeshes.skybox) {
-                        vert.pos[1] += 1.15f;
-                    }
-
-                    vertexBuffer.push_back(vert);
-                }
-            }
-            auto result = createBuffer(vk::BufferUsageFlagBits::eVertexBuffer, vertexBuffer);
-            mesh->vertexBuffer.buf = result.buffer;
-            mesh->vertexBuffer.mem = result.memory;
             std::vector<uint32_t> indexBuffer;
-            for (int m = 0; m < mesh->m_Entries.size(); m++) {
-                int indexBase = indexBuffer.size();
-                for (int i = 0; i < mesh->m_Entries[m].Indices.size(); i++) {
-                    indexBuffer.push_back(mesh->m_Entries[m].Indices[i] + indexBase);
-                }
-            }
-            result = createBuffer(vk::BufferUsageFlagBits::eVertexBuffer, indexBuffer);
-            mesh->indexBuffer.buf = result.buffer;
-            mesh->indexBuffer.mem = result.memory;
-            mesh->indexBuffer.count = indexBuffer.size();
+            appendVertices(mesh, vertexBuffer, indexBuffer);
 
-            meshes.push_back(mesh);
+            // Offset Vulkan meshes
+            // todo : center before export
+            DrawData drawData;
+            if (sceneMesh.batch != BATCH_SKYBOX) {
+                drawData.model = glm::translate(glm::mat4(), glm::vec3(0.0f, 1.15f, 0.0f));
+            }
+            sceneBatcher.addDraw(sceneBatcher.addMesh(vertexBuffer, indexBuffer), sceneMesh.batch, drawData);
         }
+        sceneBatcher.build();
 
         // Binding description
         demoMeshes.bindingDescriptions.resize(1);
@@ -247,11 +288,13 @@ public:
     }
 
     void setupDescriptorPool() {
-        // Example uses one ubo and one image sampler
+        // Example uses one ubo, one image sampler and one draw data buffer
+        // per set, with one set for the scene and one for the synthetic scene
         std::vector<vk::DescriptorPoolSize> poolSizes =
         {
             vkx::descriptorPoolSize(vk::DescriptorType::eUniformBuffer, 2),
-            vkx::descriptorPoolSize(vk::DescriptorType::eCombinedImageSampler, 1)
+            vkx::descriptorPoolSize(vk::DescriptorType::eCombinedImageSampler, 2),
+            vkx::descriptorPoolSize(vk::DescriptorType::eStorageBuffer, 2)
         };
 
         vk::DescriptorPoolCreateInfo descriptorPoolInfo =
@@ -272,7 +315,12 @@ public:
             vkx::descriptorSetLayoutBinding(
                 vk::DescriptorType::eCombinedImageSampler,
                 vk::ShaderStageFlagBits::eFragment,
-                1)
+                1),
+            // Binding 2 : Vertex shader per draw data
+            vkx::descriptorSetLayoutBinding(
+                vk::DescriptorType::eStorageBuffer,
+                vk::ShaderStageFlagBits::eVertex,
+                2)
         };
 
         vk::DescriptorSetLayoutCreateInfo descriptorLayout =
@@ -288,16 +336,18 @@ public:
 
     }
 
-    void setupDescriptorSet() {
+    vk::DescriptorSet setupDescriptorSet(const vkx::SceneBatcher& batcher) {
         vk::DescriptorSetAllocateInfo allocInfo =
             vkx::descriptorSetAllocateInfo(descriptorPool, &descriptorSetLayout, 1);
 
-        descriptorSet = device.allocateDescriptorSets(allocInfo)[0];
+        vk::DescriptorSet descriptorSet = device.allocateDescriptorSets(allocInfo)[0];
 
         // Cube map image descriptor
         vk::DescriptorImageInfo texDescriptorCubeMap =
             vkx::descriptorImageInfo(textures.skybox.sampler, textures.skybox.view, vk::ImageLayout::eGeneral);
 
+        vk::DescriptorBufferInfo drawDataDescriptor = batcher.drawDataDescriptor();
+
         std::vector<vk::WriteDescriptorSet> writeDescriptorSets =
         {
             // Binding 0 : Vertex shader uniform buffer
@@ -311,10 +361,17 @@ public:
                 descriptorSet,
                 vk::DescriptorType::eCombinedImageSampler,
                 1,
-                &texDescriptorCubeMap)
+                &texDescriptorCubeMap),
+            // Binding 2 : Vertex shader per draw data
+            vkx::writeDescriptorSet(
+                descriptorSet,
+                vk::DescriptorType::eStorageBuffer,
+                2,
+                &drawDataDescriptor)
         };
 
         device.updateDescriptorSets(writeDescriptorSets, nullptr);
+        return descriptorSet;
     }
 
     void preparePipelines() {
@@ -355,7 +412,7 @@ public:
         // vk::Pipeline for the meshes (armadillo, bunny, etc.)
         // Load shaders
         std::array<vk::PipelineShaderStageCreateInfo, 2> shaderStages;
-        shaderStages[0] = loadShader(getAssetPath() + "shaders/vulkanscene/mesh.vert.spv", vk::ShaderStageFlagBits::eVertex);
+        shaderStages[0] = loadGlslShader(getAssetPath() + "shaders/vulkanscene/mesh.vert", vk::ShaderStageFlagBits::eVertex);
         shaderStages[1] = loadShader(getAssetPath() + "shaders/vulkanscene/mesh.frag.spv", vk::ShaderStageFlagBits::eFragment);
 
         vk::GraphicsPipelineCreateInfo pipelineCreateInfo =
@@ -376,7 +433,7 @@ public:
 
 
         // vk::Pipeline for the logos
-        shaderStages[0] = loadShader(getAssetPath() + "shaders/vulkanscene/logo.vert.spv", vk::ShaderStageFlagBits::eVertex);
+        shaderStages[0] = loadGlslShader(getAssetPath() + "shaders/vulkanscene/logo.vert", vk::ShaderStageFlagBits::eVertex);
         shaderStages[1] = loadShader(getAssetPath() + "shaders/vulkanscene/logo.frag.spv", vk::ShaderStageFlagBits::eFragment);
         pipelines.logos = device.createGraphicsPipelines(pipelineCache, pipelineCreateInfo, nullptr)[0];
 
@@ -389,11 +446,6 @@ public:
         pipelines.skybox = device.createGraphicsPipelines(pipelineCache, pipelineCreateInfo, nullptr)[0];
 
 
-        // Assign pipelines
-        demoMeshes.logos->pipeline = pipelines.logos;
-        demoMeshes.models->pipeline = pipelines.models;
-        demoMeshes.background->pipeline = pipelines.models;
-        demoMeshes.skybox->pipeline = pipelines.skybox;
     }
 
     // Prepare and initialize uniform buffer containing shader uniforms
@@ -421,9 +473,7 @@ public:
 
         uboVS.lightPos = lightPos;
 
-        void *pData = device.mapMemory(uniformData.meshVS.memory, 0, sizeof(uboVS), vk::MemoryMapFlags());
-        memcpy(pData, &uboVS, sizeof(uboVS));
-        device.unmapMemory(uniformData.meshVS.memory);
+        uniformData.meshVS.copy(uboVS);
     }
 
     void prepare() {
@@ -434,7 +484,7 @@ public:
         setupDescriptorSetLayout();
         preparePipelines();
         setupDescriptorPool();
-        setupDescriptorSet();
+        descriptorSets.scene = setupDescriptorSet(sceneBatcher);
         buildCommandBuffers();
         prepared = true;
     }
@@ -451,6 +501,95 @@ public:
         updateUniformBuffers();
     }
 
+    // Grid of small meshes with random shapes and proportions, every one with
+    // its own geometry in the arena
+    void prepareSyntheticScene() {
+        std::vector<geometry::Solid<3>> solids = {
+            geometry::tetrahedron(),
+            geometry::triangulate(geometry::cube()),
+            geometry::octahedron(),
+            geometry::triangulate(geometry::dodecahedron()),
+            geometry::icosahedron(),
+        };
+
+        uint32_t gridSize = (uint32_t)ceil(sqrt((float)SYNTHETIC_MESH_COUNT));
+        float spacing = 6.0f / gridSize;
+        std::vector<Vertex> vertexBuffer;
+        std::vector<uint32_t> indexBuffer;
+        for (uint32_t m = 0; m < SYNTHETIC_MESH_COUNT; ++m) {
+            const auto& solid = solids[rand() % solids.size()];
+            glm::vec3 proportions = glm::vec3(0.5f) + glm::vec3(rand(), rand(), rand()) / (float)RAND_MAX;
+            glm::vec3 color = glm::vec3(0.3f) + 0.7f * glm::vec3(rand(), rand(), rand()) / (float)RAND_MAX;
+
+            vertexBuffer.clear();
+            indexBuffer.clear();
+            for (size_t f = 0; f < solid.faces.size(); ++f) {
+                const auto& face = solid.faces[f];
+                glm::vec3 normal = solid.getFaceNormal(f);
+                // Same winding as the indirect example
+                for (size_t v : { 0, 2, 1 }) {
+                    glm::vec3 pos = solid.vertices[face[v]] * proportions;
+                    indexBuffer.push_back((uint32_t)vertexBuffer.size());
+                    vertexBuffer.push_back({
+                        { pos.x, pos.y, pos.z },
+                        { normal.x, -normal.y, normal.z },
+                        { 0.0f, 0.0f },
+                        { color.r, color.g, color.b }
+                    });
+                }
+            }
+            uint32_t mesh = syntheticBatcher.addMesh(vertexBuffer, indexBuffer);
+
+            DrawData drawData;
+            glm::vec3 pos = glm::vec3((m % gridSize) * spacing - 3.0f, 0.0f, (m / gridSize) * spacing - 3.0f);
+            drawData.model = glm::translate(glm::mat4(), pos);
+            drawData.model = glm::rotate(drawData.model, glm::radians((float)rand() / RAND_MAX * 360.0f), glm::vec3(0.0f, 1.0f, 0.0f));
+            drawData.model = glm::scale(drawData.model, glm::vec3(spacing * 0.35f));
+            syntheticBatcher.addDraw(mesh, BATCH_MODELS, drawData);
+        }
+        syntheticBatcher.build();
+        descriptorSets.synthetic = setupDescriptorSet(syntheticBatcher);
+    }
+
+    void toggleSyntheticScene() {
+        if (!descriptorSets.synthetic) {
+            prepareSyntheticScene();
+        }
+        syntheticScene = !syntheticScene;
+        buildCommandBuffers();
+        updateTextOverlay();
+    }
+
+    void toggleBatching() {
+        batched = !batched;
+        buildCommandBuffers();
+        updateTextOverlay();
+    }
+
+    void keyPressed(uint32_t key) override {
+        switch (key) {
+        case GLFW_KEY_S:
+        case GAMEPAD_BUTTON_A:
+            toggleSyntheticScene();
+            break;
+        case GLFW_KEY_B:
+        case GAMEPAD_BUTTON_X:
+            toggleBatching();
+            break;
+        }
+    }
+
+    void getOverlayText(vkx::TextOverlay *textOverlay) override {
+        std::stringstream ss;
+        ss << std::fixed << std::setprecision(3);
+        ss << (syntheticScene ? syntheticBatcher.meshCount() : sceneBatcher.meshCount()) << " meshes, " << (batched ? "multi draw indirect" : "one draw per mesh");
+        textOverlay->addText(ss.str(), 5.0f, 85.0f, vkx::TextOverlay::alignLeft);
+        ss.str("");
+        ss << drawCalls << " draw calls, " << recordTime << " ms CPU per command buffer";
+        textOverlay->addText(ss.str(), 5.0f, 105.0f, vkx::TextOverlay::alignLeft);
+        textOverlay->addText("Press \"S\" to toggle the synthetic scene, \"B\" to toggle batching", 5.0f, 125.0f, vkx::TextOverlay::alignLeft);
+    }
+
 };
 
 RUN_EXAMPLE(VulkanExample)
@@ -0,0 +1,426 @@
+/*
+* Asset pack tool
+*
+* Builds, lists and benchmarks the asset packs read by vkx::AssetPack
+*
+*   assetpack build <data folder> <pack file> [--lz4 auto|all|none] [--mips box|kaiser]
+*   assetpack list <pack file>
+*   assetpack bench <pack file> <data folder> [--cold]
+*
+* With --lz4 auto (the default) KTX textures and SPIR-V shaders are stored uncompressed
+* so they can be used straight from the mapping, all other files are compressed if that
+* saves at least 10%.
+*
+* --mips bakes the mip chain of 8 bit RGBA KTX textures stored with a single level, so
+* they don't have to be generated at load time.
+*
+* This code is licensed under the MIT license (MIT) (http://opensource.org/licenses/MIT)
+*/
+
+#include <stdint.h>
+#include <string.h>
+
+#include <algorithm>
+#include <chrono>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#if defined(_WIN32)
+#include <windows.h>
+#else
+#include <dirent.h>
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+#include "vulkanAssetPack.h"
+#include "vulkanMipmaps.h"
+#include "vulkanTools.h"
+
+namespace lz4 {
+    static const size_t MINMATCH = 4;
+    // The last 5 bytes are always literals
+    static const size_t LASTLITERALS = 5;
+    // The last match has to start at least 12 bytes before the end of the block
+    static const size_t MFLIMIT = 12;
+    static const size_t MAX_DISTANCE = 65535;
+    static const uint32_t HASH_BITS = 16;
+
+    void writeLength(std::vector<uint8_t>& out, size_t length) {
+        while (length >= 255) {
+            out.push_back(255);
+            length -= 255;
+        }
+        out.push_back((uint8_t)length);
+    }
+
+    void writeSequence(std::vector<uint8_t>& out, const uint8_t* literals, size_t literalLength, size_t offset, size_t matchLength) {
+        uint8_t token = (uint8_t)(std::min<size_t>(literalLength, 15) << 4);
+        if (matchLength) {
+            token |= (uint8_t)std::min<size_t>(matchLength - MINMATCH, 15);
+        }
+        out.push_back(token);
+        if (literalLength >= 15) {
+            writeLength(out, literalLength - 15);
+        }
+        out.insert(out.end(), literals, literals + literalLength);
+        if (matchLength) {
+            out.push_back((uint8_t)(offset & 0xFF));
+            out.push_back((uint8_t)(offset >> 8));
+            if (matchLength - MINMATCH >= 15) {
+                writeLength(out, matchLength - MINMATCH - 15);
+            }
+        }
+    }
+
+    uint32_t read32(const uint8_t* ptr) {
+        uint32_t value;
+        memcpy(&value, ptr, sizeof(value));
+        return value;
+    }
+
+    // Greedy compressor producing a raw LZ4 block, compatible with vkx::pack::lz4Decompress
+    std::vector<uint8_t> compress(const std::vector<uint8_t>& input) {
+        const uint8_t* src = input.data();
+        const size_t size = input.size();
+        std::vector<uint8_t> out;
+        out.reserve(size + size / 255 + 16);
+
+        size_t anchor = 0;
+        if (size > MFLIMIT) {
+            std::vector<int64_t> table(1 << HASH_BITS, -1);
+            const size_t matchLimit = size - LASTLITERALS;
+            const size_t lastMatchStart = size - MFLIMIT;
+            size_t ip = 0;
+            while (ip <= lastMatchStart) {
+                uint32_t sequence = read32(src + ip);
+                uint32_t hash = (sequence * 2654435761U) >> (32 - HASH_BITS);
+                int64_t ref = table[hash];
+                table[hash] = (int64_t)ip;
+                if (ref < 0 || ip - (size_t)ref > MAX_DISTANCE || read32(src + ref) != sequence) {
+                    ++ip;
+                    continue;
+                }
+                size_t matchLength = MINMATCH;
+                while (ip + matchLength < matchLimit && src[ref + matchLength] == src[ip + matchLength]) {
+                    ++matchLength;
+                }
+                writeSequence(out, src + anchor, ip - anchor, ip - (size_t)ref, matchLength);
+                ip += matchLength;
+                anchor = ip;
+            }
+        }
+        writeSequence(out, src + anchor, size - anchor, 0, 0);
+        return out;
+    }
+}
+
+namespace {
+    struct InputFile {
+        std::string name;
+        std::vector<uint8_t> data;
+        uint64_t size{ 0 };
+        uint16_t flags{ 0 };
+    };
+
+    enum class Compression { Auto, All, None };
+
+    bool hasExtension(const std::string& name, const std::string& extension) {
+        return name.size() >= extension.size() && name.compare(name.size() - extension.size(), extension.size(), extension) == 0;
+    }
+
+    void listFiles(const std::string& root, const std::string& relative, std::vector<std::string>& result) {
+        std::string dir = relative.empty() ? root : root + "/" + relative;
+#if defined(_WIN32)
+        WIN32_FIND_DATAA findData;
+        HANDLE find = FindFirstFileA((dir + "/*").c_str(), &findData);
+        if (find == INVALID_HANDLE_VALUE) {
+            throw std::runtime_error("Could not open " + dir);
+        }
+        do {
+            std::string name = findData.cFileName;
+            bool isDirectory = (findData.dwFileAttributes & FILE_ATTRIBUTE_DIRECTORY) != 0;
+#else
+        DIR* find = opendir(dir.c_str());
+        if (!find) {
+            throw std::runtime_error("Could not open " + dir);
+        }
+        while (dirent* entry = readdir(find)) {
+            std::string name = entry->d_name;
+            struct stat fileStat;
+            stat((dir + "/" + name).c_str(), &fileStat);
+            bool isDirectory = S_ISDIR(fileStat.st_mode);
+#endif
+            if (name == "." || name == "..") {
+                continue;
+            }
+            std::string path = relative.empty() ? name : relative + "/" + name;
+            if (isDirectory) {
+                listFiles(root, path, result);
+            } else if (!hasExtension(name, ".pack")) {
+                result.push_back(path);
+            }
+#if defined(_WIN32)
+        } while (FindNextFileA(find, &findData));
+        FindClose(find);
+#else
+        }
+        closedir(find);
+#endif
+    }
+
+    std::vector<uint8_t> readFile(const std::string& filename) {
+        std::ifstream file(filename, std::ios::binary | std::ios::ate);
+        if (!file.is_open()) {
+            throw std::runtime_error("Could not open " + filename);
+        }
+        std::vector<uint8_t> data((size_t)file.tellg());
+        file.seekg(0);
+        file.read((char*)data.data(), data.size());
+        return data;
+    }
+
+    // Returns a KTX file with the complete mip chain if the texture is a single level 8 bit RGBA
+    // 2D texture, an empty vector otherwise
+    std::vector<uint8_t> bakeMips(const std::vector<uint8_t>& data, vkx::mipmap::Filter filter) {
+        static const uint32_t GL_RGBA8 = 0x8058;
+        static const uint32_t GL_SRGB8_ALPHA8 = 0x8C43;
+        static const size_t HEADER_SIZE = 64;
+        vkx::KtxView ktx(data.data(), data.size());
+        const uint32_t* header = (const uint32_t*)(data.data() + 12);
+        uint32_t internalFormat = header[4];
+        if ((internalFormat != GL_RGBA8 && internalFormat != GL_SRGB8_ALPHA8) || ktx.levels != 1 || ktx.layers != 1 || ktx.faces != 1 || ktx.depth != 1) {
+            return {};
+        }
+        std::vector<uint8_t> levels = vkx::mipmap::generateRGBA8(ktx.image(0, 0, 0), ktx.width, ktx.height, internalFormat == GL_SRGB8_ALPHA8, filter);
+        uint32_t levelCount = vkx::mipLevelCount(ktx.width, ktx.height);
+
+        // Same header without key / value data
+        std::vector<uint8_t> result(data.begin(), data.begin() + HEADER_SIZE);
+        uint32_t* resultHeader = (uint32_t*)(result.data() + 12);
+        resultHeader[11] = levelCount;
+        resultHeader[12] = 0;
+        size_t offset = 0;
+        for (uint32_t level = 0; level < levelCount; ++level) {
+            // RGBA8 rows and images are always 4 byte aligned, no padding needed
+            uint32_t imageSize = std::max(ktx.width >> level, 1u) * std::max(ktx.height >> level, 1u) * 4;
+            result.insert(result.end(), (const uint8_t*)&imageSize, (const uint8_t*)&imageSize + sizeof(imageSize));
+            result.insert(result.end(), levels.begin() + offset, levels.begin() + offset + imageSize);
+            offset += imageSize;
+        }
+        return result;
+    }
+
+    uint64_t align(uint64_t value) {
+        return (value + vkx::pack::ALIGNMENT - 1) & ~(vkx::pack::ALIGNMENT - 1);
+    }
+
+    void build(const std::string& dataDir, const std::string& packFile, Compression compression, bool mips, vkx::mipmap::Filter mipFilter) {
+        std::vector<std::string> names;
+        listFiles(dataDir, "", names);
+        std::sort(names.begin(), names.end());
+
+        std::vector<InputFile> files(names.size());
+        uint64_t totalSize = 0, storedSize = 0;
+        for (size_t i = 0; i < names.size(); ++i) {
+            InputFile& file = files[i];
+            file.name = names[i];
+            if (file.name.size() > UINT16_MAX) {
+                throw std::runtime_error("File name too long: " + file.name);
+            }
+            file.data = readFile(dataDir + "/" + file.name);
+            if (mips && hasExtension(file.name, ".ktx")) {
+                std::vector<uint8_t> baked = bakeMips(file.data, mipFilter);
+                if (!baked.empty()) {
+                    std::cout << "Baked mip chain of " << file.name << std::endl;
+                    file.data.swap(baked);
+                }
+            }
+            file.size = file.data.size();
+            totalSize += file.size;
+
+            bool mappable = hasExtension(file.name, ".ktx") || hasExtension(file.name, ".spv");
+            if (compression == Compression::None || file.data.empty() || (compression == Compression::Auto && mappable)) {
+                storedSize += file.data.size();
+                continue;
+            }
+            std::vector<uint8_t> compressed = lz4::compress(file.data);
+            float ratio = compression == Compression::Auto ? 0.9f : 1.0f;
+            if (compressed.size() < file.data.size() * ratio) {
+                file.data.swap(compressed);
+                file.flags |= vkx::pack::ENTRY_LZ4;
+            }
+            storedSize += file.data.size();
+        }
+
+        vkx::pack::Header header;
+        memcpy(header.magic, vkx::pack::MAGIC, sizeof(header.magic));
+        header.version = vkx::pack::VERSION;
+        header.entryCount = (uint32_t)files.size();
+        header.tocOffset = align(sizeof(header));
+        header.namesOffset = header.tocOffset + files.size() * sizeof(vkx::pack::Entry);
+
+        std::vector<vkx::pack::Entry> entries(files.size());
+        std::string nameData;
+        for (size_t i = 0; i < files.size(); ++i) {
+            entries[i].nameOffset = (uint32_t)nameData.size();
+            entries[i].nameLength = (uint16_t)files[i].name.size();
+            nameData += files[i].name;
+        }
+        header.namesSize = nameData.size();
+
+        uint64_t offset = align(header.namesOffset + header.namesSize);
+        for (size_t i = 0; i < files.size(); ++i) {
+            entries[i].offset = offset;
+            entries[i].storedSize = files[i].data.size();
+            entries[i].flags = files[i].flags;
+            entries[i].size = files[i].size;
+            offset = align(offset + entries[i].storedSize);
+        }
+
+        std::ofstream out(packFile, std::ios::binary);
+        if (!out.is_open()) {
+            throw std::runtime_error("Could not create " + packFile);
+        }
+        auto padTo = [&](uint64_t target) {
+            static const char zeros[vkx::pack::ALIGNMENT] = {};
+            out.write(zeros, target - (uint64_t)out.tellp());
+        };
+        out.write((const char*)&header, sizeof(header));
+        padTo(header.tocOffset);
+        out.write((const char*)entries.data(), entries.size() * sizeof(vkx::pack::Entry));
+        out.write(nameData.data(), nameData.size());
+        for (size_t i = 0; i < files.size(); ++i) {
+            padTo(entries[i].offset);
+            out.write((const char*)files[i].data.data(), files[i].data.size());
+        }
+        padTo(offset);
+
+        std::cout << "Packed " << files.size() << " files, " << totalSize / 1024 << " KB -> " << storedSize / 1024 << " KB into " << packFile << std::endl;
+    }
+
+    void list(const std::string& packFile) {
+        vkx::AssetPack pack;
+        pack.open(packFile);
+        for (const auto& entry : pack.entries()) {
+            std::cout << std::setw(12) << entry.size << std::setw(12) << entry.storedSize << ((entry.flags & vkx::pack::ENTRY_LZ4) ? "  lz4  " : "       ") << pack.name(entry) << std::endl;
+        }
+    }
+
+    // Drops the file from the page cache so the next read has to go to the disk
+    void evict(const std::string& filename) {
+#if defined(__linux__)
+        int fd = open(filename.c_str(), O_RDONLY);
+        if (fd >= 0) {
+            fdatasync(fd);
+            posix_fadvise(fd, 0, 0, POSIX_FADV_DONTNEED);
+            close(fd);
+        }
+#endif
+    }
+
+    void bench(const std::string& packFile, const std::string& dataDir, bool cold) {
+        std::vector<std::string> names;
+        {
+            vkx::AssetPack pack;
+            pack.open(packFile);
+            for (const auto& entry : pack.entries()) {
+                names.push_back(pack.name(entry));
+            }
+        }
+
+        if (cold) {
+            for (const auto& name : names) {
+                evict(dataDir + "/" + name);
+            }
+        }
+        // Read every file the way the loaders did before
+        auto tStart = std::chrono::high_resolution_clock::now();
+        uint64_t looseBytes = 0;
+        for (const auto& name : names) {
+            looseBytes += vkx::readBinaryFile(dataDir + "/" + name).size();
+        }
+        auto tLoose = std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - tStart).count();
+
+        if (cold) {
+            evict(packFile);
+        }
+        // Map the pack and touch every page of uncompressed entries, decompress the others
+        tStart = std::chrono::high_resolution_clock::now();
+        uint64_t packBytes = 0;
+        uint32_t checksum = 0;
+        {
+            vkx::AssetPack pack;
+            pack.open(packFile);
+            std::vector<uint8_t> buffer;
+            for (const auto& entry : pack.entries()) {
+                if (const uint8_t* data = pack.map(entry)) {
+                    for (uint64_t i = 0; i < entry.size; i += 4096) {
+                        checksum += data[i];
+                    }
+                } else {
+                    buffer.resize(entry.size);
+                    pack.read(entry, buffer.data());
+                    checksum += buffer.empty() ? 0 : buffer[0];
+                }
+                packBytes += entry.size;
+            }
+        }
+        auto tPack = std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - tStart).count();
+
+        std::cout << std::fixed << std::setprecision(2);
+        std::cout << (cold ? "Cold" : "Warm") << " cache, " << names.size() << " files (checksum " << checksum << ")" << std::endl;
+        std::cout << "  loose files: " << tLoose << " ms, " << (looseBytes / 1048576.0) / (tLoose / 1000.0) << " MB/s" << std::endl;
+        std::cout << "  asset pack:  " << tPack << " ms, " << (packBytes / 1048576.0) / (tPack / 1000.0) << " MB/s" << std::endl;
+    }
+
+    void usage() {
+        std::cout << "Usage:" << std::endl;
+        std::cout << "  assetpack build <data folder> <pack file> [--lz4 auto|all|none] [--mips box|kaiser]" << std::endl;
+        std::cout << "  assetpack list <pack file>" << std::endl;
+        std::cout << "  assetpack bench <pack file> <data folder> [--cold]" << std::endl;
+    }
+}
+
+int main(int argc, char* argv[]) {
+    std::vector<std::string> args(argv + 1, argv + argc);
+    try {
+        if (args.size() >= 3 && args[0] == "build") {
+            Compression compression = Compression::Auto;
+            bool mips = false;
+            vkx::mipmap::Filter mipFilter = vkx::mipmap::Filter::Box;
+            for (size_t i = 3; i + 1 < args.size(); i += 2) {
+                if (args[i] == "--lz4") {
+                    if (args[i + 1] == "all") {
+                        compression = Compression::All;
+                    } else if (args[i + 1] == "none") {
+                        compression = Compression::None;
+                    }
+                } else if (args[i] == "--mips") {
+                    mips = true;
+                    if (args[i + 1] == "kaiser") {
+                        mipFilter = vkx::mipmap::Filter::Kaiser;
+                    }
+                }
+            }
+            build(args[1], args[2], compression, mips, mipFilter);
+        } else if (args.size() == 2 && args[0] == "list") {
+            list(args[1]);
+        } else if (args.size() >= 3 && args[0] == "bench") {
+            bool cold = args.size() == 4 && args[3] == "--cold";
+            bench(args[1], args[2], cold);
+        } else {
+            usage();
+            return 1;
+        }
+    } catch (const std::exception& e) {
+        std::cerr << e.what() << std::endl;
+        return 1;
+    }
+    return 0;
+}
@@ -0,0 +1,204 @@
+/*
+* Easing benchmark
+*
+* Measures the throughput of the batch easing evaluation against one call of the scalar
+* templates per property, and the maximum error of every curve against a double precision
+* reference.
+*
+*   easingbench [millions of properties per frame] [frames]
+*
+* This code is licensed under the MIT license (MIT) (http://opensource.org/licenses/MIT)
+*/
+
+#include <stdint.h>
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <iomanip>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include "easings.hpp"
+
+namespace {
+    const double PI_D = 3.141592653589793;
+
+    typedef double(*Reference)(double);
+    typedef void(*Batch)(const float*, float*, size_t, float, float, float);
+    typedef void(*PerCall)(const float*, float*, size_t, float, float, float);
+
+    double quad(double x) { return x * x; }
+    double cubic(double x) { return x * x * x; }
+    double quart(double x) { return x * x * x * x; }
+    double quint(double x) { return x * x * x * x * x; }
+    double circ(double x) { return 1.0 - std::sqrt(1.0 - x * x); }
+    double back(double x) { return x * x * (2.70158 * x - 1.70158); }
+    double backScaled(double x) { const double s = 1.70158 * 1.525; return x * x * ((s + 1.0) * x - s); }
+    double sine(double x) { return 1.0 - std::cos(x * PI_D / 2.0); }
+    double expo(double x) { return x == 0.0 ? 0.0 : std::pow(2.0, 10.0 * (x - 1.0)); }
+    double bounceOut(double x) {
+        if (x < 1 / 2.75) {
+            return 7.5625 * x * x;
+        } else if (x < 2 / 2.75) {
+            x -= 1.5 / 2.75;
+            return 7.5625 * x * x + 0.75;
+        } else if (x < 2.5 / 2.75) {
+            x -= 2.25 / 2.75;
+            return 7.5625 * x * x + 0.9375;
+        }
+        x -= 2.625 / 2.75;
+        return 7.5625 * x * x + 0.984375;
+    }
+    double elasticIn(double x) {
+        if (x == 0.0 || x == 1.0) {
+            return x;
+        }
+        const double p = 0.3, s = p / 4.0;
+        return -std::pow(2.0, 10.0 * (x - 1.0)) * std::sin((x - 1.0 - s) * 2.0 * PI_D / p);
+    }
+    double elasticInOut(double x) {
+        if (x == 0.0 || x == 1.0) {
+            return x;
+        }
+        const double p = 0.45, s = p / 4.0;
+        double t = 2.0 * x - 1.0;
+        if (t < 0.0) {
+            return -0.5 * std::pow(2.0, 10.0 * t) * std::sin((t - s) * 2.0 * PI_D / p);
+        }
+        return 0.5 * std::pow(2.0, -10.0 * t) * std::sin((t - s) * 2.0 * PI_D / p) + 1.0;
+    }
+
+    // The scalar template inlined into the loop, like the examples call it per object
+    template <float(*Easing)(float, float, float, float)>
+    void perCall(const float* t, float* values, size_t count, float d, float b, float c) {
+        for (size_t i = 0; i < count; ++i) {
+            values[i] = Easing(t[i], d, b, c);
+        }
+    }
+
+    template <Reference In>
+    double out(double x) { return 1.0 - In(1.0 - x); }
+
+    template <Reference In>
+    double inOut(double x) { return x < 0.5 ? In(2.0 * x) / 2.0 : 1.0 - In(2.0 - 2.0 * x) / 2.0; }
+
+    struct Case {
+        const char* name;
+        Batch batch;
+        Reference reference;
+        // One call of the scalar template per property, where the tree has one to compare with
+        PerCall perCall;
+    };
+
+#define EASING_CASE(NAME, REFERENCE) { #NAME, easings::evaluate<easings::curves::NAME>, REFERENCE, nullptr }
+#define EASING_CASE_SCALAR(NAME, REFERENCE) { #NAME, easings::evaluate<easings::curves::NAME>, REFERENCE, perCall<easings::NAME<float>> }
+
+    const Case CASES[] = {
+        EASING_CASE_SCALAR(inQuad, quad),
+        EASING_CASE_SCALAR(outQuad, out<quad>),
+        EASING_CASE_SCALAR(inOutQuad, inOut<quad>),
+        EASING_CASE_SCALAR(inCubic, cubic),
+        EASING_CASE_SCALAR(outCubic, out<cubic>),
+        EASING_CASE_SCALAR(inOutCubic, inOut<cubic>),
+        EASING_CASE_SCALAR(inQuart, quart),
+        EASING_CASE_SCALAR(outQuart, out<quart>),
+        EASING_CASE_SCALAR(inOutQuart, inOut<quart>),
+        EASING_CASE_SCALAR(inQuint, quint),
+        EASING_CASE_SCALAR(outQuint, out<quint>),
+        EASING_CASE_SCALAR(inOutQuint, inOut<quint>),
+        EASING_CASE_SCALAR(inCirc, circ),
+        EASING_CASE_SCALAR(outCirc, out<circ>),
+        EASING_CASE_SCALAR(inOutCirc, inOut<circ>),
+        EASING_CASE(inBack, back),
+        EASING_CASE(outBack, out<back>),
+        EASING_CASE(inOutBack, inOut<backScaled>),
+        EASING_CASE(inBounce, out<bounceOut>),
+        EASING_CASE(outBounce, bounceOut),
+        EASING_CASE(inOutBounce, inOut<out<bounceOut>>),
+        EASING_CASE_SCALAR(inSine, sine),
+        EASING_CASE_SCALAR(outSine, out<sine>),
+        EASING_CASE_SCALAR(inOutSine, inOut<sine>),
+        EASING_CASE_SCALAR(inExpo, expo),
+        EASING_CASE_SCALAR(outExpo, out<expo>),
+        EASING_CASE_SCALAR(inOutExpo, inOut<expo>),
+        EASING_CASE(inElastic, elasticIn),
+        EASING_CASE(outElastic, out<elasticIn>),
+        EASING_CASE(inOutElastic, elasticInOut),
+    };
+
+#undef EASING_CASE
+#undef EASING_CASE_SCALAR
+
+    // Best of the frames, in ms
+    template <typename F>
+    double time(uint32_t frames, F f) {
+        double best = 1e30;
+        for (uint32_t frame = 0; frame < frames; ++frame) {
+            auto tStart = std::chrono::high_resolution_clock::now();
+            f();
+            auto tEnd = std::chrono::high_resolution_clock::now();
+            best = std::min(best, std::chrono::duration<double, std::milli>(tEnd - tStart).count());
+        }
+        return best;
+    }
+}
+
+int main(int argc, char* argv[]) {
+    size_t properties = (size_t)((argc > 1 ? std::stod(argv[1]) : 4.0) * 1000000.0);
+    uint32_t frames = argc > 2 ? (uint32_t)std::stoul(argv[2]) : 10;
+    if (properties == 0 || frames == 0) {
+        std::cerr << "usage: easingbench [millions of properties per frame] [frames]" << std::endl;
+        return 1;
+    }
+
+    // Every property animates over 2 seconds with its own start time
+    const float duration = 2.0f, start = 10.0f, change = -4.0f;
+    std::vector<float> times(properties);
+    for (size_t i = 0; i < properties; ++i) {
+        times[i] = duration * (float)((i * 2654435761u) % 65536) / 65535.0f;
+    }
+    std::vector<float> values(properties);
+
+    // Error samples, including both ends of every table interval
+    std::vector<float> errorTimes(256 * 64 + 1);
+    for (size_t i = 0; i < errorTimes.size(); ++i) {
+        errorTimes[i] = (float)i / (float)(errorTimes.size() - 1);
+    }
+    std::vector<float> errorValues(errorTimes.size());
+
+#if defined(EASINGS_AVX)
+    const char* path = "AVX";
+#elif defined(EASINGS_SSE)
+    const char* path = "SSE";
+#else
+    const char* path = "scalar";
+#endif
+    std::cout << properties << " properties per frame, best of " << frames << " frames, batch path: " << path << std::endl;
+    std::cout << std::left << std::setw(14) << "curve" << std::right << std::setw(14) << "batch ms" << std::setw(14) << "Mprops/s"
+        << std::setw(14) << "per call ms" << std::setw(14) << "max error" << std::endl;
+
+    for (const Case& c : CASES) {
+        double batchTime = time(frames, [&] { c.batch(times.data(), values.data(), properties, duration, start, change); });
+        std::string perCallTime = "-";
+        if (c.perCall) {
+            double ms = time(frames, [&] { c.perCall(times.data(), values.data(), properties, duration, start, change); });
+            std::ostringstream ss;
+            ss << std::fixed << std::setprecision(2) << ms;
+            perCallTime = ss.str();
+        }
+
+        c.batch(errorTimes.data(), errorValues.data(), errorTimes.size(), 1.0f, 0.0f, 1.0f);
+        double maxError = 0.0;
+        for (size_t i = 0; i < errorTimes.size(); ++i) {
+            maxError = std::max(maxError, std::abs(errorValues[i] - c.reference(errorTimes[i])));
+        }
+
+        std::cout << std::left << std::setw(14) << c.name << std::right << std::fixed << std::setprecision(2)
+            << std::setw(14) << batchTime << std::setw(14) << properties / (batchTime * 1000.0)
+            << std::setw(14) << perCallTime << std::setw(14) << std::scientific << std::setprecision(1) << maxError << std::endl;
+    }
+    return 0;
+}
@@ -0,0 +1,135 @@
+/*
+* Tesselation benchmark
+*
+* Measures every subdivision level of the five platonic solids with geometry::tesselate and
+* geometry::tesselateParallel: time of the level, size of the resulting mesh and the peak heap
+* usage while the level is built, which includes the midpoint tables.  The parallel time includes
+* starting the thread pool, as every call to tesselateParallel does.
+*
+*   shapebench [levels] [threads] [repeats]
+*
+* This code is licensed under the MIT license (MIT) (http://opensource.org/licenses/MIT)
+*/
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdlib.h>
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <iomanip>
+#include <iostream>
+#include <new>
+#include <string>
+#include <thread>
+
+#include "shapes.h"
+
+namespace {
+    // Heap usage of the whole process, every allocation carries its size in front of it
+    std::atomic<size_t> heapBytes{ 0 };
+    std::atomic<size_t> heapPeak{ 0 };
+    const size_t HEADER = alignof(max_align_t);
+
+    void resetPeak() {
+        heapPeak = heapBytes.load();
+    }
+
+    struct Result {
+        double ms{ 1e30 };
+        size_t peakBytes{ 0 };
+        geometry::Solid<3> solid;
+    };
+
+    // Best time of the repeats, the peak is the growth of the heap over the level's input
+    template <typename F>
+    Result measure(uint32_t repeats, F f) {
+        Result result;
+        for (uint32_t i = 0; i < repeats; ++i) {
+            size_t base = heapBytes;
+            resetPeak();
+            auto tStart = std::chrono::high_resolution_clock::now();
+            geometry::Solid<3> solid = f();
+            auto tEnd = std::chrono::high_resolution_clock::now();
+            result.ms = std::min(result.ms, std::chrono::duration<double, std::milli>(tEnd - tStart).count());
+            result.peakBytes = std::max(result.peakBytes, heapPeak - base);
+            result.solid = std::move(solid);
+        }
+        return result;
+    }
+}
+
+void* operator new(size_t size) {
+    uint8_t* block = (uint8_t*)malloc(size + HEADER);
+    if (!block) {
+        throw std::bad_alloc();
+    }
+    *(size_t*)block = size;
+    size_t bytes = heapBytes.fetch_add(size) + size;
+    size_t peak = heapPeak.load();
+    while (bytes > peak && !heapPeak.compare_exchange_weak(peak, bytes)) {
+    }
+    return block + HEADER;
+}
+
+void operator delete(void* memory) noexcept {
+    if (memory) {
+        uint8_t* block = (uint8_t*)memory - HEADER;
+        heapBytes.fetch_sub(*(size_t*)block);
+        free(block);
+    }
+}
+
+void operator delete(void* memory, size_t) noexcept {
+    operator delete(memory);
+}
+
+int main(int argc, char* argv[]) {
+    int levels = argc > 1 ? std::stoi(argv[1]) : 7;
+    uint32_t threads = argc > 2 ? (uint32_t)std::stoul(argv[2]) : std::max(1u, std::thread::hardware_concurrency());
+    uint32_t repeats = argc > 3 ? (uint32_t)std::stoul(argv[3]) : 5;
+    if (levels <= 0 || threads == 0 || repeats == 0) {
+        std::cerr << "usage: shapebench [levels] [threads] [repeats]" << std::endl;
+        return 1;
+    }
+
+    struct Case {
+        const char* name;
+        geometry::Solid<3> solid;
+    };
+    const Case cases[] = {
+        { "tetrahedron", geometry::tetrahedron() },
+        { "cube", geometry::triangulate(geometry::cube()) },
+        { "octahedron", geometry::octahedron() },
+        { "dodecahedron", geometry::triangulate(geometry::dodecahedron()) },
+        { "icosahedron", geometry::icosahedron() },
+    };
+
+    std::cout << levels << " levels, " << threads << " threads, best of " << repeats << std::endl;
+    std::cout << std::left << std::setw(14) << "solid" << std::right << std::setw(6) << "level" << std::setw(10) << "vertices"
+        << std::setw(10) << "faces" << std::setw(11) << "mesh KB" << std::setw(11) << "serial ms" << std::setw(11) << "peak KB"
+        << std::setw(13) << "parallel ms" << std::setw(11) << "peak KB" << std::endl;
+    int exitCode = 0;
+    for (const Case& c : cases) {
+        geometry::Solid<3> input = c.solid;
+        for (int level = 1; level <= levels; ++level) {
+            Result serial = measure(repeats, [&] { return geometry::tesselate(input, 1); });
+            // No minimum face count, every level is split across the threads
+            Result parallel = measure(repeats, [&] { return geometry::tesselateParallel(input, 1, threads, 0); });
+
+            const geometry::Solid<3>& solid = serial.solid;
+            if (parallel.solid.vertices.size() != solid.vertices.size() || parallel.solid.faces.size() != solid.faces.size()) {
+                std::cerr << c.name << " level " << level << ": the parallel mesh differs" << std::endl;
+                exitCode = 1;
+            }
+            size_t meshBytes = solid.vertices.size() * sizeof(geometry::Vec) + solid.faces.size() * sizeof(geometry::Face<3>);
+            std::cout << std::left << std::setw(14) << c.name << std::right << std::setw(6) << level << std::setw(10) << solid.vertices.size()
+                << std::setw(10) << solid.faces.size() << std::fixed << std::setprecision(1) << std::setw(11) << meshBytes / 1024.0
+                << std::setprecision(3) << std::setw(11) << serial.ms << std::setprecision(1) << std::setw(11) << serial.peakBytes / 1024.0
+                << std::setprecision(3) << std::setw(13) << parallel.ms << std::setprecision(1) << std::setw(11) << parallel.peakBytes / 1024.0 << std::endl;
+            input = std::move(serial.solid);
+        }
+    }
+    return exitCode;
+}